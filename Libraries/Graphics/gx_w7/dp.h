@@ -461,7 +461,8 @@ GLOBAL gxPattern     gx_Fill_pattern;             // 0 - MAX_PATTERNS-1
 |__________________*/
 
 GLOBAL gxRectangle   gx3d_Viewport;
-GLOBAL gx3dMatrix    gx3d_View_matrix;
+// Default view context (view_matrix is always valid, the rest is updated on demand - see below)
+GLOBAL gx3dViewContext gx3d_View_context;
 
 GLOBAL float         gx3d_Projection_hfov;        // horizontal field of view in degress (0.1 - 179.9)
 GLOBAL float         gx3d_Projection_vfov;        // vertical field of view in degress (0.1 - 179.9)
@@ -481,13 +482,11 @@ GLOBAL char          gx3d_Texture_Directory[256]; // directory to load textures
 // Functions using these globals test the dirty flag and update if dirty
 // These globals are not always updated since that would not be efficient
 
-// (View * Projection) matrix
-GLOBAL gx3dMatrix gx3d_View_projection_matrix;
+// (View * Projection) matrix (gx3d_View_context.projection_matrix and view_projection_matrix)
 GLOBAL bool       gx3d_View_projection_matrix_dirty;
 
-// View frustrum data
-GLOBAL gx3dViewFrustum gx3d_View_frustum;
-GLOBAL bool            gx3d_View_frustum_dirty;
+// View frustrum data (gx3d_View_context.frustum)
+GLOBAL bool       gx3d_View_frustum_dirty;
 
 #ifdef DEBUG
 static char debug_str [256];
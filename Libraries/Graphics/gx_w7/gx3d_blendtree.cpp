@@ -27,6 +27,13 @@
 
 #include "dp.h"
 
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define MATRIX_BATCH 64   // # bone matrices built with one call to gx3d_GetQuaternionMatrices()
+
 /*___________________
 |
 | Function prototypes
@@ -265,9 +272,12 @@ void gx3d_BlendTree_Set_Output (gx3dBlendTree *blendtree, gx3dObjectLayer *objec
 
 void gx3d_BlendTree_Update (gx3dBlendTree *blendtree, gx3dVector *new_position)
 {
-  int i, parent, index;
-  gx3dMatrix m, mt;
+  int i, j, n, parent, index;
+  gx3dAffineMatrix a, b;
   gx3dBlendNode *np;
+  gx3dQuaternionStream q;
+  float qx[MATRIX_BATCH], qy[MATRIX_BATCH], qz[MATRIX_BATCH], qw[MATRIX_BATCH];
+  gx3dMatrix mq[MATRIX_BATCH];
 
 /*____________________________________________________________________
 |
@@ -295,37 +305,49 @@ void gx3d_BlendTree_Update (gx3dBlendTree *blendtree, gx3dVector *new_position)
 | Update each global bone pose
 |___________________________________________________________________*/
 
-  // Output to global pose - convert each local bone pose into global poses (matrices)
+  q.x = qx;
+  q.y = qy;
+  q.z = qz;
+  q.w = qw;
+
+  // Output to global pose - convert each local bone pose into global poses (local and composite matrices)
   for (i=0; i<blendtree->skeleton->num_bones; i++) {
-    // Build a matrix from the quaternion
-    gx3d_GetQuaternionMatrix (&(blendtree->local_pose->bone_pose[i].q), &m);
-    gx3d_MultiplyMatrix (&(blendtree->skeleton->bones[i].pre), &m, &m);
-    gx3d_MultiplyMatrix (&m, &(blendtree->skeleton->bones[i].post), &m);
+    // Build matrices from the quaternions of the next batch of bones
+    j = i % MATRIX_BATCH;
+    if (j == 0) {
+      n = blendtree->skeleton->num_bones - i;
+      if (n > MATRIX_BATCH)
+        n = MATRIX_BATCH;
+      for (j=0; j<n; j++) {
+        qx[j] = blendtree->local_pose->bone_pose[i+j].q.x;
+        qy[j] = blendtree->local_pose->bone_pose[i+j].q.y;
+        qz[j] = blendtree->local_pose->bone_pose[i+j].q.z;
+        qw[j] = blendtree->local_pose->bone_pose[i+j].q.w;
+      }
+      gx3d_GetQuaternionMatrices (&q, mq, n);
+      j = 0;
+    }
+    // Local matrix = pre * rotation * post
+    gx3d_MatrixToAffineMatrix (&mq[j], &b);
+    gx3d_MultiplyAffineMatrix (&(blendtree->skeleton->bones[i].pre), &b, &a);
+    gx3d_MultiplyAffineMatrix (&a, &(blendtree->skeleton->bones[i].post), &a);
+    parent = blendtree->skeleton->bones[i].parent;
     // If root bone, translate also
-    if (blendtree->skeleton->bones[i].parent == 0xFF) {
-      gx3d_GetTranslateMatrix (&mt, blendtree->local_pose->root_translate.x, blendtree->local_pose->root_translate.y, blendtree->local_pose->root_translate.z); 
-      gx3d_MultiplyMatrix (&m, &mt, &m);
+    if (parent == 0xFF) {
+      a._30 += blendtree->local_pose->root_translate.x;
+      a._31 += blendtree->local_pose->root_translate.y;
+      a._32 += blendtree->local_pose->root_translate.z;
       // Send root bone position back to caller?
       if (new_position)
         *new_position = blendtree->local_pose->root_translate;
     }
-    blendtree->global_pose->bone_pose[i].transform.local_matrix = m;
-  }
+    blendtree->global_pose->bone_pose[i].transform.local_matrix = a;
 
-/*____________________________________________________________________
-|
-| Walk the tree and update all composite matrices
-|___________________________________________________________________*/
-
-  for (i=0; i<blendtree->skeleton->num_bones; i++) {
-    parent = blendtree->skeleton->bones[i].parent;
+    // Composite matrix = local * parent matrix (parent bones come before their children so it's already computed)
     if (parent == 0xFF)
-      blendtree->global_pose->bone_pose[i].transform.composite_matrix = blendtree->global_pose->bone_pose[i].transform.local_matrix;
+      blendtree->global_pose->bone_pose[i].transform.composite_matrix = a;
     else 
-      // Composite matrix = local * parent matrix
-      gx3d_MultiplyMatrix (&(blendtree->global_pose->bone_pose[i].transform.local_matrix),
-                           &(blendtree->global_pose->bone_pose[parent].transform.composite_matrix),
-                           &(blendtree->global_pose->bone_pose[i].transform.composite_matrix));
+      gx3d_MultiplyAffineMatrix (&a, &(blendtree->global_pose->bone_pose[parent].transform.composite_matrix), &(blendtree->global_pose->bone_pose[i].transform.composite_matrix));
   }
 
 /*____________________________________________________________________
@@ -337,6 +359,6 @@ void gx3d_BlendTree_Update (gx3dBlendTree *blendtree, gx3dVector *new_position)
     for (i=0; i<blendtree->skeleton->num_bones; i++) {
       index = blendtree->target_matrix_palette_index[i];
       if (index != -1)
-        blendtree->target_objectlayer->matrix_palette[index].m = blendtree->global_pose->bone_pose[i].transform.composite_matrix;
+        gx3d_AffineMatrixToMatrix (&(blendtree->global_pose->bone_pose[i].transform.composite_matrix), &(blendtree->target_objectlayer->matrix_palette[index].m));
     }
 }
@@ -5,25 +5,89 @@
 | Description: Functions to manipulate gx3dBoxtree.
 |
 | Functions: gx3d_Boxtree_Init        
+|            gx3d_Boxtree_Init_Prebuilt
 |             Init_Static_Boxtree
 |              Get_Static_Geometry
+|              Attach_Tree
 |              Get_Static_Bound_Box        
-|              Make_Static_Tree
-|               Subdivide_Static_Subtree
-|                Make_Node
-|                Get_Best_Split
-|                Shrink_To_Fit
-|             Init_Dynamic_Boxtree        // not done
-|              Get_Dynamic_Geometry       // not done
-|              Make_Dynamic_Tree          // not done
+|              Make_Tree
+|               Get_Num_Build_Threads
+|               Get_Build_Threads
+|                Free_Build_Threads
+|               Subdivide_Subtree
+|                Partition_Mean
+|                 Get_Best_Split
+|                Partition_SAH
+|                 Get_SAH_Split
+|                  Get_Bins
+|                   Bin_Polys
+|                    Get_Bin
+|                   Add_Bin_Task
+|                   Run_Bin_Task
+|                   End_Bin_Task
+|                  Surface_Area
+|                Partition_Polys
+|                 Get_Center
+|                Get_Poly_Range_Box
+|                Add_Subtree_Task
+|               Build_Chunk
+|                Run_Build_Tasks
+|                 Run_Build_Task
+|                  End_Subtree_Task
+|                  End_Bin_Task
+|               Pack_Subtree
+|               Reorder_Polys
+|             Init_Dynamic_Boxtree
+|              Get_Dynamic_Geometry
+|              Transform_Dynamic_Vertices
+|              Get_Dynamic_Bound_Box
+|              Make_Dynamic_Tree
+|               Get_Tree_Area
+|              Refit_Tree
 |            gx3d_Boxtree_Free
-|             Free_Subtree
+|            gx3d_Boxtree_FreeThreads
+|             Free_Build_Threads
+|            gx3d_Boxtree_GetStats
+|             Get_Subtree_Stats
 |            gx3d_Boxtree_SetDirty
 |            gx3d_Boxtree_Update
-|             Update_Static_BoxTree
-|             Update_Dynamic_BoxTree      // not done
+|             Update_Static_Boxtree
+|             Update_Dynamic_Boxtree
+|              Refit_Tree
 |            gx3d_Boxtree_Intersect_Ray
-|             Subtree_Intersect_Ray
+|             Intersect_Ray
+|              Get_Inverse_Direction
+|              Get_Vertex
+|            gx3d_Boxtree_Intersect_Rays
+|             Rays_Coherent
+|             Intersect_Packet_SSE
+|              Intersect_Packet_Node_SSE
+|              Get_Packet_Distance
+|              Intersect_Packet_Polys
+|             Intersect_Packet_AVX
+|              Intersect_Packet_Node_AVX
+|            gx3d_Boxtree_Intersect_Ray_Any
+|             Intersect_Ray_Any
+|            gx3d_Boxtree_Intersect_Rays_Any
+|             Intersect_Ray_Any
+|            gx3d_Boxtree_Intersect_Sphere
+|             Set_Contact
+|            gx3d_Boxtree_Intersect_Capsule
+|             Expand_Box
+|             Nearest_Segment_Triangle
+|              Nearest_Segment_Segment
+|               Clamp
+|            gx3d_Boxtree_Collide_Sphere
+|            gx3d_Boxtree_Nearest_Point
+|            gx3d_Boxtree_Intersect_Boxtree
+|             Init_Pair_Context
+|             Intersect_Boxtree
+|              Overlap_Node_Node
+|              Intersect_Leaf_Leaf
+|               Boxes_Overlap
+|            gx3d_Boxtree_Intersect_Boxtree_Any
+|             Init_Pair_Context
+|             Intersect_Boxtree
 |
 | Description: A boxtree is an AABB hierarchy used for collision 
 |   detection that is similar to a BSP tree.  Geometry is split
@@ -43,11 +107,42 @@
 |   memory.  A dynamic boxtree has copies of vertices and so uses more
 |   memory.
 |
+|   Two build methods are available.  The mean build splits the largest
+|   axis of a node at the mean of its poly centers, down to a fixed depth.
+|   The SAH build evaluates a set of binned split candidates on all 3 axes
+|   using the surface area heuristic and stops splitting when a leaf is
+|   cheaper to test than its best split, so leaves stay small on large
+|   meshes.  gx3d_Boxtree_GetStats() reports the quality of either tree.
+|
+|   The bsp tree is stored as a single array of 32-byte nodes in 
+|   depth-first order, so the left child of a nonterminal node is the 
+|   next node and only the right child needs an offset.  The poly arrays
+|   of the boxtree are reordered when the tree is built so each terminal
+|   node refers to a contiguous range of polys.
+|
 |   The boxtree update function is useful if the actual geometry of a 
 |   model changes.  For example if gx3d_TransformObject() or
 |   gx3d_TransformObjectLayer() were called on an object.  In this case
-|   the boxtree needs to be recomputed from scratch (either static or
-|   dynamic).
+|   a static boxtree needs to be recomputed from scratch.
+|
+|   A dynamic boxtree is updated only if it has been set dirty.  Its 
+|   vertices are recopied from the object layers (using the skinned/morphed
+|   vertices, if any) and transformed by each layer's composite matrix, so 
+|   they are current as of the last gx3d_Object_UpdateTransforms().  The
+|   boxes of the bsp tree are then refit bottom-up, which is O(n) and much
+|   cheaper than a rebuild.  Refitting doesn't change the topology of the 
+|   tree, so as geometry deforms the boxes grow and the tree gets slower to
+|   query.  The growth in total box area is tracked against the time it 
+|   took to build the tree, and the tree is rebuilt only when the time 
+|   lost to the degraded tree exceeds the cost of a rebuild.
+|
+|   Boxtrees built with more than one thread share a pool of worker 
+|   threads (see gx3d_jobpool.cpp) that is started by the first such
+|   build and kept for later builds and rebuilds, so a build doesn't pay
+|   to start threads.  Only one build uses the pool at a time; if 
+|   another thread is already building a tree, the build runs on the
+|   calling thread.  Call gx3d_Boxtree_FreeThreads() at shutdown to stop
+|   the pool.
 |
 | (C) Copyright 2017 Abonvita Software LLC.
 | Licensed under the GX Toolkit License, Version 1.0.
@@ -65,9 +160,13 @@
 #include <first_header.h>
 
 #include <math.h>
+#include <xmmintrin.h>
+#include <immintrin.h>
 
 #include "dp.h"
 
+#include "gx3d_jobpool.h"
+
 /*___________________
 |
 | Constants
@@ -79,47 +178,378 @@
 
 #define MAX_LEVEL 8 // don't subdivide past this level (root is level 1)
 
+// SAH build
+#define SAH_NUM_BINS        16    // # split candidates evaluated per axis
+#define SAH_TRAVERSAL_COST  1.0f  // relative cost of visiting a node
+#define SAH_INTERSECT_COST  1.0f  // relative cost of testing a poly
+#define SAH_MAX_LEAF_POLYS  8     // always try to split a node with more polys than this
+#define SAH_MAX_LEVEL       64    // safety limit (root is level 1)
+
+// Multi-threaded build
+#define MAX_BUILD_THREADS         MAX_JOBPOOL_THREADS
+#define PARALLEL_MIN_TASK_POLYS   4096   // build subtrees with fewer polys than this on the same thread
+#define PARALLEL_MIN_BIN_POLYS    32768  // min # polys per thread to bin a node in parallel
+
+// Build task types
+#define BUILD_TASK_SUBTREE  0
+#define BUILD_TASK_BOUNDS   1
+#define BUILD_TASK_BINS     2
+
+// Ray intersection
+#define INV_DIRECTION_MAX   1e30f // used as reciprocal of a 0 ray direction component
+#define PACKET_MIN_COHERENCE 0.9f // min cosine between ray directions in a packet
+#define CONTACT_MIN_DISTANCE 0.001f // (fraction of radius) closer than this the poly normal is used as contact normal
+
+// Nearest point
+#define NEAREST_MAX_DISTANCE 1e30f // squared distance used when there is no max distance
+
+// Boxtree vs. boxtree
+#define PAIR_MIN_AXIS       1e-6f   // (relative, squared) shorter cross product axes are not used as separating axes
+#define PAIR_BOX_TOLERANCE  1.0001f // node boxes are enlarged by this factor so rounding can't miss touching polys
+
+// Dynamic boxtree update
+#define DYNAMIC_MAX_GROWTH  4.0f  // always rebuild when total box area grows past this multiple of the area at build
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+// Poly center bounds and bins of a node (or part of a node)
+typedef struct {
+  float   cmin[3], cmax[3];               // bounds of poly centers on each axis
+  int     count[3][SAH_NUM_BINS];         // # polys in each bin on each axis
+  gx3dBox box[3][SAH_NUM_BINS];           // box enclosing polys in each bin on each axis
+} Bin_Data;
+
+// Unit of work for a build thread
+typedef struct {
+  int            type;                    // BUILD_TASK_SUBTREE, BUILD_TASK_BOUNDS or BUILD_TASK_BINS
+  int            node;                    // (subtree) index of subtree node
+  int            first;                   // index of first poly in poly_index
+  int            num_polys;
+  int            level;                   // (subtree) level at subtree
+  float         *bin_scale;               // (bins) converts poly center to bin # on each axis
+  Bin_Data      *bins;                    // (bounds, bins) results
+  volatile LONG *remaining;               // (bounds, bins) # chunks of node not binned yet
+  HANDLE         done;                    // (bounds, bins) signaled when remaining reaches 0
+} Build_Task;
+
+// Worker threads shared by all multi-threaded builds (see Get_Build_Threads())
+typedef struct {
+  gx3dJobPool     *pool;
+  volatile LONG    busy;                  // 1 while a build is using the threads
+  HANDLE           semaphore;             // signaled for each task added
+  HANDLE           event[MAX_BUILD_THREADS]; // signaled when the chunks of a node are binned (one per waiting thread)
+} Build_Threads;
+
+// Data shared by all threads building a bsp tree
+typedef struct {
+  gx3dBoxtree     *boxtree;
+  unsigned        *poly_index;            // polys in bsp tree order
+  int              num_threads;
+  // Worker threads (only used if num_threads > 1)
+  HANDLE           semaphore;             // signaled for each task added
+  CRITICAL_SECTION critical_section;      // guards all members below
+  HANDLE           event[MAX_BUILD_THREADS]; // events not in use by Get_Bins()
+  int              num_events;
+  Build_Task      *task;                  // stack of tasks not yet started
+  int              num_tasks;
+  int              max_tasks;
+  int              num_pending;           // # subtree tasks not finished
+  bool             done;                  // true when all subtrees are built
+} Build_Context;
+
+// Bsp tree built earlier (see gx3d_Boxtree_Init_Prebuilt())
+typedef struct {
+  gx3dBoxtreeNode *node;                  // array of nodes (depth-first order)
+  int              num_nodes;
+  gx3dPolygon     *poly;                  // array of polygons in bsp tree order
+  int              num_polygons;
+  float            build_time;            // time (ms) it took to build the tree
+} Prebuilt_Tree;
+
+// Two boxtrees being tested against each other (see gx3d_Boxtree_Intersect_Boxtree())
+typedef struct {
+  gx3dBoxtree         *boxtree1;
+  gx3dBoxtree         *boxtree2;
+  gx3dMatrix           transform;         // boxtree2 object space to boxtree1 object space
+  float                row_length[3];     // squared length of each row of upper 3x3 part of transform
+  // Separating axes between a node box of boxtree1 and a (transformed) node box of boxtree2
+  int                  num_axes;
+  float                axis[15][3];       // in boxtree1 object space
+  float                abs_axis[15][3];   // absolute values of axis components
+  float                abs_row[15][3];    // absolute dot products of axis with each row of transform
+  // Results
+  gx3dBoxtreePolyPair *pairs;             // NULL if not needed
+  int                  max_pairs;
+  int                  num_pairs;
+  bool                 first_only;        // stop at the first pair found
+} Pair_Context;
+
+// A node of boxtree1 and a node of boxtree2 waiting to be tested (see Intersect_Boxtree())
+typedef struct {
+  int node1;
+  int node2;
+} Node_Pair;
+
+/*___________________
+|
+| Global variables
+|__________________*/
+
+static Build_Threads *Threads = 0;   // worker threads for multi-threaded builds, if started
+
 /*___________________
 |
 | Function Prototypes
 |__________________*/
 
-static gx3dBoxtree *Init_Static_Boxtree  (gx3dObject *object);
+static gx3dBoxtree *Init_Static_Boxtree  (gx3dObject *object, gx3dBoxtreeBuild build, int num_threads, Prebuilt_Tree *prebuilt);
 static void         Get_Static_Geometry  (gx3dObjectLayer *layer, gx3dBoxtree *boxtree);
 static void         Get_Static_Bound_Box (gx3dBoxtree *boxtree);
-static bool         Make_Static_Tree     (gx3dBoxtree *boxtree);
-static bool Subdivide_Static_Subtree (
-  gx3dBoxtree     *boxtree, 
-  gx3dBoxtreeNode *subtree, 
-  int              level ); // level at subtree (root is level 1)
-static gx3dBoxtreeNode *Make_Node (int num_polys);
-static float Get_Best_Split (gx3dBoxtree *boxtree, gx3dBoxtreeNode *node, char axis);
-static bool Shrink_To_Fit (gx3dBoxtreeNode *node, int current_size);
-static gx3dBoxtree *Init_Dynamic_Boxtree (gx3dObject *object);
-static void         Get_Dynamic_Geometry (gx3dObjectLayer *layer, gx3dBoxtree *boxtree, int *n);
+static bool         Make_Tree            (gx3dBoxtree *boxtree);
+static bool         Attach_Tree          (gx3dBoxtree *boxtree, Prebuilt_Tree *prebuilt);
+static int          Get_Num_Build_Threads (gx3dBoxtree *boxtree);
+static Build_Threads *Get_Build_Threads  ();
+static void         Free_Build_Threads   (Build_Threads *threads);
+static void Subdivide_Subtree (
+  Build_Context *context,
+  int            node,        // index of subtree node
+  int            first,       // index of first poly in poly_index
+  int            num_polys,
+  int            level );     // level at subtree (root is level 1)
+static int Partition_Mean (
+  gx3dBoxtree *boxtree,
+  unsigned    *poly_index,
+  gx3dBox     *box,         // box of node
+  int          first,       // index of first poly in poly_index
+  int          num_polys,
+  int          level );     // level at node (root is level 1)
+static float Get_Best_Split (gx3dBoxtree *boxtree, unsigned *poly_index, int first, int num_polys, int axis);
+static int Partition_SAH (
+  Build_Context *context,
+  gx3dBox       *box,         // box of node
+  int            first,       // index of first poly in poly_index
+  int            num_polys,
+  int            level );     // level at node (root is level 1)
+static bool Get_SAH_Split (
+  Build_Context *context, 
+  gx3dBox       *box,           // box of node
+  int            first,         // index of first poly in poly_index
+  int            num_polys,
+  int           *axis,          // X_AXIS, Y_AXIS or Z_AXIS
+  int           *split_bin,     // polys in bins < split_bin go left
+  float         *bin_min,       // min poly center on axis
+  float         *bin_scale,     // converts poly center to bin #
+  float         *cost );
+static void Get_Bins (
+  Build_Context *context,
+  int            type,
+  int            first,       // index of first poly in poly_index
+  int            num_polys,
+  float         *bin_scale,   // (BUILD_TASK_BINS) converts poly center to bin # on each axis (0 = skip axis)
+  Bin_Data      *bins );
+static void Bin_Polys (
+  Build_Context *context,
+  int            type,
+  int            first,       // index of first poly in poly_index
+  int            num_polys,
+  float         *bin_scale,
+  Bin_Data      *bins );
+static int Partition_Polys (
+  gx3dBoxtree *boxtree,
+  unsigned    *poly_index,
+  int          first,       // index of first poly in poly_index
+  int          num_polys,
+  int          axis,
+  float        split,       // split position or min poly center on axis (if binning)
+  float        bin_scale,   // 0 or converts poly center to bin #
+  int          split_bin );
+static void Get_Poly_Range_Box (gx3dBoxtree *boxtree, unsigned *poly_index, int first, int num_polys, gx3dBox *box);
+static bool Reorder_Polys (gx3dBoxtree *boxtree, unsigned *poly_index);
+static void Add_Subtree_Task (Build_Context *context, int node, int first, int num_polys, int level);
+static void Add_Bin_Task (
+  Build_Context *context, 
+  int            type, 
+  int            first, 
+  int            num_polys, 
+  float         *bin_scale, 
+  Bin_Data      *bins, 
+  volatile LONG *remaining,
+  HANDLE         done );
+static bool Run_Bin_Task (Build_Context *context);
+static void End_Bin_Task (volatile LONG *remaining, HANDLE done);
+static void Build_Chunk (void *context, int chunk);
+static void Run_Build_Tasks (Build_Context *context);
+static void Run_Build_Task (Build_Context *context, Build_Task *task);
+static void End_Subtree_Task (Build_Context *context);
+static void Pack_Subtree (gx3dBoxtreeNode *node, int n, int *next);
+static inline float Get_Center (gx3dBoxtree *boxtree, int poly, int axis);
+static inline int   Get_Bin (float center, float bin_min, float bin_scale);
+static float Surface_Area (gx3dBox *box);
+static gx3dBoxtree *Init_Dynamic_Boxtree (gx3dObject *object, gx3dBoxtreeBuild build, int num_threads, Prebuilt_Tree *prebuilt);
+static void         Get_Dynamic_Geometry (gx3dObjectLayer *layer, gx3dBoxtree *boxtree);
+static void         Transform_Dynamic_Vertices (gx3dBoxtree *boxtree);
+static void         Get_Dynamic_Bound_Box      (gx3dBoxtree *boxtree);
 static bool         Make_Dynamic_Tree    (gx3dBoxtree *boxtree);
-static void         Free_Subtree         (gx3dBoxtreeNode *subtree);
+static float        Get_Tree_Area        (gx3dBoxtree *boxtree);
+static void Get_Subtree_Stats (
+  gx3dBoxtree      *boxtree, 
+  int               node,         // index of subtree node
+  int               depth,        // depth of subtree (root is depth 1)
+  float             root_area,    // surface area of root box
+  gx3dBoxtreeStats *stats );
 static void         Update_Static_Boxtree  (gx3dBoxtree *boxtree);
 static void         Update_Dynamic_Boxtree (gx3dBoxtree *boxtree);
-static void Subtree_Intersect_Ray (
-  gx3dBoxtree     *boxtree,
-  gx3dBoxtreeNode *subtree,         
-  gx3dRay         *ray,
-  float            ray_length,     
-  bool            *intersection_found,
-  gx3dVector      *intersection,
-  float           *closest_distance,
-  char           **name );
+static float        Refit_Tree             (gx3dBoxtree *boxtree);
+static float        Get_Elapsed_Time       (LARGE_INTEGER *start_time);
+static int Intersect_Ray (
+  gx3dBoxtree *boxtree,         
+  gx3dRay     *ray,
+  float        ray_length,     
+  gx3dVector  *intersection );
+static int Intersect_Ray_Any (
+  gx3dBoxtree *boxtree,
+  gx3dRay     *ray,
+  float        ray_length,
+  int         *last_poly );
+static void Get_Inverse_Direction (gx3dVector *direction, gx3dVector *inv_direction);
+static inline gx3dVector *Get_Vertex (gx3dBoxtree *boxtree, int index);
+static bool Rays_Coherent (gx3dRay *rays, int num_rays);
+static void Intersect_Packet_SSE (
+  gx3dBoxtree       *boxtree,
+  gx3dRay           *rays,
+  float             *ray_lengths,
+  int                num_rays,      // 1-4
+  gx3dBoxtreeRayHit *hits );
+static inline int Intersect_Packet_Node_SSE (
+  __m128  *origin,              // x,y,z of 4 rays
+  __m128  *inv_direction,       // x,y,z of 4 rays
+  __m128  *tmax, 
+  gx3dBox *box, 
+  __m128  *distance );
+static void Intersect_Packet_AVX (
+  gx3dBoxtree       *boxtree,
+  gx3dRay           *rays,
+  float             *ray_lengths,
+  int                num_rays,      // 1-8
+  gx3dBoxtreeRayHit *hits );
+static inline int Intersect_Packet_Node_AVX (
+  __m256  *origin,              // x,y,z of 8 rays
+  __m256  *inv_direction,       // x,y,z of 8 rays
+  __m256  *tmax, 
+  gx3dBox *box, 
+  __m256  *distance );
+static inline float Get_Packet_Distance (float *distance, int mask, int num_lanes);
+static inline void Intersect_Packet_Polys (
+  gx3dRay            *rays,
+  int                 num_rays,
+  gx3dTrianglePacket *packet,
+  int                *packet_poly,
+  int                *packet_mask,
+  float              *tmax,
+  gx3dBoxtreeRayHit  *hits );
+static void Set_Contact (
+  gx3dBoxtree        *boxtree,
+  int                 poly,
+  gx3dVector         *triangle,
+  gx3dVector         *center,
+  gx3dVector         *point,
+  float               radius,
+  gx3dBoxtreeContact *contact );
+static inline void Expand_Box (gx3dBox *box, float distance, gx3dBox *new_box);
+static float Nearest_Segment_Triangle (
+  gx3dLine   *segment, 
+  gx3dVector *triangle, 
+  gx3dVector *segment_point, 
+  gx3dVector *triangle_point );
+static float Nearest_Segment_Segment (
+  gx3dLine   *segment1, 
+  gx3dLine   *segment2, 
+  gx3dVector *point1, 
+  gx3dVector *point2 );
+static bool Init_Pair_Context (
+  Pair_Context *context,
+  gx3dBoxtree  *boxtree1,
+  gx3dMatrix   *transform1,
+  gx3dBoxtree  *boxtree2,
+  gx3dMatrix   *transform2 );
+static void Intersect_Boxtree (Pair_Context *context);
+static inline bool Overlap_Node_Node (Pair_Context *context, gx3dBox *box1, gx3dBox *box2);
+static bool Intersect_Leaf_Leaf (Pair_Context *context, gx3dBoxtreeNode *node1, gx3dBoxtreeNode *node2);
+static inline bool Boxes_Overlap (gx3dBox *box1, gx3dBox *box2);
+static inline float Clamp (float f, float min, float max);
+static inline float Min (float f1, float f2);
+static inline float Max (float f1, float f2);
 
 /*____________________________________________________________________
 |
 | Function: gx3d_Boxtree_Init
 | 
-| Output: Creates a boxtree for an object.
+| Output: Creates a boxtree for an object.  The bsp tree is built (and 
+|   rebuilt) using num_threads threads (0 = one per processor).  The tree
+|   is the same for any # of threads.
+|___________________________________________________________________*/
+
+gx3dBoxtree *gx3d_Boxtree_Init (gx3dObject *object, gx3dBoxtreeType type, gx3dBoxtreeBuild build, int num_threads)
+{
+  gx3dBoxtree *boxtree = 0;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (object);
+  DEBUG_ASSERT ((type == gx3d_BOXTREE_TYPE_STATIC) OR (type == gx3d_BOXTREE_TYPE_DYNAMIC));
+  DEBUG_ASSERT ((build == gx3d_BOXTREE_BUILD_MEAN) OR (build == gx3d_BOXTREE_BUILD_SAH));
+  DEBUG_ASSERT (num_threads >= 0);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  switch (type) {
+    case gx3d_BOXTREE_TYPE_STATIC:
+      boxtree = Init_Static_Boxtree (object, build, num_threads, 0);
+      break;
+    case gx3d_BOXTREE_TYPE_DYNAMIC:
+      boxtree = Init_Dynamic_Boxtree (object, build, num_threads, 0);
+      break;
+  }      
+
+  return (boxtree);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Boxtree_Init_Prebuilt
+| 
+| Output: Creates a boxtree for an object using a bsp tree that was built
+|   earlier (usually loaded from a file, see gx3d_ReadGX3DBINBoxtree()),
+|   without rebuilding it.  The polys must be the polys of the object in
+|   bsp tree order, with vertex indeces into the vertices of all layers
+|   (child layers first) as in a boxtree created by gx3d_Boxtree_Init().  
+|   The node boxes are refit to the object geometry.  
+|
+|   Returns 0 if the tree doesn't match the object or on any error.  
+|   Calls gxError() if the tree is invalid (see Attach_Tree()).
 |___________________________________________________________________*/
 
-gx3dBoxtree *gx3d_Boxtree_Init (gx3dObject *object, gx3dBoxtreeType type)
+gx3dBoxtree *gx3d_Boxtree_Init_Prebuilt (
+  gx3dObject      *object, 
+  gx3dBoxtreeType  type, 
+  gx3dBoxtreeBuild build,
+  gx3dBoxtreeNode *node,
+  int              num_nodes,
+  gx3dPolygon     *poly,
+  int              num_polygons,
+  float            build_time,
+  int              num_threads )
 {
+  Prebuilt_Tree prebuilt;
   gx3dBoxtree *boxtree = 0;
 
 /*____________________________________________________________________
@@ -129,18 +559,28 @@ gx3dBoxtree *gx3d_Boxtree_Init (gx3dObject *object, gx3dBoxtreeType type)
 
   DEBUG_ASSERT (object);
   DEBUG_ASSERT ((type == gx3d_BOXTREE_TYPE_STATIC) OR (type == gx3d_BOXTREE_TYPE_DYNAMIC));
+  DEBUG_ASSERT ((build == gx3d_BOXTREE_BUILD_MEAN) OR (build == gx3d_BOXTREE_BUILD_SAH));
+  DEBUG_ASSERT (node);
+  DEBUG_ASSERT (poly);
+  DEBUG_ASSERT (num_threads >= 0);
 
 /*____________________________________________________________________
 |
 | Main procedure
 |___________________________________________________________________*/
 
+  prebuilt.node         = node;
+  prebuilt.num_nodes    = num_nodes;
+  prebuilt.poly         = poly;
+  prebuilt.num_polygons = num_polygons;
+  prebuilt.build_time   = build_time;
+
   switch (type) {
     case gx3d_BOXTREE_TYPE_STATIC:
-      boxtree = Init_Static_Boxtree (object);
+      boxtree = Init_Static_Boxtree (object, build, num_threads, &prebuilt);
       break;
     case gx3d_BOXTREE_TYPE_DYNAMIC:
-      boxtree = Init_Dynamic_Boxtree (object);
+      boxtree = Init_Dynamic_Boxtree (object, build, num_threads, &prebuilt);
       break;
   }      
 
@@ -151,11 +591,12 @@ gx3dBoxtree *gx3d_Boxtree_Init (gx3dObject *object, gx3dBoxtreeType type)
 |
 | Function: Init_Static_Boxtree
 | 
-| Input: Called from gx3d_Boxtree_Init()
-| Output: Creates a static boxtree of an object.
+| Input: Called from gx3d_Boxtree_Init(), gx3d_Boxtree_Init_Prebuilt()
+| Output: Creates a static boxtree of an object.  If prebuilt is not 0,
+|   uses that bsp tree instead of building one.
 |___________________________________________________________________*/
 
-static gx3dBoxtree *Init_Static_Boxtree (gx3dObject *object)
+static gx3dBoxtree *Init_Static_Boxtree (gx3dObject *object, gx3dBoxtreeBuild build, int num_threads, Prebuilt_Tree *prebuilt)
 {
   int num_vertices, num_polygons;
   bool error;
@@ -186,7 +627,9 @@ static gx3dBoxtree *Init_Static_Boxtree (gx3dObject *object)
 
   if (NOT error) {
     // Init boxtree members
-    boxtree->type = gx3d_BOXTREE_TYPE_STATIC;
+    boxtree->type  = gx3d_BOXTREE_TYPE_STATIC;
+    boxtree->build = build;
+    boxtree->num_threads = num_threads;
 /***** I want to get rid of this dependency! ************/
 //    boxtree->object = object;
 /********************************************************/
@@ -221,11 +664,22 @@ static gx3dBoxtree *Init_Static_Boxtree (gx3dObject *object)
     if (object->layer) {
       // Fill arrays with data, starting with first layer in object
       Get_Static_Geometry (object->layer, boxtree);
-      // Compute bound boxes
-      Get_Static_Bound_Box (boxtree);
-      // Make bsp tree
-      if (NOT Make_Static_Tree (boxtree))
-        error = true;
+      // Use bsp tree built earlier?
+      if (prebuilt) {
+        if (NOT Attach_Tree (boxtree, prebuilt))
+          error = true;
+        else {
+          Get_Static_Bound_Box (boxtree);
+          Refit_Tree (boxtree);
+        }
+      }
+      else {
+        // Compute bound boxes
+        Get_Static_Bound_Box (boxtree);
+        // Make bsp tree
+        if (NOT Make_Tree (boxtree))
+          error = true;
+      }
     }
   }
 
@@ -286,6 +740,134 @@ static void Get_Static_Geometry (gx3dObjectLayer *layer, gx3dBoxtree *boxtree)
   }
 }
 
+/*____________________________________________________________________
+|
+| Function: Attach_Tree
+|
+| Input: Called from Init_Static_Boxtree(), Init_Dynamic_Boxtree()
+| Output: Replaces the polys of a boxtree (in object order) with the polys
+|   of a bsp tree built earlier (in bsp tree order) and copies the nodes
+|   of that tree.  The node boxes still have to be refit.  Returns true 
+|   on success or false if the tree doesn't match the boxtree geometry or
+|   on any error.  Calls gxError() if the tree itself is invalid (bad 
+|   node indeces or deeper than SAH_MAX_LEVEL).
+|___________________________________________________________________*/
+
+static bool Attach_Tree (gx3dBoxtree *boxtree, Prebuilt_Tree *prebuilt)
+{
+  int i, j, *level;
+  unsigned index;
+  gx3dObjectLayer **vertex_layer, **poly_layer;
+  gx3dBoxtreeNode *node;
+  bool invalid = false;
+  bool error = false;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (boxtree);
+  DEBUG_ASSERT (prebuilt);
+
+/*____________________________________________________________________
+|
+| Make sure the tree is valid for this geometry
+|___________________________________________________________________*/
+
+  level = 0;
+  if ((prebuilt->num_polygons != boxtree->num_polygons) OR (prebuilt->num_nodes < 1) OR (prebuilt->num_nodes > 2*boxtree->num_polygons-1))
+    error = true;
+  else {
+    // Level of each node (root is level 1, 0 = not reached yet)
+    level = (int *) calloc (prebuilt->num_nodes, sizeof(int));
+    if (level == 0)
+      error = true;
+    else
+      level[0] = 1;
+  }
+  // Every node must be the child of exactly one node before it and within the depth the traversal stacks can hold
+  for (i=0; (i<prebuilt->num_nodes) AND (NOT error) AND (NOT invalid); i++) {
+    node = &(prebuilt->node[i]);
+    if ((level[i] == 0) OR (level[i] > SAH_MAX_LEVEL))
+      invalid = true;
+    // Terminal nodes must have a valid range of polys
+    else if (node->num_polys) {
+      if ((node->offset >= (unsigned)boxtree->num_polygons) OR (node->num_polys > (unsigned)boxtree->num_polygons - node->offset))
+        invalid = true;
+    }
+    else if ((node->offset <= (unsigned)(i+1)) OR (node->offset >= (unsigned)prebuilt->num_nodes) OR level[i+1] OR level[node->offset])
+      invalid = true;
+    else {
+      level[i+1]          = level[i] + 1;
+      level[node->offset] = level[i] + 1;
+    }
+  }
+  if (invalid) {
+    gxError ("Attach_Tree(): Invalid bsp tree");
+    error = true;
+  }
+  for (i=0; (i<prebuilt->num_polygons) AND (NOT error); i++) 
+    for (j=0; j<3; j++) 
+      if ((unsigned)(prebuilt->poly[i].index[j]) >= (unsigned)boxtree->num_vertices)
+        error = true;
+
+/*____________________________________________________________________
+|
+| Get layer of each poly
+|___________________________________________________________________*/
+
+  vertex_layer = 0;
+  poly_layer   = 0;
+  if (NOT error) {
+    vertex_layer = (gx3dObjectLayer **) calloc (boxtree->num_vertices, sizeof(gx3dObjectLayer *));
+    poly_layer   = (gx3dObjectLayer **) malloc (boxtree->num_polygons * sizeof(gx3dObjectLayer *));
+    if ((vertex_layer == 0) OR (poly_layer == 0))
+      error = true;
+  }
+  if (NOT error) {
+    // Each layer supplies a contiguous range of vertices, so the layer of a poly can be found from any of its vertices
+    for (i=0; i<boxtree->num_polygons; i++) 
+      for (j=0; j<3; j++) 
+        vertex_layer[boxtree->poly[i].index[j]] = boxtree->poly_layer[i];
+    for (i=0; (i<prebuilt->num_polygons) AND (NOT error); i++) {
+      index = prebuilt->poly[i].index[0];
+      poly_layer[i] = vertex_layer[index];
+      if ((poly_layer[i] == 0) OR (vertex_layer[prebuilt->poly[i].index[1]] != poly_layer[i]) OR (vertex_layer[prebuilt->poly[i].index[2]] != poly_layer[i]))
+        error = true;
+    }
+  }
+
+/*____________________________________________________________________
+|
+| Copy the tree
+|___________________________________________________________________*/
+
+  if (NOT error) {
+    boxtree->node = (gx3dBoxtreeNode *) malloc (prebuilt->num_nodes * sizeof(gx3dBoxtreeNode));
+    if (boxtree->node == 0)
+      error = true;
+    else {
+      memcpy (boxtree->node, prebuilt->node, prebuilt->num_nodes * sizeof(gx3dBoxtreeNode));
+      boxtree->num_nodes = prebuilt->num_nodes;
+      memcpy (boxtree->poly, prebuilt->poly, prebuilt->num_polygons * sizeof(gx3dPolygon));
+      free (boxtree->poly_layer);
+      boxtree->poly_layer = poly_layer;
+      poly_layer = 0;
+    }
+  }
+
+  // Free temp memory
+  if (level)
+    free (level);
+  if (vertex_layer)
+    free (vertex_layer);
+  if (poly_layer)
+    free (poly_layer);
+
+  return (NOT error);
+}
+
 /*____________________________________________________________________
 |
 | Function: Get_Static_Bound_Box
@@ -331,18 +913,32 @@ static void Get_Static_Bound_Box (gx3dBoxtree *boxtree)
 
 /*____________________________________________________________________
 |
-| Function: Make_Static_Tree
+| Function: Make_Tree
 |
-| Input: Called from Init_Static_Boxtree()
-| Output: Creates static bsp tree.  Returns true on success or false 
-|   on any error.
+| Input: Called from Init_Static_Boxtree(), Update_Static_Boxtree(),
+|   Make_Dynamic_Tree()
+| Output: Creates bsp tree from the poly boxes of a boxtree (static or
+|   dynamic).  Returns true on success or false on any error.
+|
+|   All nodes are created in one array allocated for the largest possible
+|   tree.  Each subtree is given a fixed range of this array based on its
+|   # polys, so subtrees can be built in any order (or on different 
+|   threads) and the result is always the same.  The nodes are then 
+|   packed in depth-first order and the poly arrays are reordered so the
+|   polys in each terminal node are a contiguous range.
+|
+|   If the boxtree was created with more than one thread, large subtrees
+|   are built by the shared pool of worker threads and the polys of large
+|   nodes are binned in parallel.  
 |___________________________________________________________________*/
 
-static bool Make_Static_Tree (gx3dBoxtree *boxtree)
+static bool Make_Tree (gx3dBoxtree *boxtree)
 {
-  int i;
+  int i, num_threads;
   gx3dBoxtreeNode *node;
-  bool success = false;
+  Build_Context context;
+  Build_Threads *threads = 0;
+  bool error = false;
 
 /*____________________________________________________________________
 |
@@ -350,260 +946,354 @@ static bool Make_Static_Tree (gx3dBoxtree *boxtree)
 |___________________________________________________________________*/
 
   DEBUG_ASSERT (boxtree);
+  DEBUG_ASSERT (boxtree->node == 0);
 
 /*____________________________________________________________________
 |
 | Main procedure
 |___________________________________________________________________*/
 
-  // Create root node
-  node = Make_Node (boxtree->num_polygons);
-  if (node) {
-    // Make this node the root of the bsp tree
-    boxtree->root = node;
-    // Put all polygons in root node
-    for (i=0; i<boxtree->num_polygons; i++)
-      node->poly_index[i] = i;
-    node->num_polys = boxtree->num_polygons;
-    // Set box of this node
-    node->box = boxtree->box;
-    // Subdivide this node
-    if (Subdivide_Static_Subtree (boxtree, boxtree->root, 1))
-      success = true;
+  if (boxtree->num_polygons) {
+    // Get # threads to use
+    num_threads = Get_Num_Build_Threads (boxtree);
+    if (num_threads > 1) {
+      threads = Get_Build_Threads ();
+      if (threads == 0)
+        num_threads = 1;
+      else if (num_threads > threads->pool->num_workers + 1)
+        num_threads = threads->pool->num_workers + 1;
+    }
+    // Init build context
+    memset (&context, 0, sizeof(Build_Context));
+    context.boxtree     = boxtree;
+    context.num_threads = num_threads;
+    // Allocate memory for the largest possible tree (each terminal node has at least 1 poly)
+    boxtree->node = (gx3dBoxtreeNode *) malloc ((2 * boxtree->num_polygons - 1) * sizeof(gx3dBoxtreeNode));
+    context.poly_index = (unsigned *) malloc (boxtree->num_polygons * sizeof(unsigned));
+    if ((boxtree->node == 0) OR (context.poly_index == 0))
+      error = true;
+    // Allocate memory for task stack
+    if ((NOT error) AND (num_threads > 1)) {
+      context.max_tasks = 2 * (boxtree->num_polygons / PARALLEL_MIN_TASK_POLYS) + num_threads * num_threads;
+      context.task = (Build_Task *) malloc (context.max_tasks * sizeof(Build_Task));
+      if (context.task == 0)
+        error = true;
+    }
+    if (NOT error) {
+      // Put all polygons in root node
+      for (i=0; i<boxtree->num_polygons; i++)
+        context.poly_index[i] = i;
+      boxtree->num_nodes = 2 * boxtree->num_polygons - 1;
+      Get_Poly_Range_Box (boxtree, context.poly_index, 0, boxtree->num_polygons, &(boxtree->node[0].box));
+      // Subdivide root node on this thread
+      if (num_threads == 1) 
+        Subdivide_Subtree (&context, 0, 0, boxtree->num_polygons, 1);
+      // Subdivide root node using the pool of threads (this thread is also a worker)
+      else {
+        InitializeCriticalSection (&context.critical_section);
+        context.semaphore = threads->semaphore;
+        for (i=0; i<num_threads; i++)
+          context.event[i] = threads->event[i];
+        context.num_events  = num_threads;
+        context.num_pending = 1;
+        gx3d_JobPool_Run (threads->pool, Build_Chunk, &context, num_threads);
+        // Clear signals left for tasks that were run by Run_Bin_Task()
+        while (WaitForSingleObject (context.semaphore, 0) == WAIT_OBJECT_0)
+          ;
+        DeleteCriticalSection (&context.critical_section);
+      }
+    }
+    // Let other builds use the threads
+    if (threads)
+      InterlockedExchange (&(threads->busy), 0);
+    if (NOT error) {
+      // Pack nodes in depth-first order
+      boxtree->num_nodes = 0;
+      Pack_Subtree (boxtree->node, 0, &(boxtree->num_nodes));
+      // Put polys in terminal node order
+      if (NOT Reorder_Polys (boxtree, context.poly_index))
+        error = true;
+    }
+    if (NOT error) {
+      // Free unused nodes
+      node = (gx3dBoxtreeNode *) realloc (boxtree->node, boxtree->num_nodes * sizeof(gx3dBoxtreeNode));
+      if (node)
+        boxtree->node = node;
+    }
+    if (context.poly_index)
+      free (context.poly_index);
+    if (context.task)
+      free (context.task);
+    if (error) {
+      if (boxtree->node)
+        free (boxtree->node);
+      boxtree->node = 0;
+      boxtree->num_nodes = 0;
+    }
   }
 
 #ifdef DEBUG
-  if (NOT success)
-    debug_WriteFile ("Make_Static_Tree(): Error");
+  if (error)
+    debug_WriteFile ("Make_Tree(): Error");
 #endif
 
-  return (success);
+  return (NOT error);
 }
 
 /*____________________________________________________________________
 |
-| Function: Subdivide_Static_Subtree
+| Function: Get_Num_Build_Threads
 |
-| Input: Called from Make_Static_Tree()
-| Output: Subdivides static bsp subtree.  Returns true on success or 
-|   false on any error.
+| Input: Called from Make_Tree()
+| Output: Returns # threads to use to build the bsp tree of a boxtree.
 |___________________________________________________________________*/
 
-static bool Subdivide_Static_Subtree (
-  gx3dBoxtree     *boxtree, 
-  gx3dBoxtreeNode *subtree, 
-  int              level )  // level at subtree (root is level 1)
+static int Get_Num_Build_Threads (gx3dBoxtree *boxtree)
 {
-  int i, j, which;
-  float t, dx, dy, dz, split;
-  bool subdivide;
-  gx3dBoxtreeNode *left, *right;
-  bool error = false;
+  int num_threads;
+  SYSTEM_INFO info;
+
+  num_threads = boxtree->num_threads;
+  // Use one thread per processor?
+  if (num_threads == 0) {
+    GetSystemInfo (&info);
+    num_threads = (int)info.dwNumberOfProcessors;
+  }
+  if (num_threads > MAX_BUILD_THREADS)
+    num_threads = MAX_BUILD_THREADS;
+  // Not worth using threads on a small tree?
+  if ((num_threads < 1) OR (boxtree->num_polygons < 2 * PARALLEL_MIN_TASK_POLYS))
+    num_threads = 1;
+
+  return (num_threads);
+}
 
 /*____________________________________________________________________
 |
-| Verify input params
+| Function: Get_Build_Threads
+|
+| Input: Called from Make_Tree()
+| Output: Returns the worker threads shared by all multi-threaded builds,
+|   starting them (one per processor) on first use.  The caller must 
+|   clear busy when done with them.  Returns 0 if the threads can't be 
+|   started or another build is using them.
 |___________________________________________________________________*/
 
-  DEBUG_ASSERT (boxtree);
-  DEBUG_ASSERT (subtree);
-  DEBUG_ASSERT (level >= 1);
+static Build_Threads *Get_Build_Threads ()
+{
+  int i;
+  Build_Threads *threads;
+  bool error = false;
 
-#ifdef DEBUG
-  char str[256];
-  sprintf (str, "BSP tree node has %d polys, boxsize=%f,%f,%f", 
-    subtree->num_polys,
-    subtree->box.max.x - subtree->box.min.x,
-    subtree->box.max.y - subtree->box.min.y,
-    subtree->box.max.z - subtree->box.min.z );
-  debug_WriteFile (str);
-#endif
+  // Start the threads?
+  if (Threads == 0) {
+    threads = (Build_Threads *) calloc (1, sizeof(Build_Threads));
+    if (threads == 0)
+      error = true;
+    else {
+      threads->pool      = gx3d_JobPool_Init (0);
+      threads->semaphore = CreateSemaphore (0, 0, 0x7FFFFFFF, 0);
+      if ((threads->pool == 0) OR (threads->semaphore == 0))
+        error = true;
+      for (i=0; (i<MAX_BUILD_THREADS) AND (NOT error); i++) {
+        threads->event[i] = CreateEvent (0, FALSE, FALSE, 0);
+        if (threads->event[i] == 0)
+          error = true;
+      }
+      // Keep them, unless another thread started them first
+      if (error OR (InterlockedCompareExchangePointer ((PVOID volatile *)&Threads, threads, 0) != 0))
+        Free_Build_Threads (threads);
+    }
+  }
+
+  // Use them, unless another build is
+  threads = Threads;
+  if (threads AND (InterlockedCompareExchange (&(threads->busy), 1, 0) != 0))
+    threads = 0;
+
+  return (threads);
+}
 
 /*____________________________________________________________________
 |
-| Check if need to subdivide this node
+| Function: Free_Build_Threads
+|
+| Input: Called from Get_Build_Threads(), gx3d_Boxtree_FreeThreads()
+| Output: Stops a set of build threads and frees all memory for them.
 |___________________________________________________________________*/
 
-  // Assume yes
-  subdivide = true;
-  // If max level reached, don't subdivide any more
-  if (level == MAX_LEVEL)
-    subdivide = false;
-  // If only 1 or 2 polys left, don't subdivide
-  else if (subtree->num_polys <= 2)
-    subdivide = false;
-  
+static void Free_Build_Threads (Build_Threads *threads)
+{
+  int i;
+
+  if (threads) {
+    gx3d_JobPool_Free (threads->pool);
+    if (threads->semaphore)
+      CloseHandle (threads->semaphore);
+    for (i=0; i<MAX_BUILD_THREADS; i++)
+      if (threads->event[i])
+        CloseHandle (threads->event[i]);
+    free (threads);
+  }
+}
+
 /*____________________________________________________________________
 |
-| Subdivide this node
+| Function: Subdivide_Subtree
+|
+| Input: Called from Make_Tree(), Subdivide_Subtree(), Run_Build_Task()
+| Output: Subdivides a bsp subtree.  The polys of the subtree are 
+|   poly_index[first] to poly_index[first+num_polys-1].  On return these
+|   are partitioned so each terminal node below this subtree has a 
+|   contiguous range.  The box of the subtree node must already be set.
+|
+|   A subtree with n polys has at most 2n-1 nodes, so the left subtree 
+|   uses nodes node+1 to node+2*num_left-1 and the right subtree starts 
+|   at node+2*num_left.  If building with threads, a large right subtree 
+|   is added to the task stack instead of being built here.
 |___________________________________________________________________*/
 
-  if (subdivide) {
-
-    // Create child nodes
-    left  = Make_Node (subtree->num_polys);
-    right = Make_Node (subtree->num_polys);
-    if ((left == 0) OR (right == 0))
-      error = true;
-
-    if (NOT error) {
-      // Get dimension of box
-      dx = fabs (subtree->box.max.x - subtree->box.min.x);
-      dy = fabs (subtree->box.max.y - subtree->box.min.y);
-      dz = fabs (subtree->box.max.z - subtree->box.min.z);
-      // Select largest dimension of box
-      which = X_AXIS;
-      t = dx;
-      if (dz > t) {
-        which = Z_AXIS;
-        t = dz;
-      }
-      if (dy > t) 
-        which = Y_AXIS;
-      // Split on the selected axis
-      left->box  = subtree->box;
-      right->box = subtree->box;
-      switch (which) {
-        case X_AXIS: split = Get_Best_Split (boxtree, subtree, 'x');
-                     left->box.max.x  = split;
-                     right->box.min.x = split;
-#ifdef DEBUG
-                     debug_WriteFile ("  splitting on X-axis");
-#endif
-                     break;
-                     break;
-        case Y_AXIS: split = Get_Best_Split (boxtree, subtree, 'y');
-                     left->box.max.y  = split;
-                     right->box.min.y = split;
-#ifdef DEBUG
-                     debug_WriteFile ("  splitting on Y-axis");
-#endif
-                     break;
-        case Z_AXIS: split = Get_Best_Split (boxtree, subtree, 'z');
-                     left->box.max.z  = split;
-                     right->box.min.z = split;
-#ifdef DEBUG
-                     debug_WriteFile ("  splitting on Z-axis");
-#endif
-      }
-      // Put polys from subtree node into left and right children (each poly will go into either left or right)
-      for (i=0; i<subtree->num_polys; i++) {
-        j = subtree->poly_index[i];
-        if (gx3d_Relation_Point_Box (&(boxtree->poly_box_center[j]), &(left->box)) == gxRELATION_INSIDE)
-          left->poly_index[left->num_polys++] = j;
-        else
-          right->poly_index[right->num_polys++] = j;
-      }
-      // Relax child bounding boxes to encompass boxes of all polys in the child
-      if (left->num_polys) {
-        left->box = boxtree->poly_box[left->poly_index[0]];
-        for (i=1; i<left->num_polys; i++)
-          gx3d_EncloseBoundBox (&(left->box), &(boxtree->poly_box[left->poly_index[i]]));
-      }
-      if (right->num_polys) {
-        right->box = boxtree->poly_box[right->poly_index[0]];
-        for (i=1; i<right->num_polys; i++)
-          gx3d_EncloseBoundBox (&(right->box), &(boxtree->poly_box[right->poly_index[i]]));
-      }
-      // Reallocate poly arrays in children as needed
-      error = NOT Shrink_To_Fit (left,  subtree->num_polys);
-      error = NOT Shrink_To_Fit (right, subtree->num_polys);
-      if (NOT error) {
-        // If left child has any polygons, attach the child to the subtree
-        if (left->num_polys)
-          subtree->left = left;
-        else
-          Free_Subtree (left);
-        // If right child has any polygons, attach the child to the subtree
-        if (right->num_polys)
-          subtree->right = right;
-        else
-          Free_Subtree (right);
-        // Delete the subtree poly array since all polys have been assigned to children
-        free (subtree->poly_index);
-        subtree->poly_index = 0;
-      }
-    } // if (NOT error)
+static void Subdivide_Subtree (
+  Build_Context *context,
+  int            node,        // index of subtree node
+  int            first,       // index of first poly in poly_index
+  int            num_polys,
+  int            level )      // level at subtree (root is level 1)
+{
+  int left, right, num_left;
+  gx3dBoxtree *boxtree;
+  unsigned *poly_index;
 
 /*____________________________________________________________________
 |
-| Subdivide children
+| Verify input params
 |___________________________________________________________________*/
 
-    // Subdivide left subtree, if any
-    if (NOT error)
-      if (subtree->left)
-        error = NOT Subdivide_Static_Subtree (boxtree, subtree->left, level+1);
-    // Subdivide right subtree, if any
-    if (NOT error)
-      if (subtree->right)
-        error = NOT Subdivide_Static_Subtree (boxtree, subtree->right, level+1);
+  DEBUG_ASSERT (context);
+  DEBUG_ASSERT ((node >= 0) AND (node < context->boxtree->num_nodes));
+  DEBUG_ASSERT (num_polys > 0);
+  DEBUG_ASSERT (level >= 1);
 
-  } // if (subdivide)
+  boxtree    = context->boxtree;
+  poly_index = context->poly_index;
 
 #ifdef DEBUG
-  if (error)
-    debug_WriteFile ("Subdivide_Static_Subtree(): Error");
+  char str[256];
+  sprintf (str, "BSP tree node has %d polys, boxsize=%f,%f,%f", 
+    num_polys,
+    boxtree->node[node].box.max.x - boxtree->node[node].box.min.x,
+    boxtree->node[node].box.max.y - boxtree->node[node].box.min.y,
+    boxtree->node[node].box.max.z - boxtree->node[node].box.min.z );
+  debug_WriteFile (str);
 #endif
 
-  return (NOT error);
-}
+/*____________________________________________________________________
+|
+| Partition polys into left and right children
+|___________________________________________________________________*/
+
+  if (boxtree->build == gx3d_BOXTREE_BUILD_SAH)
+    num_left = Partition_SAH (context, &(boxtree->node[node].box), first, num_polys, level);
+  else
+    num_left = Partition_Mean (boxtree, poly_index, &(boxtree->node[node].box), first, num_polys, level);
 
 /*____________________________________________________________________
 |
-| Function: Make_Node
-| 
-| Input: Called from Make_Static_Tree(), Subdivide_Static_Subtree() 
-| Output: Creates a bsp tree node. Returns pointer to the node created
-|   or 0 on any error.
+| Subdivide this node if both children have polys, else make a terminal node
 |___________________________________________________________________*/
 
-static gx3dBoxtreeNode *Make_Node (int num_polys)
-{
-  gx3dBoxtreeNode *node = 0;
+  if ((num_left > 0) AND (num_left < num_polys)) {
+    // Left child is the next node, right child follows the space reserved for the left subtree
+    left  = node + 1;
+    right = node + 2 * num_left;
+    boxtree->node[node].offset    = right;
+    boxtree->node[node].num_polys = 0;
+    Get_Poly_Range_Box (boxtree, poly_index, first, num_left, &(boxtree->node[left].box));
+    Get_Poly_Range_Box (boxtree, poly_index, first+num_left, num_polys-num_left, &(boxtree->node[right].box));
+    // Let another thread build a large right subtree?
+    if ((context->num_threads > 1) AND (num_polys-num_left >= PARALLEL_MIN_TASK_POLYS))
+      Add_Subtree_Task (context, right, first+num_left, num_polys-num_left, level+1);
+    else
+      Subdivide_Subtree (context, right, first+num_left, num_polys-num_left, level+1);
+    Subdivide_Subtree (context, left, first, num_left, level+1);
+  }
+  else {
+    boxtree->node[node].offset    = first;
+    boxtree->node[node].num_polys = num_polys;
+  }
+}
 
 /*____________________________________________________________________
 |
-| Verify input params
+| Function: Partition_Mean
+|
+| Input: Called from Subdivide_Subtree()
+| Output: Splits the largest axis of a node box at the mean of the poly
+|   centers and partitions the polys so the left child polys come first.
+|   Returns # polys in left child or 0 if the node shouldn't be split.
 |___________________________________________________________________*/
 
-  DEBUG_ASSERT (num_polys > 0);
+static int Partition_Mean (
+  gx3dBoxtree *boxtree,
+  unsigned    *poly_index,
+  gx3dBox     *box,         // box of node
+  int          first,       // index of first poly in poly_index
+  int          num_polys,
+  int          level )      // level at node (root is level 1)
+{
+  int axis;
+  float t, dx, dy, dz, split;
+  int num_left = 0;
 
 /*____________________________________________________________________
 |
-| Main procedure
+| Check if need to subdivide this node
 |___________________________________________________________________*/
 
-  // Create the node
-  node = (gx3dBoxtreeNode *) calloc (1, sizeof(gx3dBoxtreeNode));
-  if (node) {
-    // Create memory for poly indexes array
-    node->poly_index = (word *) malloc (num_polys * sizeof(word));
-    // If error, delete node
-    if (node->poly_index == 0) {
-      free (node);
-      node = 0;
+  // If max level reached or only 1 or 2 polys left, don't subdivide
+  if ((level < MAX_LEVEL) AND (num_polys > 2)) {
+    // Get dimension of box
+    dx = fabs (box->max.x - box->min.x);
+    dy = fabs (box->max.y - box->min.y);
+    dz = fabs (box->max.z - box->min.z);
+    // Select largest dimension of box
+    axis = X_AXIS;
+    t = dx;
+    if (dz > t) {
+      axis = Z_AXIS;
+      t = dz;
     }
-  }
-
+    if (dy > t) 
+      axis = Y_AXIS;
+    // Split on the selected axis
+    split = Get_Best_Split (boxtree, poly_index, first, num_polys, axis);
 #ifdef DEBUG
-  if (node == 0)
-    debug_WriteFile ("Make_Node(): Error");
+    switch (axis) {
+      case X_AXIS: debug_WriteFile ("  splitting on X-axis");
+                   break;
+      case Y_AXIS: debug_WriteFile ("  splitting on Y-axis");
+                   break;
+      case Z_AXIS: debug_WriteFile ("  splitting on Z-axis");
+                   break;
+    }
 #endif
+    // Put polys with center on or left of the split into the left child
+    num_left = Partition_Polys (boxtree, poly_index, first, num_polys, axis, split, 0, 0);
+  }
 
-  return (node);
+  return (num_left);
 }
 
 /*____________________________________________________________________
 |
 | Function: Get_Best_Split
 |
-| Input: Called from Subdivide_Static_Subtree()
+| Input: Called from Partition_Mean()
 | Output: Computes best split point on an axis by average the center
 |   points (on the given axis) of all polygons in the node.
 |___________________________________________________________________*/
 
-static float Get_Best_Split (gx3dBoxtree *boxtree, gx3dBoxtreeNode *node, char axis)
+static float Get_Best_Split (gx3dBoxtree *boxtree, unsigned *poly_index, int first, int num_polys, int axis)
 {
   int i;
   float sum = 0;
@@ -614,95 +1304,799 @@ static float Get_Best_Split (gx3dBoxtree *boxtree, gx3dBoxtreeNode *node, char a
 |___________________________________________________________________*/
 
   DEBUG_ASSERT (boxtree);
-  DEBUG_ASSERT (node);
-  DEBUG_ASSERT ((axis == 'x') OR (axis == 'y') OR (axis == 'z'));
+  DEBUG_ASSERT (poly_index);
+  DEBUG_ASSERT (num_polys > 0);
+  DEBUG_ASSERT ((axis == X_AXIS) OR (axis == Y_AXIS) OR (axis == Z_AXIS));
 
 /*____________________________________________________________________
 |
 | Main procedure
 |___________________________________________________________________*/
 
-  switch (axis) {
-    case 'x': 
-      for (i=0; i<node->num_polys; i++)
-        sum += boxtree->poly_box_center[node->poly_index[i]].x;
-      break;
-    case 'y': 
-      for (i=0; i<node->num_polys; i++)
-        sum += boxtree->poly_box_center[node->poly_index[i]].y;
-      break;
-    case 'z': 
-      for (i=0; i<node->num_polys; i++)
-        sum += boxtree->poly_box_center[node->poly_index[i]].z;
-      break;
-  }
-  return (sum / i);
+  for (i=first; i<first+num_polys; i++)
+    sum += Get_Center (boxtree, poly_index[i], axis);
+
+  return (sum / num_polys);
 }
 
 /*____________________________________________________________________
 |
-| Function: Shrink_To_Fit
-| 
-| Input: Called from Subdivide_Static_Subtree() 
-| Output: Shrinks poly_index array to fit exactly the number of polys.
-|   Returns true on success, else false on any error.
+| Function: Partition_SAH
+|
+| Input: Called from Subdivide_Subtree()
+| Output: Partitions the polys of a node at the split with the lowest
+|   surface area heuristic cost so the left child polys come first.  
+|   Returns # polys in left child or 0 if the node shouldn't be split.
+|
+|   A node becomes a terminal node when it has too few polys to split, 
+|   when no split separates its polys, or when testing all of its polys
+|   is cheaper than the best split (and it is small enough).
 |___________________________________________________________________*/
 
-static bool Shrink_To_Fit (gx3dBoxtreeNode *node, int current_size)
+static int Partition_SAH (
+  Build_Context *context,
+  gx3dBox       *box,         // box of node
+  int            first,       // index of first poly in poly_index
+  int            num_polys,
+  int            level )      // level at node (root is level 1)
 {
-  word *array;
-  int error = false;
+  int axis, split_bin;
+  float bin_min, bin_scale, cost;
+  int num_left = 0;
 
 /*____________________________________________________________________
 |
-| Verify input params
+| Check if need to subdivide this node
 |___________________________________________________________________*/
 
-  DEBUG_ASSERT (node);
-  DEBUG_ASSERT (current_size > 0);
+  // If max level reached or only 1 or 2 polys left, don't subdivide
+  if ((level < SAH_MAX_LEVEL) AND (num_polys > 2))
+    // If no split separates the polys, don't subdivide
+    if (Get_SAH_Split (context, box, first, num_polys, &axis, &split_bin, &bin_min, &bin_scale, &cost))
+      // If a small node is cheaper than the best split, don't subdivide
+      if ((num_polys > SAH_MAX_LEAF_POLYS) OR (cost < num_polys * SAH_INTERSECT_COST))
+        // Put polys in bins left of the split into the left child, using the same binning as Get_SAH_Split()
+        num_left = Partition_Polys (context->boxtree, context->poly_index, first, num_polys, axis, bin_min, bin_scale, split_bin);
+
+  return (num_left);
+}
 
 /*____________________________________________________________________
 |
-| Main procedure
+| Function: Get_SAH_Split
+|
+| Input: Called from Partition_SAH()
+| Output: Finds the cheapest split of a node.  Poly centers are sorted
+|   into SAH_NUM_BINS bins on each axis and each of the bin boundaries is
+|   evaluated with the surface area heuristic:
+|
+|     cost = traversal_cost + (area(left) * nleft + area(right) * nright) 
+|                             / area(node) * intersect_cost
+|
+|   Returns true if a split was found, else false (all poly centers are
+|   in the same place).  
 |___________________________________________________________________*/
 
-  // Any polys in this node?
-  if (node->num_polys)
-    // Too much space being used for this set of polys?
-    if (node->num_polys < current_size) {
-      // Allocate new, smaller, array
-      array = (word *) malloc (node->num_polys * sizeof(word));
-      if (array == 0)
-        error = true;
-      else {
-        // Copy data into new array
-        memcpy ((void *)array, (void *)(node->poly_index), node->num_polys * sizeof(word));
-        // Delete old array
-        free (node->poly_index);
-        // Attach new array
-        node->poly_index = array;
-      }
-    }
+static bool Get_SAH_Split (
+  Build_Context *context, 
+  gx3dBox       *box,           // box of node
+  int            first,         // index of first poly in poly_index
+  int            num_polys,
+  int           *axis,          // X_AXIS, Y_AXIS or Z_AXIS
+  int           *split_bin,     // polys in bins < split_bin go left
+  float         *bin_min,       // min poly center on axis
+  float         *bin_scale,     // converts poly center to bin #
+  float         *cost )
+{
+  int a, b, n, right_count[SAH_NUM_BINS];
+  float scale[3], node_area, c;
+  gx3dBox left_box, right_box;
+  float right_area[SAH_NUM_BINS];
+  Bin_Data bins;
+  bool found = false;
 
-#ifdef DEBUG
-  if (error)
-    debug_WriteFile ("Shrink_To_Fit(): Error");
-#endif
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (context);
+  DEBUG_ASSERT (box);
+  DEBUG_ASSERT (num_polys > 0);
+  DEBUG_ASSERT (axis);
+  DEBUG_ASSERT (split_bin);
+  DEBUG_ASSERT (bin_min);
+  DEBUG_ASSERT (bin_scale);
+  DEBUG_ASSERT (cost);
+
+/*____________________________________________________________________
+|
+| Compute bounds of poly centers
+|___________________________________________________________________*/
+
+  Get_Bins (context, BUILD_TASK_BOUNDS, first, num_polys, 0, &bins);
+
+  node_area = Surface_Area (box);
+  if (node_area <= 0)
+    node_area = 1;
+
+/*____________________________________________________________________
+|
+| Sort poly boxes into bins on each axis
+|___________________________________________________________________*/
+
+  for (a=0; a<3; a++) 
+    // Skip an axis with no extent
+    if (bins.cmax[a] <= bins.cmin[a])
+      scale[a] = 0;
+    // Scale slightly less than SAH_NUM_BINS so the max center falls in the last bin
+    else
+      scale[a] = (SAH_NUM_BINS * (1 - 0.0001f)) / (bins.cmax[a] - bins.cmin[a]);
+
+  Get_Bins (context, BUILD_TASK_BINS, first, num_polys, scale, &bins);
+
+/*____________________________________________________________________
+|
+| Evaluate split candidates on each axis
+|___________________________________________________________________*/
+
+  for (a=0; a<3; a++) {
+    if (scale[a] == 0)
+      continue;
+
+    // Sweep from the right, accumulating area and count of everything right of each boundary
+    n = 0;
+    for (b=SAH_NUM_BINS-1; b>0; b--) {
+      if (bins.count[a][b]) {
+        if (n == 0)
+          right_box = bins.box[a][b];
+        else
+          gx3d_EncloseBoundBox (&right_box, &bins.box[a][b]);
+        n += bins.count[a][b];
+      }
+      right_count[b] = n;
+      right_area[b]  = n ? Surface_Area (&right_box) : 0;
+    }
+
+    // Sweep from the left, evaluating the cost of splitting at each boundary
+    n = 0;
+    for (b=1; b<SAH_NUM_BINS; b++) {
+      if (bins.count[a][b-1]) {
+        if (n == 0)
+          left_box = bins.box[a][b-1];
+        else
+          gx3d_EncloseBoundBox (&left_box, &bins.box[a][b-1]);
+        n += bins.count[a][b-1];
+      }
+      // Only consider splits with polys on both sides
+      if (n AND right_count[b]) {
+        c = SAH_TRAVERSAL_COST + SAH_INTERSECT_COST * (Surface_Area (&left_box) * n + right_area[b] * right_count[b]) / node_area;
+        if ((NOT found) OR (c < *cost)) {
+          *axis      = a;
+          *split_bin = b;
+          *bin_min   = bins.cmin[a];
+          *bin_scale = scale[a];
+          *cost      = c;
+          found      = true;
+        }
+      }
+    }
+  }
+
+  return (found);
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Bins
+|
+| Input: Called from Get_SAH_Split()
+| Output: Computes the bounds of the poly centers of a node (type = 
+|   BUILD_TASK_BOUNDS) or sorts the polys of a node into bins on each 
+|   axis (type = BUILD_TASK_BINS, bins->cmin must already be set).
+|
+|   When building with threads, the polys of a large node are split into
+|   chunks that are binned in parallel.  The results are then merged in 
+|   chunk order.  Merging only takes mins, maxes and counts, so the result
+|   is exactly the same as binning all polys on one thread.
+|___________________________________________________________________*/
+
+static void Get_Bins (
+  Build_Context *context,
+  int            type,
+  int            first,       // index of first poly in poly_index
+  int            num_polys,
+  float         *bin_scale,   // (BUILD_TASK_BINS) converts poly center to bin # on each axis (0 = skip axis)
+  Bin_Data      *bins )
+{
+  int i, a, b, n, chunk_size;
+  Bin_Data *chunk;
+  volatile LONG remaining;
+  HANDLE done;
+
+  // Get # of chunks to bin in parallel
+  n = 1;
+  if (context->num_threads > 1) {
+    n = num_polys / PARALLEL_MIN_BIN_POLYS;
+    if (n > context->num_threads)
+      n = context->num_threads;
+  }
+  chunk = 0;
+  if (n > 1)
+    chunk = (Bin_Data *) malloc (n * sizeof(Bin_Data));
+
+  // Bin all polys on this thread?
+  if (chunk == 0) 
+    Bin_Polys (context, type, first, num_polys, bin_scale, bins);
+
+  else {
+    // Each chunk bins relative to the min poly center of the whole node
+    if (type == BUILD_TASK_BINS)
+      for (i=0; i<n; i++)
+        for (a=0; a<3; a++)
+          chunk[i].cmin[a] = bins->cmin[a];
+    chunk_size = num_polys / n;
+    // Get an event to wait on (there is one for each thread)
+    EnterCriticalSection (&context->critical_section);
+    DEBUG_ASSERT (context->num_events > 0);
+    done = context->event[--context->num_events];
+    LeaveCriticalSection (&context->critical_section);
+    // Let other threads bin all but the first chunk
+    remaining = n - 1;
+    for (i=1; i<n; i++) 
+      Add_Bin_Task (context, type, first + i*chunk_size, (i == n-1) ? num_polys - i*chunk_size : chunk_size, bin_scale, &chunk[i], &remaining, done);
+    Bin_Polys (context, type, first, chunk_size, bin_scale, &chunk[0]);
+    // Help run bin tasks, then wait for the chunks still being binned by other threads
+    while (Run_Bin_Task (context))
+      ;
+    WaitForSingleObject (done, INFINITE);
+    EnterCriticalSection (&context->critical_section);
+    context->event[context->num_events++] = done;
+    LeaveCriticalSection (&context->critical_section);
+    // Merge results
+    *bins = chunk[0];
+    for (i=1; i<n; i++) 
+      for (a=0; a<3; a++) 
+        if (type == BUILD_TASK_BOUNDS) {
+          if (chunk[i].cmin[a] < bins->cmin[a])
+            bins->cmin[a] = chunk[i].cmin[a];
+          if (chunk[i].cmax[a] > bins->cmax[a])
+            bins->cmax[a] = chunk[i].cmax[a];
+        }
+        else if (bin_scale[a] != 0) 
+          for (b=0; b<SAH_NUM_BINS; b++) 
+            if (chunk[i].count[a][b]) {
+              if (bins->count[a][b] == 0)
+                bins->box[a][b] = chunk[i].box[a][b];
+              else
+                gx3d_EncloseBoundBox (&(bins->box[a][b]), &(chunk[i].box[a][b]));
+              bins->count[a][b] += chunk[i].count[a][b];
+            }
+    free (chunk);
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Bin_Polys
+|
+| Input: Called from Get_Bins(), Run_Build_Task()
+| Output: Computes the bounds of the centers of a range of polys or sorts
+|   a range of polys into bins on each axis (see Get_Bins()).
+|___________________________________________________________________*/
+
+static void Bin_Polys (
+  Build_Context *context,
+  int            type,
+  int            first,       // index of first poly in poly_index
+  int            num_polys,
+  float         *bin_scale,
+  Bin_Data      *bins )
+{
+  int i, j, a, b;
+  float center;
+  gx3dBoxtree *boxtree = context->boxtree;
+  unsigned *poly_index = context->poly_index;
+
+  DEBUG_ASSERT (num_polys > 0);
+
+  if (type == BUILD_TASK_BOUNDS) {
+    for (a=0; a<3; a++)
+      bins->cmin[a] = bins->cmax[a] = Get_Center (boxtree, poly_index[first], a);
+    for (i=first+1; i<first+num_polys; i++) 
+      for (a=0; a<3; a++) {
+        center = Get_Center (boxtree, poly_index[i], a);
+        if (center < bins->cmin[a])
+          bins->cmin[a] = center;
+        else if (center > bins->cmax[a])
+          bins->cmax[a] = center;
+      }
+  }
+  else 
+    for (a=0; a<3; a++) {
+      if (bin_scale[a] == 0)
+        continue;
+      for (b=0; b<SAH_NUM_BINS; b++)
+        bins->count[a][b] = 0;
+      for (i=first; i<first+num_polys; i++) {
+        j = poly_index[i];
+        b = Get_Bin (Get_Center (boxtree, j, a), bins->cmin[a], bin_scale[a]);
+        if (bins->count[a][b] == 0)
+          bins->box[a][b] = boxtree->poly_box[j];
+        else
+          gx3d_EncloseBoundBox (&(bins->box[a][b]), &(boxtree->poly_box[j]));
+        bins->count[a][b]++;
+      }
+    }
+}
+
+/*____________________________________________________________________
+|
+| Function: Partition_Polys
+|
+| Input: Called from Partition_Mean(), Partition_SAH()
+| Output: Partitions a range of poly_index in place so the polys going 
+|   into the left child come first.  If bin_scale is 0 a poly goes left 
+|   if its center is <= split, else if its bin (see Get_Bin()) is less
+|   than split_bin.  Returns # polys in left child.
+|___________________________________________________________________*/
+
+static int Partition_Polys (
+  gx3dBoxtree *boxtree,
+  unsigned    *poly_index,
+  int          first,       // index of first poly in poly_index
+  int          num_polys,
+  int          axis,
+  float        split,       // split position or min poly center on axis (if binning)
+  float        bin_scale,   // 0 or converts poly center to bin #
+  int          split_bin )
+{
+  int i, j;
+  unsigned temp;
+  bool left;
+
+  i = first;
+  j = first + num_polys - 1;
+  while (i <= j) {
+    if (bin_scale == 0)
+      left = (Get_Center (boxtree, poly_index[i], axis) <= split);
+    else
+      left = (Get_Bin (Get_Center (boxtree, poly_index[i], axis), split, bin_scale) < split_bin);
+    if (left)
+      i++;
+    else {
+      temp          = poly_index[i];
+      poly_index[i] = poly_index[j];
+      poly_index[j] = temp;
+      j--;
+    }
+  }
+
+  return (i - first);
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Poly_Range_Box
+|
+| Input: Called from Make_Tree(), Subdivide_Subtree()
+| Output: Computes box enclosing the boxes of a range of polys.
+|___________________________________________________________________*/
+
+static void Get_Poly_Range_Box (gx3dBoxtree *boxtree, unsigned *poly_index, int first, int num_polys, gx3dBox *box)
+{
+  int i;
+
+  DEBUG_ASSERT (num_polys > 0);
+
+  *box = boxtree->poly_box[poly_index[first]];
+  for (i=first+1; i<first+num_polys; i++)
+    gx3d_EncloseBoundBox (box, &(boxtree->poly_box[poly_index[i]]));
+}
+
+/*____________________________________________________________________
+|
+| Function: Reorder_Polys
+|
+| Input: Called from Make_Tree()
+| Output: Reorders the poly arrays of a boxtree into the order given by
+|   poly_index.  Returns true on success or false on any error.
+|___________________________________________________________________*/
+
+static bool Reorder_Polys (gx3dBoxtree *boxtree, unsigned *poly_index)
+{
+  int i;
+  gx3dObjectLayer **poly_layer;
+  gx3dBox          *poly_box;
+  gx3dVector       *poly_box_center;
+  gx3dPolygon      *poly;
+  bool error = false;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (boxtree);
+  DEBUG_ASSERT (poly_index);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  // Allocate new arrays
+  poly_layer      = (gx3dObjectLayer **) malloc (boxtree->num_polygons * sizeof(gx3dObjectLayer *));
+  poly_box        = (gx3dBox *)          malloc (boxtree->num_polygons * sizeof(gx3dBox));
+  poly_box_center = (gx3dVector *)       malloc (boxtree->num_polygons * sizeof(gx3dVector));
+  poly            = (gx3dPolygon *)      malloc (boxtree->num_polygons * sizeof(gx3dPolygon));
+  if ((poly_layer == 0) OR (poly_box == 0) OR (poly_box_center == 0) OR (poly == 0))
+    error = true;
+
+  if (NOT error) {
+    // Copy data into new order
+    for (i=0; i<boxtree->num_polygons; i++) {
+      poly_layer     [i] = boxtree->poly_layer     [poly_index[i]];
+      poly_box       [i] = boxtree->poly_box       [poly_index[i]];
+      poly_box_center[i] = boxtree->poly_box_center[poly_index[i]];
+      poly           [i] = boxtree->poly           [poly_index[i]];
+    }
+    // Replace old arrays
+    free (boxtree->poly_layer);
+    free (boxtree->poly_box);
+    free (boxtree->poly_box_center);
+    free (boxtree->poly);
+    boxtree->poly_layer      = poly_layer;
+    boxtree->poly_box        = poly_box;
+    boxtree->poly_box_center = poly_box_center;
+    boxtree->poly            = poly;
+  }
+  else {
+    if (poly_layer)
+      free (poly_layer);
+    if (poly_box)
+      free (poly_box);
+    if (poly_box_center)
+      free (poly_box_center);
+    if (poly)
+      free (poly);
+  }
 
   return (NOT error);
 }
 
+/*____________________________________________________________________
+|
+| Function: Add_Subtree_Task
+|
+| Input: Called from Subdivide_Subtree()
+| Output: Adds a subtree to the task stack to be built by any thread.
+|   If the stack is full the subtree is built on this thread.
+|___________________________________________________________________*/
+
+static void Add_Subtree_Task (Build_Context *context, int node, int first, int num_polys, int level)
+{
+  Build_Task *task;
+  bool added = false;
+
+  EnterCriticalSection (&context->critical_section);
+  if (context->num_tasks < context->max_tasks) {
+    task = &(context->task[context->num_tasks++]);
+    task->type      = BUILD_TASK_SUBTREE;
+    task->node      = node;
+    task->first     = first;
+    task->num_polys = num_polys;
+    task->level     = level;
+    context->num_pending++;
+    added = true;
+  }
+  LeaveCriticalSection (&context->critical_section);
+
+  if (added)
+    ReleaseSemaphore (context->semaphore, 1, 0);
+  else
+    Subdivide_Subtree (context, node, first, num_polys, level);
+}
+
+/*____________________________________________________________________
+|
+| Function: Add_Bin_Task
+|
+| Input: Called from Get_Bins()
+| Output: Adds a chunk of polys to the task stack to be binned by any 
+|   thread.  If the stack is full the chunk is binned on this thread.
+|___________________________________________________________________*/
+
+static void Add_Bin_Task (
+  Build_Context *context, 
+  int            type, 
+  int            first, 
+  int            num_polys, 
+  float         *bin_scale, 
+  Bin_Data      *bins, 
+  volatile LONG *remaining,
+  HANDLE         done )
+{
+  Build_Task *task;
+  bool added = false;
+
+  EnterCriticalSection (&context->critical_section);
+  if (context->num_tasks < context->max_tasks) {
+    task = &(context->task[context->num_tasks++]);
+    task->type      = type;
+    task->first     = first;
+    task->num_polys = num_polys;
+    task->bin_scale = bin_scale;
+    task->bins      = bins;
+    task->remaining = remaining;
+    task->done      = done;
+    added = true;
+  }
+  LeaveCriticalSection (&context->critical_section);
+
+  if (added)
+    ReleaseSemaphore (context->semaphore, 1, 0);
+  else {
+    Bin_Polys (context, type, first, num_polys, bin_scale, bins);
+    End_Bin_Task (remaining, done);
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Run_Bin_Task
+|
+| Input: Called from Get_Bins()
+| Output: Removes the topmost bin task from the task stack and runs it.
+|   Returns true if a task was run.  Subtree tasks are left for the 
+|   worker threads, so a thread waiting for its bins isn't tied up 
+|   building a subtree.
+|___________________________________________________________________*/
+
+static bool Run_Bin_Task (Build_Context *context)
+{
+  int i, j;
+  Build_Task task;
+  bool found = false;
+
+  EnterCriticalSection (&context->critical_section);
+  for (i=context->num_tasks-1; (i>=0) AND (NOT found); i--)
+    if (context->task[i].type != BUILD_TASK_SUBTREE) {
+      task = context->task[i];
+      found = true;
+      // Remove it from the stack
+      for (j=i; j<context->num_tasks-1; j++)
+        context->task[j] = context->task[j+1];
+      context->num_tasks--;
+    }
+  LeaveCriticalSection (&context->critical_section);
+
+  if (found)
+    Run_Build_Task (context, &task);
+
+  return (found);
+}
+
+/*____________________________________________________________________
+|
+| Function: End_Bin_Task
+|
+| Input: Called from Add_Bin_Task(), Run_Build_Task()
+| Output: Marks a chunk of a node as binned.  When the last one is done,
+|   wakes the thread waiting in Get_Bins().
+|___________________________________________________________________*/
+
+static void End_Bin_Task (volatile LONG *remaining, HANDLE done)
+{
+  if (InterlockedDecrement (remaining) == 0)
+    SetEvent (done);
+}
+
+/*____________________________________________________________________
+|
+| Function: Build_Chunk
+|
+| Input: Called from Make_Tree() (by gx3d_JobPool_Run())
+| Output: Runs build tasks on one thread until the bsp tree is done.
+|   Chunk 0 starts the build by subdividing the root node.
+|___________________________________________________________________*/
+
+static void Build_Chunk (void *context, int chunk)
+{
+  Build_Context *c = (Build_Context *)context;
+
+  if (chunk == 0) {
+    Subdivide_Subtree (c, 0, 0, c->boxtree->num_polygons, 1);
+    End_Subtree_Task (c);
+  }
+  Run_Build_Tasks (c);
+}
+
+/*____________________________________________________________________
+|
+| Function: Run_Build_Tasks
+|
+| Input: Called from Build_Chunk()
+| Output: Runs tasks from the task stack until all subtrees are built.
+|   The semaphore is signaled once for each task added, and once for 
+|   each thread when the last subtree is done.
+|___________________________________________________________________*/
+
+static void Run_Build_Tasks (Build_Context *context)
+{
+  Build_Task task;
+  bool found, quit;
+
+  for (quit=false; NOT quit; ) {
+    WaitForSingleObject (context->semaphore, INFINITE);
+    EnterCriticalSection (&context->critical_section);
+    found = false;
+    if (context->num_tasks) {
+      task = context->task[--context->num_tasks];
+      found = true;
+    }
+    else 
+      quit = context->done;
+    LeaveCriticalSection (&context->critical_section);
+    if (found)
+      Run_Build_Task (context, &task);
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Run_Build_Task
+|
+| Input: Called from Run_Bin_Task(), Run_Build_Tasks()
+| Output: Runs one build task.
+|___________________________________________________________________*/
+
+static void Run_Build_Task (Build_Context *context, Build_Task *task)
+{
+  if (task->type == BUILD_TASK_SUBTREE) {
+    Subdivide_Subtree (context, task->node, task->first, task->num_polys, task->level);
+    End_Subtree_Task (context);
+  }
+  else {
+    Bin_Polys (context, task->type, task->first, task->num_polys, task->bin_scale, task->bins);
+    End_Bin_Task (task->remaining, task->done);
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: End_Subtree_Task
+|
+| Input: Called from Build_Chunk(), Run_Build_Task()
+| Output: Marks a subtree task as finished.  When the last one finishes,
+|   wakes all threads so they can quit.
+|___________________________________________________________________*/
+
+static void End_Subtree_Task (Build_Context *context)
+{
+  bool done;
+
+  EnterCriticalSection (&context->critical_section);
+  context->num_pending--;
+  done = (context->num_pending == 0);
+  if (done)
+    context->done = true;
+  LeaveCriticalSection (&context->critical_section);
+
+  if (done)
+    ReleaseSemaphore (context->semaphore, context->num_threads, 0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Pack_Subtree
+|
+| Input: Called from Make_Tree(), Pack_Subtree()
+| Output: Moves the nodes of a subtree into depth-first order, starting
+|   at index next.  On return next is the index after the subtree.
+|
+|   Nodes are built with room left for the largest possible subtree, so 
+|   a node never moves to a higher index.  Visiting the nodes in depth-
+|   first order, each node moves only into space that is unused or that
+|   has already been moved, so the nodes can be packed in place.
+|___________________________________________________________________*/
+
+static void Pack_Subtree (gx3dBoxtreeNode *node, int n, int *next)
+{
+  int new_n;
+  gx3dBoxtreeNode temp;
+
+  temp  = node[n];
+  new_n = (*next)++;
+  DEBUG_ASSERT (new_n <= n);
+  node[new_n] = temp;
+  if (temp.num_polys == 0) {
+    // Pack left subtree
+    Pack_Subtree (node, n+1, next);
+    // Pack right subtree
+    node[new_n].offset = *next;
+    Pack_Subtree (node, temp.offset, next);
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Center
+|
+| Input: Called from Get_Best_Split(), Bin_Polys(), Partition_Polys()
+| Output: Returns center of a poly box on an axis.
+|___________________________________________________________________*/
+
+static inline float Get_Center (gx3dBoxtree *boxtree, int poly, int axis)
+{
+  float center;
+
+  switch (axis) {
+    case X_AXIS: center = boxtree->poly_box_center[poly].x; 
+                 break;
+    case Y_AXIS: center = boxtree->poly_box_center[poly].y; 
+                 break;
+    default:     center = boxtree->poly_box_center[poly].z; 
+                 break;
+  }
+
+  return (center);
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Bin
+|
+| Input: Called from Bin_Polys(), Partition_Polys()
+| Output: Returns SAH bin # of a poly center.
+|___________________________________________________________________*/
+
+static inline int Get_Bin (float center, float bin_min, float bin_scale)
+{
+  int bin;
+
+  bin = (int)((center - bin_min) * bin_scale);
+  if (bin >= SAH_NUM_BINS)
+    bin = SAH_NUM_BINS-1;
+
+  return (bin);
+}
+
+/*____________________________________________________________________
+|
+| Function: Surface_Area
+|
+| Input: Called from Get_SAH_Split(), Get_Tree_Area(), 
+|   gx3d_Boxtree_GetStats()
+| Output: Returns half the surface area of a box (only ratios of areas 
+|   are used, so the factor of 2 is dropped).
+|___________________________________________________________________*/
+
+static float Surface_Area (gx3dBox *box)
+{
+  float dx, dy, dz;
+
+  DEBUG_ASSERT (box);
+
+  dx = box->max.x - box->min.x;
+  dy = box->max.y - box->min.y;
+  dz = box->max.z - box->min.z;
+
+  return (dx*dy + dy*dz + dz*dx);
+}
+
 /*____________________________________________________________________
 |
 | Function: Init_Dynamic_Boxtree
 | 
-| Input: Called from gx3d_Boxtree_Init()
-| Output: Creates a dynamic boxtree of an object.
+| Input: Called from gx3d_Boxtree_Init(), gx3d_Boxtree_Init_Prebuilt()
+| Output: Creates a dynamic boxtree of an object.  If prebuilt is not 0,
+|   uses that bsp tree instead of building one.
 |___________________________________________________________________*/
 
-static gx3dBoxtree *Init_Dynamic_Boxtree (gx3dObject *object)
+static gx3dBoxtree *Init_Dynamic_Boxtree (gx3dObject *object, gx3dBoxtreeBuild build, int num_threads, Prebuilt_Tree *prebuilt)
 {
-  int num_vertices, num_polygons;
+  int num_layers, num_vertices, num_polygons;
   bool error;
   gx3dBoxtree *boxtree = 0;
 
@@ -731,12 +2125,14 @@ static gx3dBoxtree *Init_Dynamic_Boxtree (gx3dObject *object)
 
   if (NOT error) {
     // Init boxtree members
-    boxtree->type = gx3d_BOXTREE_TYPE_DYNAMIC;
+    boxtree->type  = gx3d_BOXTREE_TYPE_DYNAMIC;
+    boxtree->build = build;
+    boxtree->num_threads = num_threads;
 /***** I want to get rid of this dependency! ************/
 //    boxtree->object = object;
 /********************************************************/
-    // Count total number of vertices and polygons in the object (from all layers)
-    gx3d_GetObjectInfo (object, 0, &num_vertices, &num_polygons);
+    // Count total number of layers, vertices and polygons in the object
+    gx3d_GetObjectInfo (object, &num_layers, &num_vertices, &num_polygons);
     // Allocate arrays of pointers to object data 
     boxtree->poly_layer = (gx3dObjectLayer **) calloc (num_polygons, sizeof(gx3dObjectLayer *));
     if (boxtree->poly_layer == 0)
@@ -754,6 +2150,13 @@ static gx3dBoxtree *Init_Dynamic_Boxtree (gx3dObject *object)
     boxtree->d.vertex = (gx3dVector *) calloc (num_vertices, sizeof(gx3dVector));
     if (boxtree->d.vertex == 0)
       error = true;
+    // Allocate arrays of layers supplying the vertices
+    boxtree->d.layer = (gx3dObjectLayer **) calloc (num_layers, sizeof(gx3dObjectLayer *));
+    if (boxtree->d.layer == 0)
+      error = true;
+    boxtree->d.layer_vertex = (int *) calloc (num_layers, sizeof(int));
+    if (boxtree->d.layer_vertex == 0)
+      error = true;
   }
 
 /*____________________________________________________________________
@@ -761,24 +2164,35 @@ static gx3dBoxtree *Init_Dynamic_Boxtree (gx3dObject *object)
 | Init data
 |___________________________________________________________________*/
   
-/*
   if (NOT error) {
+    // Make sure this object has a layer
     if (object->layer) {
-      // Set initial overall bound box for boxtree
-      boxtree->box.min = object->layer->vertex[0];
-      boxtree->box.max = object->layer->vertex[0];
-      // Fill arrays with data
-      n = 0;
-      m = object->transform.local_matrix;
-      Get_Static_Geometry (object->layer, boxtree, &n, m);
-      // Make bsp tree
-      if (NOT Make_Dynamic_Tree (boxtree))
-        error = true;
-    }
-  }
-*/
-  
-/*____________________________________________________________________
+      // Fill arrays with data, starting with first layer in object
+      Get_Dynamic_Geometry (object->layer, boxtree);
+      // Copy and transform vertices
+      Transform_Dynamic_Vertices (boxtree);
+      // Use bsp tree built earlier?
+      if (prebuilt) {
+        if (NOT Attach_Tree (boxtree, prebuilt))
+          error = true;
+        else {
+          Get_Dynamic_Bound_Box (boxtree);
+          boxtree->d.build_area  = Refit_Tree (boxtree);
+          boxtree->d.build_time  = prebuilt->build_time;
+          boxtree->d.degradation = 0;
+        }
+      }
+      else {
+        // Compute bound boxes
+        Get_Dynamic_Bound_Box (boxtree);
+        // Make bsp tree
+        if (NOT Make_Dynamic_Tree (boxtree))
+          error = true;
+      }
+    }
+  }
+  
+/*____________________________________________________________________
 |
 | On any error, free memory
 |___________________________________________________________________*/
@@ -788,67 +2202,1751 @@ static gx3dBoxtree *Init_Dynamic_Boxtree (gx3dObject *object)
     boxtree = 0;
   }
 
-  return (boxtree);
+  return (boxtree);
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Dynamic_Geometry
+|
+| Input: Called from Init_Dynamic_Boxtree()
+| Output: Goes through object layer (and child and sibling layers) and 
+|   fills boxtree arrays.
+|___________________________________________________________________*/
+
+static void Get_Dynamic_Geometry (gx3dObjectLayer *layer, gx3dBoxtree *boxtree)
+{
+  int i;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (layer);
+  DEBUG_ASSERT (boxtree);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  for (; layer; layer=layer->next) {
+    // Process child layer/s first
+    if (layer->child)
+      Get_Dynamic_Geometry (layer->child, boxtree);
+    // Process this layer
+    for (i=0; i<layer->num_polygons; i++) {
+      boxtree->poly_layer[boxtree->num_polygons] = layer;
+      boxtree->poly      [boxtree->num_polygons].index[0] = layer->polygon[i].index[0] + (word)(boxtree->num_vertices);
+      boxtree->poly      [boxtree->num_polygons].index[1] = layer->polygon[i].index[1] + (word)(boxtree->num_vertices);
+      boxtree->poly      [boxtree->num_polygons].index[2] = layer->polygon[i].index[2] + (word)(boxtree->num_vertices);
+      boxtree->num_polygons++;
+    }
+    // Save layer so its vertices can be recopied on each update
+    boxtree->d.layer       [boxtree->d.num_layers] = layer;
+    boxtree->d.layer_vertex[boxtree->d.num_layers] = boxtree->num_vertices;
+    boxtree->d.num_layers++;
+    boxtree->num_vertices += layer->num_vertices;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Transform_Dynamic_Vertices
+|
+| Input: Called from Init_Dynamic_Boxtree(), Update_Dynamic_Boxtree()
+| Output: Copies the vertices of all layers in a dynamic boxtree into
+|   the boxtree vertex array, transformed by the composite matrix of 
+|   each layer.  If a layer has been skinned or morphed the transformed
+|   (X_vertex) array is used.
+|___________________________________________________________________*/
+
+static void Transform_Dynamic_Vertices (gx3dBoxtree *boxtree)
+{
+  int i;
+  gx3dObjectLayer *layer;
+  gx3dVector *src, *dst;
+  gx3dMatrix m;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (boxtree);
+  DEBUG_ASSERT (boxtree->type == gx3d_BOXTREE_TYPE_DYNAMIC);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  for (i=0; i<boxtree->d.num_layers; i++) {
+    layer = boxtree->d.layer[i];
+    if (layer->X_vertex)
+      src = layer->X_vertex;
+    else
+      src = layer->vertex;
+    dst = &(boxtree->d.vertex[boxtree->d.layer_vertex[i]]);
+    gx3d_AffineMatrixToMatrix (&(layer->transform.composite_matrix), &m);
+    gx3d_MultiplyVectorArrayMatrix (src, &m, dst, layer->num_vertices);
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Dynamic_Bound_Box
+|
+| Input: Called from Init_Dynamic_Boxtree(), Update_Dynamic_Boxtree()
+| Output: Computes all bounding boxes of a dynamic boxtree (each triangle
+|   and overall box for the boxtree).
+|___________________________________________________________________*/
+
+static void Get_Dynamic_Bound_Box (gx3dBoxtree *boxtree)
+{
+  int i;
+  gx3dVector triangle[3];
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (boxtree);
+  DEBUG_ASSERT (boxtree->type == gx3d_BOXTREE_TYPE_DYNAMIC);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  // Make sure this boxtree has some polygons
+  if (boxtree->num_polygons) {
+    // Make overall box - tightest fit possible
+    gx3d_GetBoundBox (&(boxtree->box), boxtree->d.vertex, boxtree->num_vertices);
+    // Make box for each polygon
+    for (i=0; i<boxtree->num_polygons; i++) {
+      triangle[0] = boxtree->d.vertex[boxtree->poly[i].index[0]];
+      triangle[1] = boxtree->d.vertex[boxtree->poly[i].index[1]];
+      triangle[2] = boxtree->d.vertex[boxtree->poly[i].index[2]];
+      gx3d_GetBoundBox (&(boxtree->poly_box[i]), triangle, 3);
+      // Compute box center
+      gx3d_GetBoundBoxCenter (&(boxtree->poly_box[i]), &(boxtree->poly_box_center[i]));
+    }
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Make_Dynamic_Tree
+|
+| Input: Called from Init_Dynamic_Boxtree(), Update_Dynamic_Boxtree()
+| Output: Creates dynamic bsp tree and records the quality of the new
+|   tree (total box area) and how long it took to build.  Returns true 
+|   on success or false on any error.
+|___________________________________________________________________*/
+
+static bool Make_Dynamic_Tree (gx3dBoxtree *boxtree)
+{
+  LARGE_INTEGER start_time;
+  bool error = false;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (boxtree);
+  DEBUG_ASSERT (boxtree->type == gx3d_BOXTREE_TYPE_DYNAMIC);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  QueryPerformanceCounter (&start_time);
+  if (NOT Make_Tree (boxtree))
+    error = true;
+  else {
+    boxtree->d.build_time  = Get_Elapsed_Time (&start_time);
+    boxtree->d.build_area  = Get_Tree_Area (boxtree);
+    boxtree->d.degradation = 0;
+  }
+
+  return (NOT error);
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Tree_Area
+|
+| Input: Called from Make_Dynamic_Tree()
+| Output: Returns sum of surface areas of all node boxes in a bsp tree.
+|___________________________________________________________________*/
+
+static float Get_Tree_Area (gx3dBoxtree *boxtree)
+{
+  int i;
+  float area = 0;
+
+  for (i=0; i<boxtree->num_nodes; i++)
+    area += Surface_Area (&(boxtree->node[i].box));
+
+  return (area);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Boxtree_Free
+|
+| Output: Frees all memory for a boxtree.
+|___________________________________________________________________*/
+
+void gx3d_Boxtree_Free (gx3dBoxtree *boxtree)
+{
+  if (boxtree) {
+    // Free all memory for boxtree
+    if (boxtree->poly_layer)
+      free (boxtree->poly_layer);
+    if (boxtree->poly_box)
+      free (boxtree->poly_box);
+    if (boxtree->poly_box_center)
+      free (boxtree->poly_box_center);
+    if (boxtree->poly)
+      free (boxtree->poly);
+    switch (boxtree->type) {
+      case gx3d_BOXTREE_TYPE_STATIC:
+        if (boxtree->s.vertex)
+          free (boxtree->s.vertex);
+        break;
+      case gx3d_BOXTREE_TYPE_DYNAMIC:
+        if (boxtree->d.vertex)
+          free (boxtree->d.vertex);
+        if (boxtree->d.layer)
+          free (boxtree->d.layer);
+        if (boxtree->d.layer_vertex)
+          free (boxtree->d.layer_vertex);
+        break;
+    }      
+    if (boxtree->node)
+      free (boxtree->node);
+    free (boxtree);
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Boxtree_FreeThreads
+|
+| Output: Stops the worker threads started by the first multi-threaded
+|   boxtree build, if any.  Call once at shutdown, not while any boxtree
+|   is being built or updated.
+|___________________________________________________________________*/
+
+void gx3d_Boxtree_FreeThreads ()
+{
+  Free_Build_Threads (Threads);
+  Threads = 0;
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Boxtree_GetStats
+|
+| Output: Returns quality statistics for a boxtree.  The traversal cost
+|   is the expected cost (using the same costs as the SAH build) of a 
+|   random ray query that hits the root box, so trees built with 
+|   different methods can be compared.
+|___________________________________________________________________*/
+
+void gx3d_Boxtree_GetStats (gx3dBoxtree *boxtree, gx3dBoxtreeStats *stats)
+{
+  float root_area;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (boxtree);
+  DEBUG_ASSERT (stats);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  memset (stats, 0, sizeof(gx3dBoxtreeStats));
+  if (boxtree->num_nodes) {
+    root_area = Surface_Area (&(boxtree->node[0].box));
+    if (root_area <= 0)
+      root_area = 1;
+    Get_Subtree_Stats (boxtree, 0, 1, root_area, stats);
+    if (stats->num_leaves)
+      stats->avg_leaf_polys = (float)boxtree->num_polygons / (float)stats->num_leaves;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Subtree_Stats
+|
+| Input: Called from gx3d_Boxtree_GetStats()
+| Output: Accumulates statistics for a bsp subtree.
+|___________________________________________________________________*/
+
+static void Get_Subtree_Stats (
+  gx3dBoxtree      *boxtree, 
+  int               node,         // index of subtree node
+  int               depth,        // depth of subtree (root is depth 1)
+  float             root_area,    // surface area of root box
+  gx3dBoxtreeStats *stats )
+{
+  float p;
+  gx3dBoxtreeNode *subtree = &(boxtree->node[node]);
+
+  stats->num_nodes++;
+  if (depth > stats->max_depth)
+    stats->max_depth = depth;
+  // Probability a ray hitting the root also hits this node
+  p = Surface_Area (&(subtree->box)) / root_area;
+  // Is this a terminal node?
+  if (subtree->num_polys) {
+    stats->num_leaves++;
+    if ((int)subtree->num_polys > stats->max_leaf_polys)
+      stats->max_leaf_polys = subtree->num_polys;
+    stats->traversal_cost += p * subtree->num_polys * SAH_INTERSECT_COST;
+  }
+  else {
+    stats->traversal_cost += p * SAH_TRAVERSAL_COST;
+    Get_Subtree_Stats (boxtree, node+1,          depth+1, root_area, stats);
+    Get_Subtree_Stats (boxtree, subtree->offset, depth+1, root_area, stats);
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Boxtree_SetDirty
+|
+| Output: Sets dirty flag of a dynamic boxtree.  For static boxtrees
+|   this function has no effect.
+|___________________________________________________________________*/
+
+void gx3d_Boxtree_SetDirty (gx3dBoxtree *boxtree)
+{
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (boxtree);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  if (boxtree->type == gx3d_BOXTREE_TYPE_DYNAMIC)
+    boxtree->d.dirty = true;
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Boxtree_Update
+|
+| Output: Recomputes bsp tree of boxtree.  A dynamic boxtree is only
+|   updated if dirty.
+|___________________________________________________________________*/
+
+void gx3d_Boxtree_Update (gx3dBoxtree *boxtree)
+{
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (boxtree);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  switch (boxtree->type) {
+    case gx3d_BOXTREE_TYPE_STATIC:
+      Update_Static_Boxtree (boxtree);
+      break;
+    case gx3d_BOXTREE_TYPE_DYNAMIC:
+      Update_Dynamic_Boxtree (boxtree);
+      break;
+  }      
+}
+
+/*____________________________________________________________________
+|
+| Function: Update_Static_Boxtree
+|
+| Output: Updates a static boxtree. This will typically happen after a
+|   call to gx3d_TransformObject() or gx3d_TransformObjectLayer() which
+|   both permanently transform the vertices of an object.  In that case
+|   the boxtree bsp tree needs to be rebuilt from scratch.
+|___________________________________________________________________*/
+
+static void Update_Static_Boxtree (gx3dBoxtree *boxtree)
+{
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (boxtree);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  // Free current bsp tree
+  if (boxtree->node)
+    free (boxtree->node);
+  boxtree->node = 0;
+  boxtree->num_nodes = 0;
+  // Recompute bound boxes
+  Get_Static_Bound_Box (boxtree);
+  // Recompute bsp tree
+  Make_Tree (boxtree);
+}
+
+/*____________________________________________________________________
+|
+| Function: Update_Dynamic_Boxtree
+|
+| Output: Updates a dynamic boxtree.  Vertices are recopied from the
+|   object layers and the bsp tree boxes are refit bottom-up.  
+|
+|   The refit tree keeps its topology so its boxes grow as the geometry
+|   deforms.  Each refit adds the fraction of box area growth (compared 
+|   to the area when the tree was built) times the time of the refit to 
+|   an accumulated degradation.  The refit time is a stand-in for the 
+|   cost of using the tree for one frame, since both scale with the size 
+|   of the tree.  When the degradation exceeds the time it took to build
+|   the tree, or when the area grows past DYNAMIC_MAX_GROWTH, the tree is
+|   rebuilt.
+|___________________________________________________________________*/
+
+static void Update_Dynamic_Boxtree (gx3dBoxtree *boxtree)
+{
+  float area, growth;
+  LARGE_INTEGER start_time;
+  bool rebuild;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (boxtree);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  if (boxtree->d.dirty AND boxtree->num_polygons) {
+    QueryPerformanceCounter (&start_time);
+    // Recopy vertices and recompute poly boxes
+    Transform_Dynamic_Vertices (boxtree);
+    Get_Dynamic_Bound_Box (boxtree);
+    // Refit current bsp tree, if any
+    if (boxtree->num_nodes) {
+      area = Refit_Tree (boxtree);
+      // Compute the degradation of the tree since it was built
+      if (boxtree->d.build_area > 0)
+        growth = area / boxtree->d.build_area;
+      else
+        growth = 1;
+      if (growth > 1)
+        boxtree->d.degradation += (growth - 1) * Get_Elapsed_Time (&start_time);
+      rebuild = (growth > DYNAMIC_MAX_GROWTH) OR (boxtree->d.degradation > boxtree->d.build_time);
+    }
+    else
+      rebuild = true;
+    // Rebuild the bsp tree?
+    if (rebuild) {
+      if (boxtree->node)
+        free (boxtree->node);
+      boxtree->node = 0;
+      boxtree->num_nodes = 0;
+      Make_Dynamic_Tree (boxtree);
+    }
+    boxtree->d.dirty = false;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Refit_Tree
+|
+| Input: Called from Init_Static_Boxtree(), Init_Dynamic_Boxtree(),
+|   Update_Dynamic_Boxtree()
+| Output: Refits boxes of a bsp tree to the current poly boxes, 
+|   bottom-up.  Since the nodes are in depth-first order, children 
+|   always follow their parent so going through the node array in 
+|   reverse refits children first.  Returns sum of surface areas of all
+|   node boxes in the tree.
+|___________________________________________________________________*/
+
+static float Refit_Tree (gx3dBoxtree *boxtree)
+{
+  int i, j;
+  gx3dBoxtreeNode *node;
+  float area = 0;
+
+  for (i=boxtree->num_nodes-1; i>=0; i--) {
+    node = &(boxtree->node[i]);
+    // Is this a terminal node?
+    if (node->num_polys) {
+      node->box = boxtree->poly_box[node->offset];
+      for (j=node->offset+1; j<(int)(node->offset+node->num_polys); j++)
+        gx3d_EncloseBoundBox (&(node->box), &(boxtree->poly_box[j]));
+    }
+    else {
+      node->box = boxtree->node[i+1].box;
+      gx3d_EncloseBoundBox (&(node->box), &(boxtree->node[node->offset].box));
+    }
+    area += Surface_Area (&(node->box));
+  }
+
+  return (area);
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Elapsed_Time
+|
+| Input: Called from Make_Dynamic_Tree(), Update_Dynamic_Boxtree()
+| Output: Returns time elapsed (in milliseconds) since start_time.
+|___________________________________________________________________*/
+
+static float Get_Elapsed_Time (LARGE_INTEGER *start_time)
+{
+  LARGE_INTEGER end_time, frequency;
+
+  QueryPerformanceCounter (&end_time);
+  QueryPerformanceFrequency (&frequency);
+
+  return ((float)((double)(end_time.QuadPart - start_time->QuadPart) * 1000.0 / (double)frequency.QuadPart));
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Boxtree_Intersect_Ray
+|
+| Output: Returns intersection of a ray with a boxtree.
+|
+|   Returns gxRELATION_OUTSIDE     = ray outside all geometry in boxtree (doesn't intersect)
+|           gxRELATION_INTERSECT * = ray intersects (or is inside) a poly
+|
+|   * Optionally returns distance, intersection point and pointer to
+|     layer name (if any) of the layer containing the poly hit.
+|___________________________________________________________________*/
+
+gxRelation gx3d_Boxtree_Intersect_Ray (
+  gx3dBoxtree *boxtree,         
+  gx3dRay     *ray,
+  float        ray_length,     
+  float       *distance,        // optional
+  gx3dVector  *intersection,    // optional
+  char       **name )           // optional
+{
+  int poly;
+  gx3dVector intersection_point;
+  gxRelation result;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (boxtree);
+  DEBUG_ASSERT (ray);
+  DEBUG_ASSERT (ray_length > 0);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  poly = Intersect_Ray (boxtree, ray, ray_length, &intersection_point);
+  if (poly != -1) {
+    result = gxRELATION_INTERSECT;
+    if (distance) 
+      *distance = gx3d_Distance_Point_Point (&ray->origin, &intersection_point);
+    if (intersection)
+      *intersection = intersection_point;
+    if (name)
+      *name = boxtree->poly_layer[poly]->name;
+  }
+  else
+    result = gxRELATION_OUTSIDE;
+
+  return (result);
+}
+
+/*____________________________________________________________________
+|
+| Function: Intersect_Ray
+|
+| Input: Called from gx3d_Boxtree_Intersect_Ray(), 
+|   gx3d_Boxtree_Intersect_Rays()
+| Output: Returns index of the closest poly hit by a ray (and the 
+|   intersection point) or -1 if none.
+|
+| Description: The bsp tree is traversed with an explicit stack.  At
+|   each nonterminal node the child closer to the ray origin is visited
+|   first and the other child is pushed on the stack along with its 
+|   entry distance.  The length of the ray is clipped to the closest 
+|   poly hit so far, so subtrees beyond it are skipped.  The polys of a
+|   terminal node whose boxes the ray hits are tested 8 at a time with
+|   gx3d_Intersect_Ray_TrianglesFront().
+|___________________________________________________________________*/
+
+static int Intersect_Ray (
+  gx3dBoxtree *boxtree,         
+  gx3dRay     *ray,
+  float        ray_length,     
+  gx3dVector  *intersection )
+{
+  int i, n, left, right, stack_top, last, lane, mask, packet_poly[8];
+  float t, left_distance, right_distance, closest_distance, distance[8];
+  bool hit_left, hit_right;
+  gx3dVector inv_direction;
+  gx3dTrianglePacket packet;
+  gx3dBoxtreeNode *node;
+  struct {
+    int   node;
+    float distance;             // entry distance of ray into node box
+  } stack[SAH_MAX_LEVEL];
+  int closest_poly = -1;
+
+  closest_distance = ray_length;
+
+  if (boxtree->num_nodes) {
+    // Precompute reciprocal of ray direction for box tests
+    Get_Inverse_Direction (&(ray->direction), &inv_direction);
+    // Start with root node
+    stack_top = 0;
+    if (gx3d_Intersect_Ray_Box (&(ray->origin), &inv_direction, closest_distance, &(boxtree->node[0].box), &t) == gxRELATION_INTERSECT) {
+      stack[0].node     = 0;
+      stack[0].distance = t;
+      stack_top = 1;
+    }
+    while (stack_top) {
+      // Pop next node, skipping it if beyond the closest hit so far
+      stack_top--;
+      if (stack[stack_top].distance > closest_distance)
+        continue;
+      n = stack[stack_top].node;
+      node = &(boxtree->node[n]);
+      // Descend to a terminal node, visiting the nearer child first
+      while (node->num_polys == 0) {
+        left  = n + 1;
+        right = node->offset;
+        hit_left  = (gx3d_Intersect_Ray_Box (&(ray->origin), &inv_direction, closest_distance, &(boxtree->node[left].box), &left_distance) == gxRELATION_INTERSECT);
+        hit_right = (gx3d_Intersect_Ray_Box (&(ray->origin), &inv_direction, closest_distance, &(boxtree->node[right].box), &right_distance) == gxRELATION_INTERSECT);
+        if (hit_left AND hit_right) {
+          DEBUG_ASSERT (stack_top < SAH_MAX_LEVEL);
+          if (left_distance <= right_distance) {
+            stack[stack_top].node     = right;
+            stack[stack_top].distance = right_distance;
+            n = left;
+          }
+          else {
+            stack[stack_top].node     = left;
+            stack[stack_top].distance = left_distance;
+            n = right;
+          }
+          stack_top++;
+        }
+        else if (hit_left)
+          n = left;
+        else if (hit_right)
+          n = right;
+        else 
+          break;
+        node = &(boxtree->node[n]);
+      }
+      // Test against all polys in a terminal node, up to 8 at a time
+      packet.num_triangles = 0;
+      last = node->offset + node->num_polys - 1;
+      for (i=node->offset; i<=last; i++) {
+        // Test against poly box first
+        if (gx3d_Intersect_Ray_Box (&(ray->origin), &inv_direction, closest_distance, &(boxtree->poly_box[i]), &t) == gxRELATION_INTERSECT) {
+          packet_poly[packet.num_triangles] = i;
+          gx3d_SetTrianglePacket (&packet, packet.num_triangles, Get_Vertex (boxtree, boxtree->poly[i].index[0]),
+                                                                 Get_Vertex (boxtree, boxtree->poly[i].index[1]),
+                                                                 Get_Vertex (boxtree, boxtree->poly[i].index[2]));
+        }
+        if ((packet.num_triangles == 8) OR ((i == last) AND packet.num_triangles)) {
+          mask = gx3d_Intersect_Ray_TrianglesFront (ray, &packet, distance);
+          for (lane=0; mask; lane++, mask>>=1)
+            if (mask & 1)
+              // Is this one closer than the closest so far?
+              if ((distance[lane] >= 0) AND (distance[lane] <= closest_distance)) {
+                closest_distance = distance[lane];
+                closest_poly     = packet_poly[lane];
+              }
+          packet.num_triangles = 0;
+        }
+      }
+    }
+  }
+
+  // Compute intersection point
+  if (closest_poly != -1) {
+    gx3d_MultiplyScalarVector (closest_distance, &(ray->direction), intersection);
+    gx3d_AddVector (&(ray->origin), intersection, intersection);
+  }
+
+  return (closest_poly);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Boxtree_Intersect_Rays
+|
+| Output: Intersects an array of rays with a boxtree.  For each ray the
+|   closest poly hit (or -1), its layer, the distance and intersection
+|   point are returned in hits.  Returns # rays that hit a poly.
+|
+| Description: Rays are taken in groups of 8 (if the CPU supports AVX)
+|   or 4 (SSE).  If the rays in a group point in about the same direction
+|   they are traversed together as a packet, testing each node box 
+|   against all the rays at once.  Each ray keeps its own closest hit, so 
+|   the results are the same as calling gx3d_Boxtree_Intersect_Ray() for 
+|   each ray.  An incoherent group would visit the union of the nodes
+|   each of its rays visits, so its rays are traversed one at a time 
+|   instead.  For best results, put rays that are near each other 
+|   (such as rays cast from one location) next to each other in the array.
+|___________________________________________________________________*/
+
+int gx3d_Boxtree_Intersect_Rays (
+  gx3dBoxtree       *boxtree,
+  gx3dRay           *rays,
+  float             *ray_lengths,
+  int                num_rays,
+  gx3dBoxtreeRayHit *hits )
+{
+  int i, j, n, width;
+  int num_hits = 0;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (boxtree);
+  DEBUG_ASSERT (rays);
+  DEBUG_ASSERT (ray_lengths);
+  DEBUG_ASSERT (num_rays >= 0);
+  DEBUG_ASSERT (hits);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  if (gx3d_GetCPUFeatures () & gx3d_CPU_AVX)
+    width = 8;
+  else
+    width = 4;
+
+  for (i=0; i<num_rays; i+=n) {
+    // Get # rays in this group
+    n = num_rays - i;
+    if (n > width)
+      n = width;
+    // Trace as a packet?
+    if ((n > 1) AND Rays_Coherent (&rays[i], n)) {
+      if (width == 8)
+        Intersect_Packet_AVX (boxtree, &rays[i], &ray_lengths[i], n, &hits[i]);
+      else
+        Intersect_Packet_SSE (boxtree, &rays[i], &ray_lengths[i], n, &hits[i]);
+    }
+    // Trace each ray by itself
+    else 
+      for (j=i; j<i+n; j++) {
+        DEBUG_ASSERT (ray_lengths[j] > 0);
+        hits[j].poly = Intersect_Ray (boxtree, &rays[j], ray_lengths[j], &(hits[j].intersection));
+      }
+  }
+
+  // Fill in rest of results
+  for (i=0; i<num_rays; i++) {
+    if (hits[i].poly != -1) {
+      hits[i].layer    = boxtree->poly_layer[hits[i].poly];
+      hits[i].distance = gx3d_Distance_Point_Point (&(rays[i].origin), &(hits[i].intersection));
+      num_hits++;
+    }
+    else {
+      hits[i].layer    = 0;
+      hits[i].distance = 0;
+    }
+  }
+
+  return (num_hits);
+}
+
+/*____________________________________________________________________
+|
+| Function: Rays_Coherent
+|
+| Input: Called from gx3d_Boxtree_Intersect_Rays()
+| Output: Returns true if a group of rays is coherent enough to trace as
+|   a packet.  All ray directions must be in the same octant and within 
+|   a cone (PACKET_MIN_COHERENCE) around the first ray.
+|___________________________________________________________________*/
+
+static bool Rays_Coherent (gx3dRay *rays, int num_rays)
+{
+  int i;
+  gx3dVector *d0, *d;
+  bool coherent = true;
+
+  d0 = &(rays[0].direction);
+  for (i=1; (i<num_rays) AND coherent; i++) {
+    d = &(rays[i].direction);
+    if (((d->x < 0) != (d0->x < 0)) OR ((d->y < 0) != (d0->y < 0)) OR ((d->z < 0) != (d0->z < 0)))
+      coherent = false;
+    else if (gx3d_VectorDotProduct (d, d0) < PACKET_MIN_COHERENCE)
+      coherent = false;
+  }
+
+  return (coherent);
+}
+
+/*____________________________________________________________________
+|
+| Function: Intersect_Packet_SSE
+|
+| Input: Called from gx3d_Boxtree_Intersect_Rays()
+| Output: Intersects a packet of up to 4 rays with a boxtree, using SSE
+|   to test node boxes against all rays at once.  Sets the poly and
+|   intersection members of each hit.
+|___________________________________________________________________*/
+
+static void Intersect_Packet_SSE (
+  gx3dBoxtree       *boxtree,
+  gx3dRay           *rays,
+  float             *ray_lengths,
+  int                num_rays,      // 1-4
+  gx3dBoxtreeRayHit *hits )
+{
+  int i, n, lane, left, right, last, mask, left_mask, right_mask, stack_top, packet_poly[8], packet_mask[8];
+  float ox[4], oy[4], oz[4], ix[4], iy[4], iz[4], tmax[4], left_distance[4], right_distance[4];
+  __m128 origin[3], inv_direction[3], vtmax, vleft, vright;
+  gx3dVector v;
+  gx3dTrianglePacket packet;
+  gx3dBoxtreeNode *node;
+  int stack[SAH_MAX_LEVEL];
+
+  DEBUG_ASSERT ((num_rays >= 1) AND (num_rays <= 4));
+
+/*____________________________________________________________________
+|
+| Load rays into SSE registers (unused lanes have a negative length so they never hit anything)
+|___________________________________________________________________*/
+
+  for (lane=0; lane<4; lane++) {
+    i = (lane < num_rays) ? lane : 0;
+    Get_Inverse_Direction (&(rays[i].direction), &v);
+    ox[lane] = rays[i].origin.x;
+    oy[lane] = rays[i].origin.y;
+    oz[lane] = rays[i].origin.z;
+    ix[lane] = v.x;
+    iy[lane] = v.y;
+    iz[lane] = v.z;
+    tmax[lane] = (lane < num_rays) ? ray_lengths[i] : -1;
+    if (lane < num_rays) {
+      DEBUG_ASSERT (ray_lengths[i] > 0);
+      hits[lane].poly = -1;
+    }
+  }
+  origin[0]        = _mm_loadu_ps (ox);
+  origin[1]        = _mm_loadu_ps (oy);
+  origin[2]        = _mm_loadu_ps (oz);
+  inv_direction[0] = _mm_loadu_ps (ix);
+  inv_direction[1] = _mm_loadu_ps (iy);
+  inv_direction[2] = _mm_loadu_ps (iz);
+  vtmax            = _mm_loadu_ps (tmax);
+
+/*____________________________________________________________________
+|
+| Traverse the tree
+|___________________________________________________________________*/
+
+  // Start with root node (an empty tree has none, so every ray misses)
+  stack_top = 0;
+  if (boxtree->num_nodes) {
+    stack[0]  = 0;
+    stack_top = 1;
+  }
+  while (stack_top) {
+    // Pop next node, skipping it if all rays have already hit something closer
+    n = stack[--stack_top];
+    if (Intersect_Packet_Node_SSE (origin, inv_direction, &vtmax, &(boxtree->node[n].box), &vleft) == 0)
+      continue;
+    node = &(boxtree->node[n]);
+    // Descend to a terminal node, visiting the nearer child first
+    while (node->num_polys == 0) {
+      left  = n + 1;
+      right = node->offset;
+      left_mask  = Intersect_Packet_Node_SSE (origin, inv_direction, &vtmax, &(boxtree->node[left].box),  &vleft);
+      right_mask = Intersect_Packet_Node_SSE (origin, inv_direction, &vtmax, &(boxtree->node[right].box), &vright);
+      if (left_mask AND right_mask) {
+        DEBUG_ASSERT (stack_top < SAH_MAX_LEVEL);
+        _mm_storeu_ps (left_distance,  vleft);
+        _mm_storeu_ps (right_distance, vright);
+        if (Get_Packet_Distance (left_distance, left_mask, 4) <= Get_Packet_Distance (right_distance, right_mask, 4)) {
+          stack[stack_top++] = right;
+          n = left;
+        }
+        else {
+          stack[stack_top++] = left;
+          n = right;
+        }
+      }
+      else if (left_mask)
+        n = left;
+      else if (right_mask)
+        n = right;
+      else
+        break;
+      node = &(boxtree->node[n]);
+    }
+    // Test rays against all polys in a terminal node, up to 8 at a time
+    packet.num_triangles = 0;
+    last = node->offset + node->num_polys - 1;
+    for (i=node->offset; i<=last; i++) {
+      mask = Intersect_Packet_Node_SSE (origin, inv_direction, &vtmax, &(boxtree->poly_box[i]), &vleft);
+      if (mask) {
+        packet_poly[packet.num_triangles] = i;
+        packet_mask[packet.num_triangles] = mask;
+        gx3d_SetTrianglePacket (&packet, packet.num_triangles, Get_Vertex (boxtree, boxtree->poly[i].index[0]),
+                                                               Get_Vertex (boxtree, boxtree->poly[i].index[1]),
+                                                               Get_Vertex (boxtree, boxtree->poly[i].index[2]));
+      }
+      if ((packet.num_triangles == 8) OR ((i == last) AND packet.num_triangles)) {
+        Intersect_Packet_Polys (rays, num_rays, &packet, packet_poly, packet_mask, tmax, hits);
+        vtmax = _mm_loadu_ps (tmax);
+        packet.num_triangles = 0;
+      }
+    }
+  }
+
+  // Compute intersection points
+  for (lane=0; lane<num_rays; lane++)
+    if (hits[lane].poly != -1) {
+      gx3d_MultiplyScalarVector (tmax[lane], &(rays[lane].direction), &(hits[lane].intersection));
+      gx3d_AddVector (&(rays[lane].origin), &(hits[lane].intersection), &(hits[lane].intersection));
+    }
+}
+
+/*____________________________________________________________________
+|
+| Function: Intersect_Packet_Node_SSE
+|
+| Input: Called from Intersect_Packet_SSE()
+| Output: Slab test of 4 rays against a box.  Returns a bit mask of the
+|   rays that intersect the box between 0 and tmax.  Returns the entry 
+|   distance of each ray in distance.
+|___________________________________________________________________*/
+
+static inline int Intersect_Packet_Node_SSE (
+  __m128  *origin,              // x,y,z of 4 rays
+  __m128  *inv_direction,       // x,y,z of 4 rays
+  __m128  *tmax, 
+  gx3dBox *box, 
+  __m128  *distance )
+{
+  __m128 t1, t2, tmin, tfar;
+
+  t1   = _mm_mul_ps (_mm_sub_ps (_mm_set1_ps (box->min.x), origin[0]), inv_direction[0]);
+  t2   = _mm_mul_ps (_mm_sub_ps (_mm_set1_ps (box->max.x), origin[0]), inv_direction[0]);
+  tmin = _mm_max_ps (_mm_setzero_ps (), _mm_min_ps (t1, t2));
+  tfar = _mm_min_ps (*tmax,             _mm_max_ps (t1, t2));
+
+  t1   = _mm_mul_ps (_mm_sub_ps (_mm_set1_ps (box->min.y), origin[1]), inv_direction[1]);
+  t2   = _mm_mul_ps (_mm_sub_ps (_mm_set1_ps (box->max.y), origin[1]), inv_direction[1]);
+  tmin = _mm_max_ps (tmin, _mm_min_ps (t1, t2));
+  tfar = _mm_min_ps (tfar, _mm_max_ps (t1, t2));
+
+  t1   = _mm_mul_ps (_mm_sub_ps (_mm_set1_ps (box->min.z), origin[2]), inv_direction[2]);
+  t2   = _mm_mul_ps (_mm_sub_ps (_mm_set1_ps (box->max.z), origin[2]), inv_direction[2]);
+  tmin = _mm_max_ps (tmin, _mm_min_ps (t1, t2));
+  tfar = _mm_min_ps (tfar, _mm_max_ps (t1, t2));
+
+  *distance = tmin;
+
+  return (_mm_movemask_ps (_mm_cmple_ps (tmin, tfar)));
+}
+
+/*____________________________________________________________________
+|
+| Function: Intersect_Packet_AVX
+|
+| Input: Called from gx3d_Boxtree_Intersect_Rays()
+| Output: Intersects a packet of up to 8 rays with a boxtree, using AVX
+|   to test node boxes against all rays at once.  Sets the poly and
+|   intersection members of each hit.
+|___________________________________________________________________*/
+
+static void Intersect_Packet_AVX (
+  gx3dBoxtree       *boxtree,
+  gx3dRay           *rays,
+  float             *ray_lengths,
+  int                num_rays,      // 1-8
+  gx3dBoxtreeRayHit *hits )
+{
+  int i, n, lane, left, right, last, mask, left_mask, right_mask, stack_top, packet_poly[8], packet_mask[8];
+  float ox[8], oy[8], oz[8], ix[8], iy[8], iz[8], tmax[8], left_distance[8], right_distance[8];
+  __m256 origin[3], inv_direction[3], vtmax, vleft, vright;
+  gx3dVector v;
+  gx3dTrianglePacket packet;
+  gx3dBoxtreeNode *node;
+  int stack[SAH_MAX_LEVEL];
+
+  DEBUG_ASSERT ((num_rays >= 1) AND (num_rays <= 8));
+
+/*____________________________________________________________________
+|
+| Load rays into AVX registers (unused lanes have a negative length so they never hit anything)
+|___________________________________________________________________*/
+
+  for (lane=0; lane<8; lane++) {
+    i = (lane < num_rays) ? lane : 0;
+    Get_Inverse_Direction (&(rays[i].direction), &v);
+    ox[lane] = rays[i].origin.x;
+    oy[lane] = rays[i].origin.y;
+    oz[lane] = rays[i].origin.z;
+    ix[lane] = v.x;
+    iy[lane] = v.y;
+    iz[lane] = v.z;
+    tmax[lane] = (lane < num_rays) ? ray_lengths[i] : -1;
+    if (lane < num_rays) {
+      DEBUG_ASSERT (ray_lengths[i] > 0);
+      hits[lane].poly = -1;
+    }
+  }
+  origin[0]        = _mm256_loadu_ps (ox);
+  origin[1]        = _mm256_loadu_ps (oy);
+  origin[2]        = _mm256_loadu_ps (oz);
+  inv_direction[0] = _mm256_loadu_ps (ix);
+  inv_direction[1] = _mm256_loadu_ps (iy);
+  inv_direction[2] = _mm256_loadu_ps (iz);
+  vtmax            = _mm256_loadu_ps (tmax);
+
+/*____________________________________________________________________
+|
+| Traverse the tree
+|___________________________________________________________________*/
+
+  // Start with root node (an empty tree has none, so every ray misses)
+  stack_top = 0;
+  if (boxtree->num_nodes) {
+    stack[0]  = 0;
+    stack_top = 1;
+  }
+  while (stack_top) {
+    // Pop next node, skipping it if all rays have already hit something closer
+    n = stack[--stack_top];
+    if (Intersect_Packet_Node_AVX (origin, inv_direction, &vtmax, &(boxtree->node[n].box), &vleft) == 0)
+      continue;
+    node = &(boxtree->node[n]);
+    // Descend to a terminal node, visiting the nearer child first
+    while (node->num_polys == 0) {
+      left  = n + 1;
+      right = node->offset;
+      left_mask  = Intersect_Packet_Node_AVX (origin, inv_direction, &vtmax, &(boxtree->node[left].box),  &vleft);
+      right_mask = Intersect_Packet_Node_AVX (origin, inv_direction, &vtmax, &(boxtree->node[right].box), &vright);
+      if (left_mask AND right_mask) {
+        DEBUG_ASSERT (stack_top < SAH_MAX_LEVEL);
+        _mm256_storeu_ps (left_distance,  vleft);
+        _mm256_storeu_ps (right_distance, vright);
+        if (Get_Packet_Distance (left_distance, left_mask, 8) <= Get_Packet_Distance (right_distance, right_mask, 8)) {
+          stack[stack_top++] = right;
+          n = left;
+        }
+        else {
+          stack[stack_top++] = left;
+          n = right;
+        }
+      }
+      else if (left_mask)
+        n = left;
+      else if (right_mask)
+        n = right;
+      else
+        break;
+      node = &(boxtree->node[n]);
+    }
+    // Test rays against all polys in a terminal node, up to 8 at a time
+    packet.num_triangles = 0;
+    last = node->offset + node->num_polys - 1;
+    for (i=node->offset; i<=last; i++) {
+      mask = Intersect_Packet_Node_AVX (origin, inv_direction, &vtmax, &(boxtree->poly_box[i]), &vleft);
+      if (mask) {
+        packet_poly[packet.num_triangles] = i;
+        packet_mask[packet.num_triangles] = mask;
+        gx3d_SetTrianglePacket (&packet, packet.num_triangles, Get_Vertex (boxtree, boxtree->poly[i].index[0]),
+                                                               Get_Vertex (boxtree, boxtree->poly[i].index[1]),
+                                                               Get_Vertex (boxtree, boxtree->poly[i].index[2]));
+      }
+      if ((packet.num_triangles == 8) OR ((i == last) AND packet.num_triangles)) {
+        Intersect_Packet_Polys (rays, num_rays, &packet, packet_poly, packet_mask, tmax, hits);
+        vtmax = _mm256_loadu_ps (tmax);
+        packet.num_triangles = 0;
+      }
+    }
+  }
+
+  // Compute intersection points
+  for (lane=0; lane<num_rays; lane++)
+    if (hits[lane].poly != -1) {
+      gx3d_MultiplyScalarVector (tmax[lane], &(rays[lane].direction), &(hits[lane].intersection));
+      gx3d_AddVector (&(rays[lane].origin), &(hits[lane].intersection), &(hits[lane].intersection));
+    }
+
+  // Avoid AVX to SSE transition penalty in caller
+  _mm256_zeroupper ();
+}
+
+/*____________________________________________________________________
+|
+| Function: Intersect_Packet_Node_AVX
+|
+| Input: Called from Intersect_Packet_AVX()
+| Output: Slab test of 8 rays against a box.  Returns a bit mask of the
+|   rays that intersect the box between 0 and tmax.  Returns the entry 
+|   distance of each ray in distance.
+|___________________________________________________________________*/
+
+static inline int Intersect_Packet_Node_AVX (
+  __m256  *origin,              // x,y,z of 8 rays
+  __m256  *inv_direction,       // x,y,z of 8 rays
+  __m256  *tmax, 
+  gx3dBox *box, 
+  __m256  *distance )
+{
+  __m256 t1, t2, tmin, tfar;
+
+  t1   = _mm256_mul_ps (_mm256_sub_ps (_mm256_set1_ps (box->min.x), origin[0]), inv_direction[0]);
+  t2   = _mm256_mul_ps (_mm256_sub_ps (_mm256_set1_ps (box->max.x), origin[0]), inv_direction[0]);
+  tmin = _mm256_max_ps (_mm256_setzero_ps (), _mm256_min_ps (t1, t2));
+  tfar = _mm256_min_ps (*tmax,                _mm256_max_ps (t1, t2));
+
+  t1   = _mm256_mul_ps (_mm256_sub_ps (_mm256_set1_ps (box->min.y), origin[1]), inv_direction[1]);
+  t2   = _mm256_mul_ps (_mm256_sub_ps (_mm256_set1_ps (box->max.y), origin[1]), inv_direction[1]);
+  tmin = _mm256_max_ps (tmin, _mm256_min_ps (t1, t2));
+  tfar = _mm256_min_ps (tfar, _mm256_max_ps (t1, t2));
+
+  t1   = _mm256_mul_ps (_mm256_sub_ps (_mm256_set1_ps (box->min.z), origin[2]), inv_direction[2]);
+  t2   = _mm256_mul_ps (_mm256_sub_ps (_mm256_set1_ps (box->max.z), origin[2]), inv_direction[2]);
+  tmin = _mm256_max_ps (tmin, _mm256_min_ps (t1, t2));
+  tfar = _mm256_min_ps (tfar, _mm256_max_ps (t1, t2));
+
+  *distance = tmin;
+
+  return (_mm256_movemask_ps (_mm256_cmp_ps (tmin, tfar, _CMP_LE_OQ)));
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Packet_Distance
+|
+| Input: Called from Intersect_Packet_SSE(), Intersect_Packet_AVX()
+| Output: Returns the smallest entry distance of the rays in a packet 
+|   that intersect a box.
+|___________________________________________________________________*/
+
+static inline float Get_Packet_Distance (float *distance, int mask, int num_lanes)
+{
+  int lane;
+  float min_distance = INV_DIRECTION_MAX;
+
+  for (lane=0; lane<num_lanes; lane++)
+    if (mask & (1 << lane))
+      if (distance[lane] < min_distance)
+        min_distance = distance[lane];
+
+  return (min_distance);
+}
+
+/*____________________________________________________________________
+|
+| Function: Intersect_Packet_Polys
+|
+| Input: Called from Intersect_Packet_SSE(), Intersect_Packet_AVX()
+| Output: Intersects each ray of a packet with the triangles (up to 8)
+|   whose boxes it hit.  If a triangle is closer than the closest hit so
+|   far, updates the hit poly and clips the ray length (tmax) to it.
+|___________________________________________________________________*/
+
+static inline void Intersect_Packet_Polys (
+  gx3dRay            *rays,
+  int                 num_rays,
+  gx3dTrianglePacket *packet,
+  int                *packet_poly,   // poly of each triangle
+  int                *packet_mask,   // bit mask of the rays that hit the box of each triangle
+  float              *tmax,
+  gx3dBoxtreeRayHit  *hits )
+{
+  int i, lane, lanes, mask;
+  float distance[8];
+
+  // Get rays that hit any of the boxes
+  lanes = 0;
+  for (i=0; i<packet->num_triangles; i++)
+    lanes |= packet_mask[i];
+
+  for (lane=0; lane<num_rays; lane++)
+    if (lanes & (1 << lane)) {
+      mask = gx3d_Intersect_Ray_TrianglesFront (&rays[lane], packet, distance);
+      for (i=0; mask; i++, mask>>=1)
+        if ((mask & 1) AND (packet_mask[i] & (1 << lane)))
+          // Is this one closer than the closest so far?
+          if ((distance[i] >= 0) AND (distance[i] <= tmax[lane])) {
+            tmax[lane]      = distance[i];
+            hits[lane].poly = packet_poly[i];
+          }
+    }
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Boxtree_Intersect_Ray_Any
+|
+| Output: Returns true if a ray hits any poly in a boxtree within
+|   ray_length.  Faster than gx3d_Boxtree_Intersect_Ray() when only a 
+|   yes/no answer is needed (such as a line of sight check), since it 
+|   stops at the first poly hit instead of searching for the closest one.
+|___________________________________________________________________*/
+
+bool gx3d_Boxtree_Intersect_Ray_Any (
+  gx3dBoxtree *boxtree,
+  gx3dRay     *ray,
+  float        ray_length )
+{
+  int last_poly = -1;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (boxtree);
+  DEBUG_ASSERT (ray);
+  DEBUG_ASSERT (ray_length > 0);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  return (Intersect_Ray_Any (boxtree, ray, ray_length, &last_poly) != -1);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Boxtree_Intersect_Rays_Any
+|
+| Output: Tests an array of rays against a boxtree, setting blocked[i]
+|   to true if ray i hits any poly within ray_lengths[i].  Returns # 
+|   rays blocked.
+|
+| Description: The last poly to block a ray is tested first for the 
+|   next ray.  Rays cast from about the same place towards about the 
+|   same place (such as visibility checks from one location) tend to be
+|   blocked by the same poly, so for best results put rays like that
+|   next to each other in the array.
+|___________________________________________________________________*/
+
+int gx3d_Boxtree_Intersect_Rays_Any (
+  gx3dBoxtree *boxtree,
+  gx3dRay     *rays,
+  float       *ray_lengths,
+  int          num_rays,
+  bool        *blocked )
+{
+  int i;
+  int last_poly = -1;
+  int num_blocked = 0;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (boxtree);
+  DEBUG_ASSERT (rays);
+  DEBUG_ASSERT (ray_lengths);
+  DEBUG_ASSERT (num_rays >= 0);
+  DEBUG_ASSERT (blocked);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  for (i=0; i<num_rays; i++) {
+    DEBUG_ASSERT (ray_lengths[i] > 0);
+    blocked[i] = (Intersect_Ray_Any (boxtree, &rays[i], ray_lengths[i], &last_poly) != -1);
+    if (blocked[i])
+      num_blocked++;
+  }
+
+  return (num_blocked);
+}
+
+/*____________________________________________________________________
+|
+| Function: Intersect_Ray_Any
+|
+| Input: Called from gx3d_Boxtree_Intersect_Ray_Any(), 
+|   gx3d_Boxtree_Intersect_Rays_Any()
+| Output: Returns index of a poly hit by a ray within ray_length or -1 
+|   if none.  last_poly is the poly to test first (-1 if none) and is 
+|   set to the poly hit, if any.
+|
+| Description: Same traversal as Intersect_Ray() but the ray length is 
+|   never clipped and the search ends at the first poly hit.  The 
+|   intersection point isn't computed.
+|___________________________________________________________________*/
+
+static int Intersect_Ray_Any (
+  gx3dBoxtree *boxtree,
+  gx3dRay     *ray,
+  float        ray_length,
+  int         *last_poly )
+{
+  int i, n, left, right, stack_top, last, lane, mask, packet_poly[8];
+  float t, left_distance, right_distance, distance[8];
+  bool hit_left, hit_right;
+  gx3dVector inv_direction;
+  gx3dTrianglePacket packet;
+  gx3dBoxtreeNode *node;
+  int stack[SAH_MAX_LEVEL];
+  int hit_poly = -1;
+
+  // Try the last poly hit first
+  if (*last_poly != -1) {
+    gx3d_SetTrianglePacket (&packet, 0, Get_Vertex (boxtree, boxtree->poly[*last_poly].index[0]),
+                                        Get_Vertex (boxtree, boxtree->poly[*last_poly].index[1]),
+                                        Get_Vertex (boxtree, boxtree->poly[*last_poly].index[2]));
+    if (gx3d_Intersect_Ray_TrianglesFront (ray, &packet, distance) & 1)
+      if ((distance[0] >= 0) AND (distance[0] <= ray_length))
+        return (*last_poly);
+  }
+
+  if (boxtree->num_nodes) {
+    // Precompute reciprocal of ray direction for box tests
+    Get_Inverse_Direction (&(ray->direction), &inv_direction);
+    // Start with root node
+    stack_top = 0;
+    if (gx3d_Intersect_Ray_Box (&(ray->origin), &inv_direction, ray_length, &(boxtree->node[0].box), &t) == gxRELATION_INTERSECT)
+      stack[stack_top++] = 0;
+    while (stack_top AND (hit_poly == -1)) {
+      n = stack[--stack_top];
+      node = &(boxtree->node[n]);
+      // Descend to a terminal node, visiting the nearer child first
+      while (node->num_polys == 0) {
+        left  = n + 1;
+        right = node->offset;
+        hit_left  = (gx3d_Intersect_Ray_Box (&(ray->origin), &inv_direction, ray_length, &(boxtree->node[left].box), &left_distance) == gxRELATION_INTERSECT);
+        hit_right = (gx3d_Intersect_Ray_Box (&(ray->origin), &inv_direction, ray_length, &(boxtree->node[right].box), &right_distance) == gxRELATION_INTERSECT);
+        if (hit_left AND hit_right) {
+          DEBUG_ASSERT (stack_top < SAH_MAX_LEVEL);
+          if (left_distance <= right_distance) {
+            stack[stack_top++] = right;
+            n = left;
+          }
+          else {
+            stack[stack_top++] = left;
+            n = right;
+          }
+        }
+        else if (hit_left)
+          n = left;
+        else if (hit_right)
+          n = right;
+        else 
+          break;
+        node = &(boxtree->node[n]);
+      }
+      // Test against polys in a terminal node, up to 8 at a time, until one is hit
+      packet.num_triangles = 0;
+      last = node->offset + node->num_polys - 1;
+      for (i=node->offset; (i<=last) AND (hit_poly == -1); i++) {
+        // Test against poly box first
+        if (gx3d_Intersect_Ray_Box (&(ray->origin), &inv_direction, ray_length, &(boxtree->poly_box[i]), &t) == gxRELATION_INTERSECT) {
+          packet_poly[packet.num_triangles] = i;
+          gx3d_SetTrianglePacket (&packet, packet.num_triangles, Get_Vertex (boxtree, boxtree->poly[i].index[0]),
+                                                                 Get_Vertex (boxtree, boxtree->poly[i].index[1]),
+                                                                 Get_Vertex (boxtree, boxtree->poly[i].index[2]));
+        }
+        if ((packet.num_triangles == 8) OR ((i == last) AND packet.num_triangles)) {
+          mask = gx3d_Intersect_Ray_TrianglesFront (ray, &packet, distance);
+          for (lane=0; mask AND (hit_poly == -1); lane++, mask>>=1)
+            if (mask & 1)
+              if ((distance[lane] >= 0) AND (distance[lane] <= ray_length))
+                hit_poly = packet_poly[lane];
+          packet.num_triangles = 0;
+        }
+      }
+    }
+  }
+
+  if (hit_poly != -1)
+    *last_poly = hit_poly;
+
+  return (hit_poly);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Boxtree_Intersect_Sphere
+|
+| Output: Finds the polys in a boxtree that intersect a sphere.  Returns 
+|   # of polys intersecting the sphere.  Contact info is returned for 
+|   the first max_contacts polys found.
+|___________________________________________________________________*/
+
+int gx3d_Boxtree_Intersect_Sphere (
+  gx3dBoxtree        *boxtree,
+  gx3dSphere         *sphere,
+  gx3dBoxtreeContact *contacts,     // NULL if not needed
+  int                 max_contacts )
+{
+  int i, n, stack_top;
+  float radius_squared, distance_squared;
+  gx3dVector triangle[3], nearest_point;
+  gx3dBoxtreeNode *node;
+  int stack[SAH_MAX_LEVEL];
+  int num_contacts = 0;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (boxtree);
+  DEBUG_ASSERT (sphere);
+  DEBUG_ASSERT (sphere->radius > 0);
+  DEBUG_ASSERT (max_contacts >= 0);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  radius_squared = sphere->radius * sphere->radius;
+
+  stack_top = 0;
+  if (boxtree->num_nodes) 
+    stack[stack_top++] = 0;
+  while (stack_top) {
+    n = stack[--stack_top];
+    node = &(boxtree->node[n]);
+    if (gx3d_DistanceSquared_Point_Box (&(sphere->center), &(node->box)) > radius_squared)
+      continue;
+    // Nonterminal node?
+    if (node->num_polys == 0) {
+      DEBUG_ASSERT (stack_top+2 <= SAH_MAX_LEVEL);
+      stack[stack_top++] = node->offset;
+      stack[stack_top++] = n + 1;
+    }
+    // Test against all polys in a terminal node
+    else 
+      for (i=node->offset; i<(int)(node->offset+node->num_polys); i++) {
+        if (gx3d_DistanceSquared_Point_Box (&(sphere->center), &(boxtree->poly_box[i])) > radius_squared)
+          continue;
+        triangle[0] = *Get_Vertex (boxtree, boxtree->poly[i].index[0]);
+        triangle[1] = *Get_Vertex (boxtree, boxtree->poly[i].index[1]);
+        triangle[2] = *Get_Vertex (boxtree, boxtree->poly[i].index[2]);
+        gx3d_Nearest_Point_Triangle (&(sphere->center), triangle, &nearest_point);
+        distance_squared = gx3d_DistanceSquared_Point_Point (&(sphere->center), &nearest_point);
+        if (distance_squared <= radius_squared) {
+          if (contacts AND (num_contacts < max_contacts))
+            Set_Contact (boxtree, i, triangle, &(sphere->center), &nearest_point, sphere->radius, &contacts[num_contacts]);
+          num_contacts++;
+        }
+      }
+  }
+
+  return (num_contacts);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Boxtree_Intersect_Capsule
+|
+| Output: Finds the polys in a boxtree that intersect a capsule.  Returns 
+|   # of polys intersecting the capsule.  Contact info is returned for 
+|   the first max_contacts polys found.
+|___________________________________________________________________*/
+
+int gx3d_Boxtree_Intersect_Capsule (
+  gx3dBoxtree        *boxtree,
+  gx3dCapsule        *capsule,
+  gx3dBoxtreeContact *contacts,     // NULL if not needed
+  int                 max_contacts )
+{
+  int i, n, stack_top;
+  float t, radius_squared;
+  gx3dVector direction, inv_direction, triangle[3], segment_point, triangle_point;
+  gx3dBox box;
+  gx3dBoxtreeNode *node;
+  int stack[SAH_MAX_LEVEL];
+  int num_contacts = 0;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (boxtree);
+  DEBUG_ASSERT (capsule);
+  DEBUG_ASSERT (capsule->radius > 0);
+  DEBUG_ASSERT (max_contacts >= 0);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  radius_squared = capsule->radius * capsule->radius;
+
+  // Boxes are tested by intersecting the segment (as a ray of length 1) with each box enlarged by the radius
+  gx3d_SubtractVector (&(capsule->segment.end), &(capsule->segment.start), &direction);
+  Get_Inverse_Direction (&direction, &inv_direction);
+
+  stack_top = 0;
+  if (boxtree->num_nodes) 
+    stack[stack_top++] = 0;
+  while (stack_top) {
+    n = stack[--stack_top];
+    node = &(boxtree->node[n]);
+    Expand_Box (&(node->box), capsule->radius, &box);
+    if (gx3d_Intersect_Ray_Box (&(capsule->segment.start), &inv_direction, 1, &box, &t) == gxRELATION_OUTSIDE)
+      continue;
+    // Nonterminal node?
+    if (node->num_polys == 0) {
+      DEBUG_ASSERT (stack_top+2 <= SAH_MAX_LEVEL);
+      stack[stack_top++] = node->offset;
+      stack[stack_top++] = n + 1;
+    }
+    // Test against all polys in a terminal node
+    else 
+      for (i=node->offset; i<(int)(node->offset+node->num_polys); i++) {
+        Expand_Box (&(boxtree->poly_box[i]), capsule->radius, &box);
+        if (gx3d_Intersect_Ray_Box (&(capsule->segment.start), &inv_direction, 1, &box, &t) == gxRELATION_OUTSIDE)
+          continue;
+        triangle[0] = *Get_Vertex (boxtree, boxtree->poly[i].index[0]);
+        triangle[1] = *Get_Vertex (boxtree, boxtree->poly[i].index[1]);
+        triangle[2] = *Get_Vertex (boxtree, boxtree->poly[i].index[2]);
+        if (Nearest_Segment_Triangle (&(capsule->segment), triangle, &segment_point, &triangle_point) <= radius_squared) {
+          if (contacts AND (num_contacts < max_contacts))
+            Set_Contact (boxtree, i, triangle, &segment_point, &triangle_point, capsule->radius, &contacts[num_contacts]);
+          num_contacts++;
+        }
+      }
+  }
+
+  return (num_contacts);
 }
 
 /*____________________________________________________________________
 |
-| Function: Get_Dynamic_Geometry
+| Function: gx3d_Boxtree_Collide_Sphere
 |
-| Input: Called from Init_Dynamic_Boxtree()
-| Output: Goes through object layer (and child and sibling layers) and 
-|   fills boxtree arrays.
+| Output: Returns collision info regarding a sphere moving relative to
+|   a boxtree.  Returns relation and optionally, the parametric collision
+|   time in the range 0-1 and contact info for the first poly hit.
+|
+|   Returns gxRELATION_OUTSIDE   = no collision occurs
+|           gxRELATION_INTERSECT = sphere collides with a poly
+|
+|   If the sphere is already intersecting a poly, the collision time is 0.
+|
+| Description: The path of the sphere center is traced through the bsp 
+|   tree like a ray, against node boxes enlarged by the radius.  Nodes 
+|   nearer the start are visited first and nodes beyond the earliest 
+|   collision so far are skipped.
 |___________________________________________________________________*/
 
-static void Get_Dynamic_Geometry (gx3dObjectLayer *layer, gx3dBoxtree *boxtree, int *n)
-//static void Get_Dynamic_Geometry (gx3dObjectLayer *layer, gx3dBoxtree *boxtree, int *n, gx3dMatrix m)
+gxRelation gx3d_Boxtree_Collide_Sphere (
+  gx3dBoxtree             *boxtree,
+  gx3dSphere              *sphere,
+  gx3dProjectedTrajectory *ptrajectory,
+  float                   *parametric_collision_time, // NULL if not needed
+  gx3dBoxtreeContact      *contact )                  // NULL if not needed
 {
-  int i;
+  int i, n, left, right, stack_top;
+  float t, left_time, right_time, collision_time;
+  bool hit_left, hit_right;
+  gx3dVector inv_direction, triangle[3], collision_point, closest_point, center;
+  gx3dBox box;
+  gx3dBoxtreeNode *node;
+  struct {
+    int   node;
+    float time;                 // entry time of sphere into node box
+  } stack[SAH_MAX_LEVEL];
+  int closest_poly = -1;
 
 /*____________________________________________________________________
 |
 | Verify input params
 |___________________________________________________________________*/
 
-  DEBUG_ASSERT (layer);
   DEBUG_ASSERT (boxtree);
-  DEBUG_ASSERT (n);
+  DEBUG_ASSERT (sphere);
+  DEBUG_ASSERT (sphere->radius > 0);
+  DEBUG_ASSERT (ptrajectory);
 
 /*____________________________________________________________________
 |
 | Main procedure
 |___________________________________________________________________*/
 
-//***** TO DO: This function needs to compute overall boxtree box 
+  // If the sphere isn't moving, just check for intersection
+  if (gx3d_VectorDotProduct (&(ptrajectory->direction), &(ptrajectory->direction)) == 0) {
+    if (gx3d_Boxtree_Intersect_Sphere (boxtree, sphere, contact, 1) == 0)
+      return (gxRELATION_OUTSIDE);
+    if (parametric_collision_time)
+      *parametric_collision_time = 0;
+    return (gxRELATION_INTERSECT);
+  }
 
-  for (; layer; layer=layer->next) {
-    // Process child layer/s first
-    if (layer->child)
-      Get_Dynamic_Geometry (layer->child, boxtree, n);
-    // Process this layer
-    for (i=0; i<layer->num_polygons; i++) {
-      boxtree->poly_layer[boxtree->num_polygons] = layer;
-      boxtree->poly      [boxtree->num_polygons].index[0] = layer->polygon[i].index[0] + (word)(*n);
-      boxtree->poly      [boxtree->num_polygons].index[1] = layer->polygon[i].index[1] + (word)(*n);
-      boxtree->poly      [boxtree->num_polygons].index[2] = layer->polygon[i].index[2] + (word)(*n);
-      boxtree->num_polygons++;
+  collision_time = 1;
+  Get_Inverse_Direction (&(ptrajectory->direction), &inv_direction);
+
+  stack_top = 0;
+  if (boxtree->num_nodes) {
+    Expand_Box (&(boxtree->node[0].box), sphere->radius, &box);
+    if (gx3d_Intersect_Ray_Box (&(sphere->center), &inv_direction, collision_time, &box, &t) == gxRELATION_INTERSECT) {
+      stack[0].node = 0;
+      stack[0].time = t;
+      stack_top = 1;
+    }
+  }
+  while (stack_top) {
+    // Pop next node, skipping it if beyond the earliest collision so far
+    stack_top--;
+    if (stack[stack_top].time > collision_time)
+      continue;
+    n = stack[stack_top].node;
+    node = &(boxtree->node[n]);
+    // Descend to a terminal node, visiting the nearer child first
+    while (node->num_polys == 0) {
+      left  = n + 1;
+      right = node->offset;
+      Expand_Box (&(boxtree->node[left].box), sphere->radius, &box);
+      hit_left  = (gx3d_Intersect_Ray_Box (&(sphere->center), &inv_direction, collision_time, &box, &left_time) == gxRELATION_INTERSECT);
+      Expand_Box (&(boxtree->node[right].box), sphere->radius, &box);
+      hit_right = (gx3d_Intersect_Ray_Box (&(sphere->center), &inv_direction, collision_time, &box, &right_time) == gxRELATION_INTERSECT);
+      if (hit_left AND hit_right) {
+        DEBUG_ASSERT (stack_top < SAH_MAX_LEVEL);
+        if (left_time <= right_time) {
+          stack[stack_top].node = right;
+          stack[stack_top].time = right_time;
+          n = left;
+        }
+        else {
+          stack[stack_top].node = left;
+          stack[stack_top].time = left_time;
+          n = right;
+        }
+        stack_top++;
+      }
+      else if (hit_left)
+        n = left;
+      else if (hit_right)
+        n = right;
+      else 
+        break;
+      node = &(boxtree->node[n]);
+    }
+    // Test against all polys in a terminal node
+    for (i=node->offset; i<(int)(node->offset+node->num_polys); i++) {
+      Expand_Box (&(boxtree->poly_box[i]), sphere->radius, &box);
+      if (gx3d_Intersect_Ray_Box (&(sphere->center), &inv_direction, collision_time, &box, &t) == gxRELATION_OUTSIDE)
+        continue;
+      triangle[0] = *Get_Vertex (boxtree, boxtree->poly[i].index[0]);
+      triangle[1] = *Get_Vertex (boxtree, boxtree->poly[i].index[1]);
+      triangle[2] = *Get_Vertex (boxtree, boxtree->poly[i].index[2]);
+      if (gx3d_Collide_Sphere_StaticTriangle (sphere, ptrajectory, triangle, &t, &collision_point) == gxRELATION_INTERSECT)
+        // Is this one earlier than the earliest so far?
+        if ((t < collision_time) OR (closest_poly == -1)) {
+          collision_time = t;
+          closest_point  = collision_point;
+          closest_poly   = i;
+        }
     }
-    *n += layer->num_vertices; 
   }
+
+  if (closest_poly == -1)
+    return (gxRELATION_OUTSIDE);
+
+  if (parametric_collision_time)
+    *parametric_collision_time = collision_time;
+  if (contact) {
+    // Get position of sphere at time of collision
+    center.x = sphere->center.x + collision_time * ptrajectory->direction.x;
+    center.y = sphere->center.y + collision_time * ptrajectory->direction.y;
+    center.z = sphere->center.z + collision_time * ptrajectory->direction.z;
+    triangle[0] = *Get_Vertex (boxtree, boxtree->poly[closest_poly].index[0]);
+    triangle[1] = *Get_Vertex (boxtree, boxtree->poly[closest_poly].index[1]);
+    triangle[2] = *Get_Vertex (boxtree, boxtree->poly[closest_poly].index[2]);
+    Set_Contact (boxtree, closest_poly, triangle, &center, &closest_point, sphere->radius, contact);
+  }
+
+  return (gxRELATION_INTERSECT);
 }
 
 /*____________________________________________________________________
 |
-| Function: Make_Dynamic_Tree
+| Function: gx3d_Boxtree_Nearest_Point
 |
-| Input: Called from Init_Static_Boxtree()
-| Output: Creates dynamic bsp tree.  Returns true on success or false 
-|   on any error.
+| Output: Finds the point on the polys of a boxtree nearest to a point.
+|   Returns index of the nearest poly (into the boxtree poly arrays) or
+|   -1 if there are no polys within max_distance (0 = no limit).
+|
+| Description: Branch and bound.  Nodes are visited in order of distance
+|   from the point to the node box, nearer child first, and any node 
+|   farther than the nearest poly found so far is skipped.  Distances 
+|   are compared squared to avoid square roots.
 |___________________________________________________________________*/
 
-static bool Make_Dynamic_Tree (gx3dBoxtree *boxtree)
+int gx3d_Boxtree_Nearest_Point (
+  gx3dBoxtree *boxtree,
+  gx3dVector  *point,
+  gx3dVector  *nearest_point,
+  float       *distance,          // NULL if not needed
+  float        max_distance )
 {
-  bool error = false;
+  int i, n, left, right, stack_top;
+  float left_distance, right_distance, distance_squared, best_distance;
+  gx3dVector triangle[3], poly_point;
+  gx3dBoxtreeNode *node;
+  struct {
+    int   node;
+    float distance;             // squared distance from point to node box
+  } stack[SAH_MAX_LEVEL];
+  int nearest_poly = -1;
 
 /*____________________________________________________________________
 |
@@ -856,356 +3954,762 @@ static bool Make_Dynamic_Tree (gx3dBoxtree *boxtree)
 |___________________________________________________________________*/
 
   DEBUG_ASSERT (boxtree);
+  DEBUG_ASSERT (point);
+  DEBUG_ASSERT (nearest_point);
+  DEBUG_ASSERT (max_distance >= 0);
 
 /*____________________________________________________________________
 |
 | Main procedure
 |___________________________________________________________________*/
 
-  return (NOT error);
+  if (max_distance > 0)
+    best_distance = max_distance * max_distance;
+  else
+    best_distance = NEAREST_MAX_DISTANCE;
+
+  stack_top = 0;
+  if (boxtree->num_nodes) {
+    stack[0].node     = 0;
+    stack[0].distance = gx3d_DistanceSquared_Point_Box (point, &(boxtree->node[0].box));
+    stack_top = 1;
+  }
+  while (stack_top) {
+    // Pop next node, skipping it if farther than the nearest poly so far
+    stack_top--;
+    if (stack[stack_top].distance > best_distance)
+      continue;
+    n = stack[stack_top].node;
+    node = &(boxtree->node[n]);
+    // Descend to a terminal node, visiting the nearer child first
+    while (node->num_polys == 0) {
+      left  = n + 1;
+      right = node->offset;
+      left_distance  = gx3d_DistanceSquared_Point_Box (point, &(boxtree->node[left].box));
+      right_distance = gx3d_DistanceSquared_Point_Box (point, &(boxtree->node[right].box));
+      if (left_distance <= right_distance) {
+        if (left_distance > best_distance)
+          break;
+        if (right_distance <= best_distance) {
+          DEBUG_ASSERT (stack_top < SAH_MAX_LEVEL);
+          stack[stack_top].node     = right;
+          stack[stack_top].distance = right_distance;
+          stack_top++;
+        }
+        n = left;
+      }
+      else {
+        if (right_distance > best_distance)
+          break;
+        if (left_distance <= best_distance) {
+          DEBUG_ASSERT (stack_top < SAH_MAX_LEVEL);
+          stack[stack_top].node     = left;
+          stack[stack_top].distance = left_distance;
+          stack_top++;
+        }
+        n = right;
+      }
+      node = &(boxtree->node[n]);
+    }
+    // Test against all polys in a terminal node
+    for (i=node->offset; i<(int)(node->offset+node->num_polys); i++) {
+      if (gx3d_DistanceSquared_Point_Box (point, &(boxtree->poly_box[i])) > best_distance)
+        continue;
+      triangle[0] = *Get_Vertex (boxtree, boxtree->poly[i].index[0]);
+      triangle[1] = *Get_Vertex (boxtree, boxtree->poly[i].index[1]);
+      triangle[2] = *Get_Vertex (boxtree, boxtree->poly[i].index[2]);
+      gx3d_Nearest_Point_Triangle (point, triangle, &poly_point);
+      distance_squared = gx3d_DistanceSquared_Point_Point (point, &poly_point);
+      // Is this one nearer than the nearest so far?
+      if ((distance_squared < best_distance) OR ((distance_squared == best_distance) AND (nearest_poly == -1))) {
+        best_distance  = distance_squared;
+        *nearest_point = poly_point;
+        nearest_poly   = i;
+      }
+    }
+  }
+
+  if ((nearest_poly != -1) AND distance)
+    *distance = sqrtf (best_distance);
+
+  return (nearest_poly);
 }
 
 /*____________________________________________________________________
 |
-| Function: gx3d_Boxtree_Free
+| Function: gx3d_Boxtree_Intersect_Boxtree
 |
-| Output: Frees all memory for a boxtree.
+| Output: Finds the pairs of polys of two boxtrees that intersect, where
+|   each boxtree is placed in the world by its object to world 
+|   transform.  Returns # of intersecting pairs.  The first max_pairs
+|   pairs found are returned in pairs.
+|
+| Description: The two bsp trees are descended together.  All tests 
+|   are done in the object space of boxtree1, so only the node boxes
+|   and polys of boxtree2 are transformed.  A pair of node boxes is 
+|   tested with separating axes (a transformed node box of boxtree2 is 
+|   an oriented box, not an AAB box) and, if they overlap, the larger 
+|   of the two nodes is split.  Triangle-triangle tests are only done 
+|   for pairs of terminal nodes.
 |___________________________________________________________________*/
 
-void gx3d_Boxtree_Free (gx3dBoxtree *boxtree)
+int gx3d_Boxtree_Intersect_Boxtree (
+  gx3dBoxtree         *boxtree1,
+  gx3dMatrix          *transform1,
+  gx3dBoxtree         *boxtree2,
+  gx3dMatrix          *transform2,
+  gx3dBoxtreePolyPair *pairs,         // NULL if not needed
+  int                  max_pairs )
 {
-  if (boxtree) {
-    // Free all memory for boxtree
-    if (boxtree->poly_layer)
-      free (boxtree->poly_layer);
-    if (boxtree->poly_box)
-      free (boxtree->poly_box);
-    if (boxtree->poly_box_center)
-      free (boxtree->poly_box_center);
-    if (boxtree->poly)
-      free (boxtree->poly);
-    switch (boxtree->type) {
-      case gx3d_BOXTREE_TYPE_STATIC:
-        if (boxtree->s.vertex)
-          free (boxtree->s.vertex);
-        break;
-      case gx3d_BOXTREE_TYPE_DYNAMIC:
-        if (boxtree->d.vertex)
-          free (boxtree->d.vertex);
-        break;
-    }      
-    Free_Subtree (boxtree->root);
-    free (boxtree);
-  }
-}
+  Pair_Context context;
 
 /*____________________________________________________________________
 |
-| Function: Free_Subtree
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (boxtree1);
+  DEBUG_ASSERT (transform1);
+  DEBUG_ASSERT (boxtree2);
+  DEBUG_ASSERT (transform2);
+  DEBUG_ASSERT (max_pairs >= 0);
+
+/*____________________________________________________________________
 |
-| Input: Called from gx3d_Boxtree_Free
-| Output: Frees memory for the bsp subtree of boxtree.
+| Main procedure
 |___________________________________________________________________*/
 
-static void Free_Subtree (gx3dBoxtreeNode *subtree)
-{
-  if (subtree) {
-    // Free left subtree
-    Free_Subtree (subtree->left);
-    // Free right subtree
-    Free_Subtree (subtree->right);
-    // Free memory root of this subtree
-    if (subtree->poly_index)
-      free (subtree->poly_index);
-    free (subtree);
-  }
+  if (NOT Init_Pair_Context (&context, boxtree1, transform1, boxtree2, transform2))
+    return (0);
+  context.pairs      = pairs;
+  context.max_pairs  = max_pairs;
+  context.first_only = false;
+  Intersect_Boxtree (&context);
+
+  return (context.num_pairs);
 }
 
 /*____________________________________________________________________
 |
-| Function: gx3d_Boxtree_SetDirty
+| Function: gx3d_Boxtree_Intersect_Boxtree_Any
 |
-| Output: Sets dirty flag of a dynamic boxtree.  For static boxtrees
-|   this function has no effect.
+| Output: Returns true if any poly of boxtree1 intersects any poly of
+|   boxtree2, where each boxtree is placed in the world by its object 
+|   to world transform.  Stops at the first intersecting pair found.
 |___________________________________________________________________*/
 
-void gx3d_Boxtree_SetDirty (gx3dBoxtree *boxtree)
+bool gx3d_Boxtree_Intersect_Boxtree_Any (
+  gx3dBoxtree *boxtree1,
+  gx3dMatrix  *transform1,
+  gx3dBoxtree *boxtree2,
+  gx3dMatrix  *transform2 )
 {
+  Pair_Context context;
 
 /*____________________________________________________________________
 |
 | Verify input params
 |___________________________________________________________________*/
 
-  DEBUG_ASSERT (boxtree);
+  DEBUG_ASSERT (boxtree1);
+  DEBUG_ASSERT (transform1);
+  DEBUG_ASSERT (boxtree2);
+  DEBUG_ASSERT (transform2);
 
 /*____________________________________________________________________
 |
 | Main procedure
 |___________________________________________________________________*/
 
-  if (boxtree->type == gx3d_BOXTREE_TYPE_DYNAMIC)
-    boxtree->d.dirty = true;
+  if (NOT Init_Pair_Context (&context, boxtree1, transform1, boxtree2, transform2))
+    return (false);
+  context.pairs      = 0;
+  context.max_pairs  = 0;
+  context.first_only = true;
+  Intersect_Boxtree (&context);
+
+  return (context.num_pairs != 0);
 }
 
 /*____________________________________________________________________
 |
-| Function: g3d_Boxtree_Update
+| Function: Init_Pair_Context
+|
+| Input: Called from gx3d_Boxtree_Intersect_Boxtree(),
+|   gx3d_Boxtree_Intersect_Boxtree_Any()
+| Output: Computes the transform from boxtree2 object space to boxtree1
+|   object space and the separating axes used to test node boxes.  
+|   Returns false if transform1 can't be inverted.
 |
-| Output: Recomputes bsp tree of boxtree.
+| Description: The axes are the 3 face normals of a node box of 
+|   boxtree1 (the coordinate axes), the 3 face normals of a transformed
+|   node box of boxtree2 and the 9 cross products of their edge 
+|   directions.  They only depend on the transform, so they are computed
+|   once per query.  Cross products of (nearly) parallel edges are 
+|   dropped, which only makes the node box test more conservative.
 |___________________________________________________________________*/
 
-void g3d_Boxtree_Update (gx3dBoxtree *boxtree)
+static bool Init_Pair_Context (
+  Pair_Context *context,
+  gx3dBoxtree  *boxtree1,
+  gx3dMatrix   *transform1,
+  gx3dBoxtree  *boxtree2,
+  gx3dMatrix   *transform2 )
 {
+  int i, j, k;
+  float length, row[3][3], axis[3];
+  gx3dAffineMatrix a, ainverse;
+  gx3dMatrix inverse;
+
+  context->boxtree1  = boxtree1;
+  context->boxtree2  = boxtree2;
+  context->num_pairs = 0;
+
+  gx3d_MatrixToAffineMatrix (transform1, &a);
+  if (NOT gx3d_GetInverseAffineMatrix (&a, &ainverse))
+    return (false);
+  gx3d_AffineMatrixToMatrix (&ainverse, &inverse);
+  gx3d_MultiplyMatrix (transform2, &inverse, &(context->transform));
+
+  // Rows of upper 3x3 part of transform are the edge directions of a transformed node box of boxtree2
+  row[0][0] = context->transform._00;  row[0][1] = context->transform._01;  row[0][2] = context->transform._02;
+  row[1][0] = context->transform._10;  row[1][1] = context->transform._11;  row[1][2] = context->transform._12;
+  row[2][0] = context->transform._20;  row[2][1] = context->transform._21;  row[2][2] = context->transform._22;
+  for (i=0; i<3; i++)
+    context->row_length[i] = row[i][0]*row[i][0] + row[i][1]*row[i][1] + row[i][2]*row[i][2];
+
+  context->num_axes = 0;
+  // Face normals of node box of boxtree1
+  for (i=0; i<3; i++) {
+    axis[0] = axis[1] = axis[2] = 0;
+    axis[i] = 1;
+    memcpy (context->axis[context->num_axes++], axis, sizeof(axis));
+  }
+  // Face normals of transformed node box of boxtree2
+  for (i=0; i<3; i++) {
+    j = (i+1) % 3;
+    k = (i+2) % 3;
+    axis[0] = row[j][1]*row[k][2] - row[j][2]*row[k][1];
+    axis[1] = row[j][2]*row[k][0] - row[j][0]*row[k][2];
+    axis[2] = row[j][0]*row[k][1] - row[j][1]*row[k][0];
+    length = axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2];
+    if (length > PAIR_MIN_AXIS * context->row_length[j] * context->row_length[k])
+      memcpy (context->axis[context->num_axes++], axis, sizeof(axis));
+  }
+  // Cross products of edge directions (coordinate axis i x row j)
+  for (i=0; i<3; i++) 
+    for (j=0; j<3; j++) {
+      axis[i]       = 0;
+      axis[(i+1)%3] = -row[j][(i+2)%3];
+      axis[(i+2)%3] =  row[j][(i+1)%3];
+      length = axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2];
+      if (length > PAIR_MIN_AXIS * context->row_length[j])
+        memcpy (context->axis[context->num_axes++], axis, sizeof(axis));
+    }
 
-/*____________________________________________________________________
-|
-| Verify input params
-|___________________________________________________________________*/
+  for (i=0; i<context->num_axes; i++)
+    for (j=0; j<3; j++) {
+      context->abs_axis[i][j] = fabsf (context->axis[i][j]);
+      context->abs_row[i][j]  = fabsf (context->axis[i][0]*row[j][0] + context->axis[i][1]*row[j][1] + context->axis[i][2]*row[j][2]);
+    }
 
-  DEBUG_ASSERT (boxtree);
+  return (true);
+}
 
 /*____________________________________________________________________
 |
-| Main procedure
+| Function: Intersect_Boxtree
+|
+| Input: Called from gx3d_Boxtree_Intersect_Boxtree(),
+|   gx3d_Boxtree_Intersect_Boxtree_Any()
+| Output: Descends the bsp trees of both boxtrees together, testing
+|   the polys of each pair of overlapping terminal nodes.  Pairs of 
+|   intersecting polys are counted in context->num_pairs.
+|
+| Description: The stack of node pairs starts on the C stack, big enough
+|   for two trees of SAH_MAX_LEVEL levels, and is moved to the heap and 
+|   grown as needed for deeper trees.
 |___________________________________________________________________*/
 
-  switch (boxtree->type) {
-    case gx3d_BOXTREE_TYPE_STATIC:
-      Update_Static_Boxtree (boxtree);
-      break;
-    case gx3d_BOXTREE_TYPE_DYNAMIC:
-      Update_Dynamic_Boxtree (boxtree);
-      break;
-  }      
+static void Intersect_Boxtree (Pair_Context *context)
+{
+  int n1, n2, stack_top, max_stack;
+  float size1, size2;
+  gx3dBoxtreeNode *node1, *node2;
+  Node_Pair local_stack[2*SAH_MAX_LEVEL];
+  Node_Pair *stack, *new_stack;
+
+  stack     = local_stack;
+  max_stack = 2*SAH_MAX_LEVEL;
+
+  stack_top = 0;
+  if (context->boxtree1->num_nodes AND context->boxtree2->num_nodes) {
+    stack[0].node1 = 0;
+    stack[0].node2 = 0;
+    stack_top = 1;
+  }
+  while (stack_top) {
+    stack_top--;
+    n1 = stack[stack_top].node1;
+    n2 = stack[stack_top].node2;
+    node1 = &(context->boxtree1->node[n1]);
+    node2 = &(context->boxtree2->node[n2]);
+    if (NOT Overlap_Node_Node (context, &(node1->box), &(node2->box)))
+      continue;
+    // Both terminal nodes?
+    if (node1->num_polys AND node2->num_polys) {
+      if (Intersect_Leaf_Leaf (context, node1, node2))
+        break;
+      continue;
+    }
+    // Split the larger node (comparing squared diagonals in boxtree1 space)
+    if (node1->num_polys)
+      size1 = size2 = 0;
+    else if (node2->num_polys) {
+      size1 = 1;
+      size2 = 0;
+    }
+    else {
+      size1 = (node1->box.max.x - node1->box.min.x) * (node1->box.max.x - node1->box.min.x) +
+              (node1->box.max.y - node1->box.min.y) * (node1->box.max.y - node1->box.min.y) +
+              (node1->box.max.z - node1->box.min.z) * (node1->box.max.z - node1->box.min.z);
+      size2 = (node2->box.max.x - node2->box.min.x) * (node2->box.max.x - node2->box.min.x) * context->row_length[0] +
+              (node2->box.max.y - node2->box.min.y) * (node2->box.max.y - node2->box.min.y) * context->row_length[1] +
+              (node2->box.max.z - node2->box.min.z) * (node2->box.max.z - node2->box.min.z) * context->row_length[2];
+    }
+    // Grow the stack if full
+    if (stack_top+2 > max_stack) {
+      new_stack = (Node_Pair *) malloc (2 * max_stack * sizeof(Node_Pair));
+      if (new_stack == 0) {
+        gxError ("Intersect_Boxtree(): Can't allocate memory");
+        break;
+      }
+      memcpy (new_stack, stack, stack_top * sizeof(Node_Pair));
+      if (stack != local_stack)
+        free (stack);
+      stack      = new_stack;
+      max_stack *= 2;
+    }
+    if (size1 > size2) {
+      stack[stack_top].node1   = node1->offset;
+      stack[stack_top++].node2 = n2;
+      stack[stack_top].node1   = n1 + 1;
+      stack[stack_top++].node2 = n2;
+    }
+    else {
+      stack[stack_top].node1   = n1;
+      stack[stack_top++].node2 = node2->offset;
+      stack[stack_top].node1   = n1;
+      stack[stack_top++].node2 = n2 + 1;
+    }
+  }
+
+  if (stack != local_stack)
+    free (stack);
 }
 
 /*____________________________________________________________________
 |
-| Function: Update_Static_Boxtree
+| Function: Overlap_Node_Node
 |
-| Output: Updates a static boxtree. This will typically happen after a
-|   call to gx3d_TransformObject() or gx3d_TransformObjectLayer() which
-|   both permanently transform the vertices of an object.  In that case
-|   the boxtree bsp tree needs to be rebuilt from scratch.
+| Input: Called from Intersect_Boxtree()
+| Output: Returns true if a node box of boxtree1 and a node box of 
+|   boxtree2 (transformed into boxtree1 space) overlap.
+|
+| Description: The boxes are projected onto each separating axis as
+|   intervals around their centers.  The radius of a box on an axis is
+|   the sum of its half sizes times the absolute dot products of the 
+|   axis with the box edge directions.
 |___________________________________________________________________*/
 
-static void Update_Static_Boxtree (gx3dBoxtree *boxtree)
+static inline bool Overlap_Node_Node (Pair_Context *context, gx3dBox *box1, gx3dBox *box2)
 {
+  int i;
+  float distance, radius, half1[3], half2[3];
+  gx3dVector center1, center2, d;
+
+  center1.x = (box1->min.x + box1->max.x) * 0.5f;
+  center1.y = (box1->min.y + box1->max.y) * 0.5f;
+  center1.z = (box1->min.z + box1->max.z) * 0.5f;
+  half1[0]  = (box1->max.x - box1->min.x) * 0.5f;
+  half1[1]  = (box1->max.y - box1->min.y) * 0.5f;
+  half1[2]  = (box1->max.z - box1->min.z) * 0.5f;
+  center2.x = (box2->min.x + box2->max.x) * 0.5f;
+  center2.y = (box2->min.y + box2->max.y) * 0.5f;
+  center2.z = (box2->min.z + box2->max.z) * 0.5f;
+  half2[0]  = (box2->max.x - box2->min.x) * 0.5f;
+  half2[1]  = (box2->max.y - box2->min.y) * 0.5f;
+  half2[2]  = (box2->max.z - box2->min.z) * 0.5f;
+  // Transform center of box2 into boxtree1 space
+  gx3d_MultiplyVectorMatrix (&center2, &(context->transform), &d);
+  gx3d_SubtractVector (&d, &center1, &d);
+
+  for (i=0; i<context->num_axes; i++) {
+    distance = context->axis[i][0] * d.x + context->axis[i][1] * d.y + context->axis[i][2] * d.z;
+    radius = context->abs_axis[i][0] * half1[0] + context->abs_axis[i][1] * half1[1] + context->abs_axis[i][2] * half1[2] +
+             context->abs_row[i][0]  * half2[0] + context->abs_row[i][1]  * half2[1] + context->abs_row[i][2]  * half2[2];
+    if (fabsf (distance) > radius * PAIR_BOX_TOLERANCE)
+      return (false);
+  }
+
+  return (true);
+}
 
 /*____________________________________________________________________
 |
-| Verify input params
+| Function: Intersect_Leaf_Leaf
+|
+| Input: Called from Intersect_Boxtree()
+| Output: Tests each poly of a terminal node of boxtree1 against each
+|   poly of a terminal node of boxtree2, adding intersecting pairs to
+|   the results.  Returns true if the query is done (a pair was found
+|   and only the first one is wanted).
 |___________________________________________________________________*/
 
-  DEBUG_ASSERT (boxtree);
+static bool Intersect_Leaf_Leaf (Pair_Context *context, gx3dBoxtreeNode *node1, gx3dBoxtreeNode *node2)
+{
+  int i, j, k;
+  gx3dVector triangle1[3], triangle2[3];
+  gx3dBox box;
+  gx3dBoxtree *boxtree1 = context->boxtree1;
+  gx3dBoxtree *boxtree2 = context->boxtree2;
+  gx3dBoxtreePolyPair *pair;
+
+  for (j=node2->offset; j<(int)(node2->offset+node2->num_polys); j++) {
+    // Transform poly of boxtree2 into boxtree1 space
+    for (k=0; k<3; k++)
+      gx3d_MultiplyVectorMatrix (Get_Vertex (boxtree2, boxtree2->poly[j].index[k]), &(context->transform), &triangle2[k]);
+    box.min = box.max = triangle2[0];
+    for (k=1; k<3; k++) {
+      box.min.x = Min (box.min.x, triangle2[k].x);
+      box.min.y = Min (box.min.y, triangle2[k].y);
+      box.min.z = Min (box.min.z, triangle2[k].z);
+      box.max.x = Max (box.max.x, triangle2[k].x);
+      box.max.y = Max (box.max.y, triangle2[k].y);
+      box.max.z = Max (box.max.z, triangle2[k].z);
+    }
+    if (NOT Boxes_Overlap (&box, &(node1->box)))
+      continue;
+    for (i=node1->offset; i<(int)(node1->offset+node1->num_polys); i++) {
+      if (NOT Boxes_Overlap (&box, &(boxtree1->poly_box[i])))
+        continue;
+      triangle1[0] = *Get_Vertex (boxtree1, boxtree1->poly[i].index[0]);
+      triangle1[1] = *Get_Vertex (boxtree1, boxtree1->poly[i].index[1]);
+      triangle1[2] = *Get_Vertex (boxtree1, boxtree1->poly[i].index[2]);
+      if (gx3d_Relation_Triangle_Triangle (triangle1, triangle2) == gxRELATION_INTERSECT) {
+        if (context->pairs AND (context->num_pairs < context->max_pairs)) {
+          pair = &(context->pairs[context->num_pairs]);
+          pair->poly1  = i;
+          pair->poly2  = j;
+          pair->layer1 = boxtree1->poly_layer[i];
+          pair->layer2 = boxtree2->poly_layer[j];
+        }
+        context->num_pairs++;
+        if (context->first_only)
+          return (true);
+      }
+    }
+  }
+
+  return (false);
+}
 
 /*____________________________________________________________________
 |
-| Main procedure
+| Function: Boxes_Overlap
+|
+| Input: Called from Intersect_Leaf_Leaf()
+| Output: Returns true if two boxes overlap (or touch).
 |___________________________________________________________________*/
 
-  // Free current bsp tree
-  Free_Subtree (boxtree->root);
-  // Recompute bound boxes
-  Get_Static_Bound_Box (boxtree);
-  // Recompute bsp tree
-  Make_Static_Tree (boxtree);
+static inline bool Boxes_Overlap (gx3dBox *box1, gx3dBox *box2)
+{
+  return ((box1->min.x <= box2->max.x) AND (box2->min.x <= box1->max.x) AND
+          (box1->min.y <= box2->max.y) AND (box2->min.y <= box1->max.y) AND
+          (box1->min.z <= box2->max.z) AND (box2->min.z <= box1->max.z));
 }
 
 /*____________________________________________________________________
 |
-| Function: Update_Dynamic_Boxtree
+| Function: Set_Contact
 |
-| Output: Updates a static boxtree.
+| Input: Called from gx3d_Boxtree_Intersect_Sphere(), 
+|   gx3d_Boxtree_Intersect_Capsule(), gx3d_Boxtree_Collide_Sphere()
+| Output: Fills in contact info for a poly given the point on the poly
+|   nearest to the center of the sphere (or capsule segment).  
 |___________________________________________________________________*/
 
-static void Update_Dynamic_Boxtree (gx3dBoxtree *boxtree)
+static void Set_Contact (
+  gx3dBoxtree        *boxtree,
+  int                 poly,
+  gx3dVector         *triangle,
+  gx3dVector         *center,         // center of sphere (or nearest point on capsule segment)
+  gx3dVector         *point,          // nearest point on poly
+  float               radius,
+  gx3dBoxtreeContact *contact )
 {
+  float distance;
+  gx3dVector v;
+
+  contact->poly   = poly;
+  contact->layer  = boxtree->poly_layer[poly];
+  contact->point  = *point;
+  gx3d_SubtractVector (center, point, &v);
+  distance = sqrtf (gx3d_VectorDotProduct (&v, &v));
+  // Use the normal of the poly if the center is on the poly
+  if (distance > radius * CONTACT_MIN_DISTANCE) 
+    gx3d_MultiplyScalarVector (1 / distance, &v, &(contact->normal));
+  else
+    gx3d_SurfaceNormal (&triangle[0], &triangle[1], &triangle[2], &(contact->normal));
+  contact->depth = Max (radius - distance, 0);
+}
 
 /*____________________________________________________________________
 |
-| Verify input params
+| Function: Expand_Box
+|
+| Input: Called from gx3d_Boxtree_Intersect_Capsule(), 
+|   gx3d_Boxtree_Collide_Sphere()
+| Output: Returns a box enlarged by a distance on all sides.
 |___________________________________________________________________*/
 
-  DEBUG_ASSERT (boxtree);
+static inline void Expand_Box (gx3dBox *box, float distance, gx3dBox *new_box)
+{
+  new_box->min.x = box->min.x - distance;
+  new_box->min.y = box->min.y - distance;
+  new_box->min.z = box->min.z - distance;
+  new_box->max.x = box->max.x + distance;
+  new_box->max.y = box->max.y + distance;
+  new_box->max.z = box->max.z + distance;
+}
 
 /*____________________________________________________________________
 |
-| Main procedure
+| Function: Nearest_Segment_Triangle
+|
+| Input: Called from gx3d_Boxtree_Intersect_Capsule()
+| Output: Returns the squared distance between a line segment and a 
+|   triangle and the nearest points on each.
+|
+| Description: The nearest points are between an endpoint of the 
+|   segment and the triangle, between the point where the segment crosses
+|   the plane of the triangle and the triangle, or between the segment
+|   and an edge of the triangle.
 |___________________________________________________________________*/
 
+static float Nearest_Segment_Triangle (
+  gx3dLine   *segment, 
+  gx3dVector *triangle, 
+  gx3dVector *segment_point, 
+  gx3dVector *triangle_point )
+{
+  int i;
+  float d, d1, d2, t, distance;
+  gx3dVector p1, p2;
+  gx3dPlane plane;
+  gx3dLine edge;
+
+  // Check segment endpoints against triangle
+  gx3d_Nearest_Point_Triangle (&(segment->start), triangle, triangle_point);
+  *segment_point = segment->start;
+  distance = gx3d_DistanceSquared_Point_Point (segment_point, triangle_point);
+  gx3d_Nearest_Point_Triangle (&(segment->end), triangle, &p2);
+  d = gx3d_DistanceSquared_Point_Point (&(segment->end), &p2);
+  if (d < distance) {
+    distance        = d;
+    *segment_point  = segment->end;
+    *triangle_point = p2;
+  }
+  // Check where the segment crosses the plane of the triangle
+  gx3d_GetPlane (&triangle[0], &triangle[1], &triangle[2], &plane);
+  d1 = gx3d_Distance_Point_Plane (&(segment->start), &plane);
+  d2 = gx3d_Distance_Point_Plane (&(segment->end),   &plane);
+  if ((((d1 < 0) AND (d2 > 0)) OR ((d1 > 0) AND (d2 < 0)))) {
+    t = d1 / (d1 - d2);
+    p1.x = segment->start.x + t * (segment->end.x - segment->start.x);
+    p1.y = segment->start.y + t * (segment->end.y - segment->start.y);
+    p1.z = segment->start.z + t * (segment->end.z - segment->start.z);
+    gx3d_Nearest_Point_Triangle (&p1, triangle, &p2);
+    d = gx3d_DistanceSquared_Point_Point (&p1, &p2);
+    if (d < distance) {
+      distance        = d;
+      *segment_point  = p1;
+      *triangle_point = p2;
+    }
+  }
+  // Check segment against triangle edges
+  for (i=0; i<3; i++) {
+    edge.start = triangle[i];
+    edge.end   = triangle[(i+1)%3];
+    d = Nearest_Segment_Segment (segment, &edge, &p1, &p2);
+    if (d < distance) {
+      distance        = d;
+      *segment_point  = p1;
+      *triangle_point = p2;
+    }
+  }
 
+  return (distance);
 }
 
 /*____________________________________________________________________
 |
-| Function: g3d_Boxtree_Intersect_Ray
+| Function: Nearest_Segment_Segment
 |
-| Output: Returns intersection of an infinite ray with a boxtree.
+| Input: Called from Nearest_Segment_Triangle()
+| Output: Returns the squared distance between two line segments and the
+|   nearest points on each.
 |
-|   Returns gxRELATION_OUTSIDE     = ray outside all geometry in boxtree (doesn't intersect)
-|           gxRELATION_INTERSECT * = ray intersects (or is inside) a poly
-|
-|   * Optionally returns distance, intersection point and pointer to
-|     layer name (if any) of the layer containing the poly hit.
+| Reference: Real-Time Collision Detection, pg. 149
 |___________________________________________________________________*/
 
-gxRelation gx3d_Boxtree_Intersect_Ray (
-  gx3dBoxtree *boxtree,         
-  gx3dRay     *ray,
-  float        ray_length,     
-  float       *distance,        // optional
-  gx3dVector  *intersection,    // optional
-  char       **name )           // optional
+static float Nearest_Segment_Segment (
+  gx3dLine   *segment1, 
+  gx3dLine   *segment2, 
+  gx3dVector *point1, 
+  gx3dVector *point2 )
 {
-  bool intersection_found;
-  float closest_distance;
-  gx3dVector intersection_point;
-  gxRelation result;
+  float a, b, c, e, f, denom, s, t;
+  gx3dVector d1, d2, r;
+
+  gx3d_SubtractVector (&(segment1->end),   &(segment1->start), &d1);
+  gx3d_SubtractVector (&(segment2->end),   &(segment2->start), &d2);
+  gx3d_SubtractVector (&(segment1->start), &(segment2->start), &r);
+  a = gx3d_VectorDotProduct (&d1, &d1);
+  e = gx3d_VectorDotProduct (&d2, &d2);
+  f = gx3d_VectorDotProduct (&d2, &r);
+
+  // Both segments degenerate into points?
+  if ((a == 0) AND (e == 0)) {
+    s = 0;
+    t = 0;
+  }
+  // First segment degenerates into a point?
+  else if (a == 0) {
+    s = 0;
+    t = Clamp (f / e, 0, 1);
+  }
+  else {
+    c = gx3d_VectorDotProduct (&d1, &r);
+    // Second segment degenerates into a point?
+    if (e == 0) {
+      t = 0;
+      s = Clamp (-c / a, 0, 1);
+    }
+    else {
+      b = gx3d_VectorDotProduct (&d1, &d2);
+      denom = a*e - b*b;
+      // If segments not parallel, compute nearest point on line 1 to line 2 and clamp to segment 1
+      if (denom != 0)
+        s = Clamp ((b*f - c*e) / denom, 0, 1);
+      else
+        s = 0;
+      // Compute point on line 2 nearest to point on segment 1
+      t = (b*s + f) / e;
+      // If t outside segment 2, clamp it and recompute s
+      if (t < 0) {
+        t = 0;
+        s = Clamp (-c / a, 0, 1);
+      }
+      else if (t > 1) {
+        t = 1;
+        s = Clamp ((b - c) / a, 0, 1);
+      }
+    }
+  }
+
+  point1->x = segment1->start.x + d1.x * s;
+  point1->y = segment1->start.y + d1.y * s;
+  point1->z = segment1->start.z + d1.z * s;
+  point2->x = segment2->start.x + d2.x * t;
+  point2->y = segment2->start.y + d2.y * t;
+  point2->z = segment2->start.z + d2.z * t;
+
+  return (gx3d_DistanceSquared_Point_Point (point1, point2));
+}
 
 /*____________________________________________________________________
 |
-| Verify input params
+| Function: Clamp
+|
+| Input: Called from Nearest_Segment_Segment()
+| Output: Returns a value clamped to a range.
 |___________________________________________________________________*/
 
-  DEBUG_ASSERT (boxtree);
-  DEBUG_ASSERT (ray);
-  DEBUG_ASSERT (ray_length > 0);
+static inline float Clamp (float f, float min, float max)
+{
+  if (f < min)
+    return (min);
+  else if (f > max)
+    return (max);
+  else
+    return (f);
+}
 
 /*____________________________________________________________________
 |
-| Main procedure
+| Function: Get_Inverse_Direction
+|
+| Input: Called from Intersect_Ray(), Intersect_Packet_SSE(), 
+|   Intersect_Packet_AVX(), gx3d_Boxtree_Intersect_Capsule(),
+|   gx3d_Boxtree_Collide_Sphere()
+| Output: Computes the reciprocal of each component of a ray direction.
+|   Zero components are replaced with a large value (instead of infinity)
+|   so box tests never compute 0 * infinity.
 |___________________________________________________________________*/
 
-  intersection_found = false;
-  Subtree_Intersect_Ray (boxtree, boxtree->root, ray, ray_length, &intersection_found, &intersection_point, &closest_distance, name);
-  if (intersection_found) {
-    result = gxRELATION_INTERSECT;
-    if (distance) 
-      *distance = gx3d_Distance_Point_Point (&ray->origin, &intersection_point);
-    if (intersection)
-      *intersection = intersection_point;
-  }
-  else
-    result = gxRELATION_OUTSIDE;
-
-  return (result);
+static void Get_Inverse_Direction (gx3dVector *direction, gx3dVector *inv_direction)
+{
+  inv_direction->x = (direction->x != 0) ? 1 / direction->x : INV_DIRECTION_MAX;
+  inv_direction->y = (direction->y != 0) ? 1 / direction->y : INV_DIRECTION_MAX;
+  inv_direction->z = (direction->z != 0) ? 1 / direction->z : INV_DIRECTION_MAX;
 }
 
 /*____________________________________________________________________
 |
-| Function: Subtree_Intersect_Ray
+| Function: Get_Vertex
 |
-| Input: Called from gx3d_Boxtree_Intersect_Ray()
-| Output: Returns intersection information of ray with boxtree
+| Input: Called from Intersect_Ray(), Intersect_Packet_SSE(), Intersect_Packet_AVX(),
+|   and the sphere and capsule query functions
+| Output: Returns a pointer to a vertex of a static or dynamic boxtree.
 |___________________________________________________________________*/
 
-static void Subtree_Intersect_Ray (
-  gx3dBoxtree     *boxtree,
-  gx3dBoxtreeNode *subtree,         
-  gx3dRay         *ray,
-  float            ray_length,     
-  bool            *intersection_found,
-  gx3dVector      *intersection,
-  float           *closest_distance,
-  char           **name )               // optional
+static inline gx3dVector *Get_Vertex (gx3dBoxtree *boxtree, int index)
 {
-  int i;
-  float new_distance;
-  gx3dVector intersection_point, triangle[3];
-  gxRelation result;
+  if (boxtree->type == gx3d_BOXTREE_TYPE_STATIC)
+    return (boxtree->s.vertex[index]);
+  else
+    return (&(boxtree->d.vertex[index]));
+}
 
 /*____________________________________________________________________
 |
-| Verify input params
+| Function: Min
+|
+| Input: Called from Intersect_Leaf_Leaf()
+| Output: Returns minimum of two values.
 |___________________________________________________________________*/
 
-  DEBUG_ASSERT (boxtree);
-  DEBUG_ASSERT (subtree);
-  DEBUG_ASSERT (ray);
-  DEBUG_ASSERT (ray_length > 0);
-  DEBUG_ASSERT (intersection_found);
-  DEBUG_ASSERT (intersection);
-  DEBUG_ASSERT (closest_distance);
+static inline float Min (float f1, float f2)
+{
+  if (f1 < f2)
+    return (f1);
+  else
+    return (f2);
+}
 
 /*____________________________________________________________________
 |
-| Main procedure
+| Function: Max
+|
+| Input: Called from Intersect_Leaf_Leaf(), Set_Contact()
+| Output: Returns maximum of two values.
 |___________________________________________________________________*/
 
-    // Does ray intersect (or is inside of) box for this subtree?
-/*
-char str[200];
-debug_WriteFile ("(box)");
-sprintf (str, "  xmin = %f", subtree->box.min.x);
-debug_WriteFile (str);
-sprintf (str, "  ymin = %f", subtree->box.min.y);
-debug_WriteFile (str);
-sprintf (str, "  zmin = %f", subtree->box.min.z);
-debug_WriteFile (str);
-sprintf (str, "  xmax = %f", subtree->box.max.x);
-debug_WriteFile (str);
-sprintf (str, "  ymax = %f", subtree->box.max.y);
-debug_WriteFile (str);
-sprintf (str, "  zmax = %f", subtree->box.max.z);
-debug_WriteFile (str);
-debug_WriteFile ("(ray)");
-sprintf (str, "  origin = %f,%f,%f", ray->origin.x, ray->origin.y, ray->origin.z);
-debug_WriteFile (str);
-sprintf (str, "  direction = %f,%f,%f", ray->direction.x, ray->direction.y, ray->direction.z);
-debug_WriteFile (str);
-sprintf (str, "  length = %f", ray_length);
-debug_WriteFile (str);
-*/
-  if (gx3d_Intersect_Ray_Box (ray, ray_length, &(subtree->box), 0, 0) != gxRELATION_OUTSIDE) {
-//      debug_WriteFile ("Ray intersects 1");
-    // Is this a nonterminal node?
-    if (subtree->left OR subtree->right) {
-      // Then try intersection with child nodes
-      if (subtree->left)
-        Subtree_Intersect_Ray (boxtree, subtree->left, ray, ray_length, intersection_found, intersection, closest_distance, name);
-      if (subtree->right)
-        Subtree_Intersect_Ray (boxtree, subtree->right, ray, ray_length, intersection_found, intersection, closest_distance, name);
-    }
-    // This is a terminal node, containing bounding boxes for individual polys
-    else {
-      // Test against all poly boxes
-      for (i=0; i<subtree->num_polys; i++) {
-        // Test against 1 poly box
-        result = gx3d_Intersect_Ray_Box (ray, ray_length, &(boxtree->poly_box[subtree->poly_index[i]]), 0, 0);
-        if (result != gxRELATION_OUTSIDE) {
-//            debug_WriteFile ("Ray intersects 2");
-          triangle[0] = *(boxtree->s.vertex[boxtree->poly[subtree->poly_index[i]].index[0]]);
-          triangle[1] = *(boxtree->s.vertex[boxtree->poly[subtree->poly_index[i]].index[1]]);
-          triangle[2] = *(boxtree->s.vertex[boxtree->poly[subtree->poly_index[i]].index[2]]);
-          result = gx3d_Intersect_Ray_TriangleFront (ray, ray_length, triangle, 0, &intersection_point, 0, 0);
-          if (result == gxRELATION_INTERSECT) {
-//              debug_WriteFile ("Ray intersects 3");
-            // Compute distance (squared) from the ray origin to the intersection point
-            new_distance = gx3d_DistanceSquared_Point_Point (&(ray->origin), &intersection_point);
-            // Have any other intersections been found?
-            if (*intersection_found) {
-              // Is this one closer than the closest so far?
-              if (new_distance < *closest_distance) {
-                *closest_distance = new_distance;
-                if (intersection)
-                  *intersection = intersection_point;
-                if (name)
-                  *name = boxtree->poly_layer[i]->name;
-              }
-            }
-            else {
-              *intersection_found = true;
-              *closest_distance = new_distance;
-              if (intersection)
-                *intersection = intersection_point;
-              if (name)
-                *name = boxtree->poly_layer[i]->name;
-            }
-          }
-        }
-      }
-    }
-  }
+static inline float Max (float f1, float f2)
+{
+  if (f1 > f2)
+    return (f1);
+  else
+    return (f2);
 }
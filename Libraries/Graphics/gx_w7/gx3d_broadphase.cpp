@@ -0,0 +1,808 @@
+/*____________________________________________________________________
+|
+| File: gx3d_broadphase.cpp
+|
+| Description: Functions to manipulate gx3dBroadphase.
+|
+| Functions: gx3d_Broadphase_Init
+|            gx3d_Broadphase_Free
+|            gx3d_Broadphase_AddBox
+|             Add_Proxy
+|            gx3d_Broadphase_AddSphere
+|             Sphere_To_Box
+|             Add_Proxy
+|            gx3d_Broadphase_RemoveProxy
+|             Remove_Pair
+|              Find_Pair
+|               Get_Pair_Hash
+|              Delete_Pair
+|            gx3d_Broadphase_SetBoxes
+|            gx3d_Broadphase_SetSpheres
+|             Sphere_To_Box
+|            gx3d_Broadphase_Update
+|             Sort_Axis
+|              Endpoint_Less
+|              Boxes_Overlap
+|              Add_Pair
+|               Find_Pair
+|               Grow_Pairs
+|                Rehash_Pairs
+|              Remove_Pair
+|             Delete_Pair
+|
+| Description: A broadphase finds the pairs of moving objects whose
+|   bound boxes overlap, so the exact (and much slower) collision tests
+|   in gx3d_collide.cpp only need to be done for those pairs instead of
+|   all n*n pairs.
+|
+|   Each object is represented by a proxy - a world space bound box
+|   (spheres are converted to boxes).  The min and max endpoints of all
+|   the proxy boxes are kept sorted on each axis (sweep and prune).  Two
+|   boxes overlap when they overlap on all 3 axes, and they start or
+|   stop overlapping on an axis only when an endpoint of one passes an
+|   endpoint of the other.  Since objects move only a little from frame
+|   to frame, the endpoint arrays are almost sorted already and an
+|   insertion sort puts them back in order in about linear time.  Each
+|   swap of a min endpoint with a max endpoint during the sort is where
+|   a pair starts or stops overlapping.
+|
+|   The set of overlapping pairs is kept in a hash table.  Each call to
+|   gx3d_Broadphase_Update() returns the pairs that started overlapping
+|   and the pairs that stopped overlapping since the previous update.
+|
+|   Typical use each frame: move the objects, update the proxy boxes of
+|   all of them at once with gx3d_Broadphase_SetSpheres() and/or
+|   gx3d_Broadphase_SetBoxes(), then call gx3d_Broadphase_Update().
+|
+| (C) Copyright 2017 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|
+| DEBUG_ASSERTED!
+|___________________________________________________________________*/
+
+//#define DEBUG
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+
+#include <math.h>
+
+#include "dp.h"
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define MIN_PAIRS     64      // min size of pair arrays (and # hash buckets)
+
+// Change to a pair since the last update
+#define PAIR_UNCHANGED  0
+#define PAIR_ADDED      1     // started overlapping
+#define PAIR_REMOVED    2     // stopped overlapping
+
+// Value of active field of a proxy
+#define PROXY_UNUSED    0
+#define PROXY_ACTIVE    1
+#define PROXY_REMOVED   -1    // removed since the last update (not reused until then)
+
+/*___________________
+|
+| Macros
+|__________________*/
+
+#define ENDPOINT_PROXY(_ep_)  ((_ep_)->proxy >> 1)
+#define ENDPOINT_IS_MAX(_ep_) ((_ep_)->proxy & 1)
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static int  Add_Proxy (gx3dBroadphase *broadphase, gx3dBox *box, void *data);
+static void Sphere_To_Box (gx3dSphere *sphere, gx3dBox *box);
+static void Sort_Axis (gx3dBroadphase *broadphase, int axis);
+static inline bool Endpoint_Less (gx3dBroadphaseEndpoint *e1, gx3dBroadphaseEndpoint *e2);
+static inline bool Boxes_Overlap (gx3dBox *box1, gx3dBox *box2);
+static void Add_Pair (gx3dBroadphase *broadphase, int proxy1, int proxy2);
+static void Remove_Pair (gx3dBroadphase *broadphase, int proxy1, int proxy2);
+static int  Find_Pair (gx3dBroadphase *broadphase, int proxy1, int proxy2);
+static inline int Get_Pair_Hash (gx3dBroadphase *broadphase, int proxy1, int proxy2);
+static void Delete_Pair (gx3dBroadphase *broadphase, int pair);
+static bool Grow_Pairs (gx3dBroadphase *broadphase);
+static void Rehash_Pairs (gx3dBroadphase *broadphase);
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Broadphase_Init
+|
+| Output: Creates an empty broadphase with room for max_proxies proxies.
+|   More room is allocated as needed.
+|___________________________________________________________________*/
+
+gx3dBroadphase *gx3d_Broadphase_Init (int max_proxies)
+{
+  int i;
+  bool error;
+  gx3dBroadphase *broadphase = 0;
+
+  error = false;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (max_proxies > 0);
+
+/*____________________________________________________________________
+|
+| Allocate memory
+|___________________________________________________________________*/
+
+  broadphase = (gx3dBroadphase *) calloc (1, sizeof(gx3dBroadphase));
+  if (broadphase == 0)
+    error = true;
+  else {
+    broadphase->proxy = (gx3dBroadphaseProxy *) calloc (max_proxies, sizeof(gx3dBroadphaseProxy));
+    if (broadphase->proxy == 0)
+      error = true;
+    broadphase->max_proxies = max_proxies;
+    for (i=0; i<3; i++) {
+      broadphase->endpoint[i] = (gx3dBroadphaseEndpoint *) malloc (2 * max_proxies * sizeof(gx3dBroadphaseEndpoint));
+      if (broadphase->endpoint[i] == 0)
+        error = true;
+    }
+    // Start with room for about 1 pair per proxy (a power of 2)
+    for (broadphase->max_pairs=MIN_PAIRS; broadphase->max_pairs<max_proxies; broadphase->max_pairs*=2);
+    broadphase->pair         = (gx3dBroadphasePair *) malloc (broadphase->max_pairs * sizeof(gx3dBroadphasePair));
+    broadphase->pair_state   = (int *)                malloc (broadphase->max_pairs * sizeof(int));
+    broadphase->pair_next    = (int *)                malloc (broadphase->max_pairs * sizeof(int));
+    broadphase->pair_hash    = (int *)                malloc (broadphase->max_pairs * sizeof(int));
+    broadphase->added_pair   = (gx3dBroadphasePair *) malloc (broadphase->max_pairs * sizeof(gx3dBroadphasePair));
+    broadphase->removed_pair = (gx3dBroadphasePair *) malloc (broadphase->max_pairs * sizeof(gx3dBroadphasePair));
+    if ((broadphase->pair == 0) OR (broadphase->pair_state == 0) OR (broadphase->pair_next == 0) OR
+        (broadphase->pair_hash == 0) OR (broadphase->added_pair == 0) OR (broadphase->removed_pair == 0))
+      error = true;
+    else
+      for (i=0; i<broadphase->max_pairs; i++)
+        broadphase->pair_hash[i] = -1;
+  }
+
+/*____________________________________________________________________
+|
+| On any error, free memory
+|___________________________________________________________________*/
+
+  if (error) {
+    gx3d_Broadphase_Free (broadphase);
+    broadphase = 0;
+  }
+
+  return (broadphase);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Broadphase_Free
+|
+| Output: Frees all memory for a broadphase.
+|___________________________________________________________________*/
+
+void gx3d_Broadphase_Free (gx3dBroadphase *broadphase)
+{
+  int i;
+
+  if (broadphase) {
+    if (broadphase->proxy)
+      free (broadphase->proxy);
+    for (i=0; i<3; i++)
+      if (broadphase->endpoint[i])
+        free (broadphase->endpoint[i]);
+    if (broadphase->pair)
+      free (broadphase->pair);
+    if (broadphase->pair_state)
+      free (broadphase->pair_state);
+    if (broadphase->pair_next)
+      free (broadphase->pair_next);
+    if (broadphase->pair_hash)
+      free (broadphase->pair_hash);
+    if (broadphase->added_pair)
+      free (broadphase->added_pair);
+    if (broadphase->removed_pair)
+      free (broadphase->removed_pair);
+    free (broadphase);
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Broadphase_AddBox
+|
+| Output: Adds a proxy with a bound box to a broadphase.  Returns id of
+|   the new proxy or -1 on any error.  Pairs with the new proxy are
+|   found at the next update.
+|___________________________________________________________________*/
+
+int gx3d_Broadphase_AddBox (gx3dBroadphase *broadphase, gx3dBox *box, void *data)
+{
+  DEBUG_ASSERT (broadphase);
+  DEBUG_ASSERT (box);
+
+  return (Add_Proxy (broadphase, box, data));
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Broadphase_AddSphere
+|
+| Output: Adds a proxy for a sphere to a broadphase.  Returns id of
+|   the new proxy or -1 on any error.  Pairs with the new proxy are
+|   found at the next update.
+|___________________________________________________________________*/
+
+int gx3d_Broadphase_AddSphere (gx3dBroadphase *broadphase, gx3dSphere *sphere, void *data)
+{
+  gx3dBox box;
+
+  DEBUG_ASSERT (broadphase);
+  DEBUG_ASSERT (sphere);
+
+  Sphere_To_Box (sphere, &box);
+
+  return (Add_Proxy (broadphase, &box, data));
+}
+
+/*____________________________________________________________________
+|
+| Function: Add_Proxy
+|
+| Input: Called from gx3d_Broadphase_AddBox(), gx3d_Broadphase_AddSphere()
+| Output: Adds a proxy to a broadphase.  Returns id of the new proxy or
+|   -1 on any error.
+|
+| Description: The endpoints of the new proxy are put at the end of the
+|   endpoint arrays.  The next update sorts them into place, finding
+|   all the proxies the new one overlaps along the way.
+|___________________________________________________________________*/
+
+static int Add_Proxy (gx3dBroadphase *broadphase, gx3dBox *box, void *data)
+{
+  int i, n, axis;
+  gx3dBroadphaseProxy *proxy;
+  gx3dBroadphaseEndpoint *endpoint[3];
+
+/*____________________________________________________________________
+|
+| Find an unused entry
+|___________________________________________________________________*/
+
+  for (i=0; i<broadphase->max_proxies; i++)
+    if (broadphase->proxy[i].active == PROXY_UNUSED)
+      break;
+
+  // Out of room?
+  if (i == broadphase->max_proxies) {
+    n = 2 * broadphase->max_proxies;
+    proxy = (gx3dBroadphaseProxy *) realloc (broadphase->proxy, n * sizeof(gx3dBroadphaseProxy));
+    if (proxy)
+      broadphase->proxy = proxy;
+    for (i=0; i<3; i++) {
+      endpoint[i] = (gx3dBroadphaseEndpoint *) realloc (broadphase->endpoint[i], 2 * n * sizeof(gx3dBroadphaseEndpoint));
+      if (endpoint[i])
+        broadphase->endpoint[i] = endpoint[i];
+    }
+    if ((proxy == 0) OR (endpoint[0] == 0) OR (endpoint[1] == 0) OR (endpoint[2] == 0)) {
+      gxError ("gx3d_Broadphase_AddBox(): Can't allocate memory");
+      return (-1);
+    }
+    memset (&(broadphase->proxy[broadphase->max_proxies]), 0, (n - broadphase->max_proxies) * sizeof(gx3dBroadphaseProxy));
+    i = broadphase->max_proxies;
+    broadphase->max_proxies = n;
+  }
+
+/*____________________________________________________________________
+|
+| Init the proxy
+|___________________________________________________________________*/
+
+  proxy = &(broadphase->proxy[i]);
+  proxy->box    = *box;
+  proxy->data   = data;
+  proxy->active = PROXY_ACTIVE;
+  broadphase->num_proxies++;
+
+  // Add its endpoints to the end of the endpoint arrays
+  n = broadphase->num_endpoints;
+  for (axis=0; axis<3; axis++) {
+    broadphase->endpoint[axis][n].value   = ((float *)&(box->min))[axis];
+    broadphase->endpoint[axis][n].proxy   = i << 1;
+    broadphase->endpoint[axis][n+1].value = ((float *)&(box->max))[axis];
+    broadphase->endpoint[axis][n+1].proxy = (i << 1) | 1;
+  }
+  broadphase->num_endpoints += 2;
+
+  return (i);
+}
+
+/*____________________________________________________________________
+|
+| Function: Sphere_To_Box
+|
+| Input: Called from gx3d_Broadphase_AddSphere(),
+|   gx3d_Broadphase_SetSpheres()
+| Output: Returns bound box of a sphere.
+|___________________________________________________________________*/
+
+static void Sphere_To_Box (gx3dSphere *sphere, gx3dBox *box)
+{
+  box->min.x = sphere->center.x - sphere->radius;
+  box->min.y = sphere->center.y - sphere->radius;
+  box->min.z = sphere->center.z - sphere->radius;
+  box->max.x = sphere->center.x + sphere->radius;
+  box->max.y = sphere->center.y + sphere->radius;
+  box->max.z = sphere->center.z + sphere->radius;
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Broadphase_RemoveProxy
+|
+| Output: Removes a proxy from a broadphase.  All pairs with the proxy
+|   are returned as removed pairs at the next update.  The id of the
+|   proxy isn't reused until after the next update.
+|___________________________________________________________________*/
+
+void gx3d_Broadphase_RemoveProxy (gx3dBroadphase *broadphase, int proxy)
+{
+  int i, j, axis;
+  gx3dBroadphaseEndpoint *endpoint;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (broadphase);
+  DEBUG_ASSERT ((proxy >= 0) AND (proxy < broadphase->max_proxies));
+  DEBUG_ASSERT (broadphase->proxy[proxy].active == PROXY_ACTIVE);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  if (broadphase->proxy[proxy].active == PROXY_ACTIVE) {
+    // Remove all pairs with this proxy (going backwards since removing a pair may move the last pair)
+    for (i=broadphase->num_pairs-1; i>=0; i--)
+      if ((broadphase->pair[i].proxy1 == proxy) OR (broadphase->pair[i].proxy2 == proxy))
+        Remove_Pair (broadphase, broadphase->pair[i].proxy1, broadphase->pair[i].proxy2);
+    // Remove its endpoints
+    for (axis=0; axis<3; axis++) {
+      endpoint = broadphase->endpoint[axis];
+      for (i=0, j=0; i<broadphase->num_endpoints; i++)
+        if (ENDPOINT_PROXY(&endpoint[i]) != proxy)
+          endpoint[j++] = endpoint[i];
+    }
+    broadphase->num_endpoints -= 2;
+    broadphase->proxy[proxy].active = PROXY_REMOVED;
+    broadphase->num_proxies--;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Broadphase_SetBoxes
+|
+| Output: Sets new bound boxes for some proxies.  If proxies is NULL,
+|   sets boxes of proxies 0 to num_proxies-1.  Pairs are updated at the
+|   next update.
+|___________________________________________________________________*/
+
+void gx3d_Broadphase_SetBoxes (
+  gx3dBroadphase *broadphase,
+  int            *proxies,        // NULL if boxes[i] is the box for proxy i
+  gx3dBox        *boxes,
+  int             num_proxies )
+{
+  int i, n;
+
+  DEBUG_ASSERT (broadphase);
+  DEBUG_ASSERT (boxes);
+  DEBUG_ASSERT (num_proxies >= 0);
+
+  for (i=0; i<num_proxies; i++) {
+    if (proxies)
+      n = proxies[i];
+    else
+      n = i;
+    DEBUG_ASSERT ((n >= 0) AND (n < broadphase->max_proxies));
+    broadphase->proxy[n].box = boxes[i];
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Broadphase_SetSpheres
+|
+| Output: Sets new bounding spheres for some proxies.  If proxies is
+|   NULL, sets spheres of proxies 0 to num_proxies-1.  Pairs are updated
+|   at the next update.
+|___________________________________________________________________*/
+
+void gx3d_Broadphase_SetSpheres (
+  gx3dBroadphase *broadphase,
+  int            *proxies,        // NULL if spheres[i] is the sphere for proxy i
+  gx3dSphere     *spheres,
+  int             num_proxies )
+{
+  int i, n;
+
+  DEBUG_ASSERT (broadphase);
+  DEBUG_ASSERT (spheres);
+  DEBUG_ASSERT (num_proxies >= 0);
+
+  for (i=0; i<num_proxies; i++) {
+    if (proxies)
+      n = proxies[i];
+    else
+      n = i;
+    DEBUG_ASSERT ((n >= 0) AND (n < broadphase->max_proxies));
+    Sphere_To_Box (&spheres[i], &(broadphase->proxy[n].box));
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Broadphase_Update
+|
+| Output: Updates the set of overlapping pairs to the current proxy
+|   boxes.  Sets added_pair to the pairs that started overlapping and
+|   removed_pair to the pairs that stopped overlapping since the last
+|   update.  Returns total # added and removed pairs.
+|___________________________________________________________________*/
+
+int gx3d_Broadphase_Update (gx3dBroadphase *broadphase)
+{
+  int i, axis;
+  gx3dBroadphaseEndpoint *endpoint;
+  gx3dBox *box;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (broadphase);
+
+/*____________________________________________________________________
+|
+| Sort the endpoints, finding pairs that start or stop overlapping
+|___________________________________________________________________*/
+
+  for (axis=0; axis<3; axis++) {
+    // Copy current box values into endpoints
+    endpoint = broadphase->endpoint[axis];
+    for (i=0; i<broadphase->num_endpoints; i++) {
+      box = &(broadphase->proxy[ENDPOINT_PROXY(&endpoint[i])].box);
+      if (ENDPOINT_IS_MAX(&endpoint[i]))
+        endpoint[i].value = ((float *)&(box->max))[axis];
+      else
+        endpoint[i].value = ((float *)&(box->min))[axis];
+    }
+    Sort_Axis (broadphase, axis);
+  }
+
+/*____________________________________________________________________
+|
+| Get lists of changed pairs
+|___________________________________________________________________*/
+
+  broadphase->num_added_pairs   = 0;
+  broadphase->num_removed_pairs = 0;
+  // Go backwards since deleting a pair moves the last pair
+  for (i=broadphase->num_pairs-1; i>=0; i--)
+    switch (broadphase->pair_state[i]) {
+      case PAIR_ADDED:
+        broadphase->added_pair[broadphase->num_added_pairs++] = broadphase->pair[i];
+        broadphase->pair_state[i] = PAIR_UNCHANGED;
+        break;
+      case PAIR_REMOVED:
+        broadphase->removed_pair[broadphase->num_removed_pairs++] = broadphase->pair[i];
+        Delete_Pair (broadphase, i);
+        break;
+    }
+
+  // Proxies removed since the last update can now be reused
+  for (i=0; i<broadphase->max_proxies; i++)
+    if (broadphase->proxy[i].active == PROXY_REMOVED)
+      broadphase->proxy[i].active = PROXY_UNUSED;
+
+  return (broadphase->num_added_pairs + broadphase->num_removed_pairs);
+}
+
+/*____________________________________________________________________
+|
+| Function: Sort_Axis
+|
+| Input: Called from gx3d_Broadphase_Update()
+| Output: Insertion sorts the endpoints on one axis.  When a min
+|   endpoint moves below a max endpoint, the two boxes now overlap on
+|   this axis, so the pair is added if the boxes overlap on all axes.
+|   When a max endpoint moves below a min endpoint, the two boxes no
+|   longer overlap so the pair is removed.
+|
+| Description: Insertion sort swaps each pair of endpoints that is out
+|   of order exactly once and leaves them in their final order, so each
+|   swap reflects the current boxes.
+|___________________________________________________________________*/
+
+static void Sort_Axis (gx3dBroadphase *broadphase, int axis)
+{
+  int i, j;
+  gx3dBroadphaseEndpoint e, *prev;
+  gx3dBroadphaseEndpoint *endpoint = broadphase->endpoint[axis];
+
+  for (i=1; i<broadphase->num_endpoints; i++) {
+    e = endpoint[i];
+    for (j=i; (j > 0) AND Endpoint_Less (&e, &endpoint[j-1]); j--) {
+      prev = &endpoint[j-1];
+      if (ENDPOINT_IS_MAX(&e) != ENDPOINT_IS_MAX(prev)) {
+        // Min endpoint moving below a max endpoint?
+        if (NOT ENDPOINT_IS_MAX(&e)) {
+          if (Boxes_Overlap (&(broadphase->proxy[ENDPOINT_PROXY(&e)].box), &(broadphase->proxy[ENDPOINT_PROXY(prev)].box)))
+            Add_Pair (broadphase, ENDPOINT_PROXY(&e), ENDPOINT_PROXY(prev));
+        }
+        // Max endpoint moving below a min endpoint
+        else
+          Remove_Pair (broadphase, ENDPOINT_PROXY(&e), ENDPOINT_PROXY(prev));
+      }
+      endpoint[j] = *prev;
+    }
+    endpoint[j] = e;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Endpoint_Less
+|
+| Input: Called from Sort_Axis()
+| Output: Returns true if e1 sorts before e2.  For equal values a min
+|   endpoint sorts before a max endpoint, so boxes that just touch
+|   overlap.
+|___________________________________________________________________*/
+
+static inline bool Endpoint_Less (gx3dBroadphaseEndpoint *e1, gx3dBroadphaseEndpoint *e2)
+{
+  return ((e1->value < e2->value) OR ((e1->value == e2->value) AND (NOT ENDPOINT_IS_MAX(e1)) AND ENDPOINT_IS_MAX(e2)));
+}
+
+/*____________________________________________________________________
+|
+| Function: Boxes_Overlap
+|
+| Input: Called from Sort_Axis()
+| Output: Returns true if two boxes overlap (or touch).
+|___________________________________________________________________*/
+
+static inline bool Boxes_Overlap (gx3dBox *box1, gx3dBox *box2)
+{
+  return ((box1->min.x <= box2->max.x) AND (box2->min.x <= box1->max.x) AND
+          (box1->min.y <= box2->max.y) AND (box2->min.y <= box1->max.y) AND
+          (box1->min.z <= box2->max.z) AND (box2->min.z <= box1->max.z));
+}
+
+/*____________________________________________________________________
+|
+| Function: Add_Pair
+|
+| Input: Called from Sort_Axis()
+| Output: Adds a pair to the set of overlapping pairs, if not already
+|   in the set.
+|___________________________________________________________________*/
+
+static void Add_Pair (gx3dBroadphase *broadphase, int proxy1, int proxy2)
+{
+  int n, hash;
+
+  if (proxy1 > proxy2) {
+    n      = proxy1;
+    proxy1 = proxy2;
+    proxy2 = n;
+  }
+
+  n = Find_Pair (broadphase, proxy1, proxy2);
+  // Already in the set?
+  if (n != -1) {
+    // Stopped and started overlapping again since the last update?
+    if (broadphase->pair_state[n] == PAIR_REMOVED)
+      broadphase->pair_state[n] = PAIR_UNCHANGED;
+  }
+  else {
+    if (broadphase->num_pairs == broadphase->max_pairs)
+      if (NOT Grow_Pairs (broadphase)) {
+        gxError ("gx3d_Broadphase_Update(): Can't allocate memory");
+        return;
+      }
+    n = broadphase->num_pairs++;
+    broadphase->pair[n].proxy1 = proxy1;
+    broadphase->pair[n].proxy2 = proxy2;
+    broadphase->pair_state[n]  = PAIR_ADDED;
+    // Put at head of its hash bucket
+    hash = Get_Pair_Hash (broadphase, proxy1, proxy2);
+    broadphase->pair_next[n] = broadphase->pair_hash[hash];
+    broadphase->pair_hash[hash] = n;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Remove_Pair
+|
+| Input: Called from Sort_Axis(), gx3d_Broadphase_RemoveProxy()
+| Output: Marks a pair in the set of overlapping pairs as removed (it's
+|   deleted at the end of the update).  A pair added since the last
+|   update is deleted right away.
+|___________________________________________________________________*/
+
+static void Remove_Pair (gx3dBroadphase *broadphase, int proxy1, int proxy2)
+{
+  int n;
+
+  if (proxy1 > proxy2) {
+    n      = proxy1;
+    proxy1 = proxy2;
+    proxy2 = n;
+  }
+
+  n = Find_Pair (broadphase, proxy1, proxy2);
+  if (n != -1) {
+    if (broadphase->pair_state[n] == PAIR_ADDED)
+      Delete_Pair (broadphase, n);
+    else
+      broadphase->pair_state[n] = PAIR_REMOVED;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Find_Pair
+|
+| Input: Called from Add_Pair(), Remove_Pair()
+| Output: Returns index of a pair or -1 if not in the set.  proxy1 must
+|   be less than proxy2.
+|___________________________________________________________________*/
+
+static int Find_Pair (gx3dBroadphase *broadphase, int proxy1, int proxy2)
+{
+  int n;
+
+  for (n=broadphase->pair_hash[Get_Pair_Hash (broadphase, proxy1, proxy2)]; n != -1; n=broadphase->pair_next[n])
+    if ((broadphase->pair[n].proxy1 == proxy1) AND (broadphase->pair[n].proxy2 == proxy2))
+      break;
+
+  return (n);
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Pair_Hash
+|
+| Input: Called from Find_Pair(), Add_Pair(), Delete_Pair(),
+|   Rehash_Pairs()
+| Output: Returns hash bucket of a pair.
+|___________________________________________________________________*/
+
+static inline int Get_Pair_Hash (gx3dBroadphase *broadphase, int proxy1, int proxy2)
+{
+  unsigned key;
+
+  key = (unsigned)proxy1 * 0x9E3779B1 + (unsigned)proxy2 * 0x85EBCA6B;
+  key ^= key >> 15;
+
+  return ((int)(key & (broadphase->max_pairs - 1)));
+}
+
+/*____________________________________________________________________
+|
+| Function: Delete_Pair
+|
+| Input: Called from Remove_Pair(), gx3d_Broadphase_Update()
+| Output: Deletes a pair from the set.  The last pair in the pair array
+|   is moved into its place.
+|___________________________________________________________________*/
+
+static void Delete_Pair (gx3dBroadphase *broadphase, int pair)
+{
+  int last, hash;
+  int *link;
+
+  // Unlink the pair from its hash bucket
+  hash = Get_Pair_Hash (broadphase, broadphase->pair[pair].proxy1, broadphase->pair[pair].proxy2);
+  link = &(broadphase->pair_hash[hash]);
+  while (*link != pair)
+    link = &(broadphase->pair_next[*link]);
+  *link = broadphase->pair_next[pair];
+
+  // Move the last pair into its place
+  last = --broadphase->num_pairs;
+  if (pair != last) {
+    hash = Get_Pair_Hash (broadphase, broadphase->pair[last].proxy1, broadphase->pair[last].proxy2);
+    link = &(broadphase->pair_hash[hash]);
+    while (*link != last)
+      link = &(broadphase->pair_next[*link]);
+    *link = pair;
+    broadphase->pair[pair]       = broadphase->pair[last];
+    broadphase->pair_state[pair] = broadphase->pair_state[last];
+    broadphase->pair_next[pair]  = broadphase->pair_next[last];
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Grow_Pairs
+|
+| Input: Called from Add_Pair()
+| Output: Doubles the size of the pair arrays and the hash table.
+|   Returns true on success or false on any error.
+|___________________________________________________________________*/
+
+static bool Grow_Pairs (gx3dBroadphase *broadphase)
+{
+  int n;
+  gx3dBroadphasePair *pair, *added_pair, *removed_pair;
+  int *pair_state, *pair_next, *pair_hash;
+
+  n = 2 * broadphase->max_pairs;
+  pair         = (gx3dBroadphasePair *) realloc (broadphase->pair,         n * sizeof(gx3dBroadphasePair));
+  if (pair)
+    broadphase->pair = pair;
+  pair_state   = (int *)                realloc (broadphase->pair_state,   n * sizeof(int));
+  if (pair_state)
+    broadphase->pair_state = pair_state;
+  pair_next    = (int *)                realloc (broadphase->pair_next,    n * sizeof(int));
+  if (pair_next)
+    broadphase->pair_next = pair_next;
+  pair_hash    = (int *)                realloc (broadphase->pair_hash,    n * sizeof(int));
+  if (pair_hash)
+    broadphase->pair_hash = pair_hash;
+  added_pair   = (gx3dBroadphasePair *) realloc (broadphase->added_pair,   n * sizeof(gx3dBroadphasePair));
+  if (added_pair)
+    broadphase->added_pair = added_pair;
+  removed_pair = (gx3dBroadphasePair *) realloc (broadphase->removed_pair, n * sizeof(gx3dBroadphasePair));
+  if (removed_pair)
+    broadphase->removed_pair = removed_pair;
+  if ((pair == 0) OR (pair_state == 0) OR (pair_next == 0) OR (pair_hash == 0) OR (added_pair == 0) OR (removed_pair == 0))
+    return (false);
+
+  broadphase->max_pairs = n;
+  Rehash_Pairs (broadphase);
+
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: Rehash_Pairs
+|
+| Input: Called from Grow_Pairs()
+| Output: Rebuilds the hash table after it changes size.
+|___________________________________________________________________*/
+
+static void Rehash_Pairs (gx3dBroadphase *broadphase)
+{
+  int i, hash;
+
+  for (i=0; i<broadphase->max_pairs; i++)
+    broadphase->pair_hash[i] = -1;
+  for (i=0; i<broadphase->num_pairs; i++) {
+    hash = Get_Pair_Hash (broadphase, broadphase->pair[i].proxy1, broadphase->pair[i].proxy2);
+    broadphase->pair_next[i] = broadphase->pair_hash[hash];
+    broadphase->pair_hash[hash] = i;
+  }
+}
@@ -15,24 +15,46 @@
 |   will accept trajectory/s and a (delta) time.  The other function will
 |   accept a projected trajectory (vector that encodes direction & velocity).
 |
+|   The array functions test one moving object against many static 
+|   objects, several at a time using SIMD instructions, and return the
+|   first object collided with.
+|
 | Functions:  gx3d_Collide_Sphere_StaticPlane
 |             gx3d_Collide_Sphere_StaticPlane
 |             gx3d_Collide_Sphere_StaticSphere
 |             gx3d_Collide_Sphere_StaticSphere
 |             gx3d_Collide_Sphere_Sphere
 |             gx3d_Collide_Sphere_Sphere
-|             gx3d_Collide_Sphere_StaticBox       // not done (see pg. 224 Math for 3D Game Programmers ...)
-|             gx3d_Collide_Sphere_StaticBox       // not done
-|             gx3d_Collide_Sphere_Box             // not done
-|             gx3d_Collide_Sphere_Box             // not done
-|             gx3d_Collide_Sphere_StaticTriangle  // not done (see raycasting article in aug.02 GD)
-|             gx3d_Collide_Sphere_StaticTriangle  // not done ( & pg. 624 Real-Time Rendering, 2nd ed.)
+|             gx3d_Collide_Sphere_StaticBox
+|              Collide_Sphere_Box
+|               Collide_Sphere_Edge
+|             gx3d_Collide_Sphere_StaticBox
+|             gx3d_Collide_Sphere_Box
+|              Collide_Sphere_Box
+|             gx3d_Collide_Sphere_Box
+|             gx3d_Collide_Sphere_StaticBoxes
+|              Init_Sweep
+|              Sweep_Boxes
+|               Sweep_Boxes_AVX
+|               Sweep_Boxes_SSE
+|               Sweep_Box
+|              Collide_Sphere_Box
+|             gx3d_Collide_Sphere_StaticBoxes
+|             gx3d_Collide_Sphere_StaticTriangle
+|              Point_In_Triangle
+|              Get_Lowest_Root
+|             gx3d_Collide_Sphere_StaticTriangle
 |             gx3d_Collide_Box_StaticPlane
 |             gx3d_Collide_Box_StaticPlane
-|             gx3d_Collide_Box_StaticSphere       // not done
-|             gx3d_Collide_Box_StaticSphere       // not done
+|             gx3d_Collide_Box_StaticSphere
+|              Collide_Sphere_Box
+|             gx3d_Collide_Box_StaticSphere
 |             gx3d_Collide_Box_StaticBox
 |             gx3d_Collide_Box_StaticBox
+|             gx3d_Collide_Box_StaticBoxes
+|              Init_Sweep
+|              Sweep_Boxes
+|             gx3d_Collide_Box_StaticBoxes
 |             gx3d_Collide_Box_Box
 |             gx3d_Collide_Box_Box
 |
@@ -50,6 +72,9 @@
 #include <first_header.h>
 
 #include <math.h>
+#include <xmmintrin.h>
+#include <immintrin.h>
+
 #include "dp.h"
 
 /*___________________
@@ -62,6 +87,54 @@
 #define GREATER_THAN_ZERO(_val_) ((_val_) > EPSILON)
 #define LESS_THAN_ZERO(_val_) ((_val_) < -EPSILON)
 
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+// A box (or sphere center) moving relative to static boxes
+typedef struct {
+  float min[3], max[3];                 // moving box at start of movement
+  float v[3];                           // movement
+  float inv_v[3];                       // 1 / movement (0 if not moving on that axis)
+  float grow;                           // amount to grow static boxes by (sphere radius)
+  bool  touching;                       // true if boxes that only touch count as hit
+} Sweep;
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static bool Point_In_Triangle (gx3dVector *point, gx3dVector *vertices, gx3dVector *normal);
+static bool Get_Lowest_Root (float a, float b, float c, float max_root, float *root);
+static gxRelation Collide_Sphere_Box (
+  gx3dVector *center,
+  float       radius,
+  gx3dVector *v,
+  gx3dBox    *box,
+  float      *collision_time,
+  gx3dVector *collision_point );
+static bool Collide_Sphere_Edge (
+  gx3dVector *center,
+  gx3dVector *v,
+  float       r2,
+  gx3dVector *start,
+  gx3dVector *end,
+  float      *collision_time,
+  gx3dVector *collision_point );
+static void Init_Sweep (Sweep *sweep, gx3dVector *min, gx3dVector *max, float grow, bool touching, gx3dVector *v);
+static unsigned Sweep_Boxes (
+  Sweep    *sweep,
+  gx3dBox  *boxes,
+  int       num_boxes,
+  unsigned  features,
+  float    *t_enter,
+  int      *n );
+static unsigned Sweep_Box (Sweep *sweep, gx3dBox *box, float *t_enter);
+static unsigned Sweep_Boxes_SSE (Sweep *sweep, gx3dBox *boxes, float *t_enter);
+static unsigned Sweep_Boxes_AVX (Sweep *sweep, gx3dBox *boxes, float *t_enter);
+
 /*____________________________________________________________________
 |
 | Function: gx3d_Collide_Sphere_StaticPlane
@@ -442,148 +515,175 @@ gxRelation gx3d_Collide_Sphere_Sphere (
 
 /*____________________________________________________________________
 |
-| Function: gx3d_Collide_Box_StaticPlane
+| Function: gx3d_Collide_Sphere_StaticBox
 |
-| Output: Returns collision info regarding a AAA box moving relative to
-|   a static plane.  Returns relation and optionally, the parametric 
-|   collision time in the range 0-1.
+| Output: Returns collision info regarding a sphere moving relative to
+|   a static AAB box.  Returns relation and optionally, the parametric 
+|   collision time in the range 0-1 and the point of contact on the box.
 |
 |   Returns gxRELATION_OUTSIDE   = no collision occurs
-|           gxRELATION_INTERSECT = box collides with plane
+|           gxRELATION_INTERSECT = sphere collides with box
 |
-| Reference: 3D Math for Graphics and Games Development (pg. 310, 284),
-|   Real-Time Rendering, 2nd ed. (pg. 587)
+|   If the sphere is already intersecting the box, the collision time 
+|   is 0.
+|
+| Reference: Real-Time Collision Detection, pg. 228
 |___________________________________________________________________*/
 
-gxRelation gx3d_Collide_Box_StaticPlane (
-  gx3dBox        *box,
+gxRelation gx3d_Collide_Sphere_StaticBox (
+  gx3dSphere     *sphere,
   gx3dTrajectory *trajectory,
-  float           dtime,                      // period of time box moves
-  gx3dPlane      *plane,
-  float          *parametric_collision_time ) // NULL if not needed
+  float           dtime,                      // period of time sphere moves
+  gx3dBox        *static_box,
+  float          *parametric_collision_time,  // NULL if not needed
+  gx3dVector     *collision_point )           // NULL if not needed
 {
-  float t, dot, mind, maxd;
-  gx3dVector vmin, vmax;
+  float t;
+  gx3dVector v, contact;
   gxRelation result;
-  
+
 /*____________________________________________________________________
 |
 | Verify input params
 |___________________________________________________________________*/
 
-  DEBUG_ASSERT (box);
+  DEBUG_ASSERT (sphere);
+  DEBUG_ASSERT (sphere->radius > 0);
   DEBUG_ASSERT (trajectory);
   // Make sure normal is normalized
-  DEBUG_ASSERT (fabsf(gx3d_VectorDotProduct (&trajectory->direction, &trajectory->direction) - 1) < .01);
+  DEBUG_ASSERT (fabsf(gx3d_VectorDotProduct (&trajectory->direction, &trajectory->direction) -1.0) < .01);
   DEBUG_ASSERT (dtime > 0);
-  DEBUG_ASSERT (plane);
-  // Make sure normal is normalized
-  DEBUG_ASSERT (fabsf(gx3d_VectorDotProduct (&plane->n, &plane->n) - 1) < .01);
+  DEBUG_ASSERT (static_box);
 
 /*____________________________________________________________________
 |
-| Find the diagonal most closely aligned with the plane normal (see
-|   gxRelation_Box_Plane())
+| Main procedure
 |___________________________________________________________________*/
 
-  if (plane->n.x >= 0) {
-    vmin.x = box->min.x;
-    vmax.x = box->max.x;
-  }
-  else {
-    vmin.x = box->max.x;
-    vmax.x = box->min.x;
-  }
-  if (plane->n.y >= 0) {
-    vmin.y = box->min.y;
-    vmax.y = box->max.y;
-  }
-  else {
-    vmin.y = box->max.y;
-    vmax.y = box->min.y;
-  }
-  if (plane->n.z >= 0) {
-    vmin.z = box->min.z;
-    vmax.z = box->max.z;
-  }
-  else {
-    vmin.z = box->max.z;
-    vmax.z = box->min.z;
+  // Compute the movement vector of the sphere
+  gx3d_MultiplyScalarVector (trajectory->velocity * dtime, &trajectory->direction, &v);
+
+  result = Collide_Sphere_Box (&sphere->center, sphere->radius, &v, static_box, &t, &contact);
+  if (result == gxRELATION_INTERSECT) {
+    if (parametric_collision_time)
+      *parametric_collision_time = t;
+    if (collision_point)
+      *collision_point = contact;
   }
-  mind = gx3d_Distance_Point_Plane (&vmin, plane);
-  maxd = gx3d_Distance_Point_Plane (&vmax, plane);
-                 
-  // Compute angle between trajectory and plane normal
-  dot = gx3d_VectorDotProduct (&trajectory->direction, &plane->n);
+
+  return (result);
+}
 
 /*____________________________________________________________________
 |
-| Process a box moving parallel to plane
+| Function: gx3d_Collide_Sphere_StaticBox
+|
+| Output: Returns collision info regarding a sphere moving relative to
+|   a static AAB box.  Returns relation and optionally, the parametric 
+|   collision time in the range 0-1 and the point of contact on the box.
+|
+|   The movement being calculated occurs over a default 1 time unit.
+|
+|   Returns gxRELATION_OUTSIDE   = no collision occurs
+|           gxRELATION_INTERSECT = sphere collides with box
 |___________________________________________________________________*/
 
-  if (EQUAL_ZERO(dot)) {
-    // Is box already intersecting plane?
-    if ((mind * maxd) <= 0) {
-      result = gxRELATION_INTERSECT;
-      t = 0;
-    }
-    else
-      result = gxRELATION_OUTSIDE;
-  }
-  else {
+gxRelation gx3d_Collide_Sphere_StaticBox (
+  gx3dSphere              *sphere,
+  gx3dProjectedTrajectory *ptrajectory,
+  gx3dBox                 *static_box,
+  float                   *parametric_collision_time, // NULL if not needed
+  gx3dVector              *collision_point )          // NULL if not needed
+{
+  gx3dTrajectory trajectory;
 
 /*____________________________________________________________________
 |
-| Process a box in front of plane (and not moving parallel to plane)
+| Verify input params
 |___________________________________________________________________*/
 
-    // Is vmin in front of plane?
-    if (mind > 0) { 
-      // Compute intersection of ray starting at vmin, going in trajectory->direction, with plane
-      t = -mind / dot;
-      // Is box moving away from plane?
-      if (t < 0) 
-        result = gxRELATION_OUTSIDE;
-      else 
-        result = gxRELATION_INTERSECT;
-    }
+  DEBUG_ASSERT (sphere);
+  DEBUG_ASSERT (sphere->radius > 0);
+  DEBUG_ASSERT (ptrajectory);
+  // Make sure trajectory direction is not 0
+  DEBUG_ASSERT (ptrajectory->direction.x + ptrajectory->direction.y + ptrajectory->direction.z);
+  DEBUG_ASSERT (static_box);
 
 /*____________________________________________________________________
 |
-| Process a box in back of plane
+| Main procedure
 |___________________________________________________________________*/
 
-    // Is vmax in back of plane?
-    else if (maxd < 0) { 
-      // Compute intersection of ray starting at vmin, going in trajectory->direction, with plane
-      t = -maxd / dot;
-      // Is box moving away from plane?
-      if (t < 0) 
-        result = gxRELATION_OUTSIDE;
-      else 
-        result = gxRELATION_INTERSECT;
-    }
+  // Extract normal and velocity from projected trajectory (time is assumed to be 1 unit)
+  gx3d_NormalizeVector (&ptrajectory->direction, &trajectory.direction, &trajectory.velocity);
+  
+  return (gx3d_Collide_Sphere_StaticBox (sphere, &trajectory, 1, static_box, parametric_collision_time, collision_point));
+}
 
 /*____________________________________________________________________
 |
-| Process a box already touching plane
+| Function: gx3d_Collide_Sphere_Box
+|
+| Output: Returns collision info regarding a moving sphere relative to
+|   a moving AAB box.  Returns relation and optionally, collision time
+|   in the range 0-1 and the point of contact on the box (at the time
+|   of collision).
+|
+|   Returns gxRELATION_OUTSIDE   = no collision occurs
+|           gxRELATION_INTERSECT = sphere collides with box
 |___________________________________________________________________*/
 
-    else 
-      result = gxRELATION_INTERSECT;
-  }
+gxRelation gx3d_Collide_Sphere_Box (
+  gx3dSphere     *sphere,
+  gx3dTrajectory *trajectory1,
+  float           dtime,                      // period of time sphere and box move
+  gx3dBox        *box,
+  gx3dTrajectory *trajectory2,
+  float          *parametric_collision_time,  // NULL if not needed
+  gx3dVector     *collision_point )           // NULL if not needed
+{
+  float t;
+  gx3dVector dv1, dv2, v, contact;
+  gxRelation result;
 
 /*____________________________________________________________________
 |
-| Scale collision time by velocity to get a value between 0-1
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (sphere);
+  DEBUG_ASSERT (sphere->radius > 0);
+  DEBUG_ASSERT (trajectory1);
+  // Make sure normal is normalized
+  DEBUG_ASSERT (fabsf(gx3d_VectorDotProduct (&trajectory1->direction, &trajectory1->direction) -1.0) < .01);
+  DEBUG_ASSERT (dtime > 0);
+  DEBUG_ASSERT (box);
+  DEBUG_ASSERT (trajectory2);
+  // Make sure normal is normalized
+  DEBUG_ASSERT (fabsf(gx3d_VectorDotProduct (&trajectory2->direction, &trajectory2->direction) -1.0) < .01);
+
+/*____________________________________________________________________
+|
+| Main procedure
 |___________________________________________________________________*/
 
+  // Compute projected directions for sphere and box
+  gx3d_MultiplyScalarVector (trajectory1->velocity * dtime, &trajectory1->direction, &dv1);
+  gx3d_MultiplyScalarVector (trajectory2->velocity * dtime, &trajectory2->direction, &dv2);
+
+  // Compute the movement of the sphere relative to the box
+  gx3d_SubtractVector (&dv1, &dv2, &v);
+
+  result = Collide_Sphere_Box (&sphere->center, sphere->radius, &v, box, &t, &contact);
   if (result == gxRELATION_INTERSECT) {
-    t /= (trajectory->velocity * dtime);
-    if (t > 1)
-      result = gxRELATION_OUTSIDE;
-    else if (parametric_collision_time)
+    if (parametric_collision_time)
       *parametric_collision_time = t;
+    // Move point of contact along with the box
+    if (collision_point) {
+      collision_point->x = contact.x + t * dv2.x;
+      collision_point->y = contact.y + t * dv2.y;
+      collision_point->z = contact.z + t * dv2.z;
+    }
   }
 
   return (result);
@@ -591,105 +691,749 @@ gxRelation gx3d_Collide_Box_StaticPlane (
 
 /*____________________________________________________________________
 |
-| Function: gx3d_Collide_Box_StaticPlane
+| Function: gx3d_Collide_Sphere_Box
 |
-| Output: Returns collision info regarding a AAA box moving relative to
-|   a static plane.  Returns relation and optionally, the parametric 
-|   collision time in the range 0-1.
+| Output: Returns collision info regarding a moving sphere relative to
+|   a moving AAB box.  Returns relation and optionally, collision time
+|   in the range 0-1 and the point of contact on the box (at the time
+|   of collision).
 |
 |   The movement being calculated occurs over a default 1 time unit.
 |
 |   Returns gxRELATION_OUTSIDE   = no collision occurs
-|           gxRELATION_INTERSECT = box collides with plane
-|
-| Reference: 3D Math for Graphics and Games Development (pg. 310, 284),
-|   Real-Time Rendering, 2nd ed. (pg. 587)
+|           gxRELATION_INTERSECT = sphere collides with box
 |___________________________________________________________________*/
 
-gxRelation gx3d_Collide_Box_StaticPlane (
+gxRelation gx3d_Collide_Sphere_Box (
+  gx3dSphere              *sphere,
+  gx3dProjectedTrajectory *ptrajectory1,
   gx3dBox                 *box,
-  gx3dProjectedTrajectory *ptrajectory,
-  gx3dPlane               *plane,
-  float                   *parametric_collision_time ) // NULL if not needed
+  gx3dProjectedTrajectory *ptrajectory2,
+  float                   *parametric_collision_time, // NULL if not needed
+  gx3dVector              *collision_point )          // NULL if not needed
 {
-  gx3dTrajectory trajectory;
-  
+  gx3dTrajectory trajectory1, trajectory2;
+
 /*____________________________________________________________________
 |
 | Verify input params
 |___________________________________________________________________*/
 
+  DEBUG_ASSERT (sphere);
+  DEBUG_ASSERT (sphere->radius > 0);
+  DEBUG_ASSERT (ptrajectory1);
   DEBUG_ASSERT (box);
-  DEBUG_ASSERT (ptrajectory);
-  // Make sure trajectory direction is not 0
-  DEBUG_ASSERT (ptrajectory->direction.x + ptrajectory->direction.y + ptrajectory->direction.z);
-  DEBUG_ASSERT (plane);
-  // Make sure normal is normalized
-  DEBUG_ASSERT (fabsf(gx3d_VectorDotProduct (&plane->n, &plane->n) -1.0) < .01);
+  DEBUG_ASSERT (ptrajectory2);
 
 /*____________________________________________________________________
 |
 | Main procedure
 |___________________________________________________________________*/
-
-  // Extract normal and velocity from projected trajectory (time is assumed to be 1 unit)
-  gx3d_NormalizeVector (&ptrajectory->direction, &trajectory.direction, &trajectory.velocity);
   
-  return (gx3d_Collide_Box_StaticPlane (box, &trajectory, 1, plane, parametric_collision_time));
+  // Extract normal and velocity from projected trajectories
+  gx3d_NormalizeVector (&ptrajectory1->direction, &trajectory1.direction, &trajectory1.velocity);
+  gx3d_NormalizeVector (&ptrajectory2->direction, &trajectory2.direction, &trajectory2.velocity);
+  
+  return (gx3d_Collide_Sphere_Box (sphere, &trajectory1, 1, box, &trajectory2, parametric_collision_time, collision_point));
 }
 
 /*____________________________________________________________________
 |
-| Function: gx3d_Collide_Box_StaticBox
-|
-| Output: Returns collision info regarding a AAA box moving relative to
-|   a static AAB box.  Returns relation and optionally, the parametric 
-|   collision time in the range 0-1.
-|
-|   Returns gxRELATION_OUTSIDE   = no collision occurs
-|           gxRELATION_INTERSECT = box collides with box
+| Function: gx3d_Collide_Sphere_StaticBoxes
 |
-| Reference: 3D Math for Graphics and Games Development (pg. 313)
+| Output: Returns collision info regarding a sphere moving relative to
+|   an array of static AAB boxes.  Returns the index of the first box 
+|   the sphere collides with or -1 if none.  Optionally returns the 
+|   parametric collision time in the range 0-1 and the point of contact
+|   on that box.
+|
+|   Gives the same result as calling gx3d_Collide_Sphere_StaticBox() for
+|   each box and keeping the earliest collision (lowest index on a tie).
+|
+| Description: The sphere center is swept against 8 (AVX) or 4 (SSE) 
+|   boxes at a time, each grown by the sphere radius.  Only boxes the
+|   center enters no later than the earliest collision found so far 
+|   are given the exact test.
 |___________________________________________________________________*/
 
-gxRelation gx3d_Collide_Box_StaticBox (
-  gx3dBox        *box,
+int gx3d_Collide_Sphere_StaticBoxes (
+  gx3dSphere     *sphere,
   gx3dTrajectory *trajectory,
-  float           dtime,                      // period of time box moves
-  gx3dBox        *static_box,
-  float          *parametric_collision_time ) // NULL if not needed
+  float           dtime,                      // period of time sphere moves
+  gx3dBox        *static_boxes,
+  int             num_boxes,
+  float          *parametric_collision_time,  // NULL if not needed
+  gx3dVector     *collision_point )           // NULL if not needed
 {
-  float f, t_enter, t_leave, enter, leave;
-  gx3dProjectedTrajectory ptrajectory;
-  gxRelation result = gxRELATION_INTERSECT; // assume intersecting
-  
+  int i, j, n;
+  unsigned hits, features;
+  float t, t_enter[8], collision_time;
+  gx3dVector v, p, contact;
+  Sweep sweep;
+  int index = -1;
+
 /*____________________________________________________________________
 |
 | Verify input params
 |___________________________________________________________________*/
 
-  DEBUG_ASSERT (box);
+  DEBUG_ASSERT (sphere);
+  DEBUG_ASSERT (sphere->radius > 0);
   DEBUG_ASSERT (trajectory);
   // Make sure normal is normalized
-  DEBUG_ASSERT (fabsf(gx3d_VectorDotProduct (&trajectory->direction, &trajectory->direction) - 1) < .01);
+  DEBUG_ASSERT (fabsf(gx3d_VectorDotProduct (&trajectory->direction, &trajectory->direction) -1.0) < .01);
   DEBUG_ASSERT (dtime > 0);
-  DEBUG_ASSERT (static_box);
+  DEBUG_ASSERT (static_boxes OR (num_boxes == 0));
+  DEBUG_ASSERT (num_boxes >= 0);
 
 /*____________________________________________________________________
 |
-| Init variables
+| Main procedure
 |___________________________________________________________________*/
 
-  // Compute the projected trajectory
-  gx3d_MultiplyScalarVector (trajectory->velocity * dtime, &trajectory->direction, &ptrajectory.direction);
-  
-  // Initialize interval to contain all the time under consideration
-  t_enter = 0;
-  t_leave = 1;
+  // Compute the movement vector of the sphere
+  gx3d_MultiplyScalarVector (trajectory->velocity * dtime, &trajectory->direction, &v);
+  Init_Sweep (&sweep, &sphere->center, &sphere->center, sphere->radius, true, &v);
+
+  collision_time = 1;
+  features = gx3d_GetCPUFeatures ();
+  for (i=0; i<num_boxes; i+=n) {
+    hits = Sweep_Boxes (&sweep, &static_boxes[i], num_boxes - i, features, t_enter, &n);
+    for (j=0; hits; j++, hits>>=1) 
+      // Could this box be hit before the earliest collision so far?
+      if ((hits & 1) AND (t_enter[j] <= collision_time))
+        if (Collide_Sphere_Box (&sphere->center, sphere->radius, &v, &static_boxes[i+j], &t, &p) == gxRELATION_INTERSECT)
+          if ((index == -1) OR (t < collision_time)) {
+            index = i + j;
+            collision_time = t;
+            contact = p;
+          }
+  }
 
-/*____________________________________________________________________
-|
-| Compute interval of overlap on each dimension, and intersect this 
+  if (index != -1) {
+    if (parametric_collision_time)
+      *parametric_collision_time = collision_time;
+    if (collision_point)
+      *collision_point = contact;
+  }
+
+  return (index);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Collide_Sphere_StaticBoxes
+|
+| Output: Returns collision info regarding a sphere moving relative to
+|   an array of static AAB boxes.  Returns the index of the first box 
+|   the sphere collides with or -1 if none.  Optionally returns the 
+|   parametric collision time in the range 0-1 and the point of contact
+|   on that box.
+|
+|   The movement being calculated occurs over a default 1 time unit.
+|___________________________________________________________________*/
+
+int gx3d_Collide_Sphere_StaticBoxes (
+  gx3dSphere              *sphere,
+  gx3dProjectedTrajectory *ptrajectory,
+  gx3dBox                 *static_boxes,
+  int                      num_boxes,
+  float                   *parametric_collision_time, // NULL if not needed
+  gx3dVector              *collision_point )          // NULL if not needed
+{
+  gx3dTrajectory trajectory;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (sphere);
+  DEBUG_ASSERT (sphere->radius > 0);
+  DEBUG_ASSERT (ptrajectory);
+  // Make sure trajectory direction is not 0
+  DEBUG_ASSERT (ptrajectory->direction.x + ptrajectory->direction.y + ptrajectory->direction.z);
+  DEBUG_ASSERT (static_boxes OR (num_boxes == 0));
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  // Extract normal and velocity from projected trajectory (time is assumed to be 1 unit)
+  gx3d_NormalizeVector (&ptrajectory->direction, &trajectory.direction, &trajectory.velocity);
+  
+  return (gx3d_Collide_Sphere_StaticBoxes (sphere, &trajectory, 1, static_boxes, num_boxes, parametric_collision_time, collision_point));
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Collide_Sphere_StaticTriangle
+|
+| Output: Returns collision info regarding a sphere moving relative to
+|   a static triangle (both sides of the triangle are solid).  Returns 
+|   relation and optionally, the parametric collision time in the range 
+|   0-1 and the point of contact on the triangle.
+|
+|   Returns gxRELATION_OUTSIDE   = no collision occurs
+|           gxRELATION_INTERSECT = sphere collides with triangle
+|
+|   If the sphere is already intersecting the triangle, the collision 
+|   time is 0.
+|
+| Description: The sphere first touches either the inside of the 
+|   triangle or one of its edges or vertices.  The inside is tested by
+|   finding when the sphere touches the plane of the triangle.  If that
+|   point is outside the triangle, the earliest time the sphere touches 
+|   an edge or vertex is found by solving a quadratic for each.
+|
+| Reference: Improved Collision detection and Response (Fauerby), 
+|   Real-Time Collision Detection, pg. 222
+|___________________________________________________________________*/
+
+gxRelation gx3d_Collide_Sphere_StaticTriangle (
+  gx3dSphere     *sphere,
+  gx3dTrajectory *trajectory,
+  float           dtime,                      // period of time sphere moves
+  gx3dVector     *vertices,                   // 3 vertices of triangle
+  float          *parametric_collision_time,  // NULL if not needed
+  gx3dVector     *collision_point )           // NULL if not needed
+{
+  int i;
+  float t, f, distance, nv, a, b, c, r2, edge_squared, edge_dot_v, edge_dot_base, collision_time;
+  gx3dVector v, n, p, edge, base, contact;
+  gx3dPlane plane;
+  gxRelation result = gxRELATION_OUTSIDE;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (sphere);
+  DEBUG_ASSERT (sphere->radius > 0);
+  DEBUG_ASSERT (trajectory);
+  // Make sure normal is normalized
+  DEBUG_ASSERT (fabsf(gx3d_VectorDotProduct (&trajectory->direction, &trajectory->direction) -1.0) < .01);
+  DEBUG_ASSERT (vertices);
+
+/*____________________________________________________________________
+|
+| Init variables
+|___________________________________________________________________*/
+
+  // Compute the movement vector of the sphere
+  gx3d_MultiplyScalarVector (trajectory->velocity * dtime, &trajectory->direction, &v);
+
+  // Compute the plane of the triangle, facing the sphere
+  gx3d_GetPlane (&vertices[0], &vertices[1], &vertices[2], &plane);
+  n = plane.n;
+  distance = gx3d_Distance_Point_Plane (&sphere->center, &plane);
+  nv = gx3d_VectorDotProduct (&n, &v);
+  if (distance < 0) {
+    gx3d_MultiplyScalarVector (-1, &n, &n);
+    distance = -distance;
+    nv = -nv;
+  }
+  collision_time = 1;
+  r2 = sphere->radius * sphere->radius;
+
+/*____________________________________________________________________
+|
+| Test against inside of triangle
+|___________________________________________________________________*/
+
+  // Is sphere already intersecting the plane of the triangle?
+  if (distance <= sphere->radius) {
+    gx3d_Nearest_Point_Triangle (&sphere->center, vertices, &p);
+    if (gx3d_DistanceSquared_Point_Point (&sphere->center, &p) <= r2) {
+      collision_time = 0;
+      contact = p;
+      result = gxRELATION_INTERSECT;
+    }
+  }
+  // Is sphere moving away from (or parallel to) plane of triangle?
+  else if (nv >= 0)
+    return (gxRELATION_OUTSIDE);
+  // Find when sphere touches plane of triangle
+  else {
+    t = (distance - sphere->radius) / -nv;
+    if (t > 1)
+      return (gxRELATION_OUTSIDE);
+    // Is the point of contact on the plane inside the triangle?
+    p.x = sphere->center.x + t * v.x - sphere->radius * n.x;
+    p.y = sphere->center.y + t * v.y - sphere->radius * n.y;
+    p.z = sphere->center.z + t * v.z - sphere->radius * n.z;
+    if (Point_In_Triangle (&p, vertices, &plane.n)) {
+      collision_time = t;
+      contact = p;
+      result = gxRELATION_INTERSECT;
+    }
+  }
+
+/*____________________________________________________________________
+|
+| Test against vertices and edges of triangle
+|___________________________________________________________________*/
+
+  if (result == gxRELATION_OUTSIDE) {
+    a = gx3d_VectorDotProduct (&v, &v);
+    if (a > 0) 
+      for (i=0; i<3; i++) {
+        // Test vertex: |center + t*v - vertex|^2 = r^2
+        gx3d_SubtractVector (&sphere->center, &vertices[i], &base);
+        b = 2 * gx3d_VectorDotProduct (&v, &base);
+        c = gx3d_VectorDotProduct (&base, &base) - r2;
+        if (Get_Lowest_Root (a, b, c, collision_time, &t)) {
+          collision_time = t;
+          contact = vertices[i];
+          result = gxRELATION_INTERSECT;
+        }
+        // Test edge: distance from center + t*v to line through edge = r
+        gx3d_SubtractVector (&vertices[(i+1)%3], &vertices[i], &edge);
+        gx3d_SubtractVector (&vertices[i], &sphere->center, &base);
+        edge_squared  = gx3d_VectorDotProduct (&edge, &edge);
+        edge_dot_v    = gx3d_VectorDotProduct (&edge, &v);
+        edge_dot_base = gx3d_VectorDotProduct (&edge, &base);
+        if (edge_squared > 0) 
+          if (Get_Lowest_Root (edge_squared * -a + edge_dot_v * edge_dot_v,
+                               edge_squared * 2 * gx3d_VectorDotProduct (&v, &base) - 2 * edge_dot_v * edge_dot_base,
+                               edge_squared * (r2 - gx3d_VectorDotProduct (&base, &base)) + edge_dot_base * edge_dot_base,
+                               collision_time, &t)) {
+            // Is the point of contact on the edge?
+            f = (edge_dot_v * t - edge_dot_base) / edge_squared;
+            if ((f >= 0) AND (f <= 1)) {
+              collision_time = t;
+              contact.x = vertices[i].x + f * edge.x;
+              contact.y = vertices[i].y + f * edge.y;
+              contact.z = vertices[i].z + f * edge.z;
+              result = gxRELATION_INTERSECT;
+            }
+          }
+      }
+  }
+
+  if (result == gxRELATION_INTERSECT) {
+    if (parametric_collision_time)
+      *parametric_collision_time = collision_time;
+    if (collision_point)
+      *collision_point = contact;
+  }
+
+  return (result);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Collide_Sphere_StaticTriangle
+|
+| Output: Returns collision info regarding a sphere moving relative to
+|   a static triangle (both sides of the triangle are solid).  Returns 
+|   relation and optionally, the parametric collision time in the range 
+|   0-1 and the point of contact on the triangle.
+|
+|   The movement being calculated occurs over a default 1 time unit.
+|
+|   Returns gxRELATION_OUTSIDE   = no collision occurs
+|           gxRELATION_INTERSECT = sphere collides with triangle
+|___________________________________________________________________*/
+
+gxRelation gx3d_Collide_Sphere_StaticTriangle (
+  gx3dSphere              *sphere,
+  gx3dProjectedTrajectory *ptrajectory,
+  gx3dVector              *vertices,                  // 3 vertices of triangle
+  float                   *parametric_collision_time, // NULL if not needed
+  gx3dVector              *collision_point )          // NULL if not needed
+{
+  gx3dTrajectory trajectory;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (sphere);
+  DEBUG_ASSERT (sphere->radius > 0);
+  DEBUG_ASSERT (ptrajectory);
+  DEBUG_ASSERT (vertices);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  // Extract normal and velocity from projected trajectory (time is assumed to be 1 unit)
+  gx3d_NormalizeVector (&ptrajectory->direction, &trajectory.direction, &trajectory.velocity);
+  
+  return (gx3d_Collide_Sphere_StaticTriangle (sphere, &trajectory, 1, vertices, parametric_collision_time, collision_point));
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Collide_Box_StaticPlane
+|
+| Output: Returns collision info regarding a AAA box moving relative to
+|   a static plane.  Returns relation and optionally, the parametric 
+|   collision time in the range 0-1.
+|
+|   Returns gxRELATION_OUTSIDE   = no collision occurs
+|           gxRELATION_INTERSECT = box collides with plane
+|
+| Reference: 3D Math for Graphics and Games Development (pg. 310, 284),
+|   Real-Time Rendering, 2nd ed. (pg. 587)
+|___________________________________________________________________*/
+
+gxRelation gx3d_Collide_Box_StaticPlane (
+  gx3dBox        *box,
+  gx3dTrajectory *trajectory,
+  float           dtime,                      // period of time box moves
+  gx3dPlane      *plane,
+  float          *parametric_collision_time ) // NULL if not needed
+{
+  float t, dot, mind, maxd;
+  gx3dVector vmin, vmax;
+  gxRelation result;
+  
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (box);
+  DEBUG_ASSERT (trajectory);
+  // Make sure normal is normalized
+  DEBUG_ASSERT (fabsf(gx3d_VectorDotProduct (&trajectory->direction, &trajectory->direction) - 1) < .01);
+  DEBUG_ASSERT (dtime > 0);
+  DEBUG_ASSERT (plane);
+  // Make sure normal is normalized
+  DEBUG_ASSERT (fabsf(gx3d_VectorDotProduct (&plane->n, &plane->n) - 1) < .01);
+
+/*____________________________________________________________________
+|
+| Find the diagonal most closely aligned with the plane normal (see
+|   gxRelation_Box_Plane())
+|___________________________________________________________________*/
+
+  if (plane->n.x >= 0) {
+    vmin.x = box->min.x;
+    vmax.x = box->max.x;
+  }
+  else {
+    vmin.x = box->max.x;
+    vmax.x = box->min.x;
+  }
+  if (plane->n.y >= 0) {
+    vmin.y = box->min.y;
+    vmax.y = box->max.y;
+  }
+  else {
+    vmin.y = box->max.y;
+    vmax.y = box->min.y;
+  }
+  if (plane->n.z >= 0) {
+    vmin.z = box->min.z;
+    vmax.z = box->max.z;
+  }
+  else {
+    vmin.z = box->max.z;
+    vmax.z = box->min.z;
+  }
+  mind = gx3d_Distance_Point_Plane (&vmin, plane);
+  maxd = gx3d_Distance_Point_Plane (&vmax, plane);
+                 
+  // Compute angle between trajectory and plane normal
+  dot = gx3d_VectorDotProduct (&trajectory->direction, &plane->n);
+
+/*____________________________________________________________________
+|
+| Process a box moving parallel to plane
+|___________________________________________________________________*/
+
+  if (EQUAL_ZERO(dot)) {
+    // Is box already intersecting plane?
+    if ((mind * maxd) <= 0) {
+      result = gxRELATION_INTERSECT;
+      t = 0;
+    }
+    else
+      result = gxRELATION_OUTSIDE;
+  }
+  else {
+
+/*____________________________________________________________________
+|
+| Process a box in front of plane (and not moving parallel to plane)
+|___________________________________________________________________*/
+
+    // Is vmin in front of plane?
+    if (mind > 0) { 
+      // Compute intersection of ray starting at vmin, going in trajectory->direction, with plane
+      t = -mind / dot;
+      // Is box moving away from plane?
+      if (t < 0) 
+        result = gxRELATION_OUTSIDE;
+      else 
+        result = gxRELATION_INTERSECT;
+    }
+
+/*____________________________________________________________________
+|
+| Process a box in back of plane
+|___________________________________________________________________*/
+
+    // Is vmax in back of plane?
+    else if (maxd < 0) { 
+      // Compute intersection of ray starting at vmin, going in trajectory->direction, with plane
+      t = -maxd / dot;
+      // Is box moving away from plane?
+      if (t < 0) 
+        result = gxRELATION_OUTSIDE;
+      else 
+        result = gxRELATION_INTERSECT;
+    }
+
+/*____________________________________________________________________
+|
+| Process a box already touching plane
+|___________________________________________________________________*/
+
+    else 
+      result = gxRELATION_INTERSECT;
+  }
+
+/*____________________________________________________________________
+|
+| Scale collision time by velocity to get a value between 0-1
+|___________________________________________________________________*/
+
+  if (result == gxRELATION_INTERSECT) {
+    t /= (trajectory->velocity * dtime);
+    if (t > 1)
+      result = gxRELATION_OUTSIDE;
+    else if (parametric_collision_time)
+      *parametric_collision_time = t;
+  }
+
+  return (result);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Collide_Box_StaticPlane
+|
+| Output: Returns collision info regarding a AAA box moving relative to
+|   a static plane.  Returns relation and optionally, the parametric 
+|   collision time in the range 0-1.
+|
+|   The movement being calculated occurs over a default 1 time unit.
+|
+|   Returns gxRELATION_OUTSIDE   = no collision occurs
+|           gxRELATION_INTERSECT = box collides with plane
+|
+| Reference: 3D Math for Graphics and Games Development (pg. 310, 284),
+|   Real-Time Rendering, 2nd ed. (pg. 587)
+|___________________________________________________________________*/
+
+gxRelation gx3d_Collide_Box_StaticPlane (
+  gx3dBox                 *box,
+  gx3dProjectedTrajectory *ptrajectory,
+  gx3dPlane               *plane,
+  float                   *parametric_collision_time ) // NULL if not needed
+{
+  gx3dTrajectory trajectory;
+  
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (box);
+  DEBUG_ASSERT (ptrajectory);
+  // Make sure trajectory direction is not 0
+  DEBUG_ASSERT (ptrajectory->direction.x + ptrajectory->direction.y + ptrajectory->direction.z);
+  DEBUG_ASSERT (plane);
+  // Make sure normal is normalized
+  DEBUG_ASSERT (fabsf(gx3d_VectorDotProduct (&plane->n, &plane->n) -1.0) < .01);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  // Extract normal and velocity from projected trajectory (time is assumed to be 1 unit)
+  gx3d_NormalizeVector (&ptrajectory->direction, &trajectory.direction, &trajectory.velocity);
+  
+  return (gx3d_Collide_Box_StaticPlane (box, &trajectory, 1, plane, parametric_collision_time));
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Collide_Box_StaticSphere
+|
+| Output: Returns collision info regarding a AAB box moving relative to
+|   a static sphere.  Returns relation and optionally, the parametric 
+|   collision time in the range 0-1 and the point of contact on the box
+|   (at the time of collision).
+|
+|   Returns gxRELATION_OUTSIDE   = no collision occurs
+|           gxRELATION_INTERSECT = box collides with sphere
+|
+|   If the box is already intersecting the sphere, the collision time 
+|   is 0.
+|
+| Description: Same as the sphere moving the opposite way relative to
+|   a static box.
+|___________________________________________________________________*/
+
+gxRelation gx3d_Collide_Box_StaticSphere (
+  gx3dBox        *box,
+  gx3dTrajectory *trajectory,
+  float           dtime,                      // period of time box moves
+  gx3dSphere     *static_sphere,
+  float          *parametric_collision_time,  // NULL if not needed
+  gx3dVector     *collision_point )           // NULL if not needed
+{
+  float t;
+  gx3dVector v, reverse_v, contact;
+  gxRelation result;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (box);
+  DEBUG_ASSERT (trajectory);
+  // Make sure normal is normalized
+  DEBUG_ASSERT (fabsf(gx3d_VectorDotProduct (&trajectory->direction, &trajectory->direction) - 1) < .01);
+  DEBUG_ASSERT (dtime > 0);
+  DEBUG_ASSERT (static_sphere);
+  DEBUG_ASSERT (static_sphere->radius > 0);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  // Compute the movement vector of the box
+  gx3d_MultiplyScalarVector (trajectory->velocity * dtime, &trajectory->direction, &v);
+  // Compute the movement of the sphere relative to the box
+  gx3d_NegateVector (&v, &reverse_v);
+
+  result = Collide_Sphere_Box (&static_sphere->center, static_sphere->radius, &reverse_v, box, &t, &contact);
+  if (result == gxRELATION_INTERSECT) {
+    if (parametric_collision_time)
+      *parametric_collision_time = t;
+    // Move point of contact along with the box
+    if (collision_point) {
+      collision_point->x = contact.x + t * v.x;
+      collision_point->y = contact.y + t * v.y;
+      collision_point->z = contact.z + t * v.z;
+    }
+  }
+
+  return (result);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Collide_Box_StaticSphere
+|
+| Output: Returns collision info regarding a AAB box moving relative to
+|   a static sphere.  Returns relation and optionally, the parametric 
+|   collision time in the range 0-1 and the point of contact on the box
+|   (at the time of collision).
+|
+|   The movement being calculated occurs over a default 1 time unit.
+|
+|   Returns gxRELATION_OUTSIDE   = no collision occurs
+|           gxRELATION_INTERSECT = box collides with sphere
+|___________________________________________________________________*/
+
+gxRelation gx3d_Collide_Box_StaticSphere (
+  gx3dBox                 *box,
+  gx3dProjectedTrajectory *ptrajectory,
+  gx3dSphere              *static_sphere,
+  float                   *parametric_collision_time, // NULL if not needed
+  gx3dVector              *collision_point )          // NULL if not needed
+{
+  gx3dTrajectory trajectory;
+  
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (box);
+  DEBUG_ASSERT (ptrajectory);
+  // Make sure trajectory direction is not 0
+  DEBUG_ASSERT (ptrajectory->direction.x + ptrajectory->direction.y + ptrajectory->direction.z);
+  DEBUG_ASSERT (static_sphere);
+  DEBUG_ASSERT (static_sphere->radius > 0);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  // Extract normal and velocity from projected trajectory (time is assumed to be 1 unit)
+  gx3d_NormalizeVector (&ptrajectory->direction, &trajectory.direction, &trajectory.velocity);
+  
+  return (gx3d_Collide_Box_StaticSphere (box, &trajectory, 1, static_sphere, parametric_collision_time, collision_point));
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Collide_Box_StaticBox
+|
+| Output: Returns collision info regarding a AAA box moving relative to
+|   a static AAB box.  Returns relation and optionally, the parametric 
+|   collision time in the range 0-1.
+|
+|   Returns gxRELATION_OUTSIDE   = no collision occurs
+|           gxRELATION_INTERSECT = box collides with box
+|
+| Reference: 3D Math for Graphics and Games Development (pg. 313)
+|___________________________________________________________________*/
+
+gxRelation gx3d_Collide_Box_StaticBox (
+  gx3dBox        *box,
+  gx3dTrajectory *trajectory,
+  float           dtime,                      // period of time box moves
+  gx3dBox        *static_box,
+  float          *parametric_collision_time ) // NULL if not needed
+{
+  float f, t_enter, t_leave, enter, leave;
+  gx3dProjectedTrajectory ptrajectory;
+  gxRelation result = gxRELATION_INTERSECT; // assume intersecting
+  
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (box);
+  DEBUG_ASSERT (trajectory);
+  // Make sure normal is normalized
+  DEBUG_ASSERT (fabsf(gx3d_VectorDotProduct (&trajectory->direction, &trajectory->direction) - 1) < .01);
+  DEBUG_ASSERT (dtime > 0);
+  DEBUG_ASSERT (static_box);
+
+/*____________________________________________________________________
+|
+| Init variables
+|___________________________________________________________________*/
+
+  // Compute the projected trajectory
+  gx3d_MultiplyScalarVector (trajectory->velocity * dtime, &trajectory->direction, &ptrajectory.direction);
+  
+  // Initialize interval to contain all the time under consideration
+  t_enter = 0;
+  t_leave = 1;
+
+/*____________________________________________________________________
+|
+| Compute interval of overlap on each dimension, and intersect this 
 | interval with the interval accumulated so far.  When an empty interval
 | is found, return a negative result (no intersection).  Look out for an
 | infinite or empty interval of each dimension.
@@ -718,7 +1462,7 @@ gxRelation gx3d_Collide_Box_StaticBox (
       // Update interval
       if (enter > t_enter) 
         t_enter = enter;
-      if (leave > t_leave)
+      if (leave < t_leave)
         t_leave = leave;
       // Check if this resulted in empty interval
       if (t_enter > t_leave)
@@ -749,7 +1493,7 @@ gxRelation gx3d_Collide_Box_StaticBox (
       // Update interval
       if (enter > t_enter) 
         t_enter = enter;
-      if (leave > t_leave)
+      if (leave < t_leave)
         t_leave = leave;
       // Check if this resulted in empty interval
       if (t_enter > t_leave)
@@ -780,7 +1524,7 @@ gxRelation gx3d_Collide_Box_StaticBox (
       // Update interval
       if (enter > t_enter) 
         t_enter = enter;
-      if (leave > t_leave)
+      if (leave < t_leave)
         t_leave = leave;
       // Check if this resulted in empty interval
       if (t_enter > t_leave)
@@ -788,9 +1532,9 @@ gxRelation gx3d_Collide_Box_StaticBox (
     }
   }
 
-  // Compute collision time
-  if (parametric_collision_time)
-    *parametric_collision_time = t_enter / (trajectory->velocity * dtime);
+  // Compute collision time (already scaled to 0-1 by the projected trajectory)
+  if ((result == gxRELATION_INTERSECT) AND parametric_collision_time)
+    *parametric_collision_time = t_enter;
   
   return (result);
 }
@@ -840,6 +1584,118 @@ gxRelation gx3d_Collide_Box_StaticBox (
   return (gx3d_Collide_Box_StaticBox (box, &trajectory, 1, static_box, parametric_collision_time));
 }
 
+/*____________________________________________________________________
+|
+| Function: gx3d_Collide_Box_StaticBoxes
+|
+| Output: Returns collision info regarding a AAB box moving relative to
+|   an array of static AAB boxes.  Returns the index of the first box
+|   collided with or -1 if none.  Optionally returns the parametric 
+|   collision time in the range 0-1.
+|
+|   Gives the same result as calling gx3d_Collide_Box_StaticBox() for
+|   each box and keeping the earliest collision (lowest index on a tie).
+|
+| Description: Tests 8 (AVX) or 4 (SSE) boxes at a time.
+|___________________________________________________________________*/
+
+int gx3d_Collide_Box_StaticBoxes (
+  gx3dBox        *box,
+  gx3dTrajectory *trajectory,
+  float           dtime,                      // period of time box moves
+  gx3dBox        *static_boxes,
+  int             num_boxes,
+  float          *parametric_collision_time ) // NULL if not needed
+{
+  int i, j, n;
+  unsigned hits, features;
+  float t_enter[8], collision_time;
+  gx3dVector v;
+  Sweep sweep;
+  int index = -1;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (box);
+  DEBUG_ASSERT (trajectory);
+  // Make sure normal is normalized
+  DEBUG_ASSERT (fabsf(gx3d_VectorDotProduct (&trajectory->direction, &trajectory->direction) - 1) < .01);
+  DEBUG_ASSERT (dtime > 0);
+  DEBUG_ASSERT (static_boxes OR (num_boxes == 0));
+  DEBUG_ASSERT (num_boxes >= 0);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  // Compute the projected trajectory
+  gx3d_MultiplyScalarVector (trajectory->velocity * dtime, &trajectory->direction, &v);
+  Init_Sweep (&sweep, &box->min, &box->max, 0, false, &v);
+
+  collision_time = 1;
+  features = gx3d_GetCPUFeatures ();
+  for (i=0; i<num_boxes; i+=n) {
+    hits = Sweep_Boxes (&sweep, &static_boxes[i], num_boxes - i, features, t_enter, &n);
+    for (j=0; hits; j++, hits>>=1) 
+      if ((hits & 1) AND ((index == -1) OR (t_enter[j] < collision_time))) {
+        index = i + j;
+        collision_time = t_enter[j];
+      }
+  }
+
+  if ((index != -1) AND parametric_collision_time)
+    *parametric_collision_time = collision_time;
+
+  return (index);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Collide_Box_StaticBoxes
+|
+| Output: Returns collision info regarding a AAB box moving relative to
+|   an array of static AAB boxes.  Returns the index of the first box
+|   collided with or -1 if none.  Optionally returns the parametric 
+|   collision time in the range 0-1.
+|
+|   The movement being calculated occurs over a default 1 time unit.
+|___________________________________________________________________*/
+
+int gx3d_Collide_Box_StaticBoxes (
+  gx3dBox                 *box,
+  gx3dProjectedTrajectory *ptrajectory,
+  gx3dBox                 *static_boxes,
+  int                      num_boxes,
+  float                   *parametric_collision_time )  // NULL if not needed
+{
+  gx3dTrajectory trajectory;
+  
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (box);
+  DEBUG_ASSERT (ptrajectory);
+  // Make sure trajectory direction is not 0
+  DEBUG_ASSERT (ptrajectory->direction.x + ptrajectory->direction.y + ptrajectory->direction.z);
+  DEBUG_ASSERT (static_boxes OR (num_boxes == 0));
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  // Extract normal and velocity from projected trajectory (time is assumed to be 1 unit)
+  gx3d_NormalizeVector (&ptrajectory->direction, &trajectory.direction, &trajectory.velocity);
+  
+  return (gx3d_Collide_Box_StaticBoxes (box, &trajectory, 1, static_boxes, num_boxes, parametric_collision_time));
+}
+
 /*____________________________________________________________________
 |
 | Function: gx3d_Collide_Box_Box
@@ -898,11 +1754,11 @@ gxRelation gx3d_Collide_Box_Box (
   gx3d_MultiplyScalarVector (trajectory1->velocity * dtime, &trajectory1->direction, &dv1);
   gx3d_MultiplyScalarVector (trajectory2->velocity * dtime, &trajectory2->direction, &dv2);
 
-  // Compute the trajectory of movement of box1 relative to box2
+  // Compute the trajectory of movement of box1 relative to box2 (dv1, dv2 already include dtime)
   gx3d_SubtractVector (&dv1, &dv2, &trajectory.direction);
-  gx3d_NormalizeVector (&trajectory.direction, &trajectory.direction);
+  gx3d_NormalizeVector (&trajectory.direction, &trajectory.direction, &trajectory.velocity);
 
-  return (gx3d_Collide_Box_StaticBox (box1, &trajectory, dtime, box2, parametric_collision_time));
+  return (gx3d_Collide_Box_StaticBox (box1, &trajectory, 1, box2, parametric_collision_time));
 }
   
 /*____________________________________________________________________
@@ -951,3 +1807,487 @@ gxRelation gx3d_Collide_Box_Box (
   
   return (gx3d_Collide_Box_Box (box1, &trajectory1, 1, box2, &trajectory2, parametric_collision_time));
 }
+
+/*____________________________________________________________________
+|
+| Function: Point_In_Triangle
+|
+| Input: Called from gx3d_Collide_Sphere_StaticTriangle()
+| Output: Returns true if a point on the plane of a triangle is inside
+|   the triangle.
+|___________________________________________________________________*/
+
+static bool Point_In_Triangle (gx3dVector *point, gx3dVector *vertices, gx3dVector *normal)
+{
+  int i;
+  gx3dVector edge, v, cross;
+  bool inside = true;
+
+  for (i=0; (i<3) AND inside; i++) {
+    gx3d_SubtractVector (&vertices[(i+1)%3], &vertices[i], &edge);
+    gx3d_SubtractVector (point, &vertices[i], &v);
+    gx3d_VectorCrossProduct (&edge, &v, &cross);
+    if (gx3d_VectorDotProduct (&cross, normal) < 0)
+      inside = false;
+  }
+
+  return (inside);
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Lowest_Root
+|
+| Input: Called from gx3d_Collide_Sphere_StaticTriangle()
+| Output: Solves a*x^2 + b*x + c = 0.  Returns true if there is a root
+|   in the range 0-max_root, and returns the lowest such root.
+|___________________________________________________________________*/
+
+static bool Get_Lowest_Root (float a, float b, float c, float max_root, float *root)
+{
+  float determinant, sqrt_d, r1, r2, temp;
+  bool found = false;
+
+  determinant = b*b - 4*a*c;
+  if ((determinant >= 0) AND NOT EQUAL_ZERO(a)) {
+    sqrt_d = sqrtf (determinant);
+    r1 = (-b - sqrt_d) / (2*a);
+    r2 = (-b + sqrt_d) / (2*a);
+    if (r1 > r2) {
+      temp = r1;
+      r1 = r2;
+      r2 = temp;
+    }
+    if ((r1 > 0) AND (r1 < max_root)) {
+      *root = r1;
+      found = true;
+    }
+    else if ((r2 > 0) AND (r2 < max_root)) {
+      *root = r2;
+      found = true;
+    }
+  }
+
+  return (found);
+}
+
+/*____________________________________________________________________
+|
+| Function: Collide_Sphere_Box
+|
+| Input: Called from gx3d_Collide_Sphere_StaticBox(), 
+|   gx3d_Collide_Sphere_Box(), gx3d_Collide_Sphere_StaticBoxes(),
+|   gx3d_Collide_Box_StaticSphere()
+| Output: Returns collision info regarding a sphere moving (by a vector
+|   that may be 0) relative to a static box.  If a collision occurs,
+|   returns the parametric collision time in the range 0-1 and the point 
+|   of contact on the box.
+|
+| Description: The sphere collides with the box when its center enters
+|   the box with rounded edges and corners formed by growing the box by
+|   the radius.  First find when the center enters the box grown by the 
+|   radius (with square edges).  If that point is next to a face of the
+|   box, that is the collision.  Otherwise it is next to an edge or a 
+|   corner, so the collision is with the rounded edge (a capsule) or one 
+|   of the 3 rounded edges meeting at the corner, if any.
+|
+| Reference: Real-Time Collision Detection, pg. 228
+|___________________________________________________________________*/
+
+static gxRelation Collide_Sphere_Box (
+  gx3dVector *center,
+  float       radius,
+  gx3dVector *v,                    // movement of sphere
+  gx3dBox    *box,
+  float      *collision_time,
+  gx3dVector *collision_point )
+{
+  int i, below, above, num_outside;
+  float f, c, m, min, max, enter, leave, t_enter, t_leave, r2, t;
+  gx3dVector p, corner, end;
+  gxRelation result = gxRELATION_OUTSIDE;
+
+/*____________________________________________________________________
+|
+| Is sphere already intersecting the box?
+|___________________________________________________________________*/
+
+  r2 = radius * radius;
+  gx3d_Nearest_Point_Box (center, box, &p);
+  if (gx3d_DistanceSquared_Point_Point (center, &p) <= r2) {
+    *collision_time  = 0;
+    *collision_point = p;
+    return (gxRELATION_INTERSECT);
+  }
+
+/*____________________________________________________________________
+|
+| Find when the center enters the box grown by the radius
+|___________________________________________________________________*/
+
+  t_enter = 0;
+  t_leave = 1;
+  for (i=0; i<3; i++) {
+    c   = ((float *)center)[i];
+    m   = ((float *)v)[i];
+    min = ((float *)&(box->min))[i] - radius;
+    max = ((float *)&(box->max))[i] + radius;
+    // Not moving on this axis?
+    if (m == 0) {
+      if ((c < min) OR (c > max))
+        return (gxRELATION_OUTSIDE);
+    }
+    else {
+      f = 1 / m;
+      enter = (min - c) * f;
+      leave = (max - c) * f;
+      if (enter > leave) {
+        f = enter;
+        enter = leave;
+        leave = f;
+      }
+      if (enter > t_enter)
+        t_enter = enter;
+      if (leave < t_leave)
+        t_leave = leave;
+      if (t_enter > t_leave)
+        return (gxRELATION_OUTSIDE);
+    }
+  }
+
+/*____________________________________________________________________
+|
+| Find which region of the box the point of entry is next to
+|___________________________________________________________________*/
+
+  below = 0;
+  above = 0;
+  num_outside = 0;
+  for (i=0; i<3; i++) {
+    ((float *)&p)[i] = ((float *)center)[i] + t_enter * ((float *)v)[i];
+    if (((float *)&p)[i] < ((float *)&(box->min))[i]) {
+      below |= (1 << i);
+      num_outside++;
+    }
+    else if (((float *)&p)[i] > ((float *)&(box->max))[i]) {
+      above |= (1 << i);
+      num_outside++;
+    }
+    // Corner of the box nearest the point of entry
+    if (above & (1 << i))
+      ((float *)&corner)[i] = ((float *)&(box->max))[i];
+    else
+      ((float *)&corner)[i] = ((float *)&(box->min))[i];
+  }
+
+/*____________________________________________________________________
+|
+| Face region: point of entry is the point of collision
+|___________________________________________________________________*/
+
+  if (num_outside <= 1) {
+    *collision_time = t_enter;
+    gx3d_Nearest_Point_Box (&p, box, collision_point);
+    result = gxRELATION_INTERSECT;
+  }
+
+/*____________________________________________________________________
+|
+| Edge or corner region: test the rounded edges 
+|___________________________________________________________________*/
+
+  else {
+    t = 1;
+    for (i=0; i<3; i++) 
+      // Test the edge along an axis the point of entry is within, or all 3 edges of a corner
+      if ((num_outside == 3) OR NOT ((below | above) & (1 << i))) {
+        end = corner;
+        if (above & (1 << i))
+          ((float *)&end)[i] = ((float *)&(box->min))[i];
+        else
+          ((float *)&end)[i] = ((float *)&(box->max))[i];
+        if (Collide_Sphere_Edge (center, v, r2, &corner, &end, &t, collision_point)) {
+          *collision_time = t;
+          result = gxRELATION_INTERSECT;
+        }
+      }
+  }
+
+  return (result);
+}
+
+/*____________________________________________________________________
+|
+| Function: Collide_Sphere_Edge
+|
+| Input: Called from Collide_Sphere_Box()
+| Output: Returns true if a sphere moving by v collides with an edge
+|   (including its end points) at a time earlier than collision_time.
+|   If so, returns the new collision time and the point of contact.
+|___________________________________________________________________*/
+
+static bool Collide_Sphere_Edge (
+  gx3dVector *center,
+  gx3dVector *v,                    // movement of sphere
+  float       r2,                   // radius squared
+  gx3dVector *start,                // edge end points
+  gx3dVector *end,
+  float      *collision_time,
+  gx3dVector *collision_point )
+{
+  int i;
+  float t, f, a, b, c, edge_squared, edge_dot_v, edge_dot_base;
+  gx3dVector edge, base, *vertex;
+  bool found = false;
+
+  a = gx3d_VectorDotProduct (v, v);
+  if (a > 0) {
+    for (i=0; i<2; i++) {
+      // Test vertex: |center + t*v - vertex|^2 = r^2
+      vertex = (i == 0) ? start : end;
+      gx3d_SubtractVector (center, vertex, &base);
+      b = 2 * gx3d_VectorDotProduct (v, &base);
+      c = gx3d_VectorDotProduct (&base, &base) - r2;
+      if (Get_Lowest_Root (a, b, c, *collision_time, &t)) {
+        *collision_time  = t;
+        *collision_point = *vertex;
+        found = true;
+      }
+    }
+    // Test edge: distance from center + t*v to line through edge = r
+    gx3d_SubtractVector (end, start, &edge);
+    gx3d_SubtractVector (start, center, &base);
+    edge_squared  = gx3d_VectorDotProduct (&edge, &edge);
+    edge_dot_v    = gx3d_VectorDotProduct (&edge, v);
+    edge_dot_base = gx3d_VectorDotProduct (&edge, &base);
+    if (edge_squared > 0) 
+      if (Get_Lowest_Root (edge_squared * -a + edge_dot_v * edge_dot_v,
+                           edge_squared * 2 * gx3d_VectorDotProduct (v, &base) - 2 * edge_dot_v * edge_dot_base,
+                           edge_squared * (r2 - gx3d_VectorDotProduct (&base, &base)) + edge_dot_base * edge_dot_base,
+                           *collision_time, &t)) {
+        // Is the point of contact on the edge?
+        f = (edge_dot_v * t - edge_dot_base) / edge_squared;
+        if ((f >= 0) AND (f <= 1)) {
+          *collision_time = t;
+          collision_point->x = start->x + f * edge.x;
+          collision_point->y = start->y + f * edge.y;
+          collision_point->z = start->z + f * edge.z;
+          found = true;
+        }
+      }
+  }
+
+  return (found);
+}
+
+/*____________________________________________________________________
+|
+| Function: Init_Sweep
+|
+| Input: Called from gx3d_Collide_Sphere_StaticBoxes(),
+|   gx3d_Collide_Box_StaticBoxes()
+| Output: Sets up a box moving by v to be tested against static boxes
+|   grown by grow.  A sphere is a box with min = max = center, tested
+|   against boxes grown by its radius.  If touching is true, boxes that
+|   only touch count as hit.
+|___________________________________________________________________*/
+
+static void Init_Sweep (Sweep *sweep, gx3dVector *min, gx3dVector *max, float grow, bool touching, gx3dVector *v)
+{
+  int i;
+
+  for (i=0; i<3; i++) {
+    sweep->min[i] = ((float *)min)[i];
+    sweep->max[i] = ((float *)max)[i];
+    sweep->v[i]   = ((float *)v)[i];
+    if (sweep->v[i] != 0)
+      sweep->inv_v[i] = 1 / sweep->v[i];
+    else
+      sweep->inv_v[i] = 0;
+  }
+  sweep->grow     = grow;
+  sweep->touching = touching;
+}
+
+/*____________________________________________________________________
+|
+| Function: Sweep_Boxes
+|
+| Input: Called from gx3d_Collide_Sphere_StaticBoxes(),
+|   gx3d_Collide_Box_StaticBoxes()
+| Output: Tests the next group of boxes (8, 4 or 1 depending on the CPU 
+|   and # of boxes left) against the sweep.  Returns # of boxes tested 
+|   in n, and a bit mask of the boxes hit.  For each box hit, returns
+|   the parametric time of entry in t_enter.
+|___________________________________________________________________*/
+
+static unsigned Sweep_Boxes (
+  Sweep    *sweep,
+  gx3dBox  *boxes,
+  int       num_boxes,
+  unsigned  features,
+  float    *t_enter,
+  int      *n )
+{
+  unsigned hits;
+
+  if ((features & gx3d_CPU_AVX) AND (num_boxes >= 8)) {
+    hits = Sweep_Boxes_AVX (sweep, boxes, t_enter);
+    *n = 8;
+  }
+  else if ((features & gx3d_CPU_SSE2) AND (num_boxes >= 4)) {
+    hits = Sweep_Boxes_SSE (sweep, boxes, t_enter);
+    *n = 4;
+  }
+  else {
+    hits = Sweep_Box (sweep, boxes, t_enter);
+    *n = 1;
+  }
+
+  return (hits);
+}
+
+/*____________________________________________________________________
+|
+| Function: Sweep_Box
+|
+| Input: Called from Sweep_Boxes()
+| Output: Tests 1 box against the sweep.  Returns 1 if hit, else 0.
+|
+| Description: Same test as gx3d_Collide_Box_StaticBox().
+|___________________________________________________________________*/
+
+static unsigned Sweep_Box (Sweep *sweep, gx3dBox *box, float *t_enter)
+{
+  int i;
+  float f, min, max, enter, leave, t_leave;
+
+  *t_enter = 0;
+  t_leave  = 1;
+  for (i=0; i<3; i++) {
+    min = ((float *)&(box->min))[i] - sweep->grow;
+    max = ((float *)&(box->max))[i] + sweep->grow;
+    if (sweep->v[i] == 0) {
+      if (sweep->touching) {
+        if ((min > sweep->max[i]) OR (max < sweep->min[i]))
+          return (0);
+      }
+      else if ((min >= sweep->max[i]) OR (max <= sweep->min[i]))
+        return (0);
+    }
+    else {
+      enter = (min - sweep->max[i]) * sweep->inv_v[i];
+      leave = (max - sweep->min[i]) * sweep->inv_v[i];
+      if (enter > leave) {
+        f = enter;
+        enter = leave;
+        leave = f;
+      }
+      if (enter > *t_enter)
+        *t_enter = enter;
+      if (leave < t_leave)
+        t_leave = leave;
+      if (*t_enter > t_leave)
+        return (0);
+    }
+  }
+
+  return (1);
+}
+
+/*____________________________________________________________________
+|
+| Function: Sweep_Boxes_SSE
+|
+| Input: Called from Sweep_Boxes()
+| Output: Tests 4 boxes against the sweep using SSE.  Returns a bit 
+|   mask of the boxes hit.
+|
+| Description: Computes the same values as Sweep_Box(), so the results
+|   are exactly the same.
+|___________________________________________________________________*/
+
+static unsigned Sweep_Boxes_SSE (Sweep *sweep, gx3dBox *boxes, float *t_enter)
+{
+  int i;
+  __m128 min, max, enter, leave, inv_v, grow, te, tl, out;
+  float *b = (float *)boxes;
+
+  grow = _mm_set1_ps (sweep->grow);
+  te   = _mm_setzero_ps ();
+  tl   = _mm_set1_ps (1);
+  out  = _mm_setzero_ps ();
+  for (i=0; i<3; i++) {
+    // Load axis i of the 4 boxes (6 floats per box)
+    min = _mm_sub_ps (_mm_setr_ps (b[i], b[6+i], b[12+i], b[18+i]), grow);
+    max = _mm_add_ps (_mm_setr_ps (b[3+i], b[9+i], b[15+i], b[21+i]), grow);
+    if (sweep->v[i] == 0) {
+      if (sweep->touching)
+        out = _mm_or_ps (out, _mm_or_ps (_mm_cmpgt_ps (min, _mm_set1_ps (sweep->max[i])), _mm_cmplt_ps (max, _mm_set1_ps (sweep->min[i]))));
+      else
+        out = _mm_or_ps (out, _mm_or_ps (_mm_cmpge_ps (min, _mm_set1_ps (sweep->max[i])), _mm_cmple_ps (max, _mm_set1_ps (sweep->min[i]))));
+    }
+    else {
+      inv_v = _mm_set1_ps (sweep->inv_v[i]);
+      enter = _mm_mul_ps (_mm_sub_ps (min, _mm_set1_ps (sweep->max[i])), inv_v);
+      leave = _mm_mul_ps (_mm_sub_ps (max, _mm_set1_ps (sweep->min[i])), inv_v);
+      te = _mm_max_ps (te, _mm_min_ps (enter, leave));
+      tl = _mm_min_ps (tl, _mm_max_ps (enter, leave));
+    }
+  }
+  out = _mm_or_ps (out, _mm_cmpgt_ps (te, tl));
+  _mm_storeu_ps (t_enter, te);
+
+  return (~_mm_movemask_ps (out) & 0xF);
+}
+
+/*____________________________________________________________________
+|
+| Function: Sweep_Boxes_AVX
+|
+| Input: Called from Sweep_Boxes()
+| Output: Tests 8 boxes against the sweep using AVX.  Returns a bit 
+|   mask of the boxes hit.
+|
+| Description: Computes the same values as Sweep_Box(), so the results
+|   are exactly the same.
+|___________________________________________________________________*/
+
+static unsigned Sweep_Boxes_AVX (Sweep *sweep, gx3dBox *boxes, float *t_enter)
+{
+  int i;
+  unsigned hits;
+  __m256 min, max, enter, leave, inv_v, grow, te, tl, out;
+  float *b = (float *)boxes;
+
+  grow = _mm256_set1_ps (sweep->grow);
+  te   = _mm256_setzero_ps ();
+  tl   = _mm256_set1_ps (1);
+  out  = _mm256_setzero_ps ();
+  for (i=0; i<3; i++) {
+    // Load axis i of the 8 boxes (6 floats per box)
+    min = _mm256_sub_ps (_mm256_setr_ps (b[i], b[6+i], b[12+i], b[18+i], b[24+i], b[30+i], b[36+i], b[42+i]), grow);
+    max = _mm256_add_ps (_mm256_setr_ps (b[3+i], b[9+i], b[15+i], b[21+i], b[27+i], b[33+i], b[39+i], b[45+i]), grow);
+    if (sweep->v[i] == 0) {
+      if (sweep->touching)
+        out = _mm256_or_ps (out, _mm256_or_ps (_mm256_cmp_ps (min, _mm256_set1_ps (sweep->max[i]), _CMP_GT_OQ), _mm256_cmp_ps (max, _mm256_set1_ps (sweep->min[i]), _CMP_LT_OQ)));
+      else
+        out = _mm256_or_ps (out, _mm256_or_ps (_mm256_cmp_ps (min, _mm256_set1_ps (sweep->max[i]), _CMP_GE_OQ), _mm256_cmp_ps (max, _mm256_set1_ps (sweep->min[i]), _CMP_LE_OQ)));
+    }
+    else {
+      inv_v = _mm256_set1_ps (sweep->inv_v[i]);
+      enter = _mm256_mul_ps (_mm256_sub_ps (min, _mm256_set1_ps (sweep->max[i])), inv_v);
+      leave = _mm256_mul_ps (_mm256_sub_ps (max, _mm256_set1_ps (sweep->min[i])), inv_v);
+      te = _mm256_max_ps (te, _mm256_min_ps (enter, leave));
+      tl = _mm256_min_ps (tl, _mm256_max_ps (enter, leave));
+    }
+  }
+  out = _mm256_or_ps (out, _mm256_cmp_ps (te, tl, _CMP_GT_OQ));
+  _mm256_storeu_ps (t_enter, te);
+  hits = ~_mm256_movemask_ps (out) & 0xFF;
+
+  // Avoid AVX to SSE transition penalty in caller
+  _mm256_zeroupper ();
+
+  return (hits);
+}
@@ -0,0 +1,661 @@
+/*____________________________________________________________________
+|
+| File: gx3d_convexhull.cpp
+|
+| Description: Functions to manipulate gx3dConvexHull.
+|
+| Functions: gx3d_ConvexHull_Init
+|             Init_Simplex
+|              Add_Face
+|              Add_Outside_Point
+|             Add_Point
+|              Add_Face
+|              Add_Outside_Point
+|             Copy_Hull
+|            gx3d_ConvexHull_Free
+|            gx3d_GetLayerConvexHull
+|            gx3d_ConvexHull_Support
+|
+| Description: A convex hull is the smallest convex polyhedron that
+|   contains a set of points.  It is a much tighter collision shape for
+|   most objects than a bound box or sphere, and can be tested with the
+|   GJK/EPA functions in gx3d_gjk.cpp.
+|
+|   The hull is built with the quickhull algorithm.  Starting with a
+|   tetrahedron of 4 extreme points, each point outside the hull is
+|   assigned to one face it is in front of.  The point farthest in front
+|   of a face is added to the hull by removing all the faces it can see
+|   and connecting it to the edges around the hole (the horizon).  The
+|   remaining points are reassigned to the new faces, and points inside
+|   the hull are dropped.  This repeats until no points are left outside.
+|
+|   The hull keeps a list of the vertices connected to each vertex, so
+|   the vertex farthest in a direction (support point) can be found by
+|   walking uphill from a nearby vertex instead of testing all of them.
+|
+| (C) Copyright 2017 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|
+| DEBUG_ASSERTED!
+|___________________________________________________________________*/
+
+//#define DEBUG
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+
+#include <math.h>
+#include <float.h>
+
+#include "dp.h"
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define MIN_FACES             32    // initial size of face array
+#define HILL_CLIMB_MIN_VERTICES 16  // search hulls with fewer vertices than this one vertex at a time
+
+/*___________________
+|
+| Macros
+|__________________*/
+
+#define DISTANCE_POINT_PLANE(_p_,_plane_) ((_plane_)->n.x * (_p_)->x + (_plane_)->n.y * (_p_)->y + (_plane_)->n.z * (_p_)->z + (_plane_)->d)
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+// Triangle of a hull being built
+typedef struct {
+  int       v[3];                   // vertices (clockwise seen from outside)
+  gx3dPlane plane;                  // normal points out
+  int       first_point;            // first point in front of this face or -1
+  bool      deleted;
+} Hull_Face;
+
+// Hull being built
+typedef struct {
+  gx3dVector *vertex;               // input points
+  int         num_vertices;
+  int        *point_next;           // next point in front of the same face or -1
+  Hull_Face  *face;
+  int         num_faces;
+  int         max_faces;
+  float       epsilon;              // points closer to a face than this are on it
+  // Scratch arrays
+  int        *visible;              // faces seen by the point being added
+  int        *horizon;              // edges around the visible faces (2 vertices each)
+  int        *points;               // points in front of the visible faces
+} Hull_Build;
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static bool Init_Simplex (Hull_Build *build);
+static bool Add_Point (Hull_Build *build, int face);
+static int  Add_Face (Hull_Build *build, int v0, int v1, int v2);
+static void Add_Outside_Point (Hull_Build *build, int point, int first_face, int last_face);
+static bool Copy_Hull (Hull_Build *build, gx3dConvexHull *hull);
+
+/*____________________________________________________________________
+|
+| Function: gx3d_ConvexHull_Init
+|
+| Output: Returns the convex hull of an array of points or NULL on any
+|   error.  If the points are all in a plane (or on a line), the hull
+|   has no faces and all the points are used as vertices.
+|___________________________________________________________________*/
+
+gx3dConvexHull *gx3d_ConvexHull_Init (gx3dVector *vertices, int num_vertices)
+{
+  int i;
+  float max;
+  Hull_Build build;
+  bool error;
+  gx3dConvexHull *hull = 0;
+
+  error = false;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (vertices);
+  DEBUG_ASSERT (num_vertices > 0);
+
+/*____________________________________________________________________
+|
+| Allocate memory
+|___________________________________________________________________*/
+
+  memset (&build, 0, sizeof(Hull_Build));
+  build.vertex       = vertices;
+  build.num_vertices = num_vertices;
+  build.max_faces    = MIN_FACES;
+  hull             = (gx3dConvexHull *) calloc (1, sizeof(gx3dConvexHull));
+  build.point_next = (int *)       malloc (num_vertices * sizeof(int));
+  build.points     = (int *)       malloc (num_vertices * sizeof(int));
+  build.face       = (Hull_Face *) malloc (build.max_faces * sizeof(Hull_Face));
+  build.visible    = (int *)       malloc (build.max_faces * sizeof(int));
+  build.horizon    = (int *)       malloc (2 * 3 * build.max_faces * sizeof(int));
+  if ((hull == 0) OR (build.point_next == 0) OR (build.points == 0) OR (build.face == 0) OR
+      (build.visible == 0) OR (build.horizon == 0))
+    error = true;
+
+/*____________________________________________________________________
+|
+| Build the hull
+|___________________________________________________________________*/
+
+  if (NOT error) {
+    // Get tolerance based on size of coordinates
+    max = 0;
+    for (i=0; i<num_vertices; i++) {
+      if (fabsf(vertices[i].x) > max)
+        max = fabsf(vertices[i].x);
+      if (fabsf(vertices[i].y) > max)
+        max = fabsf(vertices[i].y);
+      if (fabsf(vertices[i].z) > max)
+        max = fabsf(vertices[i].z);
+    }
+    build.epsilon = 3 * 3 * max * FLT_EPSILON;
+    // Start with a tetrahedron
+    if (Init_Simplex (&build)) {
+      // Add the farthest point in front of each face until all points are inside
+      for (i=0; (i<build.num_faces) AND (NOT error); i++)
+        if ((NOT build.face[i].deleted) AND (build.face[i].first_point != -1))
+          if (NOT Add_Point (&build, i))
+            error = true;
+      if (NOT error)
+        if (NOT Copy_Hull (&build, hull))
+          error = true;
+    }
+    // Points are all in a plane, so use all of them
+    else {
+      hull->vertex = (gx3dVector *) malloc (num_vertices * sizeof(gx3dVector));
+      if (hull->vertex == 0)
+        error = true;
+      else {
+        memcpy (hull->vertex, vertices, num_vertices * sizeof(gx3dVector));
+        hull->num_vertices = num_vertices;
+      }
+    }
+  }
+
+  if ((NOT error) AND hull->num_vertices) {
+    for (i=0; i<hull->num_vertices; i++)
+      gx3d_AddVector (&(hull->center), &(hull->vertex[i]), &(hull->center));
+    gx3d_MultiplyScalarVector (1 / (float)hull->num_vertices, &(hull->center), &(hull->center));
+  }
+
+/*____________________________________________________________________
+|
+| On any error, free memory
+|___________________________________________________________________*/
+
+  if (build.point_next)
+    free (build.point_next);
+  if (build.points)
+    free (build.points);
+  if (build.face)
+    free (build.face);
+  if (build.visible)
+    free (build.visible);
+  if (build.horizon)
+    free (build.horizon);
+  if (error) {
+    gxError ("gx3d_ConvexHull_Init(): Can't allocate memory");
+    gx3d_ConvexHull_Free (hull);
+    hull = 0;
+  }
+
+  return (hull);
+}
+
+/*____________________________________________________________________
+|
+| Function: Init_Simplex
+|
+| Input: Called from gx3d_ConvexHull_Init()
+| Output: Creates the first 4 faces from 4 extreme points and puts each
+|   other point in front of a face.  Returns false if the points are all
+|   in a plane.
+|___________________________________________________________________*/
+
+static bool Init_Simplex (Hull_Build *build)
+{
+  int i, j, axis, extreme[6], v[4];
+  float d, max;
+  gx3dVector *p, e1, e2, cross;
+  gx3dPlane plane;
+
+  p = build->vertex;
+
+  // Find the min and max points on each axis
+  for (axis=0; axis<3; axis++) {
+    extreme[axis*2]   = 0;
+    extreme[axis*2+1] = 0;
+    for (i=1; i<build->num_vertices; i++) {
+      if (((float *)&p[i])[axis] < ((float *)&p[extreme[axis*2]])[axis])
+        extreme[axis*2] = i;
+      if (((float *)&p[i])[axis] > ((float *)&p[extreme[axis*2+1]])[axis])
+        extreme[axis*2+1] = i;
+    }
+  }
+
+  // First 2 points are the farthest apart of the extreme points
+  max = 0;
+  v[0] = v[1] = 0;
+  for (i=0; i<6; i++)
+    for (j=i+1; j<6; j++) {
+      d = gx3d_DistanceSquared_Point_Point (&p[extreme[i]], &p[extreme[j]]);
+      if (d > max) {
+        max = d;
+        v[0] = extreme[i];
+        v[1] = extreme[j];
+      }
+    }
+  if (max <= build->epsilon * build->epsilon)
+    return (false);
+
+  // Third point is the farthest from the line through the first 2
+  max = 0;
+  gx3d_SubtractVector (&p[v[1]], &p[v[0]], &e1);
+  for (i=0; i<build->num_vertices; i++) {
+    gx3d_SubtractVector (&p[i], &p[v[0]], &e2);
+    gx3d_VectorCrossProduct (&e1, &e2, &cross);
+    d = gx3d_VectorDotProduct (&cross, &cross);
+    if (d > max) {
+      max = d;
+      v[2] = i;
+    }
+  }
+  if (max <= build->epsilon * build->epsilon * gx3d_VectorDotProduct (&e1, &e1))
+    return (false);
+
+  // Fourth point is the farthest from the plane through the first 3
+  gx3d_GetPlane (&p[v[0]], &p[v[1]], &p[v[2]], &plane);
+  max = 0;
+  for (i=0; i<build->num_vertices; i++) {
+    d = fabsf (DISTANCE_POINT_PLANE (&p[i], &plane));
+    if (d > max) {
+      max = d;
+      v[3] = i;
+    }
+  }
+  if (max <= build->epsilon)
+    return (false);
+
+  // Create the 4 faces of the tetrahedron (Add_Face() can't fail here)
+  Add_Face (build, v[0], v[1], v[2]);
+  Add_Face (build, v[0], v[3], v[1]);
+  Add_Face (build, v[1], v[3], v[2]);
+  Add_Face (build, v[2], v[3], v[0]);
+  // Make sure faces point out
+  if (DISTANCE_POINT_PLANE (&p[v[3]], &(build->face[0].plane)) > 0)
+    for (i=0; i<4; i++) {
+      j = build->face[i].v[1];
+      build->face[i].v[1] = build->face[i].v[2];
+      build->face[i].v[2] = j;
+      gx3d_NegateVector (&(build->face[i].plane.n), &(build->face[i].plane.n));
+      build->face[i].plane.d = -build->face[i].plane.d;
+    }
+
+  // Put the other points in front of a face
+  for (i=0; i<build->num_vertices; i++)
+    if ((i != v[0]) AND (i != v[1]) AND (i != v[2]) AND (i != v[3]))
+      Add_Outside_Point (build, i, 0, 3);
+
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: Add_Point
+|
+| Input: Called from gx3d_ConvexHull_Init()
+| Output: Adds the point farthest in front of a face to the hull.
+|   Returns false on any error.
+|___________________________________________________________________*/
+
+static bool Add_Point (Hull_Build *build, int face)
+{
+  int i, j, k, n, a, b, point, first_new_face, num_visible, num_horizon, num_points;
+  float d, max;
+  Hull_Face *f;
+  bool shared;
+
+/*____________________________________________________________________
+|
+| Find the point farthest in front of the face
+|___________________________________________________________________*/
+
+  max = 0;
+  point = -1;
+  for (i=build->face[face].first_point; i!=-1; i=build->point_next[i]) {
+    d = DISTANCE_POINT_PLANE (&(build->vertex[i]), &(build->face[face].plane));
+    if (d > max) {
+      max = d;
+      point = i;
+    }
+  }
+
+/*____________________________________________________________________
+|
+| Find all the faces the point can see, and remove them
+|___________________________________________________________________*/
+
+  num_visible = 0;
+  num_points  = 0;
+  for (i=0; i<build->num_faces; i++) {
+    f = &(build->face[i]);
+    if ((NOT f->deleted) AND (DISTANCE_POINT_PLANE (&(build->vertex[point]), &(f->plane)) > build->epsilon)) {
+      build->visible[num_visible++] = i;
+      f->deleted = true;
+      // Keep the points in front of this face to reassign later
+      for (j=f->first_point; j!=-1; j=build->point_next[j])
+        if (j != point)
+          build->points[num_points++] = j;
+    }
+  }
+
+/*____________________________________________________________________
+|
+| Find the horizon - the edges of visible faces not shared with another
+| visible face
+|___________________________________________________________________*/
+
+  num_horizon = 0;
+  for (i=0; i<num_visible; i++) {
+    f = &(build->face[build->visible[i]]);
+    for (j=0; j<3; j++) {
+      a = f->v[j];
+      b = f->v[(j+1)%3];
+      shared = false;
+      for (k=0; (k<num_visible) AND (NOT shared); k++)
+        if (k != i)
+          for (n=0; n<3; n++)
+            if ((build->face[build->visible[k]].v[n] == b) AND (build->face[build->visible[k]].v[(n+1)%3] == a))
+              shared = true;
+      if (NOT shared) {
+        build->horizon[num_horizon*2]   = a;
+        build->horizon[num_horizon*2+1] = b;
+        num_horizon++;
+      }
+    }
+  }
+
+/*____________________________________________________________________
+|
+| Connect the point to the horizon edges and reassign points
+|___________________________________________________________________*/
+
+  first_new_face = build->num_faces;
+  for (i=0; i<num_horizon; i++)
+    if (Add_Face (build, build->horizon[i*2], build->horizon[i*2+1], point) == -1)
+      return (false);
+  for (i=0; i<num_points; i++)
+    Add_Outside_Point (build, build->points[i], first_new_face, build->num_faces-1);
+
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: Add_Face
+|
+| Input: Called from Init_Simplex(), Add_Point()
+| Output: Adds a face to the hull being built.  Returns index of the new
+|   face or -1 on any error.
+|___________________________________________________________________*/
+
+static int Add_Face (Hull_Build *build, int v0, int v1, int v2)
+{
+  int max_faces;
+  Hull_Face *face, *f;
+  int *visible, *horizon;
+
+  // Make room for another face?
+  if (build->num_faces == build->max_faces) {
+    max_faces = build->max_faces * 2;
+    face    = (Hull_Face *) realloc (build->face, max_faces * sizeof(Hull_Face));
+    if (face)
+      build->face = face;
+    visible = (int *) realloc (build->visible, max_faces * sizeof(int));
+    if (visible)
+      build->visible = visible;
+    horizon = (int *) realloc (build->horizon, 2 * 3 * max_faces * sizeof(int));
+    if (horizon)
+      build->horizon = horizon;
+    if ((face == 0) OR (visible == 0) OR (horizon == 0))
+      return (-1);
+    build->max_faces = max_faces;
+  }
+
+  f = &(build->face[build->num_faces]);
+  f->v[0] = v0;
+  f->v[1] = v1;
+  f->v[2] = v2;
+  gx3d_GetPlane (&(build->vertex[v0]), &(build->vertex[v1]), &(build->vertex[v2]), &(f->plane));
+  f->first_point = -1;
+  f->deleted     = false;
+
+  return (build->num_faces++);
+}
+
+/*____________________________________________________________________
+|
+| Function: Add_Outside_Point
+|
+| Input: Called from Init_Simplex(), Add_Point()
+| Output: Puts a point in front of the first face (in a range of faces)
+|   it is in front of.  Drops the point if it's not in front of any.
+|___________________________________________________________________*/
+
+static void Add_Outside_Point (Hull_Build *build, int point, int first_face, int last_face)
+{
+  int i;
+  Hull_Face *f;
+
+  for (i=first_face; i<=last_face; i++) {
+    f = &(build->face[i]);
+    if (DISTANCE_POINT_PLANE (&(build->vertex[point]), &(f->plane)) > build->epsilon) {
+      build->point_next[point] = f->first_point;
+      f->first_point = point;
+      break;
+    }
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Copy_Hull
+|
+| Input: Called from gx3d_ConvexHull_Init()
+| Output: Copies the faces of the hull being built, and the vertices
+|   they use, to a hull.  Builds the list of vertices connected to each
+|   vertex.  Returns false on any error.
+|___________________________________________________________________*/
+
+static bool Copy_Hull (Hull_Build *build, gx3dConvexHull *hull)
+{
+  int i, j, a, b, *remap, *count;
+  Hull_Face *f;
+  bool error = false;
+
+  remap = (int *) malloc (build->num_vertices * sizeof(int));
+  if (remap == 0)
+    return (false);
+  for (i=0; i<build->num_vertices; i++)
+    remap[i] = -1;
+
+  // Count faces and vertices used
+  for (i=0; i<build->num_faces; i++)
+    if (NOT build->face[i].deleted) {
+      hull->num_faces++;
+      for (j=0; j<3; j++)
+        if (remap[build->face[i].v[j]] == -1)
+          remap[build->face[i].v[j]] = hull->num_vertices++;
+    }
+
+  hull->vertex         = (gx3dVector *) malloc (hull->num_vertices * sizeof(gx3dVector));
+  hull->face           = (int *)        malloc (3 * hull->num_faces * sizeof(int));
+  hull->neighbor_start = (int *)        calloc (hull->num_vertices + 1, sizeof(int));
+  hull->neighbor       = (int *)        malloc (3 * hull->num_faces * sizeof(int));
+  if ((hull->vertex == 0) OR (hull->face == 0) OR (hull->neighbor_start == 0) OR (hull->neighbor == 0))
+    error = true;
+
+  if (NOT error) {
+    // Copy vertices and faces
+    for (i=0; i<build->num_vertices; i++)
+      if (remap[i] != -1)
+        hull->vertex[remap[i]] = build->vertex[i];
+    for (i=0, j=0; i<build->num_faces; i++)
+      if (NOT build->face[i].deleted) {
+        f = &(build->face[i]);
+        hull->face[j++] = remap[f->v[0]];
+        hull->face[j++] = remap[f->v[1]];
+        hull->face[j++] = remap[f->v[2]];
+      }
+    // Each edge is in 2 faces, once in each direction, so edge a-b of each face makes b a neighbor of a
+    for (i=0; i<3*hull->num_faces; i++)
+      hull->neighbor_start[hull->face[i] + 1]++;
+    for (i=0; i<hull->num_vertices; i++)
+      hull->neighbor_start[i+1] += hull->neighbor_start[i];
+    count = remap;      // reuse memory
+    memcpy (count, hull->neighbor_start, hull->num_vertices * sizeof(int));
+    for (i=0; i<hull->num_faces; i++)
+      for (j=0; j<3; j++) {
+        a = hull->face[i*3 + j];
+        b = hull->face[i*3 + (j+1)%3];
+        hull->neighbor[count[a]++] = b;
+      }
+  }
+
+  free (remap);
+
+  return (NOT error);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_ConvexHull_Free
+|
+| Output: Frees all memory for a convex hull.
+|___________________________________________________________________*/
+
+void gx3d_ConvexHull_Free (gx3dConvexHull *hull)
+{
+  if (hull) {
+    if (hull->vertex)
+      free (hull->vertex);
+    if (hull->face)
+      free (hull->face);
+    if (hull->neighbor_start)
+      free (hull->neighbor_start);
+    if (hull->neighbor)
+      free (hull->neighbor);
+    free (hull);
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_GetLayerConvexHull
+|
+| Output: Returns the convex hull of the vertices of a layer (layer
+|   space) or NULL on any error.  The hull is built the first time
+|   and kept with the layer.
+|___________________________________________________________________*/
+
+gx3dConvexHull *gx3d_GetLayerConvexHull (gx3dObjectLayer *layer)
+{
+  DEBUG_ASSERT (layer);
+
+  if ((layer->convex_hull == 0) AND layer->num_vertices)
+    layer->convex_hull = gx3d_ConvexHull_Init (layer->vertex, layer->num_vertices);
+
+  return (layer->convex_hull);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_ConvexHull_Support
+|
+| Output: Returns index of the hull vertex farthest in a direction.
+|
+| Description: Walks from start_vertex to a connected vertex farther in
+|   the direction until there isn't one.  Since the hull is convex that
+|   vertex is the farthest of all.  Starting from the result of the last
+|   call with a similar direction usually takes only a few steps.
+|___________________________________________________________________*/
+
+int gx3d_ConvexHull_Support (gx3dConvexHull *hull, gx3dVector *direction, int start_vertex)
+{
+  int i, n, best;
+  float d, max;
+  bool found;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (hull);
+  DEBUG_ASSERT (hull->num_vertices > 0);
+  DEBUG_ASSERT (direction);
+  DEBUG_ASSERT ((start_vertex >= 0) AND (start_vertex < hull->num_vertices));
+
+/*____________________________________________________________________
+|
+| Small hull (or hull with no faces): test all the vertices
+|___________________________________________________________________*/
+
+  if ((hull->num_faces == 0) OR (hull->num_vertices < HILL_CLIMB_MIN_VERTICES)) {
+    best = 0;
+    max  = gx3d_VectorDotProduct (&(hull->vertex[0]), direction);
+    for (i=1; i<hull->num_vertices; i++) {
+      d = gx3d_VectorDotProduct (&(hull->vertex[i]), direction);
+      if (d > max) {
+        max  = d;
+        best = i;
+      }
+    }
+  }
+
+/*____________________________________________________________________
+|
+| Walk uphill
+|___________________________________________________________________*/
+
+  else {
+    best = start_vertex;
+    max  = gx3d_VectorDotProduct (&(hull->vertex[best]), direction);
+    do {
+      found = false;
+      for (i=hull->neighbor_start[best]; i<hull->neighbor_start[best+1]; i++) {
+        n = hull->neighbor[i];
+        d = gx3d_VectorDotProduct (&(hull->vertex[n]), direction);
+        if (d > max) {
+          max   = d;
+          best  = n;
+          found = true;
+          break;
+        }
+      }
+    } while (found);
+  }
+
+  return (best);
+}
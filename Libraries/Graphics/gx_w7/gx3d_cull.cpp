@@ -0,0 +1,569 @@
+/*____________________________________________________________________
+|
+| File: gx3d_cull.cpp
+|
+| Description: Functions to cull arrays of bounding volumes against the
+|   view frustum.
+|
+| Functions: gx3d_Cull_Spheres
+|            gx3d_Cull_Spheres
+|             Get_Sphere_Planes
+|             Cull_Spheres_AVX
+|              Add_Visible
+|             Cull_Spheres_SSE
+|              Add_Visible
+|             Sphere_Outside
+|             Add_Visible
+|            gx3d_Cull_Boxes
+|             Get_Box_Planes
+|             Box_Outside_Plane
+|             Add_Visible
+|
+| Description: These functions give the same results as calling
+|   gx3d_Relation_Sphere_Frustum() or gx3d_Relation_Box_Frustum() for
+|   each bounding volume and checking for gxRELATION_OUTSIDE.  The
+|   visible volumes are returned as a bit mask and/or a list of indices.
+|
+|   gx3d_Cull_Spheres() tests 8 (AVX) or 4 (SSE) spheres at a time 
+|   against all the planes with no branches.  The spheres are passed in 
+|   separate arrays for each coordinate (structure of arrays) so they 
+|   can be loaded straight into SIMD registers.
+|
+|   gx3d_Cull_Boxes() instead avoids testing planes.  Planes a parent
+|   volume is known to be entirely inside of are skipped, and the planes
+|   each box is entirely inside of are returned for its children.  The
+|   plane that last culled each box is tested first, since an object
+|   outside the frustum is usually outside the same plane as last frame.
+|
+| (C) Copyright 2017 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|
+| DEBUG_ASSERTED!
+|___________________________________________________________________*/
+
+//#define DEBUG
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+
+#include <math.h>
+#include <xmmintrin.h>
+#include <immintrin.h>
+
+#include "dp.h"
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+// View matrix and frustum planes as used by gx3d_Relation_Sphere_Frustum()
+typedef struct {
+  float view_x[4];                      // _00, _10, _20, _30 (transforms a point to view space x)
+  float view_y[4];                      // _01, _11, _21, _31
+  float view_z[4];                      // _02, _12, _22, _32
+  float near_d, far_d;
+  float left_x, left_z;                 // normals of side planes (view space)
+  float right_x, right_z;
+  float top_y, top_z;
+  float bottom_y, bottom_z;
+} Sphere_Planes;
+
+// World frustum plane as used by gx3d_Relation_Box_Frustum()
+typedef struct {
+  gx3dPlane plane;
+  int       vmax[3];                    // indices into the 6 floats of a box of the corner farthest along the normal
+  int       vmin[3];                    // indices of the opposite corner
+} Box_Plane;
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static void Get_Sphere_Planes (gx3dViewContext *context, Sphere_Planes *planes);
+static int  Cull_Spheres_SSE (
+  Sphere_Planes *planes,
+  float         *x,
+  float         *y,
+  float         *z,
+  float         *radius,
+  int            num_spheres,
+  unsigned      *visible_mask,
+  int           *visible,
+  int           *num_visible );
+static int  Cull_Spheres_AVX (
+  Sphere_Planes *planes,
+  float         *x,
+  float         *y,
+  float         *z,
+  float         *radius,
+  int            num_spheres,
+  unsigned      *visible_mask,
+  int           *visible,
+  int           *num_visible );
+static inline bool Sphere_Outside (Sphere_Planes *planes, float x, float y, float z, float radius);
+static void Get_Box_Planes (gx3dWorldFrustum *wf, Box_Plane *planes);
+static inline bool Box_Outside_Plane (Box_Plane *plane, gx3dBox *box, unsigned bit, unsigned *inside_mask);
+static inline void Add_Visible (
+  unsigned  bits,
+  int       first,
+  int       n,
+  unsigned *visible_mask,
+  int      *visible,
+  int      *num_visible );
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Cull_Spheres
+|
+| Output: Tests an array of spheres (in world space) against the
+|   default view frustum.  Returns # of spheres that are visible (not
+|   outside the frustum).
+|
+|   If visible_mask is not NULL, bit (i % 32) of visible_mask[i / 32] is
+|   set if sphere i is visible (the array must hold (num_spheres+31)/32
+|   words).  If visible is not NULL, the indices of the visible spheres
+|   are returned in it, in increasing order.
+|___________________________________________________________________*/
+
+int gx3d_Cull_Spheres (
+  float    *x,                // sphere centers
+  float    *y,
+  float    *z,
+  float    *radius,
+  int       num_spheres,
+  unsigned *visible_mask,     // NULL if not needed
+  int      *visible )         // NULL if not needed
+{
+  if (gx3d_View_frustum_dirty)
+    gx3d_UpdateViewFrustum ();
+
+  return (gx3d_Cull_Spheres (&gx3d_View_context, x, y, z, radius, num_spheres, visible_mask, visible));
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Cull_Spheres
+|
+| Output: Tests an array of spheres (in world space) against the view
+|   frustum of a view context.  Returns # of spheres that are visible.
+|   Only reads the context, so different threads can cull against the
+|   same or different contexts at the same time.
+|___________________________________________________________________*/
+
+int gx3d_Cull_Spheres (
+  gx3dViewContext *context,
+  float           *x,         // sphere centers
+  float           *y,
+  float           *z,
+  float           *radius,
+  int              num_spheres,
+  unsigned        *visible_mask,  // NULL if not needed
+  int             *visible )      // NULL if not needed
+{
+  int i;
+  unsigned features;
+  Sphere_Planes planes;
+  int num_visible = 0;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (context);
+  DEBUG_ASSERT (x);
+  DEBUG_ASSERT (y);
+  DEBUG_ASSERT (z);
+  DEBUG_ASSERT (radius);
+  DEBUG_ASSERT (num_spheres >= 0);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  Get_Sphere_Planes (context, &planes);
+
+  if (visible_mask)
+    memset (visible_mask, 0, ((num_spheres + 31) / 32) * sizeof(unsigned));
+
+  features = gx3d_GetCPUFeatures ();
+  if (features & gx3d_CPU_AVX)
+    i = Cull_Spheres_AVX (&planes, x, y, z, radius, num_spheres, visible_mask, visible, &num_visible);
+  else if (features & gx3d_CPU_SSE2)
+    i = Cull_Spheres_SSE (&planes, x, y, z, radius, num_spheres, visible_mask, visible, &num_visible);
+  else
+    i = 0;
+
+  // Test any remaining spheres one at a time
+  for (; i<num_spheres; i++)
+    if (NOT Sphere_Outside (&planes, x[i], y[i], z[i], radius[i]))
+      Add_Visible (1, i, 1, visible_mask, visible, &num_visible);
+
+  return (num_visible);
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Sphere_Planes
+|
+| Input: Called from gx3d_Cull_Spheres()
+| Output: Gets the parts of the view matrix and view frustum planes
+|   of a view context needed to test spheres.
+|___________________________________________________________________*/
+
+static void Get_Sphere_Planes (gx3dViewContext *context, Sphere_Planes *planes)
+{
+  planes->view_x[0] = context->view_matrix._00;
+  planes->view_x[1] = context->view_matrix._10;
+  planes->view_x[2] = context->view_matrix._20;
+  planes->view_x[3] = context->view_matrix._30;
+  planes->view_y[0] = context->view_matrix._01;
+  planes->view_y[1] = context->view_matrix._11;
+  planes->view_y[2] = context->view_matrix._21;
+  planes->view_y[3] = context->view_matrix._31;
+  planes->view_z[0] = context->view_matrix._02;
+  planes->view_z[1] = context->view_matrix._12;
+  planes->view_z[2] = context->view_matrix._22;
+  planes->view_z[3] = context->view_matrix._32;
+  planes->near_d    = context->frustum.plane[gx3d_FRUSTUM_PLANE_NEAR].d;
+  planes->far_d     = context->frustum.plane[gx3d_FRUSTUM_PLANE_FAR].d;
+  planes->left_x    = context->frustum.plane[gx3d_FRUSTUM_PLANE_LEFT].n.x;
+  planes->left_z    = context->frustum.plane[gx3d_FRUSTUM_PLANE_LEFT].n.z;
+  planes->right_x   = context->frustum.plane[gx3d_FRUSTUM_PLANE_RIGHT].n.x;
+  planes->right_z   = context->frustum.plane[gx3d_FRUSTUM_PLANE_RIGHT].n.z;
+  planes->top_y     = context->frustum.plane[gx3d_FRUSTUM_PLANE_TOP].n.y;
+  planes->top_z     = context->frustum.plane[gx3d_FRUSTUM_PLANE_TOP].n.z;
+  planes->bottom_y  = context->frustum.plane[gx3d_FRUSTUM_PLANE_BOTTOM].n.y;
+  planes->bottom_z  = context->frustum.plane[gx3d_FRUSTUM_PLANE_BOTTOM].n.z;
+}
+
+/*____________________________________________________________________
+|
+| Function: Cull_Spheres_SSE
+|
+| Input: Called from gx3d_Cull_Spheres()
+| Output: Tests spheres 4 at a time using SSE.  Returns # of spheres
+|   tested (a multiple of 4).
+|
+| Description: Computes the same distances as Sphere_Outside() in the
+|   same order, so the results are exactly the same.
+|___________________________________________________________________*/
+
+static int Cull_Spheres_SSE (
+  Sphere_Planes *planes,
+  float         *x,
+  float         *y,
+  float         *z,
+  float         *radius,
+  int            num_spheres,
+  unsigned      *visible_mask,
+  int           *visible,
+  int           *num_visible )
+{
+  int i, outside;
+  __m128 vx, vy, vz, vr, vnr, px, py, pz, d, out;
+  __m128 zero = _mm_setzero_ps ();
+
+  for (i=0; i+4<=num_spheres; i+=4) {
+    vx = _mm_loadu_ps (&x[i]);
+    vy = _mm_loadu_ps (&y[i]);
+    vz = _mm_loadu_ps (&z[i]);
+    vr = _mm_loadu_ps (&radius[i]);
+    vnr = _mm_sub_ps (zero, vr);
+    // Transform centers into view space
+    pz = _mm_add_ps (_mm_add_ps (_mm_add_ps (_mm_mul_ps (_mm_set1_ps (planes->view_z[0]), vx), _mm_mul_ps (_mm_set1_ps (planes->view_z[1]), vy)), _mm_mul_ps (_mm_set1_ps (planes->view_z[2]), vz)), _mm_set1_ps (planes->view_z[3]));
+    px = _mm_add_ps (_mm_add_ps (_mm_add_ps (_mm_mul_ps (_mm_set1_ps (planes->view_x[0]), vx), _mm_mul_ps (_mm_set1_ps (planes->view_x[1]), vy)), _mm_mul_ps (_mm_set1_ps (planes->view_x[2]), vz)), _mm_set1_ps (planes->view_x[3]));
+    py = _mm_add_ps (_mm_add_ps (_mm_add_ps (_mm_mul_ps (_mm_set1_ps (planes->view_y[0]), vx), _mm_mul_ps (_mm_set1_ps (planes->view_y[1]), vy)), _mm_mul_ps (_mm_set1_ps (planes->view_y[2]), vz)), _mm_set1_ps (planes->view_y[3]));
+    // Behind near plane?
+    d   = _mm_sub_ps (_mm_set1_ps (planes->near_d), pz);
+    out = _mm_cmpgt_ps (d, vr);
+    // Beyond far plane?
+    d   = _mm_sub_ps (pz, _mm_set1_ps (planes->far_d));
+    out = _mm_or_ps (out, _mm_cmpgt_ps (d, vr));
+    // Left of left plane?
+    d   = _mm_add_ps (_mm_mul_ps (px, _mm_set1_ps (planes->left_x)), _mm_mul_ps (pz, _mm_set1_ps (planes->left_z)));
+    out = _mm_or_ps (out, _mm_cmplt_ps (d, vnr));
+    // Right of right plane?
+    d   = _mm_add_ps (_mm_mul_ps (px, _mm_set1_ps (planes->right_x)), _mm_mul_ps (pz, _mm_set1_ps (planes->right_z)));
+    out = _mm_or_ps (out, _mm_cmplt_ps (d, vnr));
+    // Above top plane?
+    d   = _mm_add_ps (_mm_mul_ps (py, _mm_set1_ps (planes->top_y)), _mm_mul_ps (pz, _mm_set1_ps (planes->top_z)));
+    out = _mm_or_ps (out, _mm_cmplt_ps (d, vnr));
+    // Below bottom plane?
+    d   = _mm_add_ps (_mm_mul_ps (py, _mm_set1_ps (planes->bottom_y)), _mm_mul_ps (pz, _mm_set1_ps (planes->bottom_z)));
+    out = _mm_or_ps (out, _mm_cmplt_ps (d, vnr));
+    outside = _mm_movemask_ps (out);
+    if (outside != 0xF)
+      Add_Visible (~outside & 0xF, i, 4, visible_mask, visible, num_visible);
+  }
+
+  return (i);
+}
+
+/*____________________________________________________________________
+|
+| Function: Cull_Spheres_AVX
+|
+| Input: Called from gx3d_Cull_Spheres()
+| Output: Tests spheres 8 at a time using AVX.  Returns # of spheres
+|   tested (a multiple of 8).
+|
+| Description: Computes the same distances as Sphere_Outside() in the
+|   same order, so the results are exactly the same.
+|___________________________________________________________________*/
+
+static int Cull_Spheres_AVX (
+  Sphere_Planes *planes,
+  float         *x,
+  float         *y,
+  float         *z,
+  float         *radius,
+  int            num_spheres,
+  unsigned      *visible_mask,
+  int           *visible,
+  int           *num_visible )
+{
+  int i, outside;
+  __m256 vx, vy, vz, vr, vnr, px, py, pz, d, out;
+  __m256 zero = _mm256_setzero_ps ();
+
+  for (i=0; i+8<=num_spheres; i+=8) {
+    vx = _mm256_loadu_ps (&x[i]);
+    vy = _mm256_loadu_ps (&y[i]);
+    vz = _mm256_loadu_ps (&z[i]);
+    vr = _mm256_loadu_ps (&radius[i]);
+    vnr = _mm256_sub_ps (zero, vr);
+    // Transform centers into view space
+    pz = _mm256_add_ps (_mm256_add_ps (_mm256_add_ps (_mm256_mul_ps (_mm256_set1_ps (planes->view_z[0]), vx), _mm256_mul_ps (_mm256_set1_ps (planes->view_z[1]), vy)), _mm256_mul_ps (_mm256_set1_ps (planes->view_z[2]), vz)), _mm256_set1_ps (planes->view_z[3]));
+    px = _mm256_add_ps (_mm256_add_ps (_mm256_add_ps (_mm256_mul_ps (_mm256_set1_ps (planes->view_x[0]), vx), _mm256_mul_ps (_mm256_set1_ps (planes->view_x[1]), vy)), _mm256_mul_ps (_mm256_set1_ps (planes->view_x[2]), vz)), _mm256_set1_ps (planes->view_x[3]));
+    py = _mm256_add_ps (_mm256_add_ps (_mm256_add_ps (_mm256_mul_ps (_mm256_set1_ps (planes->view_y[0]), vx), _mm256_mul_ps (_mm256_set1_ps (planes->view_y[1]), vy)), _mm256_mul_ps (_mm256_set1_ps (planes->view_y[2]), vz)), _mm256_set1_ps (planes->view_y[3]));
+    // Behind near plane?
+    d   = _mm256_sub_ps (_mm256_set1_ps (planes->near_d), pz);
+    out = _mm256_cmp_ps (d, vr, _CMP_GT_OQ);
+    // Beyond far plane?
+    d   = _mm256_sub_ps (pz, _mm256_set1_ps (planes->far_d));
+    out = _mm256_or_ps (out, _mm256_cmp_ps (d, vr, _CMP_GT_OQ));
+    // Left of left plane?
+    d   = _mm256_add_ps (_mm256_mul_ps (px, _mm256_set1_ps (planes->left_x)), _mm256_mul_ps (pz, _mm256_set1_ps (planes->left_z)));
+    out = _mm256_or_ps (out, _mm256_cmp_ps (d, vnr, _CMP_LT_OQ));
+    // Right of right plane?
+    d   = _mm256_add_ps (_mm256_mul_ps (px, _mm256_set1_ps (planes->right_x)), _mm256_mul_ps (pz, _mm256_set1_ps (planes->right_z)));
+    out = _mm256_or_ps (out, _mm256_cmp_ps (d, vnr, _CMP_LT_OQ));
+    // Above top plane?
+    d   = _mm256_add_ps (_mm256_mul_ps (py, _mm256_set1_ps (planes->top_y)), _mm256_mul_ps (pz, _mm256_set1_ps (planes->top_z)));
+    out = _mm256_or_ps (out, _mm256_cmp_ps (d, vnr, _CMP_LT_OQ));
+    // Below bottom plane?
+    d   = _mm256_add_ps (_mm256_mul_ps (py, _mm256_set1_ps (planes->bottom_y)), _mm256_mul_ps (pz, _mm256_set1_ps (planes->bottom_z)));
+    out = _mm256_or_ps (out, _mm256_cmp_ps (d, vnr, _CMP_LT_OQ));
+    outside = _mm256_movemask_ps (out);
+    if (outside != 0xFF)
+      Add_Visible (~outside & 0xFF, i, 8, visible_mask, visible, num_visible);
+  }
+
+  // Avoid AVX to SSE transition penalty in caller
+  _mm256_zeroupper ();
+
+  return (i);
+}
+
+/*____________________________________________________________________
+|
+| Function: Sphere_Outside
+|
+| Input: Called from gx3d_Cull_Spheres()
+| Output: Returns true if a sphere is outside the view frustum.  Same
+|   test as gx3d_Relation_Sphere_Frustum().
+|___________________________________________________________________*/
+
+static inline bool Sphere_Outside (Sphere_Planes *planes, float x, float y, float z, float radius)
+{
+  float px, py, pz;
+
+  // Transform center into view space
+  pz = planes->view_z[0] * x + planes->view_z[1] * y + planes->view_z[2] * z + planes->view_z[3];
+  px = planes->view_x[0] * x + planes->view_x[1] * y + planes->view_x[2] * z + planes->view_x[3];
+  py = planes->view_y[0] * x + planes->view_y[1] * y + planes->view_y[2] * z + planes->view_y[3];
+
+  return ((planes->near_d - pz > radius) OR
+          (pz - planes->far_d > radius) OR
+          ((px * planes->left_x)   + (pz * planes->left_z)   < -radius) OR
+          ((px * planes->right_x)  + (pz * planes->right_z)  < -radius) OR
+          ((py * planes->top_y)    + (pz * planes->top_z)    < -radius) OR
+          ((py * planes->bottom_y) + (pz * planes->bottom_z) < -radius));
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Cull_Boxes
+|
+| Output: Tests an array of axis-aligned boxes (in world space) against
+|   a world frustum.  Returns # of boxes that are visible (not outside
+|   the frustum).  The visible boxes are returned in visible_mask and/or
+|   visible, as in gx3d_Cull_Spheres().
+|
+|   Bit i of a plane mask is for frustum plane i (gx3d_FRUSTUM_PLANE_NEAR
+|   etc.).  Planes in parent_mask are not tested (for example, the boxes
+|   are the children of a volume entirely inside those planes).  If 
+|   inside_mask is not NULL, the planes each box is entirely inside of 
+|   are returned in it - a box with all planes set 
+|   (gx3d_FRUSTUM_PLANES_ALL) is entirely inside the frustum.
+|
+|   If last_plane is not NULL it holds the plane that last culled each
+|   box, which is tested first.  Keep it with the boxes from frame to
+|   frame (initialize to 0).
+|___________________________________________________________________*/
+
+int gx3d_Cull_Boxes (
+  gx3dWorldFrustum *wf,
+  gx3dBox          *boxes,
+  int               num_boxes,
+  unsigned          parent_mask,  // planes all boxes are known to be inside of
+  unsigned char    *last_plane,   // NULL if not needed
+  unsigned char    *inside_mask,  // NULL if not needed
+  unsigned         *visible_mask, // NULL if not needed
+  int              *visible )     // NULL if not needed
+{
+  int i, j, first;
+  unsigned mask;
+  bool outside;
+  Box_Plane planes[gx3d_NUM_FRUSTUM_PLANES];
+  int num_visible = 0;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (wf);
+  DEBUG_ASSERT (boxes);
+  DEBUG_ASSERT (num_boxes >= 0);
+  DEBUG_ASSERT ((parent_mask & ~gx3d_FRUSTUM_PLANES_ALL) == 0);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  Get_Box_Planes (wf, planes);
+
+  if (visible_mask)
+    memset (visible_mask, 0, ((num_boxes + 31) / 32) * sizeof(unsigned));
+
+  for (i=0; i<num_boxes; i++) {
+    mask    = parent_mask;
+    outside = false;
+    if (mask != gx3d_FRUSTUM_PLANES_ALL) {
+      // Test the plane that last culled this box first
+      if (last_plane) {
+        DEBUG_ASSERT (last_plane[i] < gx3d_NUM_FRUSTUM_PLANES);
+        first = last_plane[i];
+      }
+      else
+        first = 0;
+      if ((mask & (1 << first)) == 0)
+        outside = Box_Outside_Plane (&planes[first], &boxes[i], 1 << first, &mask);
+      // Test the rest of the planes
+      for (j=0; (j<gx3d_NUM_FRUSTUM_PLANES) AND (NOT outside); j++)
+        if ((j != first) AND ((mask & (1 << j)) == 0)) 
+          if (Box_Outside_Plane (&planes[j], &boxes[i], 1 << j, &mask)) {
+            outside = true;
+            if (last_plane)
+              last_plane[i] = (unsigned char)j;
+          }
+    }
+    if (inside_mask)
+      inside_mask[i] = (unsigned char)mask;
+    if (NOT outside)
+      Add_Visible (1, i, 1, visible_mask, visible, &num_visible);
+  }
+
+  return (num_visible);
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Box_Planes
+|
+| Input: Called from gx3d_Cull_Boxes()
+| Output: Gets the planes of a world frustum along with the corners of
+|   a box to test against each plane.
+|___________________________________________________________________*/
+
+static void Get_Box_Planes (gx3dWorldFrustum *wf, Box_Plane *planes)
+{
+  int i;
+
+  for (i=0; i<gx3d_NUM_FRUSTUM_PLANES; i++) {
+    planes[i].plane   = wf->plane[i];
+    planes[i].vmax[0] = wf->box_diagonal[i].maxx;
+    planes[i].vmax[1] = wf->box_diagonal[i].maxy;
+    planes[i].vmax[2] = wf->box_diagonal[i].maxz;
+    planes[i].vmin[0] = wf->box_diagonal[i].minx;
+    planes[i].vmin[1] = wf->box_diagonal[i].miny;
+    planes[i].vmin[2] = wf->box_diagonal[i].minz;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Box_Outside_Plane
+|
+| Input: Called from gx3d_Cull_Boxes()
+| Output: Returns true if a box is outside a frustum plane.  If the box
+|   is entirely inside the plane, sets bit in inside_mask.  Same test as
+|   gx3d_Relation_Box_Frustum(), with gx3d_Distance_Point_Plane() done
+|   inline.
+|___________________________________________________________________*/
+
+static inline bool Box_Outside_Plane (Box_Plane *plane, gx3dBox *box, unsigned bit, unsigned *inside_mask)
+{
+  float *v = (float *)box;
+  bool outside = false;
+
+  // Outside plane? (corner farthest along the plane normal is outside)
+  if (plane->plane.n.x * v[plane->vmax[0]] + plane->plane.n.y * v[plane->vmax[1]] + plane->plane.n.z * v[plane->vmax[2]] + plane->plane.d < 0)
+    outside = true;
+  // Inside plane? (corner farthest behind the plane normal is inside)
+  else if (plane->plane.n.x * v[plane->vmin[0]] + plane->plane.n.y * v[plane->vmin[1]] + plane->plane.n.z * v[plane->vmin[2]] + plane->plane.d >= 0)
+    *inside_mask |= bit;
+
+  return (outside);
+}
+
+/*____________________________________________________________________
+|
+| Function: Add_Visible
+|
+| Input: Called from gx3d_Cull_Spheres(), Cull_Spheres_SSE(),
+|   Cull_Spheres_AVX(), gx3d_Cull_Boxes()
+| Output: Adds a group of n volumes starting at index first to the
+|   results.  Bit i of bits is set if volume first+i is visible.  first
+|   must be a multiple of n.
+|___________________________________________________________________*/
+
+static inline void Add_Visible (
+  unsigned  bits,
+  int       first,
+  int       n,
+  unsigned *visible_mask,
+  int      *visible,
+  int      *num_visible )
+{
+  int i;
+
+  if (visible_mask)
+    visible_mask[first >> 5] |= bits << (first & 31);
+  for (i=0; i<n; i++)
+    if (bits & (1 << i)) {
+      if (visible)
+        visible[*num_visible] = first + i;
+      (*num_visible)++;
+    }
+}
@@ -0,0 +1,1063 @@
+/*____________________________________________________________________
+|
+| File: gx3d_gjk.cpp
+|
+| Description: Functions to test 2 convex hulls for overlap, distance
+|   and penetration.
+|
+| Functions: gx3d_Relation_ConvexHull_ConvexHull
+|             GJK
+|            gx3d_Distance_ConvexHull_ConvexHull
+|             GJK
+|            gx3d_Penetration_ConvexHull_ConvexHull
+|             GJK
+|             EPA
+|              Expand_Simplex
+|              Add_Face
+|
+|            GJK
+|             Start_Simplex
+|              Support
+|              Get_Vertex
+|             Solve_Simplex
+|              Closest_Segment
+|              Closest_Triangle
+|              Outside_Face
+|
+| Description: Uses the GJK (Gilbert-Johnson-Keerthi) algorithm to find
+|   the point of the Minkowski difference of 2 hulls (the set of points
+|   a-b, a in hull1 and b in hull2) closest to the origin.  The hulls
+|   overlap if the difference contains the origin, otherwise the closest
+|   point is the vector between the closest points of the hulls.
+|
+|   GJK builds a simplex (point, segment, triangle or tetrahedron) of
+|   points of the difference, each found as the support point of the 2
+|   hulls in a direction, and moves it toward the origin one support
+|   point at a time.  The cost depends on the number of steps, not the
+|   number of vertices, since support points are found by walking the
+|   hull (see gx3d_ConvexHull_Support()).
+|
+|   When the hulls overlap, EPA (Expanding Polytope Algorithm) grows the
+|   final simplex into a polytope inside the difference until it finds
+|   the face closest to the origin, which gives the penetration depth and
+|   direction.
+|
+|   Passing the same gx3dGJKSimplex for a pair of hulls each frame starts
+|   GJK with the simplex found the last frame, which for objects that
+|   moved only a little is usually at or near the answer.
+|
+| (C) Copyright 2017 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|
+| DEBUG_ASSERTED!
+|___________________________________________________________________*/
+
+//#define DEBUG
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+
+#include <math.h>
+#include <float.h>
+
+#include "dp.h"
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define GJK_MAX_ITERATIONS    64
+#define GJK_TOLERANCE         1e-6f   // stop when the closest point gets no closer by this fraction of its distance (squared)
+#define GJK_OVERLAP_TOLERANCE 1e-10f  // overlap if the closest point is this close to the origin (squared, as a fraction of the simplex size squared)
+
+#define EPA_MAX_ITERATIONS    64
+#define EPA_MAX_VERTICES      (EPA_MAX_ITERATIONS+4)
+#define EPA_MAX_FACES         (2*EPA_MAX_VERTICES)
+#define EPA_TOLERANCE         1e-5f   // stop when the polytope grows by less than this fraction of its size
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+// Point of the Minkowski difference of 2 hulls
+typedef struct {
+  gx3dVector w;                     // a - b
+  gx3dVector a, b;                  // support points of hull1, hull2 (world space)
+  int        vertex1, vertex2;      // hull vertices of support points
+} Simplex_Vertex;
+
+typedef struct {
+  Simplex_Vertex p[4];
+  float          lambda[4];         // barycentric coords of the point closest to the origin
+  int            num_points;
+} Simplex;
+
+// Pair of hulls being tested
+typedef struct {
+  gx3dConvexHull *hull1, *hull2;
+  gx3dMatrix     *transform1, *transform2;
+} Hull_Pair;
+
+typedef struct {
+  int        v[3];                  // polytope vertices
+  gx3dVector n;                     // normal (points out)
+  float      d;                     // distance from origin
+  bool       deleted;
+  bool       visible;               // seen by the point being added
+} EPA_Face;
+
+typedef struct {
+  Simplex_Vertex vertex[EPA_MAX_VERTICES];
+  int            num_vertices;
+  EPA_Face       face[EPA_MAX_FACES];
+  int            num_faces;
+} EPA_Polytope;
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static bool  GJK (Hull_Pair *pair, gx3dGJKSimplex *cache, bool early_out, Simplex *s, gx3dVector *v);
+static void  Start_Simplex (Hull_Pair *pair, gx3dGJKSimplex *cache, Simplex *s);
+static void  Support (Hull_Pair *pair, gx3dVector *direction, int start1, int start2, Simplex_Vertex *sv);
+static void  Get_Vertex (Hull_Pair *pair, int vertex1, int vertex2, Simplex_Vertex *sv);
+static bool  Solve_Simplex (Simplex *s, gx3dVector *v);
+static float Closest_Segment (Simplex_Vertex *a, Simplex_Vertex *b, Simplex *s);
+static float Closest_Triangle (Simplex_Vertex *a, Simplex_Vertex *b, Simplex_Vertex *c, Simplex *s);
+static bool  Outside_Face (gx3dVector *a, gx3dVector *b, gx3dVector *c, gx3dVector *d);
+static void  Get_Closest_Points (Simplex *s, gx3dVector *point1, gx3dVector *point2);
+static void  Save_Simplex (Simplex *s, gx3dGJKSimplex *cache);
+static bool  EPA (Hull_Pair *pair, Simplex *s, float *depth, gx3dVector *normal, gx3dVector *point1, gx3dVector *point2);
+static bool  Expand_Simplex (Hull_Pair *pair, Simplex *s, float tolerance);
+static bool  Add_Face (EPA_Polytope *poly, int v0, int v1, int v2);
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Relation_ConvexHull_ConvexHull
+|
+| Output: Returns relationship between 2 convex hulls as:
+|   gxRELATION_OUTSIDE   = hulls don't overlap
+|   gxRELATION_INTERSECT = hulls overlap (or touch)
+|
+|   Transforms are layer to world transforms (NULL = identity).  If
+|   simplex is not NULL it is used to start GJK and updated for the next
+|   call on the same pair (set num_points to 0 before the first call).
+|___________________________________________________________________*/
+
+gxRelation gx3d_Relation_ConvexHull_ConvexHull (
+  gx3dConvexHull *hull1,
+  gx3dMatrix     *transform1,
+  gx3dConvexHull *hull2,
+  gx3dMatrix     *transform2,
+  gx3dGJKSimplex *simplex )
+{
+  Hull_Pair pair;
+  Simplex s;
+  gx3dVector v;
+  bool overlap;
+
+  DEBUG_ASSERT (hull1);
+  DEBUG_ASSERT (hull2);
+
+  pair.hull1      = hull1;
+  pair.hull2      = hull2;
+  pair.transform1 = transform1;
+  pair.transform2 = transform2;
+
+  // Stop as soon as a separating direction is found
+  overlap = GJK (&pair, simplex, true, &s, &v);
+  if (simplex)
+    Save_Simplex (&s, simplex);
+
+  if (overlap)
+    return (gxRELATION_INTERSECT);
+  else
+    return (gxRELATION_OUTSIDE);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Distance_ConvexHull_ConvexHull
+|
+| Output: Returns distance between 2 convex hulls (0 if they overlap).
+|   If they don't overlap, optionally returns the closest point on each
+|   hull (world space).
+|
+|   Transforms and simplex as for gx3d_Relation_ConvexHull_ConvexHull().
+|___________________________________________________________________*/
+
+float gx3d_Distance_ConvexHull_ConvexHull (
+  gx3dConvexHull *hull1,
+  gx3dMatrix     *transform1,
+  gx3dConvexHull *hull2,
+  gx3dMatrix     *transform2,
+  gx3dVector     *point1,
+  gx3dVector     *point2,
+  gx3dGJKSimplex *simplex )
+{
+  Hull_Pair pair;
+  Simplex s;
+  gx3dVector v;
+  float distance;
+
+  DEBUG_ASSERT (hull1);
+  DEBUG_ASSERT (hull2);
+
+  pair.hull1      = hull1;
+  pair.hull2      = hull2;
+  pair.transform1 = transform1;
+  pair.transform2 = transform2;
+
+  if (GJK (&pair, simplex, false, &s, &v))
+    distance = 0;
+  else {
+    distance = gx3d_VectorMagnitude (&v);
+    Get_Closest_Points (&s, point1, point2);
+  }
+  if (simplex)
+    Save_Simplex (&s, simplex);
+
+  return (distance);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Penetration_ConvexHull_ConvexHull
+|
+| Output: Returns relationship between 2 convex hulls as:
+|   gxRELATION_OUTSIDE   = hulls don't overlap
+|   gxRELATION_INTERSECT = hulls overlap
+|
+|   If the hulls overlap, returns the penetration depth and direction -
+|   moving hull2 by depth along normal (or hull1 by depth along -normal)
+|   separates them.  Optionally returns the deepest point of each hull
+|   inside the other (world space).
+|
+|   Transforms and simplex as for gx3d_Relation_ConvexHull_ConvexHull().
+|___________________________________________________________________*/
+
+gxRelation gx3d_Penetration_ConvexHull_ConvexHull (
+  gx3dConvexHull *hull1,
+  gx3dMatrix     *transform1,
+  gx3dConvexHull *hull2,
+  gx3dMatrix     *transform2,
+  float          *depth,
+  gx3dVector     *normal,
+  gx3dVector     *point1,
+  gx3dVector     *point2,
+  gx3dGJKSimplex *simplex )
+{
+  Hull_Pair pair;
+  Simplex s;
+  gx3dVector v;
+  gxRelation relation = gxRELATION_OUTSIDE;
+
+  DEBUG_ASSERT (hull1);
+  DEBUG_ASSERT (hull2);
+  DEBUG_ASSERT (depth);
+  DEBUG_ASSERT (normal);
+
+  pair.hull1      = hull1;
+  pair.hull2      = hull2;
+  pair.transform1 = transform1;
+  pair.transform2 = transform2;
+
+  if (GJK (&pair, simplex, true, &s, &v)) {
+    // Save the GJK simplex (the EPA polytope is no use next time)
+    if (simplex)
+      Save_Simplex (&s, simplex);
+    EPA (&pair, &s, depth, normal, point1, point2);
+    relation = gxRELATION_INTERSECT;
+  }
+  else if (simplex)
+    Save_Simplex (&s, simplex);
+
+  return (relation);
+}
+
+/*____________________________________________________________________
+|
+| Function: GJK
+|
+| Input: Called from gx3d_Relation_ConvexHull_ConvexHull(),
+|                    gx3d_Distance_ConvexHull_ConvexHull(),
+|                    gx3d_Penetration_ConvexHull_ConvexHull()
+| Output: Returns true if the hulls overlap.  Returns the final simplex
+|   and, if no overlap, the point of the Minkowski difference closest to
+|   the origin in v.  If early_out is true, stops as soon as the hulls
+|   are known not to overlap (v is then not the closest point).
+|___________________________________________________________________*/
+
+static bool GJK (Hull_Pair *pair, gx3dGJKSimplex *cache, bool early_out, Simplex *s, gx3dVector *v)
+{
+  int i, iterations;
+  float vv, vw, ww, max_ww;
+  gx3dVector d;
+  Simplex_Vertex sv, *last;
+  bool duplicate;
+
+  Start_Simplex (pair, cache, s);
+
+  for (iterations=0; iterations<GJK_MAX_ITERATIONS; iterations++) {
+    // Get closest point of simplex to origin (and drop points not needed)
+    if (Solve_Simplex (s, v))
+      return (true);    // origin inside tetrahedron
+    vv = gx3d_VectorDotProduct (v, v);
+    // Is the origin (almost) on the simplex?
+    max_ww = 0;
+    for (i=0; i<s->num_points; i++) {
+      ww = gx3d_VectorDotProduct (&(s->p[i].w), &(s->p[i].w));
+      if (ww > max_ww)
+        max_ww = ww;
+    }
+    if (vv <= GJK_OVERLAP_TOLERANCE * max_ww)
+      return (true);
+    // Get support point in the direction of the origin
+    gx3d_NegateVector (v, &d);
+    last = &(s->p[s->num_points-1]);
+    Support (pair, &d, last->vertex1, last->vertex2, &sv);
+    vw = gx3d_VectorDotProduct (v, &(sv.w));
+    // Is the whole difference on the far side of a plane through v?
+    if (early_out AND (vw > 0))
+      return (false);
+    // Is the support point no closer to the origin than v?
+    if (vv - vw <= GJK_TOLERANCE * vv)
+      return (false);
+    // Is it already in the simplex? (no progress possible)
+    duplicate = false;
+    for (i=0; i<s->num_points; i++)
+      if ((s->p[i].vertex1 == sv.vertex1) AND (s->p[i].vertex2 == sv.vertex2))
+        duplicate = true;
+    if (duplicate)
+      return (false);
+    s->p[s->num_points++] = sv;
+  }
+
+  // Out of iterations - solve the simplex with the last point added so s and v match
+  return (Solve_Simplex (s, v));
+}
+
+/*____________________________________________________________________
+|
+| Function: Start_Simplex
+|
+| Input: Called from GJK()
+| Output: Starts a simplex from the cached simplex (if any) or from the
+|   support point in the direction from the center of hull1 to the
+|   center of hull2.
+|
+| Description: A hull can be rebuilt between queries (for example by
+|   gx3d_TransformObjectLayer()), renumbering or removing its vertices,
+|   so the cached vertex indices are checked before they are used.  If
+|   any is out of range (or repeats a point) the cache is ignored.
+|___________________________________________________________________*/
+
+static void Start_Simplex (Hull_Pair *pair, gx3dGJKSimplex *cache, Simplex *s)
+{
+  int i, j;
+  bool use_cache;
+  gx3dVector c1, c2, d;
+
+  use_cache = false;
+  if (cache AND (cache->num_points > 0) AND (cache->num_points <= 4)) {
+    use_cache = true;
+    for (i=0; (i<cache->num_points) AND use_cache; i++) {
+      if ((cache->vertex1[i] < 0) OR (cache->vertex1[i] >= pair->hull1->num_vertices) OR
+          (cache->vertex2[i] < 0) OR (cache->vertex2[i] >= pair->hull2->num_vertices))
+        use_cache = false;
+      for (j=0; j<i; j++)
+        if ((cache->vertex1[i] == cache->vertex1[j]) AND (cache->vertex2[i] == cache->vertex2[j]))
+          use_cache = false;
+    }
+  }
+
+  if (use_cache) {
+    for (i=0; i<cache->num_points; i++)
+      Get_Vertex (pair, cache->vertex1[i], cache->vertex2[i], &(s->p[i]));
+    s->num_points = cache->num_points;
+  }
+  else {
+    c1 = pair->hull1->center;
+    c2 = pair->hull2->center;
+    if (pair->transform1)
+      gx3d_MultiplyVectorMatrix (&(pair->hull1->center), pair->transform1, &c1);
+    if (pair->transform2)
+      gx3d_MultiplyVectorMatrix (&(pair->hull2->center), pair->transform2, &c2);
+    gx3d_SubtractVector (&c2, &c1, &d);
+    if ((d.x == 0) AND (d.y == 0) AND (d.z == 0))
+      d.x = 1;
+    Support (pair, &d, 0, 0, &(s->p[0]));
+    s->num_points = 1;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Support
+|
+| Input: Called from GJK(), Start_Simplex(), Expand_Simplex(), EPA()
+| Output: Returns the support point of the Minkowski difference in a
+|   direction (world space) - the support point of hull1 in the
+|   direction minus the support point of hull2 in the opposite direction.
+|___________________________________________________________________*/
+
+static void Support (Hull_Pair *pair, gx3dVector *direction, int start1, int start2, Simplex_Vertex *sv)
+{
+  gx3dMatrix *m;
+  gx3dVector d;
+
+  // Rotate direction into layer space of hull1 (inverse of rotation part of transform1 applied to a row vector)
+  m = pair->transform1;
+  if (m) {
+    d.x = m->_00 * direction->x + m->_01 * direction->y + m->_02 * direction->z;
+    d.y = m->_10 * direction->x + m->_11 * direction->y + m->_12 * direction->z;
+    d.z = m->_20 * direction->x + m->_21 * direction->y + m->_22 * direction->z;
+  }
+  else
+    d = *direction;
+  sv->vertex1 = gx3d_ConvexHull_Support (pair->hull1, &d, start1);
+
+  m = pair->transform2;
+  if (m) {
+    d.x = -(m->_00 * direction->x + m->_01 * direction->y + m->_02 * direction->z);
+    d.y = -(m->_10 * direction->x + m->_11 * direction->y + m->_12 * direction->z);
+    d.z = -(m->_20 * direction->x + m->_21 * direction->y + m->_22 * direction->z);
+  }
+  else
+    gx3d_NegateVector (direction, &d);
+  sv->vertex2 = gx3d_ConvexHull_Support (pair->hull2, &d, start2);
+
+  Get_Vertex (pair, sv->vertex1, sv->vertex2, sv);
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Vertex
+|
+| Input: Called from Start_Simplex(), Support()
+| Output: Returns the point of the Minkowski difference for a vertex of
+|   each hull.
+|___________________________________________________________________*/
+
+static void Get_Vertex (Hull_Pair *pair, int vertex1, int vertex2, Simplex_Vertex *sv)
+{
+  DEBUG_ASSERT ((vertex1 >= 0) AND (vertex1 < pair->hull1->num_vertices));
+  DEBUG_ASSERT ((vertex2 >= 0) AND (vertex2 < pair->hull2->num_vertices));
+
+  sv->vertex1 = vertex1;
+  sv->vertex2 = vertex2;
+  if (pair->transform1)
+    gx3d_MultiplyVectorMatrix (&(pair->hull1->vertex[vertex1]), pair->transform1, &(sv->a));
+  else
+    sv->a = pair->hull1->vertex[vertex1];
+  if (pair->transform2)
+    gx3d_MultiplyVectorMatrix (&(pair->hull2->vertex[vertex2]), pair->transform2, &(sv->b));
+  else
+    sv->b = pair->hull2->vertex[vertex2];
+  gx3d_SubtractVector (&(sv->a), &(sv->b), &(sv->w));
+}
+
+/*____________________________________________________________________
+|
+| Function: Solve_Simplex
+|
+| Input: Called from GJK()
+| Output: Reduces the simplex to the smallest part of it containing the
+|   point closest to the origin, and returns that point in v.  Returns
+|   true if the simplex is a tetrahedron containing the origin.
+|___________________________________________________________________*/
+
+static bool Solve_Simplex (Simplex *s, gx3dVector *v)
+{
+  int i;
+  float d, min;
+  Simplex best, test;
+  Simplex_Vertex *p;
+
+  p = s->p;
+  switch (s->num_points) {
+    case 1: s->lambda[0] = 1;
+            break;
+    case 2: best = *s;
+            Closest_Segment (&p[0], &p[1], &best);
+            *s = best;
+            break;
+    case 3: best = *s;
+            Closest_Triangle (&p[0], &p[1], &p[2], &best);
+            *s = best;
+            break;
+    case 4: // Test each face the origin is in front of
+            min = FLT_MAX;
+            if (Outside_Face (&p[0].w, &p[1].w, &p[2].w, &p[3].w)) {
+              d = Closest_Triangle (&p[0], &p[1], &p[2], &test);
+              if (d < min) {
+                min  = d;
+                best = test;
+              }
+            }
+            if (Outside_Face (&p[0].w, &p[3].w, &p[1].w, &p[2].w)) {
+              d = Closest_Triangle (&p[0], &p[3], &p[1], &test);
+              if (d < min) {
+                min  = d;
+                best = test;
+              }
+            }
+            if (Outside_Face (&p[0].w, &p[2].w, &p[3].w, &p[1].w)) {
+              d = Closest_Triangle (&p[0], &p[2], &p[3], &test);
+              if (d < min) {
+                min  = d;
+                best = test;
+              }
+            }
+            if (Outside_Face (&p[1].w, &p[3].w, &p[2].w, &p[0].w)) {
+              d = Closest_Triangle (&p[1], &p[3], &p[2], &test);
+              if (d < min) {
+                min  = d;
+                best = test;
+              }
+            }
+            // Origin is inside all faces?
+            if (min == FLT_MAX) {
+              s->lambda[0] = s->lambda[1] = s->lambda[2] = s->lambda[3] = 0.25f;
+              v->x = v->y = v->z = 0;
+              return (true);
+            }
+            *s = best;
+            break;
+  }
+
+  // Get closest point
+  v->x = v->y = v->z = 0;
+  for (i=0; i<s->num_points; i++) {
+    v->x += s->lambda[i] * s->p[i].w.x;
+    v->y += s->lambda[i] * s->p[i].w.y;
+    v->z += s->lambda[i] * s->p[i].w.z;
+  }
+
+  return (false);
+}
+
+/*____________________________________________________________________
+|
+| Function: Closest_Segment
+|
+| Input: Called from Solve_Simplex(), Closest_Triangle()
+| Output: Puts the part of segment ab containing the point closest to
+|   the origin in simplex s.  Returns distance squared to the point.
+|___________________________________________________________________*/
+
+static float Closest_Segment (Simplex_Vertex *a, Simplex_Vertex *b, Simplex *s)
+{
+  float t, ab_ab;
+  gx3dVector ab, v;
+
+  gx3d_SubtractVector (&(b->w), &(a->w), &ab);
+  ab_ab = gx3d_VectorDotProduct (&ab, &ab);
+  t = 0;
+  if (ab_ab > 0)
+    t = -gx3d_VectorDotProduct (&(a->w), &ab) / ab_ab;
+
+  if (t <= 0) {
+    s->p[0] = *a;
+    s->lambda[0] = 1;
+    s->num_points = 1;
+    return (gx3d_VectorDotProduct (&(a->w), &(a->w)));
+  }
+  else if (t >= 1) {
+    s->p[0] = *b;
+    s->lambda[0] = 1;
+    s->num_points = 1;
+    return (gx3d_VectorDotProduct (&(b->w), &(b->w)));
+  }
+  else {
+    s->p[0] = *a;
+    s->p[1] = *b;
+    s->lambda[0] = 1 - t;
+    s->lambda[1] = t;
+    s->num_points = 2;
+    v.x = a->w.x + t * ab.x;
+    v.y = a->w.y + t * ab.y;
+    v.z = a->w.z + t * ab.z;
+    return (gx3d_VectorDotProduct (&v, &v));
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Closest_Triangle
+|
+| Input: Called from Solve_Simplex()
+| Output: Puts the part of triangle abc containing the point closest to
+|   the origin in simplex s.  Returns distance squared to the point.
+|
+| Description: Tests which vertex, edge or face region of the triangle
+|   the origin is in (Ericson, Real-Time Collision Detection, 5.1.5).
+|___________________________________________________________________*/
+
+static float Closest_Triangle (Simplex_Vertex *a, Simplex_Vertex *b, Simplex_Vertex *c, Simplex *s)
+{
+  float d1, d2, d3, d4, d5, d6, va, vb, vc, denom, v, w;
+  gx3dVector ab, ac, p;
+
+  gx3d_SubtractVector (&(b->w), &(a->w), &ab);
+  gx3d_SubtractVector (&(c->w), &(a->w), &ac);
+
+  // Vertex region a?
+  d1 = -gx3d_VectorDotProduct (&ab, &(a->w));
+  d2 = -gx3d_VectorDotProduct (&ac, &(a->w));
+  if ((d1 <= 0) AND (d2 <= 0)) {
+    s->p[0] = *a;
+    s->lambda[0] = 1;
+    s->num_points = 1;
+    return (gx3d_VectorDotProduct (&(a->w), &(a->w)));
+  }
+  // Vertex region b?
+  d3 = -gx3d_VectorDotProduct (&ab, &(b->w));
+  d4 = -gx3d_VectorDotProduct (&ac, &(b->w));
+  if ((d3 >= 0) AND (d4 <= d3)) {
+    s->p[0] = *b;
+    s->lambda[0] = 1;
+    s->num_points = 1;
+    return (gx3d_VectorDotProduct (&(b->w), &(b->w)));
+  }
+  // Edge region ab?
+  vc = d1*d4 - d3*d2;
+  if ((vc <= 0) AND (d1 >= 0) AND (d3 <= 0))
+    return (Closest_Segment (a, b, s));
+  // Vertex region c?
+  d5 = -gx3d_VectorDotProduct (&ab, &(c->w));
+  d6 = -gx3d_VectorDotProduct (&ac, &(c->w));
+  if ((d6 >= 0) AND (d5 <= d6)) {
+    s->p[0] = *c;
+    s->lambda[0] = 1;
+    s->num_points = 1;
+    return (gx3d_VectorDotProduct (&(c->w), &(c->w)));
+  }
+  // Edge region ac?
+  vb = d5*d2 - d1*d6;
+  if ((vb <= 0) AND (d2 >= 0) AND (d6 <= 0))
+    return (Closest_Segment (a, c, s));
+  // Edge region bc?
+  va = d3*d6 - d5*d4;
+  if ((va <= 0) AND ((d4 - d3) >= 0) AND ((d5 - d6) >= 0))
+    return (Closest_Segment (b, c, s));
+
+  // Face region
+  denom = va + vb + vc;
+  if (denom <= 0)     // degenerate triangle
+    return (Closest_Segment (a, b, s));
+  denom = 1 / denom;
+  v = vb * denom;
+  w = vc * denom;
+  s->p[0] = *a;
+  s->p[1] = *b;
+  s->p[2] = *c;
+  s->lambda[0] = 1 - v - w;
+  s->lambda[1] = v;
+  s->lambda[2] = w;
+  s->num_points = 3;
+  p.x = a->w.x + v * ab.x + w * ac.x;
+  p.y = a->w.y + v * ab.y + w * ac.y;
+  p.z = a->w.z + v * ab.z + w * ac.z;
+  return (gx3d_VectorDotProduct (&p, &p));
+}
+
+/*____________________________________________________________________
+|
+| Function: Outside_Face
+|
+| Input: Called from Solve_Simplex()
+| Output: Returns true if the origin is not on the same side of plane
+|   abc as point d (or the tetrahedron is flat).
+|___________________________________________________________________*/
+
+static bool Outside_Face (gx3dVector *a, gx3dVector *b, gx3dVector *c, gx3dVector *d)
+{
+  float sign_origin, sign_d;
+  gx3dVector ab, ac, ad, n;
+
+  gx3d_SubtractVector (b, a, &ab);
+  gx3d_SubtractVector (c, a, &ac);
+  gx3d_SubtractVector (d, a, &ad);
+  gx3d_VectorCrossProduct (&ab, &ac, &n);
+  sign_origin = -gx3d_VectorDotProduct (a, &n);
+  sign_d      =  gx3d_VectorDotProduct (&ad, &n);
+
+  return (sign_origin * sign_d <= 0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Closest_Points
+|
+| Input: Called from gx3d_Distance_ConvexHull_ConvexHull()
+| Output: Returns point of each hull for the closest point of a simplex
+|   to the origin.
+|___________________________________________________________________*/
+
+static void Get_Closest_Points (Simplex *s, gx3dVector *point1, gx3dVector *point2)
+{
+  int i;
+
+  if (point1) {
+    point1->x = point1->y = point1->z = 0;
+    for (i=0; i<s->num_points; i++) {
+      point1->x += s->lambda[i] * s->p[i].a.x;
+      point1->y += s->lambda[i] * s->p[i].a.y;
+      point1->z += s->lambda[i] * s->p[i].a.z;
+    }
+  }
+  if (point2) {
+    point2->x = point2->y = point2->z = 0;
+    for (i=0; i<s->num_points; i++) {
+      point2->x += s->lambda[i] * s->p[i].b.x;
+      point2->y += s->lambda[i] * s->p[i].b.y;
+      point2->z += s->lambda[i] * s->p[i].b.z;
+    }
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Save_Simplex
+|
+| Input: Called from gx3d_Relation_ConvexHull_ConvexHull(),
+|                    gx3d_Distance_ConvexHull_ConvexHull(),
+|                    gx3d_Penetration_ConvexHull_ConvexHull()
+| Output: Saves the vertices of a simplex to start the next query.
+|___________________________________________________________________*/
+
+static void Save_Simplex (Simplex *s, gx3dGJKSimplex *cache)
+{
+  int i;
+
+  for (i=0; i<s->num_points; i++) {
+    cache->vertex1[i] = s->p[i].vertex1;
+    cache->vertex2[i] = s->p[i].vertex2;
+  }
+  cache->num_points = s->num_points;
+}
+
+/*____________________________________________________________________
+|
+| Function: EPA
+|
+| Input: Called from gx3d_Penetration_ConvexHull_ConvexHull()
+| Output: Returns penetration depth and direction of 2 overlapping hulls
+|   given the final GJK simplex.  Returns false if the simplex couldn't
+|   be grown into a polytope (the hulls only touch, depth is 0).
+|___________________________________________________________________*/
+
+static bool EPA (Hull_Pair *pair, Simplex *s, float *depth, gx3dVector *normal, gx3dVector *point1, gx3dVector *point2)
+{
+  int i, j, k, a, b, iterations, best, num_visible, num_horizon, visible[EPA_MAX_FACES], horizon[2*3*EPA_MAX_FACES];
+  float scale, tolerance, min, d, u, v, w, denom;
+  gx3dVector p, e0, e1, e2, c;
+  Simplex_Vertex sv;
+  EPA_Polytope *poly;
+  EPA_Face *f;
+  bool duplicate;
+
+/*____________________________________________________________________
+|
+| Grow the simplex into a tetrahedron
+|___________________________________________________________________*/
+
+  scale = 0;
+  for (i=0; i<s->num_points; i++) {
+    d = gx3d_VectorMagnitude (&(s->p[i].w));
+    if (d > scale)
+      scale = d;
+  }
+  tolerance = EPA_TOLERANCE * scale;
+
+  if (NOT Expand_Simplex (pair, s, tolerance)) {
+    // Hulls are touching
+    *depth = 0;
+    c  = pair->hull1->center;
+    e0 = pair->hull2->center;
+    if (pair->transform1)
+      gx3d_MultiplyVectorMatrix (&(pair->hull1->center), pair->transform1, &c);
+    if (pair->transform2)
+      gx3d_MultiplyVectorMatrix (&(pair->hull2->center), pair->transform2, &e0);
+    gx3d_SubtractVector (&e0, &c, normal);
+    gx3d_NormalizeVector (normal, normal);
+    Get_Closest_Points (s, point1, point2);
+    return (false);
+  }
+
+  poly = (EPA_Polytope *) malloc (sizeof(EPA_Polytope));
+  if (poly == 0) {
+    gxError ("EPA(): Can't allocate memory");
+    *depth = 0;
+    normal->x = normal->y = normal->z = 0;
+    return (false);
+  }
+  poly->num_vertices = 4;
+  poly->num_faces    = 0;
+  for (i=0; i<4; i++)
+    poly->vertex[i] = s->p[i];
+  // Make faces point out
+  gx3d_SubtractVector (&(s->p[1].w), &(s->p[0].w), &e0);
+  gx3d_SubtractVector (&(s->p[2].w), &(s->p[0].w), &e1);
+  gx3d_SubtractVector (&(s->p[3].w), &(s->p[0].w), &e2);
+  gx3d_VectorCrossProduct (&e0, &e1, &c);
+  if (gx3d_VectorDotProduct (&c, &e2) > 0) {
+    poly->vertex[1] = s->p[2];
+    poly->vertex[2] = s->p[1];
+  }
+  Add_Face (poly, 0, 1, 2);
+  Add_Face (poly, 0, 3, 1);
+  Add_Face (poly, 1, 3, 2);
+  Add_Face (poly, 2, 3, 0);
+
+/*____________________________________________________________________
+|
+| Grow the polytope toward the face closest to the origin
+|___________________________________________________________________*/
+
+  best = 0;
+  for (iterations=0; iterations<EPA_MAX_ITERATIONS; iterations++) {
+    // Find closest face
+    min  = FLT_MAX;
+    for (i=0; i<poly->num_faces; i++)
+      if ((NOT poly->face[i].deleted) AND (poly->face[i].d < min)) {
+        min  = poly->face[i].d;
+        best = i;
+      }
+    f = &(poly->face[best]);
+    // Get support point in direction of its normal
+    Support (pair, &(f->n), poly->vertex[f->v[0]].vertex1, poly->vertex[f->v[0]].vertex2, &sv);
+    // Can't grow past this face?
+    if (gx3d_VectorDotProduct (&(sv.w), &(f->n)) - f->d <= tolerance)
+      break;
+    duplicate = false;
+    for (i=0; i<poly->num_vertices; i++)
+      if ((poly->vertex[i].vertex1 == sv.vertex1) AND (poly->vertex[i].vertex2 == sv.vertex2))
+        duplicate = true;
+    if (duplicate OR (poly->num_vertices == EPA_MAX_VERTICES))
+      break;
+
+    // Find the faces the new point can see, spreading out from the closest face, and the horizon around them
+    poly->face[best].visible = true;
+    visible[0]  = best;
+    num_visible = 1;
+    num_horizon = 0;
+    for (i=0; i<num_visible; i++)
+      for (j=0; j<3; j++) {
+        a = poly->face[visible[i]].v[j];
+        b = poly->face[visible[i]].v[(j+1)%3];
+        // Find the face on the other side of this edge
+        for (k=0; k<poly->num_faces; k++) {
+          f = &(poly->face[k]);
+          if ((NOT f->deleted) AND (((f->v[0] == b) AND (f->v[1] == a)) OR ((f->v[1] == b) AND (f->v[2] == a)) OR ((f->v[2] == b) AND (f->v[0] == a))))
+            break;
+        }
+        DEBUG_ASSERT (k < poly->num_faces);
+        if (NOT f->visible) {
+          gx3d_SubtractVector (&(sv.w), &(poly->vertex[f->v[0]].w), &p);
+          if (gx3d_VectorDotProduct (&(f->n), &p) > 0) {
+            f->visible = true;
+            visible[num_visible++] = k;
+          }
+          else {
+            horizon[num_horizon*2]   = a;
+            horizon[num_horizon*2+1] = b;
+            num_horizon++;
+          }
+        }
+      }
+    if (poly->num_faces + num_horizon > EPA_MAX_FACES)
+      break;
+    // Connect the new point to the horizon
+    for (i=0; i<num_visible; i++)
+      poly->face[visible[i]].deleted = true;
+    poly->vertex[poly->num_vertices++] = sv;
+    for (i=0; i<num_horizon; i++)
+      if (NOT Add_Face (poly, horizon[i*2], horizon[i*2+1], poly->num_vertices-1))
+        break;
+    if (i < num_horizon) {
+      // Degenerate face: undo and use the closest face found so far
+      poly->num_faces -= i;
+      poly->num_vertices--;
+      for (i=0; i<num_visible; i++) {
+        poly->face[visible[i]].deleted = false;
+        poly->face[visible[i]].visible = false;
+      }
+      break;
+    }
+  }
+
+/*____________________________________________________________________
+|
+| Get results from the closest face
+|___________________________________________________________________*/
+
+  f = &(poly->face[best]);
+  *depth  = f->d;
+  if (*depth < 0)
+    *depth = 0;
+  *normal = f->n;
+  if (point1 OR point2) {
+    // Get barycentric coords of the point of the face closest to the origin
+    gx3d_MultiplyScalarVector (f->d, &(f->n), &p);
+    gx3d_SubtractVector (&(poly->vertex[f->v[1]].w), &(poly->vertex[f->v[0]].w), &e0);
+    gx3d_SubtractVector (&(poly->vertex[f->v[2]].w), &(poly->vertex[f->v[0]].w), &e1);
+    gx3d_SubtractVector (&p, &(poly->vertex[f->v[0]].w), &e2);
+    d = gx3d_VectorDotProduct (&e0, &e0) * gx3d_VectorDotProduct (&e1, &e1) - gx3d_VectorDotProduct (&e0, &e1) * gx3d_VectorDotProduct (&e0, &e1);
+    v = w = 0;
+    if (d > 0) {
+      denom = 1 / d;
+      v = (gx3d_VectorDotProduct (&e1, &e1) * gx3d_VectorDotProduct (&e2, &e0) - gx3d_VectorDotProduct (&e0, &e1) * gx3d_VectorDotProduct (&e2, &e1)) * denom;
+      w = (gx3d_VectorDotProduct (&e0, &e0) * gx3d_VectorDotProduct (&e2, &e1) - gx3d_VectorDotProduct (&e0, &e1) * gx3d_VectorDotProduct (&e2, &e0)) * denom;
+    }
+    u = 1 - v - w;
+    s->num_points = 3;
+    s->p[0] = poly->vertex[f->v[0]];
+    s->p[1] = poly->vertex[f->v[1]];
+    s->p[2] = poly->vertex[f->v[2]];
+    s->lambda[0] = u;
+    s->lambda[1] = v;
+    s->lambda[2] = w;
+    Get_Closest_Points (s, point1, point2);
+  }
+
+  free (poly);
+
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: Expand_Simplex
+|
+| Input: Called from EPA()
+| Output: Adds support points to a simplex with less than 4 points (or a
+|   flat tetrahedron) until it's a tetrahedron with volume.  Returns
+|   false if it can't be done (the difference is flat where it touches
+|   the origin).
+|___________________________________________________________________*/
+
+static bool Expand_Simplex (Hull_Pair *pair, Simplex *s, float tolerance)
+{
+  int i, j, axis;
+  float min;
+  gx3dVector d, e, ab, ac, n;
+  Simplex_Vertex sv;
+  static gx3dVector axes[6] = { {1,0,0}, {-1,0,0}, {0,1,0}, {0,-1,0}, {0,0,1}, {0,0,-1} };
+
+  // A flat tetrahedron is treated as a triangle
+  if (s->num_points == 4) {
+    gx3d_SubtractVector (&(s->p[1].w), &(s->p[0].w), &ab);
+    gx3d_SubtractVector (&(s->p[2].w), &(s->p[0].w), &ac);
+    gx3d_VectorCrossProduct (&ab, &ac, &n);
+    gx3d_NormalizeVector (&n, &n);
+    gx3d_SubtractVector (&(s->p[3].w), &(s->p[0].w), &d);
+    if (fabsf (gx3d_VectorDotProduct (&n, &d)) > tolerance)
+      return (true);
+    s->num_points = 3;
+  }
+
+  // Point: add support point farthest from it along an axis
+  if (s->num_points == 1) {
+    for (i=0; i<6; i++) {
+      Support (pair, &axes[i], s->p[0].vertex1, s->p[0].vertex2, &sv);
+      if (gx3d_Distance_Point_Point (&(sv.w), &(s->p[0].w)) > tolerance)
+        break;
+    }
+    if (i == 6)
+      return (false);
+    s->p[s->num_points++] = sv;
+  }
+
+  // Segment: add support point farthest from the line
+  if (s->num_points == 2) {
+    gx3d_SubtractVector (&(s->p[1].w), &(s->p[0].w), &ab);
+    // Get a direction perpendicular to the segment
+    axis = 0;
+    min  = fabsf (ab.x);
+    if (fabsf (ab.y) < min) {
+      axis = 1;
+      min  = fabsf (ab.y);
+    }
+    if (fabsf (ab.z) < min)
+      axis = 2;
+    gx3d_VectorCrossProduct (&ab, &axes[axis*2], &d);
+    gx3d_NormalizeVector (&ab, &ab);
+    for (i=0; i<4; i++) {
+      Support (pair, &d, s->p[0].vertex1, s->p[0].vertex2, &sv);
+      // Get distance from line
+      gx3d_SubtractVector (&(sv.w), &(s->p[0].w), &e);
+      gx3d_VectorCrossProduct (&ab, &e, &n);
+      if (gx3d_VectorMagnitude (&n) > tolerance)
+        break;
+      // Try the next of 4 directions around the segment
+      gx3d_VectorCrossProduct (&ab, &d, &e);
+      d = e;
+    }
+    if (i == 4)
+      return (false);
+    s->p[s->num_points++] = sv;
+  }
+
+  // Triangle: add support point farthest from the plane
+  if (s->num_points == 3) {
+    gx3d_SubtractVector (&(s->p[1].w), &(s->p[0].w), &ab);
+    gx3d_SubtractVector (&(s->p[2].w), &(s->p[0].w), &ac);
+    gx3d_VectorCrossProduct (&ab, &ac, &n);
+    gx3d_NormalizeVector (&n, &n);
+    for (j=0; j<2; j++) {
+      Support (pair, &n, s->p[0].vertex1, s->p[0].vertex2, &sv);
+      gx3d_SubtractVector (&(sv.w), &(s->p[0].w), &e);
+      if (fabsf (gx3d_VectorDotProduct (&n, &e)) > tolerance)
+        break;
+      gx3d_NegateVector (&n, &n);
+    }
+    if (j == 2)
+      return (false);
+    s->p[s->num_points++] = sv;
+  }
+
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: Add_Face
+|
+| Input: Called from EPA()
+| Output: Adds a face to an EPA polytope.  Returns false if the face is
+|   degenerate.
+|___________________________________________________________________*/
+
+static bool Add_Face (EPA_Polytope *poly, int v0, int v1, int v2)
+{
+  gx3dVector ab, ac;
+  EPA_Face *f;
+
+  DEBUG_ASSERT (poly->num_faces < EPA_MAX_FACES);
+
+  f = &(poly->face[poly->num_faces]);
+  f->v[0] = v0;
+  f->v[1] = v1;
+  f->v[2] = v2;
+  gx3d_SubtractVector (&(poly->vertex[v1].w), &(poly->vertex[v0].w), &ab);
+  gx3d_SubtractVector (&(poly->vertex[v2].w), &(poly->vertex[v0].w), &ac);
+  gx3d_VectorCrossProduct (&ab, &ac, &(f->n));
+  if (gx3d_VectorDotProduct (&(f->n), &(f->n)) == 0)
+    return (false);
+  gx3d_NormalizeVector (&(f->n), &(f->n));
+  f->d = gx3d_VectorDotProduct (&(f->n), &(poly->vertex[v0].w));
+  f->deleted = false;
+  f->visible = false;
+  poly->num_faces++;
+
+  return (true);
+}
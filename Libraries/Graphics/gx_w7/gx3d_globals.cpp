@@ -6,6 +6,7 @@
 |
 | Functions:  gx3d_UpdateViewProjectionMatrix
 |             gx3d_UpdateViewFrustum
+|             gx3d_GetCPUFeatures
 |
 | (C) Copyright 2017 Abonvita Software LLC.
 | Licensed under the GX Toolkit License, Version 1.0.
@@ -21,6 +22,7 @@
 #include <first_header.h>
 
 #include <math.h>
+#include <intrin.h>
 
 #include "dp.h"
 
@@ -35,13 +37,11 @@
 
 void gx3d_UpdateViewProjectionMatrix ()
 {
-  gx3dMatrix mp;
-
   DEBUG_ASSERT (gx3d_View_projection_matrix_dirty);
 
   // Compute the view * projection matrix
-  gx3d_GetProjectionMatrix (&mp);
-  gx3d_MultiplyMatrix (&gx3d_View_matrix, &mp, &gx3d_View_projection_matrix);
+  gx3d_GetProjectionMatrix (&(gx3d_View_context.projection_matrix));
+  gx3d_MultiplyMatrix (&(gx3d_View_context.view_matrix), &(gx3d_View_context.projection_matrix), &(gx3d_View_context.view_projection_matrix));
 
   gx3d_View_projection_matrix_dirty = false;
 }
@@ -57,84 +57,50 @@ void gx3d_UpdateViewProjectionMatrix ()
 
 void gx3d_UpdateViewFrustum ()
 {
-  float hradians, vradians, far_x, far_y, xtan, ytan;
-  gx3dVector p1, p2, p3;
-
   DEBUG_ASSERT (gx3d_View_frustum_dirty);
 
-  // Init variables
-  hradians = (float)((double)gx3d_Projection_hfov * DEGREES_TO_RADIANS * 0.5);
-  vradians = (float)((double)gx3d_Projection_vfov * DEGREES_TO_RADIANS * 0.5);
-  xtan = tanf (hradians);
-  ytan = tanf (vradians);
-  far_x = gx3d_Projection_far_plane * xtan;
-  far_y = gx3d_Projection_far_plane * ytan;
-
-  // Compute near plane rectangle (in world space, and y points up)
-  gx3d_View_frustum.view_plane.xright  = gx3d_Projection_near_plane * xtan;
-  gx3d_View_frustum.view_plane.xleft   = -gx3d_View_frustum.view_plane.xright;
-  gx3d_View_frustum.view_plane.ytop    = gx3d_Projection_near_plane * ytan;
-  gx3d_View_frustum.view_plane.ybottom = -gx3d_View_frustum.view_plane.ytop;
-
-  // Set near plane
-  gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_NEAR].n.x = 0;
-  gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_NEAR].n.y = 0;
-  gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_NEAR].n.z = 1;
-  gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_NEAR].d = gx3d_Projection_near_plane;
-
-  // Set far plane
-  gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_FAR].n.x = 0;
-  gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_FAR].n.y = 0;
-  gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_FAR].n.z = -1;
-  gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_FAR].d = gx3d_Projection_far_plane;
-
-  // Calculate left plane using 3 points
-  p1.x = 0;
-  p1.y = 0;
-  p1.z = 0;
-  p2.x = -far_x;
-  p2.y =  far_y;
-  p2.z =  gx3d_Projection_far_plane;
-  p3.x = -far_x;
-  p3.y = -far_y;
-  p3.z =  gx3d_Projection_far_plane;
-  gx3d_GetPlane (&p1, &p2, &p3, &gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_LEFT]);
-
-  // Calculate right plane using 3 points
-  p1.x = 0;
-  p1.y = 0;
-  p1.z = 0;
-  p2.x =  far_x;
-  p2.y = -far_y;
-  p2.z =  gx3d_Projection_far_plane;
-  p3.x =  far_x;
-  p3.y =  far_y;
-  p3.z =  gx3d_Projection_far_plane;
-  gx3d_GetPlane (&p1, &p2, &p3, &gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_RIGHT]);
-
-  // Calculate top plane using 3 points
-  p1.x = 0;
-  p1.y = 0;
-  p1.z = 0;
-  p2.x =  far_x;
-  p2.y =  far_y;
-  p2.z =  gx3d_Projection_far_plane;
-  p3.x = -far_x;
-  p3.y =  far_y;
-  p3.z =  gx3d_Projection_far_plane;
-  gx3d_GetPlane (&p1, &p2, &p3, &gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_TOP]);
-
-  // Calculate bottom plane using 3 points
-  p1.x = 0;
-  p1.y = 0;
-  p1.z = 0;
-  p2.x = -far_x;
-  p2.y = -far_y;
-  p2.z =  gx3d_Projection_far_plane;
-  p3.x =  far_x;
-  p3.y = -far_y;
-  p3.z =  gx3d_Projection_far_plane;
-  gx3d_GetPlane (&p1, &p2, &p3, &gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_BOTTOM]);
+  gx3d_ComputeViewFrustum (&(gx3d_View_context.frustum), gx3d_Projection_hfov, gx3d_Projection_vfov, gx3d_Projection_near_plane, gx3d_Projection_far_plane);
 
   gx3d_View_frustum_dirty = false;
 }
+
+/*____________________________________________________________________
+|
+| Function: gx3d_GetCPUFeatures
+|
+| Output: Returns flags for the SIMD instruction sets that can be used
+|   on this CPU (and are enabled by the OS).  The CPU is only queried 
+|   the first time this function is called.
+|___________________________________________________________________*/
+
+unsigned gx3d_GetCPUFeatures ()
+{
+  int info[4];
+  unsigned flags;
+  static volatile bool     initialized = false;
+  static volatile unsigned features    = 0;
+
+  if (NOT initialized) {
+    flags = 0;
+    __cpuid (info, 0);
+    if (info[0] >= 1) {
+      __cpuid (info, 1);
+      if (info[3] & (1 << 26))
+        flags |= gx3d_CPU_SSE2;
+      if (info[2] & (1 << 19))
+        flags |= gx3d_CPU_SSE41;
+      // AVX needs the OS to save the upper halves of the ymm registers (OSXSAVE and XCR0 bits 1,2)
+      if ((info[2] & (1 << 27)) AND (info[2] & (1 << 28)))
+        if ((_xgetbv (0) & 6) == 6) {
+          flags |= gx3d_CPU_AVX;
+          if (info[2] & (1 << 12))
+            flags |= gx3d_CPU_FMA;
+        }
+    }
+    // Set all flags before initialized, so a thread calling this at the same time never sees only some of them
+    features    = flags;
+    initialized = true;
+  }
+
+  return (features);
+}
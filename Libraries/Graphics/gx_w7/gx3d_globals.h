@@ -8,3 +8,11 @@
 
 void gx3d_UpdateViewProjectionMatrix ();
 void gx3d_UpdateViewFrustum ();
+
+// SIMD instruction sets supported by the CPU (see gx3d_GetCPUFeatures())
+#define gx3d_CPU_SSE2   0x1
+#define gx3d_CPU_SSE41  0x2
+#define gx3d_CPU_AVX    0x4
+#define gx3d_CPU_FMA    0x8
+
+unsigned gx3d_GetCPUFeatures ();
@@ -9,7 +9,9 @@
 |              Process_Layers
 |              Process_Geometry_Layer
 |               Copy_String
+|              Write_Boxtree
 |             GX3DBIN_File_TO_GX3D_Object
+|             GX3DBIN_File_To_Boxtree
 |
 | (C) Copyright 2017 Abonvita Software LLC.
 | Licensed under the GX Toolkit License, Version 1.0.
@@ -68,6 +70,11 @@ static void Process_Geometry_Layer (
   bool             write_textfile_version,
   FILE            *out); 
 static void Copy_String (char *src, char *dst);
+static bool Write_Boxtree (
+  gx3dBoxtree *boxtree,
+  gx3dObject  *g_object,
+  bool         opengl_formatting,
+  FILE        *out );
 
 /*___________________
 |
@@ -86,21 +93,23 @@ static void Copy_String (char *src, char *dst);
 |___________________________________________________________________*/
 
 void GX3D_Object_To_GX3DBIN_File (
-  char       *filename, 
-  gx3dObject *g_object, 
-  bool        output_texcoords,
-  bool        output_vertex_normals, 
-  bool        output_diffuse_color,
-  bool        output_specular_color,
-  bool        output_weights,
-  bool        output_morphs,
-  bool        output_skeleton,
-  bool        opengl_formatting, 
-  bool        write_textfile_version )
+  char        *filename, 
+  gx3dObject  *g_object, 
+  bool         output_texcoords,
+  bool         output_vertex_normals, 
+  bool         output_diffuse_color,
+  bool         output_specular_color,
+  bool         output_weights,
+  bool         output_morphs,
+  bool         output_skeleton,
+  bool         opengl_formatting, 
+  bool         write_textfile_version,
+  gx3dBoxtree *boxtree )
 {
   int n;
   FILE *out;
   gx3dBinFileHeader header;
+  gx3dBinFileBoxtreeTrailer trailer;
 
 /*____________________________________________________________________
 |
@@ -166,6 +175,20 @@ void GX3D_Object_To_GX3DBIN_File (
 
 
     }
+
+/*____________________________________________________________________
+|
+| Write out boxtree?
+|___________________________________________________________________*/
+
+    if (boxtree) {
+      trailer.offset = (int) ftell (out);
+      if (Write_Boxtree (boxtree, g_object, opengl_formatting, out)) {
+        // Write trailer at end of file so a reader can find the boxtree chunk
+        memcpy (trailer.id, GX3DBIN_BOXTREE_ID, sizeof(trailer.id));
+        fwrite (&trailer, sizeof(gx3dBinFileBoxtreeTrailer), 1, out);
+      }
+    }
     
 /*____________________________________________________________________
 |
@@ -257,7 +280,7 @@ static void Process_Layers (
                             out);
 		// Process child layers
 		if (layer->child)
-        Process_Layers (layer, 
+        Process_Layers (layer->child, 
                         vertex_format, 
                         output_texcoords,
                         output_vertex_normals,
@@ -511,6 +534,103 @@ static void Copy_String (char *src, char *dst)
   dst[31] = 0;
 }
 
+/*____________________________________________________________________
+|
+| Function: Write_Boxtree
+| 
+| Input: Called from GX3D_Object_To_GX3DBIN_File()
+| Output: Writes the bsp tree of a boxtree to output file.  Returns true
+|   on success or false if the boxtree doesn't match the object.
+|___________________________________________________________________*/
+
+static bool Write_Boxtree (
+  gx3dBoxtree *boxtree,
+  gx3dObject  *g_object,
+  bool         opengl_formatting,
+  FILE        *out )
+{
+  int i, num_vertices, num_polygons;
+  gx3dBinFileBoxtreeHeader header;
+  bool error = false;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (boxtree);
+  DEBUG_ASSERT (g_object);
+  DEBUG_ASSERT (out);
+
+/*____________________________________________________________________
+|
+| Make sure boxtree was created for this object
+|___________________________________________________________________*/
+
+  gx3d_GetObjectInfo (g_object, 0, &num_vertices, &num_polygons);
+  if ((boxtree->num_vertices != num_vertices) OR (boxtree->num_polygons != num_polygons) OR (boxtree->num_nodes == 0)) {
+    gxError ("Write_Boxtree(): Boxtree doesn't match object, not written");
+    error = true;
+  }
+
+/*____________________________________________________________________
+|
+| Write boxtree header
+|___________________________________________________________________*/
+
+  if (NOT error) {
+    debug_WriteFile ("Write_Boxtree(): Writing boxtree");
+    header.type         = (int) boxtree->type;
+    header.build        = (int) boxtree->build;
+    header.num_vertices = boxtree->num_vertices;
+    header.num_polygons = boxtree->num_polygons;
+    header.num_nodes    = boxtree->num_nodes;
+    if (boxtree->type == gx3d_BOXTREE_TYPE_DYNAMIC)
+      header.build_time = boxtree->d.build_time;
+    else
+      header.build_time = 0;
+    fwrite (&header, sizeof(gx3dBinFileBoxtreeHeader), 1, out);
+
+/*____________________________________________________________________
+|
+| Write nodes
+|___________________________________________________________________*/
+
+    if (opengl_formatting) {
+      gx3dBoxtreeNode *temp_node = (gx3dBoxtreeNode *) malloc (boxtree->num_nodes * sizeof(gx3dBoxtreeNode));
+      for (i=0; i<boxtree->num_nodes; i++) {
+        temp_node[i] = boxtree->node[i];
+        temp_node[i].box.min.z = -boxtree->node[i].box.max.z;
+        temp_node[i].box.max.z = -boxtree->node[i].box.min.z;
+      }
+      fwrite (temp_node, sizeof(gx3dBoxtreeNode), boxtree->num_nodes, out);
+      free (temp_node);
+    }
+    else
+      fwrite (boxtree->node, sizeof(gx3dBoxtreeNode), boxtree->num_nodes, out);
+
+/*____________________________________________________________________
+|
+| Write polygons
+|___________________________________________________________________*/
+
+    if (opengl_formatting) {
+      gx3dPolygon *temp_polygon = (gx3dPolygon *) malloc (boxtree->num_polygons * sizeof(gx3dPolygon));
+      for (i=0; i<boxtree->num_polygons; i++) {
+        temp_polygon[i].index[0] = boxtree->poly[i].index[0];
+        temp_polygon[i].index[1] = boxtree->poly[i].index[2];
+        temp_polygon[i].index[2] = boxtree->poly[i].index[1];
+      }
+      fwrite (temp_polygon, sizeof(gx3dPolygon), boxtree->num_polygons, out);
+      free (temp_polygon);
+    }
+    else
+      fwrite (boxtree->poly, sizeof(gx3dPolygon), boxtree->num_polygons, out);
+  }
+
+  return (NOT error);
+}
+
 /*____________________________________________________________________
 |
 | Function: GX3DBIN_File_TO_GX3D_Object
@@ -531,3 +651,124 @@ bool GX3DBIN_File_TO_GX3D_Object (
 
   return (false);
 }
+
+/*____________________________________________________________________
+|
+| Function: GX3DBIN_File_To_Boxtree
+|                       
+| Input: Called from gx3d_ReadGX3DBINBoxtree()                                                                 
+| Output: Reads the boxtree chunk from a GX3DBIN File and creates a 
+|       boxtree for the object using the stored bsp tree.  Returns the
+|       boxtree or 0 if the file has no boxtree chunk, it doesn't match
+|       the object or on any error.
+|___________________________________________________________________*/
+
+gx3dBoxtree *GX3DBIN_File_To_Boxtree (
+  char       *filename,
+  gx3dObject *object,
+  int         num_threads )
+{
+  FILE *fp;
+  long file_size;
+  gx3dBinFileBoxtreeTrailer trailer;
+  gx3dBinFileBoxtreeHeader boxtree_header;
+  gx3dBoxtreeNode *node = 0;
+  gx3dPolygon *poly = 0;
+  gx3dBoxtree *boxtree = 0;
+  bool error = false;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (filename);
+  DEBUG_ASSERT (object);
+
+/*____________________________________________________________________
+|
+| Read trailer and boxtree header (files without a boxtree chunk have no trailer)
+|___________________________________________________________________*/
+
+  fp = fopen (filename, "rb");
+  if (fp == 0)
+    error = true;
+  else {
+    if (fseek (fp, 0, SEEK_END))
+      error = true;
+    else if ((file_size = ftell (fp)) < (long)(sizeof(gx3dBinFileHeader) + sizeof(gx3dBinFileBoxtreeHeader) + sizeof(gx3dBinFileBoxtreeTrailer)))
+      error = true;
+    else if (fseek (fp, file_size - sizeof(gx3dBinFileBoxtreeTrailer), SEEK_SET))
+      error = true;
+    else if (fread (&trailer, sizeof(gx3dBinFileBoxtreeTrailer), 1, fp) != 1)
+      error = true;
+    else if (memcmp (trailer.id, GX3DBIN_BOXTREE_ID, sizeof(trailer.id)))
+      error = true;
+    else if ((trailer.offset < (int)sizeof(gx3dBinFileHeader)) OR (trailer.offset > file_size - (long)(sizeof(gx3dBinFileBoxtreeHeader) + sizeof(gx3dBinFileBoxtreeTrailer))))
+      error = true;
+    else if (fseek (fp, trailer.offset, SEEK_SET))
+      error = true;
+    else if (fread (&boxtree_header, sizeof(gx3dBinFileBoxtreeHeader), 1, fp) != 1)
+      error = true;
+  }
+  if (NOT error) {
+    if (NOT ((boxtree_header.type == gx3d_BOXTREE_TYPE_STATIC) OR (boxtree_header.type == gx3d_BOXTREE_TYPE_DYNAMIC)))
+      error = true;
+    else if (NOT ((boxtree_header.build == gx3d_BOXTREE_BUILD_MEAN) OR (boxtree_header.build == gx3d_BOXTREE_BUILD_SAH)))
+      error = true;
+    else if ((boxtree_header.num_polygons <= 0) OR (boxtree_header.num_polygons > file_size / (long)sizeof(gx3dPolygon)))
+      error = true;
+    else if ((boxtree_header.num_nodes <= 0) OR (boxtree_header.num_nodes > 2*boxtree_header.num_polygons-1) OR (boxtree_header.num_nodes > file_size / (long)sizeof(gx3dBoxtreeNode)))
+      error = true;
+    // Make sure the chunk fills the space up to the trailer
+    else if (trailer.offset + sizeof(gx3dBinFileBoxtreeHeader) + boxtree_header.num_nodes * sizeof(gx3dBoxtreeNode) + boxtree_header.num_polygons * sizeof(gx3dPolygon) != (size_t)(file_size - sizeof(gx3dBinFileBoxtreeTrailer)))
+      error = true;
+  }
+
+/*____________________________________________________________________
+|
+| Read nodes and polygons
+|___________________________________________________________________*/
+
+  if (NOT error) {
+    node = (gx3dBoxtreeNode *) malloc (boxtree_header.num_nodes * sizeof(gx3dBoxtreeNode));
+    poly = (gx3dPolygon *) malloc (boxtree_header.num_polygons * sizeof(gx3dPolygon));
+    if ((node == 0) OR (poly == 0))
+      error = true;
+    else if (fread (node, sizeof(gx3dBoxtreeNode), boxtree_header.num_nodes, fp) != (size_t)boxtree_header.num_nodes)
+      error = true;
+    else if (fread (poly, sizeof(gx3dPolygon), boxtree_header.num_polygons, fp) != (size_t)boxtree_header.num_polygons)
+      error = true;
+  }
+  if (fp)
+    fclose (fp);
+
+/*____________________________________________________________________
+|
+| Create boxtree using the stored bsp tree
+|___________________________________________________________________*/
+
+  if (NOT error) {
+    boxtree = gx3d_Boxtree_Init_Prebuilt (object, 
+                                          (gx3dBoxtreeType) boxtree_header.type, 
+                                          (gx3dBoxtreeBuild) boxtree_header.build, 
+                                          node, 
+                                          boxtree_header.num_nodes, 
+                                          poly, 
+                                          boxtree_header.num_polygons, 
+                                          boxtree_header.build_time, 
+                                          num_threads);
+#ifdef DEBUG
+    if (boxtree == 0)
+      debug_WriteFile ("GX3DBIN_File_To_Boxtree(): Stored boxtree doesn't match object");
+#endif
+  }
+
+  // Free temp memory
+  if (node)
+    free (node);
+  if (poly)
+    free (poly);
+
+  return (boxtree);
+}
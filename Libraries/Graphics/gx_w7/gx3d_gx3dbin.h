@@ -7,17 +7,18 @@
 |___________________________________________________________________*/
 
 void GX3D_Object_To_GX3DBIN_File (
-  char       *filename, 
-  gx3dObject *g_object, 
-  bool        output_texcoords,
-  bool        output_vertex_normals, 
-  bool        output_diffuse_color,
-  bool        output_specular_color,
-  bool        output_weights,
-  bool        output_morphs,
-  bool        output_skeleton,
-  bool        opengl_formatting, 
-  bool        write_textfile_version );
+  char        *filename, 
+  gx3dObject  *g_object, 
+  bool         output_texcoords,
+  bool         output_vertex_normals, 
+  bool         output_diffuse_color,
+  bool         output_specular_color,
+  bool         output_weights,
+  bool         output_morphs,
+  bool         output_skeleton,
+  bool         opengl_formatting, 
+  bool         write_textfile_version,
+  gx3dBoxtree *boxtree );
 
 bool GX3DBIN_File_TO_GX3D_Object (
   char        *filename, 
@@ -25,3 +26,8 @@ bool GX3DBIN_File_TO_GX3D_Object (
   unsigned     vertex_format_flags,
   unsigned     flags,
   void       (*free_layer) (gx3dObjectLayer *layer) );
+
+gx3dBoxtree *GX3DBIN_File_To_Boxtree (
+  char       *filename,
+  gx3dObject *object,
+  int         num_threads );
@@ -0,0 +1,445 @@
+/*____________________________________________________________________
+|
+| File: gx3d_hashgrid.cpp
+|
+| Description: Functions to manipulate gx3dHashgrid.
+|
+| Functions: gx3d_Hashgrid_Init
+|            gx3d_Hashgrid_Free
+|            gx3d_Hashgrid_Build
+|             Get_Cell
+|             Get_Cell_Hash
+|            gx3d_Hashgrid_Intersect_Sphere
+|             Intersect_Box_Cells
+|              Get_Cell
+|              Get_Cell_Hash
+|              Entity_Inside
+|            gx3d_Hashgrid_Intersect_Box
+|             Intersect_Box_Cells
+|
+| Description: A hashgrid is a uniform grid of cubic cells over all of
+|   space, used to find the entities (points) near a point or in a box.
+|   Only the cells that contain entities take any memory, since cells
+|   are mapped to a fixed # of buckets by a hash of their coordinates.
+|
+|   The grid is rebuilt from scratch each time the positions change
+|   (typically once a frame) with a counting sort, which is O(n).  The
+|   positions are stored sorted by bucket in separate x, y and z arrays
+|   so the entities of a cell are next to each other in memory.
+|
+|   Queries write entity ids into an array supplied by the caller and
+|   don't allocate memory.  Query time depends on the # of cells
+|   overlapped, so pick a cell size about the size of a typical query
+|   radius.
+|
+| (C) Copyright 2017 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|
+| DEBUG_ASSERTED!
+|___________________________________________________________________*/
+
+//#define DEBUG
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+
+#include <math.h>
+
+#include "dp.h"
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define MIN_BUCKETS   64    // min # of hash buckets
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static inline int      Get_Cell (gx3dHashgrid *hashgrid, float value);
+static inline unsigned Get_Cell_Hash (gx3dHashgrid *hashgrid, int x, int y, int z);
+static int Intersect_Box_Cells (
+  gx3dHashgrid *hashgrid,
+  gx3dBox      *box,
+  gx3dSphere   *sphere,       // if not NULL, entities must also be in this sphere
+  int          *entities,
+  int           max_entities );
+static inline bool Entity_Inside (gx3dHashgrid *hashgrid, int index, gx3dBox *box, gx3dSphere *sphere);
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Hashgrid_Init
+|
+| Output: Creates an empty hashgrid with room for max_entities entities.
+|   More room is allocated as needed.  num_buckets is rounded up to a
+|   power of 2 (0 = twice max_entities).
+|___________________________________________________________________*/
+
+gx3dHashgrid *gx3d_Hashgrid_Init (float cell_size, int max_entities, int num_buckets)
+{
+  bool error;
+  gx3dHashgrid *hashgrid = 0;
+
+  error = false;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (cell_size > 0);
+  DEBUG_ASSERT (max_entities > 0);
+  DEBUG_ASSERT (num_buckets >= 0);
+
+/*____________________________________________________________________
+|
+| Allocate memory
+|___________________________________________________________________*/
+
+  hashgrid = (gx3dHashgrid *) calloc (1, sizeof(gx3dHashgrid));
+  if (hashgrid == 0)
+    error = true;
+  else {
+    hashgrid->cell_size     = cell_size;
+    hashgrid->inv_cell_size = 1 / cell_size;
+    if (num_buckets == 0)
+      num_buckets = 2 * max_entities;
+    for (hashgrid->num_buckets=MIN_BUCKETS; hashgrid->num_buckets<num_buckets; hashgrid->num_buckets*=2);
+    hashgrid->bucket_start = (int *) calloc (hashgrid->num_buckets + 1, sizeof(int));
+    if (hashgrid->bucket_start == 0)
+      error = true;
+    hashgrid->x            = (float *)    malloc (max_entities * sizeof(float));
+    hashgrid->y            = (float *)    malloc (max_entities * sizeof(float));
+    hashgrid->z            = (float *)    malloc (max_entities * sizeof(float));
+    hashgrid->entity       = (int *)      malloc (max_entities * sizeof(int));
+    hashgrid->entity_hash  = (unsigned *) malloc (max_entities * sizeof(unsigned));
+    if ((hashgrid->x == 0) OR (hashgrid->y == 0) OR (hashgrid->z == 0) OR (hashgrid->entity == 0) OR (hashgrid->entity_hash == 0))
+      error = true;
+    hashgrid->max_entities = max_entities;
+  }
+
+/*____________________________________________________________________
+|
+| On any error, free memory
+|___________________________________________________________________*/
+
+  if (error) {
+    gx3d_Hashgrid_Free (hashgrid);
+    hashgrid = 0;
+  }
+
+  return (hashgrid);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Hashgrid_Free
+|
+| Output: Frees all memory for a hashgrid.
+|___________________________________________________________________*/
+
+void gx3d_Hashgrid_Free (gx3dHashgrid *hashgrid)
+{
+  if (hashgrid) {
+    if (hashgrid->bucket_start)
+      free (hashgrid->bucket_start);
+    if (hashgrid->x)
+      free (hashgrid->x);
+    if (hashgrid->y)
+      free (hashgrid->y);
+    if (hashgrid->z)
+      free (hashgrid->z);
+    if (hashgrid->entity)
+      free (hashgrid->entity);
+    if (hashgrid->entity_hash)
+      free (hashgrid->entity_hash);
+    free (hashgrid);
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Hashgrid_Build
+|
+| Output: Replaces all entities in a hashgrid with the positions in an
+|   array.  The id of each entity is its index in the array.  Returns
+|   true on success or false on any error.
+|
+| Description: Counting sort.  The # of entities in each bucket is
+|   counted, a prefix sum of the counts gives where each bucket starts,
+|   and then each entity is copied to the next free place in its
+|   bucket.
+|___________________________________________________________________*/
+
+bool gx3d_Hashgrid_Build (gx3dHashgrid *hashgrid, gx3dVector *positions, int num_entities)
+{
+  int i, n, sum;
+  float *x, *y, *z;
+  int *entity;
+  unsigned *entity_hash;
+  int *bucket_start;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (hashgrid);
+  DEBUG_ASSERT (positions OR (num_entities == 0));
+  DEBUG_ASSERT (num_entities >= 0);
+
+/*____________________________________________________________________
+|
+| Make sure there is enough room
+|___________________________________________________________________*/
+
+  if (num_entities > hashgrid->max_entities) {
+    x           = (float *)    realloc (hashgrid->x,           num_entities * sizeof(float));
+    if (x)
+      hashgrid->x = x;
+    y           = (float *)    realloc (hashgrid->y,           num_entities * sizeof(float));
+    if (y)
+      hashgrid->y = y;
+    z           = (float *)    realloc (hashgrid->z,           num_entities * sizeof(float));
+    if (z)
+      hashgrid->z = z;
+    entity      = (int *)      realloc (hashgrid->entity,      num_entities * sizeof(int));
+    if (entity)
+      hashgrid->entity = entity;
+    entity_hash = (unsigned *) realloc (hashgrid->entity_hash, num_entities * sizeof(unsigned));
+    if (entity_hash)
+      hashgrid->entity_hash = entity_hash;
+    if ((x == 0) OR (y == 0) OR (z == 0) OR (entity == 0) OR (entity_hash == 0)) {
+      gxError ("gx3d_Hashgrid_Build(): Can't allocate memory");
+      hashgrid->num_entities = 0;
+      memset (hashgrid->bucket_start, 0, (hashgrid->num_buckets + 1) * sizeof(int));
+      return (false);
+    }
+    hashgrid->max_entities = num_entities;
+  }
+
+/*____________________________________________________________________
+|
+| Sort entities by bucket
+|___________________________________________________________________*/
+
+  bucket_start = hashgrid->bucket_start;
+  entity_hash  = hashgrid->entity_hash;
+
+  // Count # entities in each bucket (bucket_start[b+1] is count of bucket b)
+  memset (bucket_start, 0, (hashgrid->num_buckets + 1) * sizeof(int));
+  for (i=0; i<num_entities; i++) {
+    entity_hash[i] = Get_Cell_Hash (hashgrid, Get_Cell (hashgrid, positions[i].x), Get_Cell (hashgrid, positions[i].y), Get_Cell (hashgrid, positions[i].z));
+    bucket_start[entity_hash[i] + 1]++;
+  }
+  // Convert counts to start of each bucket
+  for (i=1, sum=0; i<=hashgrid->num_buckets; i++) {
+    n = bucket_start[i];
+    bucket_start[i] = sum;
+    sum += n;
+  }
+  // Copy each entity into next place in its bucket (bucket_start[b+1] ends up as the start of bucket b+1)
+  for (i=0; i<num_entities; i++) {
+    n = bucket_start[entity_hash[i] + 1]++;
+    hashgrid->x[n]      = positions[i].x;
+    hashgrid->y[n]      = positions[i].y;
+    hashgrid->z[n]      = positions[i].z;
+    hashgrid->entity[n] = i;
+  }
+  hashgrid->num_entities = num_entities;
+
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Cell
+|
+| Input: Called from gx3d_Hashgrid_Build(), Intersect_Box_Cells()
+| Output: Returns cell coordinate of a position on one axis.
+|___________________________________________________________________*/
+
+static inline int Get_Cell (gx3dHashgrid *hashgrid, float value)
+{
+  return ((int)floorf (value * hashgrid->inv_cell_size));
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Cell_Hash
+|
+| Input: Called from gx3d_Hashgrid_Build(), Intersect_Box_Cells()
+| Output: Returns bucket of a cell.
+|___________________________________________________________________*/
+
+static inline unsigned Get_Cell_Hash (gx3dHashgrid *hashgrid, int x, int y, int z)
+{
+  return ((((unsigned)x * 73856093) ^ ((unsigned)y * 19349663) ^ ((unsigned)z * 83492791)) & (hashgrid->num_buckets - 1));
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Hashgrid_Intersect_Sphere
+|
+| Output: Finds the entities in a sphere.  Returns # of entities found.
+|   Ids are returned for the first max_entities entities found.
+|___________________________________________________________________*/
+
+int gx3d_Hashgrid_Intersect_Sphere (
+  gx3dHashgrid *hashgrid,
+  gx3dSphere   *sphere,
+  int          *entities,
+  int           max_entities )
+{
+  gx3dBox box;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (hashgrid);
+  DEBUG_ASSERT (sphere);
+  DEBUG_ASSERT (sphere->radius >= 0);
+  DEBUG_ASSERT (entities OR (max_entities == 0));
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  box.min.x = sphere->center.x - sphere->radius;
+  box.min.y = sphere->center.y - sphere->radius;
+  box.min.z = sphere->center.z - sphere->radius;
+  box.max.x = sphere->center.x + sphere->radius;
+  box.max.y = sphere->center.y + sphere->radius;
+  box.max.z = sphere->center.z + sphere->radius;
+
+  return (Intersect_Box_Cells (hashgrid, &box, sphere, entities, max_entities));
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Hashgrid_Intersect_Box
+|
+| Output: Finds the entities in a box.  Returns # of entities found.
+|   Ids are returned for the first max_entities entities found.
+|___________________________________________________________________*/
+
+int gx3d_Hashgrid_Intersect_Box (
+  gx3dHashgrid *hashgrid,
+  gx3dBox      *box,
+  int          *entities,
+  int           max_entities )
+{
+  DEBUG_ASSERT (hashgrid);
+  DEBUG_ASSERT (box);
+  DEBUG_ASSERT (entities OR (max_entities == 0));
+
+  return (Intersect_Box_Cells (hashgrid, box, 0, entities, max_entities));
+}
+
+/*____________________________________________________________________
+|
+| Function: Intersect_Box_Cells
+|
+| Input: Called from gx3d_Hashgrid_Intersect_Sphere(),
+|   gx3d_Hashgrid_Intersect_Box()
+| Output: Finds the entities in a box (and sphere, if any).  Returns #
+|   of entities found.
+|
+| Description: Each cell overlapped by the box is visited once.  Other
+|   cells may hash to the same bucket, so an entity is only counted if
+|   it's actually in the cell being visited - otherwise it could be
+|   found twice.  If the box overlaps more cells than there are
+|   entities, it's faster to just test all the entities.
+|___________________________________________________________________*/
+
+static int Intersect_Box_Cells (
+  gx3dHashgrid *hashgrid,
+  gx3dBox      *box,
+  gx3dSphere   *sphere,       // if not NULL, entities must also be in this sphere
+  int          *entities,
+  int           max_entities )
+{
+  int i, x, y, z, first, last;
+  int xmin, ymin, zmin, xmax, ymax, zmax;
+  double num_cells;
+  int num_found = 0;
+
+  xmin = Get_Cell (hashgrid, box->min.x);
+  ymin = Get_Cell (hashgrid, box->min.y);
+  zmin = Get_Cell (hashgrid, box->min.z);
+  xmax = Get_Cell (hashgrid, box->max.x);
+  ymax = Get_Cell (hashgrid, box->max.y);
+  zmax = Get_Cell (hashgrid, box->max.z);
+  num_cells = (double)(xmax - xmin + 1) * (double)(ymax - ymin + 1) * (double)(zmax - zmin + 1);
+
+  // Test all entities?
+  if (num_cells > (double)hashgrid->num_entities) {
+    for (i=0; i<hashgrid->num_entities; i++) {
+      if (NOT Entity_Inside (hashgrid, i, box, sphere))
+        continue;
+      if (num_found < max_entities)
+        entities[num_found] = hashgrid->entity[i];
+      num_found++;
+    }
+  }
+  // Test entities in each cell overlapped by the box
+  else
+    for (z=zmin; z<=zmax; z++)
+      for (y=ymin; y<=ymax; y++)
+        for (x=xmin; x<=xmax; x++) {
+          i     = Get_Cell_Hash (hashgrid, x, y, z);
+          first = hashgrid->bucket_start[i];
+          last  = hashgrid->bucket_start[i+1];
+          for (i=first; i<last; i++) {
+            if (NOT Entity_Inside (hashgrid, i, box, sphere))
+              continue;
+            // Skip entities of other cells in the same bucket
+            if ((Get_Cell (hashgrid, hashgrid->x[i]) != x) OR (Get_Cell (hashgrid, hashgrid->y[i]) != y) OR (Get_Cell (hashgrid, hashgrid->z[i]) != z))
+              continue;
+            if (num_found < max_entities)
+              entities[num_found] = hashgrid->entity[i];
+            num_found++;
+          }
+        }
+
+  return (num_found);
+}
+
+/*____________________________________________________________________
+|
+| Function: Entity_Inside
+|
+| Input: Called from Intersect_Box_Cells()
+| Output: Returns true if an entity (index into the sorted arrays) is in
+|   a box and also in a sphere, if any.
+|___________________________________________________________________*/
+
+static inline bool Entity_Inside (gx3dHashgrid *hashgrid, int index, gx3dBox *box, gx3dSphere *sphere)
+{
+  float dx, dy, dz;
+  bool inside = true;
+
+  if ((hashgrid->x[index] < box->min.x) OR (hashgrid->x[index] > box->max.x) OR
+      (hashgrid->y[index] < box->min.y) OR (hashgrid->y[index] > box->max.y) OR
+      (hashgrid->z[index] < box->min.z) OR (hashgrid->z[index] > box->max.z))
+    inside = false;
+  else if (sphere) {
+    dx = hashgrid->x[index] - sphere->center.x;
+    dy = hashgrid->y[index] - sphere->center.y;
+    dz = hashgrid->z[index] - sphere->center.z;
+    if (dx*dx + dy*dy + dz*dz > sphere->radius * sphere->radius)
+      inside = false;
+  }
+
+  return (inside);
+}
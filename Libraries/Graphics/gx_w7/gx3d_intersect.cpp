@@ -20,10 +20,20 @@
 |             gx3d_Intersect_Ray_Sphere
 |             gx3d_Intersect_Ray_Box
 |             gx3d_Intersect_Ray_Box
+|             gx3d_Intersect_Ray_Box
+|              Min
+|              Max
 |             gx3d_Intersect_Ray_Triangle
 |             gx3d_Intersect_Ray_Triangle
 |             gx3d_Intersect_Ray_TriangleFront
 |             gx3d_Intersect_Ray_TriangleFront
+|             gx3d_SetTrianglePacket
+|             gx3d_Intersect_Ray_Triangles
+|              Intersect_Ray_Triangles_SSE
+|              Intersect_Ray_Triangles_AVX
+|             gx3d_Intersect_Ray_TrianglesFront
+|              Intersect_Ray_Triangles_SSE
+|              Intersect_Ray_Triangles_AVX
 |             gx3d_Intersect_Box_Box
 |              Min
 |              Max
@@ -42,6 +52,8 @@
 #include <first_header.h>
 
 #include <math.h>
+#include <xmmintrin.h>
+#include <immintrin.h>
 #include "dp.h"
 
 /*___________________
@@ -49,6 +61,21 @@
 | Function prototypes
 |__________________*/
 
+static int Intersect_Ray_Triangles_SSE (
+  gx3dRay            *ray,
+  gx3dTrianglePacket *packet,
+  int                 first,        // 0 or 4
+  bool                front_only,
+  float              *distance,
+  float              *barycentric_u,
+  float              *barycentric_v );
+static int Intersect_Ray_Triangles_AVX (
+  gx3dRay            *ray,
+  gx3dTrianglePacket *packet,
+  bool                front_only,
+  float              *distance,
+  float              *barycentric_u,
+  float              *barycentric_v );
 static inline float Min (float f1, float f2);
 static inline float Max (float f1, float f2);
 
@@ -1231,6 +1258,72 @@ gxRelation gx3d_Intersect_Ray_Box (gx3dRay *ray, float ray_length, gx3dBox *box,
 #undef OUT_FAR
 } 
 
+/*____________________________________________________________________
+|
+| Function: gx3d_Intersect_Ray_Box
+|
+| Output: Returns intersection of a ray segment (0 to ray_length) with a
+|   AAB box, where the ray is given as its origin and the reciprocal of
+|   each component of its direction.  Faster than the versions above for 
+|   testing one ray against many boxes, such as in a tree traversal.
+|
+|   Returns gxRELATION_OUTSIDE     = ray does not intersect box
+|           gxRELATION_INTERSECT * = ray intersects (or starts inside) box
+|
+|   * Returns distance along the ray where it enters the box (0 if the
+|   ray origin is inside the box).
+|
+| Note: A zero direction component should have a large inverse (not
+|   infinity) so that 0 * inverse is not a NaN.
+|
+| Reference: Real-Time Collision Detection, pg. 180 (slab method)
+|___________________________________________________________________*/
+
+gxRelation gx3d_Intersect_Ray_Box (gx3dVector *origin, gx3dVector *inv_direction, float ray_length, gx3dBox *box, float *distance)
+{
+  float t1, t2, tmin, tmax;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (origin);
+  DEBUG_ASSERT (inv_direction);
+  DEBUG_ASSERT (box);
+  DEBUG_ASSERT (distance);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  tmin = 0;
+  tmax = ray_length;
+
+  t1 = (box->min.x - origin->x) * inv_direction->x;
+  t2 = (box->max.x - origin->x) * inv_direction->x;
+  tmin = Max (tmin, Min (t1, t2));
+  tmax = Min (tmax, Max (t1, t2));
+
+  t1 = (box->min.y - origin->y) * inv_direction->y;
+  t2 = (box->max.y - origin->y) * inv_direction->y;
+  tmin = Max (tmin, Min (t1, t2));
+  tmax = Min (tmax, Max (t1, t2));
+
+  t1 = (box->min.z - origin->z) * inv_direction->z;
+  t2 = (box->max.z - origin->z) * inv_direction->z;
+  tmin = Max (tmin, Min (t1, t2));
+  tmax = Min (tmax, Max (t1, t2));
+
+  *distance = tmin;
+
+  if (tmin <= tmax)
+    return (gxRELATION_INTERSECT);
+  else
+    return (gxRELATION_OUTSIDE);
+}
+
 /*____________________________________________________________________
 |
 | Function: gx3d_Intersect_Ray_Triangle
@@ -1579,6 +1672,325 @@ gxRelation gx3d_Intersect_Ray_TriangleFront (
   return (result);
 }
 
+/*____________________________________________________________________
+|
+| Function: gx3d_SetTrianglePacket
+|
+| Output: Puts a triangle into a packet for gx3d_Intersect_Ray_Triangles()
+|   or gx3d_Intersect_Ray_TrianglesFront().  Triangles must be added 
+|   in order starting at 0.
+|___________________________________________________________________*/
+
+void gx3d_SetTrianglePacket (gx3dTrianglePacket *packet, int triangle, gx3dVector *v0, gx3dVector *v1, gx3dVector *v2)
+{
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (packet);
+  DEBUG_ASSERT ((triangle >= 0) AND (triangle < 8));
+  DEBUG_ASSERT (v0);
+  DEBUG_ASSERT (v1);
+  DEBUG_ASSERT (v2);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  packet->vertex0[0][triangle] = v0->x;
+  packet->vertex0[1][triangle] = v0->y;
+  packet->vertex0[2][triangle] = v0->z;
+  // Same edges as computed by gx3d_Intersect_Ray_Triangle()
+  packet->edge1[0][triangle] = v1->x - v0->x;
+  packet->edge1[1][triangle] = v1->y - v0->y;
+  packet->edge1[2][triangle] = v1->z - v0->z;
+  packet->edge2[0][triangle] = v2->x - v0->x;
+  packet->edge2[1][triangle] = v2->y - v0->y;
+  packet->edge2[2][triangle] = v2->z - v0->z;
+  packet->num_triangles = triangle + 1;
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Intersect_Ray_Triangles
+|
+| Output: Returns intersection of an infinite ray with up to 8 
+|   triangles.  The intersection can occur with the ray going either 
+|   through the front side of a triangle or the back side.  
+|
+|   Returns a bit mask of the triangles hit (bit 0 = triangle 0).  For
+|   each triangle hit returns distance and optionally barycentric coords
+|   in the arrays (8 entries).
+|
+| Description: Tests 8 triangles at once with AVX, or 4 at once with 
+|   SSE.  Each step is the same single precision operation, in the same
+|   order, as gx3d_Intersect_Ray_Triangle(), so the results are exactly
+|   the same as calling it for each triangle.
+|___________________________________________________________________*/
+
+int gx3d_Intersect_Ray_Triangles (
+  gx3dRay            *ray,
+  gx3dTrianglePacket *packet,
+  float              *distance,
+  float              *barycentric_u,
+  float              *barycentric_v )
+{
+  int mask;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (ray);
+  DEBUG_ASSERT (packet);
+  DEBUG_ASSERT ((packet->num_triangles >= 0) AND (packet->num_triangles <= 8));
+  DEBUG_ASSERT (distance);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  if ((packet->num_triangles > 4) AND (gx3d_GetCPUFeatures () & gx3d_CPU_AVX))
+    mask = Intersect_Ray_Triangles_AVX (ray, packet, false, distance, barycentric_u, barycentric_v);
+  else {
+    mask = Intersect_Ray_Triangles_SSE (ray, packet, 0, false, distance, barycentric_u, barycentric_v);
+    if (packet->num_triangles > 4)
+      mask |= Intersect_Ray_Triangles_SSE (ray, packet, 4, false, distance, barycentric_u, barycentric_v) << 4;
+  }
+
+  // Ignore unused lanes
+  return (mask & ((1 << packet->num_triangles) - 1));
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Intersect_Ray_TrianglesFront
+|
+| Output: Returns intersection of an infinite ray with up to 8 
+|   triangles.  The intersection can occur only with the ray going 
+|   through the front side of a triangle.
+|
+|   Returns a bit mask of the triangles hit (bit 0 = triangle 0).  For
+|   each triangle hit returns distance and optionally barycentric coords
+|   in the arrays (8 entries).
+|
+| Description: Same results as calling gx3d_Intersect_Ray_TriangleFront() 
+|   for each triangle (see gx3d_Intersect_Ray_Triangles()).
+|___________________________________________________________________*/
+
+int gx3d_Intersect_Ray_TrianglesFront (
+  gx3dRay            *ray,
+  gx3dTrianglePacket *packet,
+  float              *distance,
+  float              *barycentric_u,
+  float              *barycentric_v )
+{
+  int mask;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (ray);
+  DEBUG_ASSERT (packet);
+  DEBUG_ASSERT ((packet->num_triangles >= 0) AND (packet->num_triangles <= 8));
+  DEBUG_ASSERT (distance);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  if ((packet->num_triangles > 4) AND (gx3d_GetCPUFeatures () & gx3d_CPU_AVX))
+    mask = Intersect_Ray_Triangles_AVX (ray, packet, true, distance, barycentric_u, barycentric_v);
+  else {
+    mask = Intersect_Ray_Triangles_SSE (ray, packet, 0, true, distance, barycentric_u, barycentric_v);
+    if (packet->num_triangles > 4)
+      mask |= Intersect_Ray_Triangles_SSE (ray, packet, 4, true, distance, barycentric_u, barycentric_v) << 4;
+  }
+
+  // Ignore unused lanes
+  return (mask & ((1 << packet->num_triangles) - 1));
+}
+
+/*____________________________________________________________________
+|
+| Function: Intersect_Ray_Triangles_SSE
+|
+| Input: Called from gx3d_Intersect_Ray_Triangles(), 
+|   gx3d_Intersect_Ray_TrianglesFront()
+| Output: Tests a ray against 4 triangles of a packet (starting at
+|   first).  Returns a bit mask of the triangles hit.
+|___________________________________________________________________*/
+
+static int Intersect_Ray_Triangles_SSE (
+  gx3dRay            *ray,
+  gx3dTrianglePacket *packet,
+  int                 first,        // 0 or 4
+  bool                front_only,
+  float              *distance,
+  float              *barycentric_u,
+  float              *barycentric_v )
+{
+  int mask;
+  __m128 dx, dy, dz, e1x, e1y, e1z, e2x, e2y, e2z, px, py, pz, tx, ty, tz, qx, qy, qz, det, inv_det, u, v, t, hit;
+
+  dx  = _mm_set1_ps (ray->direction.x);
+  dy  = _mm_set1_ps (ray->direction.y);
+  dz  = _mm_set1_ps (ray->direction.z);
+  e1x = _mm_loadu_ps (&(packet->edge1[0][first]));
+  e1y = _mm_loadu_ps (&(packet->edge1[1][first]));
+  e1z = _mm_loadu_ps (&(packet->edge1[2][first]));
+  e2x = _mm_loadu_ps (&(packet->edge2[0][first]));
+  e2y = _mm_loadu_ps (&(packet->edge2[1][first]));
+  e2z = _mm_loadu_ps (&(packet->edge2[2][first]));
+
+  // pvec = direction x edge2
+  px = _mm_sub_ps (_mm_mul_ps (dy, e2z), _mm_mul_ps (dz, e2y));
+  py = _mm_sub_ps (_mm_mul_ps (dz, e2x), _mm_mul_ps (dx, e2z));
+  pz = _mm_sub_ps (_mm_mul_ps (dx, e2y), _mm_mul_ps (dy, e2x));
+  det = _mm_add_ps (_mm_add_ps (_mm_mul_ps (e1x, px), _mm_mul_ps (e1y, py)), _mm_mul_ps (e1z, pz));
+
+  // tvec = origin - vertex0
+  tx = _mm_sub_ps (_mm_set1_ps (ray->origin.x), _mm_loadu_ps (&(packet->vertex0[0][first])));
+  ty = _mm_sub_ps (_mm_set1_ps (ray->origin.y), _mm_loadu_ps (&(packet->vertex0[1][first])));
+  tz = _mm_sub_ps (_mm_set1_ps (ray->origin.z), _mm_loadu_ps (&(packet->vertex0[2][first])));
+  u = _mm_add_ps (_mm_add_ps (_mm_mul_ps (tx, px), _mm_mul_ps (ty, py)), _mm_mul_ps (tz, pz));
+
+  // qvec = tvec x edge1
+  qx = _mm_sub_ps (_mm_mul_ps (ty, e1z), _mm_mul_ps (tz, e1y));
+  qy = _mm_sub_ps (_mm_mul_ps (tz, e1x), _mm_mul_ps (tx, e1z));
+  qz = _mm_sub_ps (_mm_mul_ps (tx, e1y), _mm_mul_ps (ty, e1x));
+  v = _mm_add_ps (_mm_add_ps (_mm_mul_ps (dx, qx), _mm_mul_ps (dy, qy)), _mm_mul_ps (dz, qz));
+  t = _mm_add_ps (_mm_add_ps (_mm_mul_ps (e2x, qx), _mm_mul_ps (e2y, qy)), _mm_mul_ps (e2z, qz));
+
+  inv_det = _mm_div_ps (_mm_set1_ps (1), det);
+  // Tests are written as the negation of the scalar rejection tests so a NaN gives the same result
+  if (front_only) {
+    // Reject det < EPSILON, u < 0, u > det, v < 0, u+v > det
+    hit = _mm_cmpnlt_ps (det, _mm_set1_ps (EPSILON));
+    hit = _mm_and_ps (hit, _mm_cmpnlt_ps (u, _mm_setzero_ps ()));
+    hit = _mm_and_ps (hit, _mm_cmpngt_ps (u, det));
+    hit = _mm_and_ps (hit, _mm_cmpnlt_ps (v, _mm_setzero_ps ()));
+    hit = _mm_and_ps (hit, _mm_cmpngt_ps (_mm_add_ps (u, v), det));
+    u = _mm_mul_ps (u, inv_det);
+    v = _mm_mul_ps (v, inv_det);
+  }
+  else {
+    // Reject -EPSILON < det < EPSILON, u < 0, u > 1, v < 0, u+v > 1
+    hit = _mm_or_ps (_mm_cmpngt_ps (det, _mm_set1_ps (-EPSILON)), _mm_cmpnlt_ps (det, _mm_set1_ps (EPSILON)));
+    u = _mm_mul_ps (u, inv_det);
+    v = _mm_mul_ps (v, inv_det);
+    hit = _mm_and_ps (hit, _mm_cmpnlt_ps (u, _mm_setzero_ps ()));
+    hit = _mm_and_ps (hit, _mm_cmpngt_ps (u, _mm_set1_ps (1)));
+    hit = _mm_and_ps (hit, _mm_cmpnlt_ps (v, _mm_setzero_ps ()));
+    hit = _mm_and_ps (hit, _mm_cmpngt_ps (_mm_add_ps (u, v), _mm_set1_ps (1)));
+  }
+  t = _mm_mul_ps (t, inv_det);
+
+  mask = _mm_movemask_ps (hit);
+  if (mask) {
+    _mm_storeu_ps (&distance[first], t);
+    if (barycentric_u)
+      _mm_storeu_ps (&barycentric_u[first], u);
+    if (barycentric_v)
+      _mm_storeu_ps (&barycentric_v[first], v);
+  }
+
+  return (mask);
+}
+
+/*____________________________________________________________________
+|
+| Function: Intersect_Ray_Triangles_AVX
+|
+| Input: Called from gx3d_Intersect_Ray_Triangles(), 
+|   gx3d_Intersect_Ray_TrianglesFront()
+| Output: Tests a ray against the 8 triangles of a packet.  Returns a 
+|   bit mask of the triangles hit.
+|___________________________________________________________________*/
+
+static int Intersect_Ray_Triangles_AVX (
+  gx3dRay            *ray,
+  gx3dTrianglePacket *packet,
+  bool                front_only,
+  float              *distance,
+  float              *barycentric_u,
+  float              *barycentric_v )
+{
+  int mask;
+  __m256 dx, dy, dz, e1x, e1y, e1z, e2x, e2y, e2z, px, py, pz, tx, ty, tz, qx, qy, qz, det, inv_det, u, v, t, hit;
+
+  dx  = _mm256_set1_ps (ray->direction.x);
+  dy  = _mm256_set1_ps (ray->direction.y);
+  dz  = _mm256_set1_ps (ray->direction.z);
+  e1x = _mm256_loadu_ps (packet->edge1[0]);
+  e1y = _mm256_loadu_ps (packet->edge1[1]);
+  e1z = _mm256_loadu_ps (packet->edge1[2]);
+  e2x = _mm256_loadu_ps (packet->edge2[0]);
+  e2y = _mm256_loadu_ps (packet->edge2[1]);
+  e2z = _mm256_loadu_ps (packet->edge2[2]);
+
+  // pvec = direction x edge2
+  px = _mm256_sub_ps (_mm256_mul_ps (dy, e2z), _mm256_mul_ps (dz, e2y));
+  py = _mm256_sub_ps (_mm256_mul_ps (dz, e2x), _mm256_mul_ps (dx, e2z));
+  pz = _mm256_sub_ps (_mm256_mul_ps (dx, e2y), _mm256_mul_ps (dy, e2x));
+  det = _mm256_add_ps (_mm256_add_ps (_mm256_mul_ps (e1x, px), _mm256_mul_ps (e1y, py)), _mm256_mul_ps (e1z, pz));
+
+  // tvec = origin - vertex0
+  tx = _mm256_sub_ps (_mm256_set1_ps (ray->origin.x), _mm256_loadu_ps (packet->vertex0[0]));
+  ty = _mm256_sub_ps (_mm256_set1_ps (ray->origin.y), _mm256_loadu_ps (packet->vertex0[1]));
+  tz = _mm256_sub_ps (_mm256_set1_ps (ray->origin.z), _mm256_loadu_ps (packet->vertex0[2]));
+  u = _mm256_add_ps (_mm256_add_ps (_mm256_mul_ps (tx, px), _mm256_mul_ps (ty, py)), _mm256_mul_ps (tz, pz));
+
+  // qvec = tvec x edge1
+  qx = _mm256_sub_ps (_mm256_mul_ps (ty, e1z), _mm256_mul_ps (tz, e1y));
+  qy = _mm256_sub_ps (_mm256_mul_ps (tz, e1x), _mm256_mul_ps (tx, e1z));
+  qz = _mm256_sub_ps (_mm256_mul_ps (tx, e1y), _mm256_mul_ps (ty, e1x));
+  v = _mm256_add_ps (_mm256_add_ps (_mm256_mul_ps (dx, qx), _mm256_mul_ps (dy, qy)), _mm256_mul_ps (dz, qz));
+  t = _mm256_add_ps (_mm256_add_ps (_mm256_mul_ps (e2x, qx), _mm256_mul_ps (e2y, qy)), _mm256_mul_ps (e2z, qz));
+
+  inv_det = _mm256_div_ps (_mm256_set1_ps (1), det);
+  if (front_only) {
+    hit = _mm256_cmp_ps (det, _mm256_set1_ps (EPSILON), _CMP_NLT_UQ);
+    hit = _mm256_and_ps (hit, _mm256_cmp_ps (u, _mm256_setzero_ps (), _CMP_NLT_UQ));
+    hit = _mm256_and_ps (hit, _mm256_cmp_ps (u, det, _CMP_NGT_UQ));
+    hit = _mm256_and_ps (hit, _mm256_cmp_ps (v, _mm256_setzero_ps (), _CMP_NLT_UQ));
+    hit = _mm256_and_ps (hit, _mm256_cmp_ps (_mm256_add_ps (u, v), det, _CMP_NGT_UQ));
+    u = _mm256_mul_ps (u, inv_det);
+    v = _mm256_mul_ps (v, inv_det);
+  }
+  else {
+    hit = _mm256_or_ps (_mm256_cmp_ps (det, _mm256_set1_ps (-EPSILON), _CMP_NGT_UQ), _mm256_cmp_ps (det, _mm256_set1_ps (EPSILON), _CMP_NLT_UQ));
+    u = _mm256_mul_ps (u, inv_det);
+    v = _mm256_mul_ps (v, inv_det);
+    hit = _mm256_and_ps (hit, _mm256_cmp_ps (u, _mm256_setzero_ps (), _CMP_NLT_UQ));
+    hit = _mm256_and_ps (hit, _mm256_cmp_ps (u, _mm256_set1_ps (1), _CMP_NGT_UQ));
+    hit = _mm256_and_ps (hit, _mm256_cmp_ps (v, _mm256_setzero_ps (), _CMP_NLT_UQ));
+    hit = _mm256_and_ps (hit, _mm256_cmp_ps (_mm256_add_ps (u, v), _mm256_set1_ps (1), _CMP_NGT_UQ));
+  }
+  t = _mm256_mul_ps (t, inv_det);
+
+  mask = _mm256_movemask_ps (hit);
+  if (mask) {
+    _mm256_storeu_ps (distance, t);
+    if (barycentric_u)
+      _mm256_storeu_ps (barycentric_u, u);
+    if (barycentric_v)
+      _mm256_storeu_ps (barycentric_v, v);
+  }
+
+  // Avoid AVX to SSE transition penalty in caller
+  _mm256_zeroupper ();
+
+  return (mask);
+}
+
 /*____________________________________________________________________
 |
 | Function: gx3d_Intersect_Box_Box
@@ -1638,7 +2050,7 @@ gxRelation gx3d_Intersect_Box_Box (gx3dBox *box1, gx3dBox *box2, gx3dBox *inters
 |
 | Function: Min
 |
-| Input: Called from gx3d_Intersect_Box_Box()
+| Input: Called from gx3d_Intersect_Ray_Box(), gx3d_Intersect_Box_Box()
 | Output: Returns minimum of two values.
 |___________________________________________________________________*/
 
@@ -1654,7 +2066,7 @@ static inline float Min (float f1, float f2)
 |
 | Function: Max
 |
-| Input: Called from gx3d_Intersect_Box_Box()
+| Input: Called from gx3d_Intersect_Ray_Box(), gx3d_Intersect_Box_Box()
 | Output: Returns maximum of two values.
 |___________________________________________________________________*/
 
@@ -0,0 +1,239 @@
+/*____________________________________________________________________
+|
+| File: gx3d_jobpool.cpp
+|
+| Description: Functions to manipulate a pool of worker threads.
+|
+| Functions: gx3d_JobPool_Init
+|             JobPool_Thread
+|              Run_Chunks
+|            gx3d_JobPool_Free
+|            gx3d_JobPool_Run
+|             Run_Chunks
+|
+| Description: A job pool runs jobs that are split into chunks of work
+|   that can be done in any order.  The chunks are handed out to a pool
+|   of worker threads (plus the calling thread) until none are left.
+|   Used by the narrowphase and the vector array functions.
+|
+|   Only one job uses the worker threads at a time.  If another thread
+|   is already using the pool, the chunks are run on the calling thread.
+|
+| (C) Copyright 2017 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|
+| DEBUG_ASSERTED!
+|___________________________________________________________________*/
+
+//#define DEBUG
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+
+#include <process.h>
+
+#include "dp.h"
+
+#include "gx3d_jobpool.h"
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static unsigned __stdcall JobPool_Thread (void *thread_data);
+static void Run_Chunks (gx3dJobPool *pool);
+
+/*____________________________________________________________________
+|
+| Function: gx3d_JobPool_Init
+|
+| Output: Creates a job pool that uses num_threads threads (including
+|   the calling thread) to run each job.  If num_threads is 0, uses one
+|   thread per processor.  Returns 0 on any error.
+|___________________________________________________________________*/
+
+gx3dJobPool *gx3d_JobPool_Init (int num_threads)
+{
+  unsigned thread_id;
+  SYSTEM_INFO info;
+  bool error;
+  gx3dJobPool *pool;
+
+  error = false;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (num_threads >= 0);
+
+/*____________________________________________________________________
+|
+| Start worker threads
+|___________________________________________________________________*/
+
+  pool = (gx3dJobPool *) calloc (1, sizeof(gx3dJobPool));
+  if (pool == 0)
+    error = true;
+  else {
+    // Use one thread per processor?
+    if (num_threads == 0) {
+      GetSystemInfo (&info);
+      num_threads = (int)info.dwNumberOfProcessors;
+    }
+    if (num_threads > MAX_JOBPOOL_THREADS)
+      num_threads = MAX_JOBPOOL_THREADS;
+    if (num_threads > 1) {
+      pool->start_semaphore = CreateSemaphore (0, 0, MAX_JOBPOOL_THREADS, 0);
+      pool->done_semaphore  = CreateSemaphore (0, 0, MAX_JOBPOOL_THREADS, 0);
+      if ((pool->start_semaphore == 0) OR (pool->done_semaphore == 0))
+        error = true;
+      else
+        // Start worker threads (the calling thread is also a worker)
+        for (pool->num_workers=0; pool->num_workers<num_threads-1; pool->num_workers++) {
+          pool->thread[pool->num_workers] = (HANDLE)_beginthreadex (0, 0, JobPool_Thread, pool, 0, &thread_id);
+          if (pool->thread[pool->num_workers] == 0)
+            break;
+        }
+    }
+  }
+
+/*____________________________________________________________________
+|
+| On any error, free memory
+|___________________________________________________________________*/
+
+  if (error) {
+    gx3d_JobPool_Free (pool);
+    pool = 0;
+  }
+
+  return (pool);
+}
+
+/*____________________________________________________________________
+|
+| Function: JobPool_Thread
+|
+| Input: Called from gx3d_JobPool_Init() (by _beginthreadex())
+| Output: Worker thread that runs chunks of each job until told to quit.
+|___________________________________________________________________*/
+
+static unsigned __stdcall JobPool_Thread (void *thread_data)
+{
+  gx3dJobPool *pool = (gx3dJobPool *)thread_data;
+
+  for (;;) {
+    WaitForSingleObject (pool->start_semaphore, INFINITE);
+    if (pool->quit)
+      break;
+    Run_Chunks (pool);
+    ReleaseSemaphore (pool->done_semaphore, 1, 0);
+  }
+
+  return (0);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_JobPool_Free
+|
+| Output: Stops the worker threads and frees all memory for a job pool.
+|   Don't call while a job is running.
+|___________________________________________________________________*/
+
+void gx3d_JobPool_Free (gx3dJobPool *pool)
+{
+  int i;
+
+  if (pool) {
+    // Stop the worker threads
+    if (pool->num_workers) {
+      pool->quit = true;
+      ReleaseSemaphore (pool->start_semaphore, pool->num_workers, 0);
+      WaitForMultipleObjects (pool->num_workers, pool->thread, TRUE, INFINITE);
+      for (i=0; i<pool->num_workers; i++)
+        CloseHandle (pool->thread[i]);
+    }
+    if (pool->start_semaphore)
+      CloseHandle (pool->start_semaphore);
+    if (pool->done_semaphore)
+      CloseHandle (pool->done_semaphore);
+    free (pool);
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_JobPool_Run
+|
+| Output: Calls run_chunk() once for each chunk 0 to num_chunks-1 of a
+|   job, on the worker threads and the calling thread.  Returns when all
+|   chunks are done.
+|___________________________________________________________________*/
+
+void gx3d_JobPool_Run (gx3dJobPool *pool, gx3dJobChunkFunction run_chunk, void *job, int num_chunks)
+{
+  int i, num_workers;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (pool);
+  DEBUG_ASSERT (run_chunk);
+  DEBUG_ASSERT (num_chunks >= 0);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  num_workers = pool->num_workers;
+  if (num_workers > num_chunks - 1)
+    num_workers = num_chunks - 1;
+
+  // Split the job among the worker threads?
+  if ((num_workers > 0) AND (InterlockedCompareExchange (&(pool->busy), 1, 0) == 0)) {
+    pool->run_chunk  = run_chunk;
+    pool->job        = job;
+    pool->num_chunks = num_chunks;
+    pool->next_chunk = 0;
+    ReleaseSemaphore (pool->start_semaphore, num_workers, 0);
+    Run_Chunks (pool);
+    // Wait for the worker threads to finish
+    for (i=0; i<num_workers; i++)
+      WaitForSingleObject (pool->done_semaphore, INFINITE);
+    InterlockedExchange (&(pool->busy), 0);
+  }
+  else
+    for (i=0; i<num_chunks; i++)
+      (*run_chunk) (job, i);
+}
+
+/*____________________________________________________________________
+|
+| Function: Run_Chunks
+|
+| Input: Called from gx3d_JobPool_Run(), JobPool_Thread()
+| Output: Runs chunks of the current job until none are left.
+|___________________________________________________________________*/
+
+static void Run_Chunks (gx3dJobPool *pool)
+{
+  int chunk;
+
+  for (;;) {
+    chunk = (int)InterlockedIncrement (&(pool->next_chunk)) - 1;
+    if (chunk >= pool->num_chunks)
+      break;
+    (*pool->run_chunk) (pool->job, chunk);
+  }
+}
@@ -0,0 +1,31 @@
+/*____________________________________________________________________
+|
+| File: gx3d_jobpool.h
+|
+| (C) Copyright 2017 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+#define MAX_JOBPOOL_THREADS 32
+
+// Runs one chunk of a job (see gx3d_JobPool_Run())
+typedef void (*gx3dJobChunkFunction) (void *job, int chunk);
+
+// Worker threads and the job they are working on
+struct gx3dJobPool {
+  HANDLE               thread[MAX_JOBPOOL_THREADS];
+  int                  num_workers;      // # worker threads (not counting the calling thread)
+  HANDLE               start_semaphore;  // signaled once for each worker when a job starts (or to quit)
+  HANDLE               done_semaphore;   // signaled by each worker when it finishes its part of a job
+  bool                 quit;
+  volatile LONG        busy;             // 1 while a job is using the worker threads
+  // Current job
+  gx3dJobChunkFunction run_chunk;
+  void                *job;
+  int                  num_chunks;
+  volatile LONG        next_chunk;       // next chunk not yet started
+};
+
+gx3dJobPool *gx3d_JobPool_Init (int num_threads);  // 0 = one thread per processor
+void         gx3d_JobPool_Free (gx3dJobPool *pool);
+void         gx3d_JobPool_Run (gx3dJobPool *pool, gx3dJobChunkFunction run_chunk, void *job, int num_chunks);
@@ -556,8 +556,8 @@ static void Process_Geometry_Layer (
     }
     else {
       // Set some variables in this new layer
-      gx3d_GetIdentityMatrix (&(g_layer->transform.local_matrix));
-      gx3d_GetIdentityMatrix (&(g_layer->transform.composite_matrix));
+      gx3d_GetIdentityAffineMatrix (&(g_layer->transform.local_matrix));
+      gx3d_GetIdentityAffineMatrix (&(g_layer->transform.composite_matrix));
       for (i=0; i<gx3d_NUM_TEXTURE_STAGES; i++)
         g_layer->texture[i]    = g_texture[i];
       g_layer->num_textures  = num_textures;
@@ -597,8 +597,8 @@ void LWS_File_To_GX3D_MotionSkeleton  (
         // Copy bone name
         Copy_Name (g_skeleton->bones[i].name, l_bone->name, gx_ASCIIZ_STRING_LENGTH_LONG);
         // Copy pre, post matrices
-        g_skeleton->bones[i].pre  = l_bone->pre;
-        g_skeleton->bones[i].post = l_bone->post;
+        gx3d_MatrixToAffineMatrix (&(l_bone->pre),  &(g_skeleton->bones[i].pre));
+        gx3d_MatrixToAffineMatrix (&(l_bone->post), &(g_skeleton->bones[i].post));
       }
       // Set first bone in array as root (already verified this in above loop)
       g_skeleton->bones[0].parent = 0xFF;
@@ -7,6 +7,7 @@
 | Functions:  gx3d_ComputeViewMatrix
 |             gx3d_ComputeProjectionMatrix
 |             gx3d_ComputeProjectionMatrixHV
+|             gx3d_ComputeViewFrustum
 |       
 |             gx3d_SetWorldMatrix
 |             gx3d_GetWorldMatrix
@@ -20,6 +21,11 @@
 |
 |             gx3d_GetViewFrustum
 |             gx3d_GetWorldFrustum
+|             gx3d_GetWorldFrustum
+|              Get_World_Frustum
+|             gx3d_InitViewContext
+|             gx3d_SetViewContextMatrix
+|             gx3d_GetViewContext
 |
 |             gx3d_GetIdentityMatrix
 |             gx3d_GetTransposeMatrix
@@ -51,14 +57,36 @@
 |             gx3d_GetRotateYTextureMatrixInverse
 |
 |             gx3d_MultiplyMatrix
+|              Multiply_Matrix_SSE
+|               Load_Row
+|               Store_Row
+|              Multiply_Matrix_AVX
+|             gx3d_MultiplyMatrixAligned
+|              Multiply_Matrix_SSE
+|              Multiply_Matrix_AVX
 |             gx3d_MultiplyScalarMatrix
 |             gx3d_MultiplyVectorMatrix
 |             gx3d_MultiplyNormalVectorMatrix
 |             gx3d_MultiplyVector4DMatrix
+|              Multiply_Vector4D_Matrix_SSE
+|             gx3d_MultiplyVector4DMatrixAligned
+|              Multiply_Vector4D_Matrix_SSE
 |             gx3d_MultiplyScalarVector
 |
+|             gx3d_MatrixToAffineMatrix
+|             gx3d_AffineMatrixToMatrix
+|             gx3d_GetIdentityAffineMatrix
+|             gx3d_MultiplyAffineMatrix
+|              Multiply_Affine_Matrix_SSE
+|             gx3d_GetInverseAffineMatrix
+|             gx3d_MultiplyVectorAffineMatrix
+|             gx3d_MultiplyNormalVectorAffineMatrix
+|
+|             gx3d_NormalizeVector
 |             gx3d_NormalizeVector
 |             gx3d_NormalizeVector
+|             gx3d_NormalizeVectorArray
+|             gx3d_ReciprocalSqrt
 |             gx3d_VectorMagnitude
 |             gx3d_VectorDotProduct
 |             gx3d_AngleBetweenVectors
@@ -87,6 +115,8 @@
 |             gx3d_HeadingToYZVector
 |             gx3d_XZVectorToHeading
 |             gx3d_YZVectorToHeading
+|
+|             Read_CPU_Features
 |  
 | Notes: 
 |   Coordinate system
@@ -109,6 +139,14 @@
 |     4x4 matrix.  This is useful since some vectors such as surface
 |     normals don't need to be translated.
 |
+|   Affine matrices
+|     Transforms built from rotations, scalings and translations always
+|     have (0,0,0,1) as the last column.  gx3dAffineMatrix stores only
+|     the first 3 columns, so hierarchy updates that concatenate many
+|     of these transforms can skip the multiplies by the last column.
+|     The columns are stored one after the other so each one can be
+|     loaded into a single SSE register.
+|
 | (C) Copyright 2017 Abonvita Software LLC.
 | Licensed under the GX Toolkit License, Version 1.0.
 |___________________________________________________________________*/
@@ -121,6 +159,9 @@
 #include <first_header.h>
 
 #include <math.h>
+#include <float.h>
+#include <xmmintrin.h>
+#include <immintrin.h>
 
 #include "dp.h"
 
@@ -138,6 +179,32 @@
     _m_->_33 = 1;                       \
   }      
 
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static void Get_World_Frustum (gx3dMatrix *view_matrix, gx3dViewFrustum *vf, gx3dWorldFrustum *wf);
+static unsigned Read_CPU_Features ();
+static void Multiply_Matrix_SSE (gx3dMatrix *m1, gx3dMatrix *m2, gx3dMatrix *mresult, bool aligned);
+static void Multiply_Matrix_AVX (gx3dMatrix *m1, gx3dMatrix *m2, gx3dMatrix *mresult);
+static void Multiply_Vector4D_Matrix_SSE (gx3dVector4D *v, gx3dMatrix *m, gx3dVector4D *vresult, bool aligned);
+static inline __m128 Load_Row (float *row, bool aligned);
+static inline void   Store_Row (float *row, __m128 r, bool aligned);
+static void Multiply_Affine_Matrix_SSE (gx3dAffineMatrix *a1, gx3dAffineMatrix *a2, gx3dAffineMatrix *aresult);
+
+/*___________________
+|
+| Global variables
+|__________________*/
+
+// SIMD instruction sets supported by the cpu, copied here the first time
+//  they are needed so the small functions below don't pay for a call each
+//  time (CPU_FEATURES_READ is set once they have been copied)
+#define CPU_FEATURES_READ 0x80000000
+static unsigned CPU_features = 0;
+#define CPU_FEATURES ((CPU_features & CPU_FEATURES_READ) ? CPU_features : Read_CPU_Features ())
+
 /*____________________________________________________________________
 |
 | Function: gx3d_ComputeViewMatrix
@@ -309,6 +376,117 @@ void gx3d_ComputeProjectionMatrixHV (
   m->_32 = -q * near_plane;
 }
 
+/*____________________________________________________________________
+|
+| Function: gx3d_ComputeViewFrustum
+|
+| Output: Computes the view frustum clip planes (in view space) from
+|   the parameters of a projection.
+|___________________________________________________________________*/
+
+void gx3d_ComputeViewFrustum (
+  gx3dViewFrustum *vf,      // the resulting frustum (in view space)
+  float            hfov,    // horizontal field of view in degrees (0.1 - 179.9)
+  float            vfov,    // vertical field of view in degrees (0.1 - 179.9)
+  float            near_plane,
+  float            far_plane )
+{
+  float hradians, vradians, far_x, far_y, xtan, ytan;
+  gx3dVector p1, p2, p3;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (vf);
+  DEBUG_ASSERT (hfov > 0);
+  DEBUG_ASSERT (hfov < 180);
+  DEBUG_ASSERT (vfov > 0);
+  DEBUG_ASSERT (vfov < 180);
+  DEBUG_ASSERT (near_plane > 0);
+  DEBUG_ASSERT (far_plane > near_plane);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  hradians = (float)((double)hfov * DEGREES_TO_RADIANS * 0.5);
+  vradians = (float)((double)vfov * DEGREES_TO_RADIANS * 0.5);
+  xtan = tanf (hradians);
+  ytan = tanf (vradians);
+  far_x = far_plane * xtan;
+  far_y = far_plane * ytan;
+
+  // Compute near plane rectangle (in world space, and y points up)
+  vf->view_plane.xright  = near_plane * xtan;
+  vf->view_plane.xleft   = -vf->view_plane.xright;
+  vf->view_plane.ytop    = near_plane * ytan;
+  vf->view_plane.ybottom = -vf->view_plane.ytop;
+
+  // Set near plane
+  vf->plane[gx3d_FRUSTUM_PLANE_NEAR].n.x = 0;
+  vf->plane[gx3d_FRUSTUM_PLANE_NEAR].n.y = 0;
+  vf->plane[gx3d_FRUSTUM_PLANE_NEAR].n.z = 1;
+  vf->plane[gx3d_FRUSTUM_PLANE_NEAR].d = near_plane;
+
+  // Set far plane
+  vf->plane[gx3d_FRUSTUM_PLANE_FAR].n.x = 0;
+  vf->plane[gx3d_FRUSTUM_PLANE_FAR].n.y = 0;
+  vf->plane[gx3d_FRUSTUM_PLANE_FAR].n.z = -1;
+  vf->plane[gx3d_FRUSTUM_PLANE_FAR].d = far_plane;
+
+  // Calculate left plane using 3 points
+  p1.x = 0;
+  p1.y = 0;
+  p1.z = 0;
+  p2.x = -far_x;
+  p2.y =  far_y;
+  p2.z =  far_plane;
+  p3.x = -far_x;
+  p3.y = -far_y;
+  p3.z =  far_plane;
+  gx3d_GetPlane (&p1, &p2, &p3, &(vf->plane[gx3d_FRUSTUM_PLANE_LEFT]));
+
+  // Calculate right plane using 3 points
+  p1.x = 0;
+  p1.y = 0;
+  p1.z = 0;
+  p2.x =  far_x;
+  p2.y = -far_y;
+  p2.z =  far_plane;
+  p3.x =  far_x;
+  p3.y =  far_y;
+  p3.z =  far_plane;
+  gx3d_GetPlane (&p1, &p2, &p3, &(vf->plane[gx3d_FRUSTUM_PLANE_RIGHT]));
+
+  // Calculate top plane using 3 points
+  p1.x = 0;
+  p1.y = 0;
+  p1.z = 0;
+  p2.x =  far_x;
+  p2.y =  far_y;
+  p2.z =  far_plane;
+  p3.x = -far_x;
+  p3.y =  far_y;
+  p3.z =  far_plane;
+  gx3d_GetPlane (&p1, &p2, &p3, &(vf->plane[gx3d_FRUSTUM_PLANE_TOP]));
+
+  // Calculate bottom plane using 3 points
+  p1.x = 0;
+  p1.y = 0;
+  p1.z = 0;
+  p2.x = -far_x;
+  p2.y = -far_y;
+  p2.z =  far_plane;
+  p3.x =  far_x;
+  p3.y = -far_y;
+  p3.z =  far_plane;
+  gx3d_GetPlane (&p1, &p2, &p3, &(vf->plane[gx3d_FRUSTUM_PLANE_BOTTOM]));
+}
+
+
 /*____________________________________________________________________
 |
 | Function: gx3d_SetWorldMatrix
@@ -360,7 +538,7 @@ void gx3d_SetViewMatrix (gx3dMatrix *m)
   (*gx_Video.set_view_matrix) ((void *)m);
 
   // Set globals
-  gx3d_View_matrix = *m;
+  gx3d_View_context.view_matrix = *m;
   gx3d_View_projection_matrix_dirty = true;
 }
 
@@ -559,7 +737,7 @@ void gx3d_GetViewFrustum (gx3dViewFrustum *vf)
   if (gx3d_View_frustum_dirty) 
      gx3d_UpdateViewFrustum ();
 
-  *vf = gx3d_View_frustum;
+  *vf = gx3d_View_context.frustum;
 }
 
 /*____________________________________________________________________
@@ -578,14 +756,46 @@ void gx3d_GetViewFrustum (gx3dViewFrustum *vf)
 |___________________________________________________________________*/
 
 void gx3d_GetWorldFrustum (gx3dViewFrustum *vf, gx3dWorldFrustum *wf)
+{
+  Get_World_Frustum (&(gx3d_View_context.view_matrix), vf, wf);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_GetWorldFrustum
+|
+| Output: Computes the world frustum of a view context.  Only reads the
+|   context, so it can be called from any thread.
+|___________________________________________________________________*/
+
+void gx3d_GetWorldFrustum (gx3dViewContext *context, gx3dWorldFrustum *wf)
+{
+  DEBUG_ASSERT (context);
+
+  Get_World_Frustum (&(context->view_matrix), &(context->frustum), wf);
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_World_Frustum
+|
+| Input: Called from gx3d_GetWorldFrustum()
+| Output: Computes a world frustum from a view frustum seen through a
+|   view matrix.
+|___________________________________________________________________*/
+
+static void Get_World_Frustum (gx3dMatrix *view_matrix, gx3dViewFrustum *vf, gx3dWorldFrustum *wf)
 {
   int i;
+  float d;
+  gx3dVector n;
 
 /*____________________________________________________________________
 |
 | Verify input params
 |___________________________________________________________________*/
 
+  DEBUG_ASSERT (view_matrix);
   DEBUG_ASSERT (vf);
   DEBUG_ASSERT (wf);
   // Make sure view frustum plane normals are normalized
@@ -594,49 +804,49 @@ void gx3d_GetWorldFrustum (gx3dViewFrustum *vf, gx3dWorldFrustum *wf)
 
 /*____________________________________________________________________
 |
-| Compute world frustum (the code below is an optimization, could also
-|   just call function to multiply plane (as a 4D vector) by the view
-|   matrix)
+| Compute world frustum.  Each view frustum plane is made into a plane
+|   equation in view space (positive distance is inside the frustum),
+|   then transformed into world space.  Since view space = world space 
+|   * view matrix, the world plane normal is the view matrix times the 
+|   view plane normal and the world plane d adds the view plane normal
+|   times the view matrix translation.
 |___________________________________________________________________*/
 
   for (i=0; i<gx3d_NUM_FRUSTUM_PLANES; i++) {
     switch (i) {
       case gx3d_FRUSTUM_PLANE_NEAR:
-        // Transform near view frustum plane into world space (view frustum near plane normal is 0,0,1)
-        wf->plane[i].n.x = gx3d_View_matrix._20;
-        wf->plane[i].n.y = gx3d_View_matrix._21;
-        wf->plane[i].n.z = gx3d_View_matrix._22;
-        wf->plane[i].d   = gx3d_View_matrix._23;
+        // Inside if view z >= distance to near plane
+        n.x = 0;
+        n.y = 0;
+        n.z = 1;
+        d   = -vf->plane[i].d;
         break;
       case gx3d_FRUSTUM_PLANE_FAR:
-        // Transform near view frustum plane into world space (view frustum far plane normal is 0,0,-1)
-        wf->plane[i].n.x = -gx3d_View_matrix._20;
-        wf->plane[i].n.y = -gx3d_View_matrix._21;
-        wf->plane[i].n.z = -gx3d_View_matrix._22;
-        wf->plane[i].d   = -gx3d_View_matrix._23;
+        // Inside if view z <= distance to far plane
+        n.x = 0;
+        n.y = 0;
+        n.z = -1;
+        d   = vf->plane[i].d;
         break;
-      case gx3d_FRUSTUM_PLANE_LEFT:
-      case gx3d_FRUSTUM_PLANE_RIGHT:
-      case gx3d_FRUSTUM_PLANE_TOP:
-      case gx3d_FRUSTUM_PLANE_BOTTOM:
-        // Transform view frustum plane into world space
-        wf->plane[i].n.x = vf->plane[i].n.x * gx3d_View_matrix._00 +
-                           vf->plane[i].n.y * gx3d_View_matrix._10 +
-                           vf->plane[i].n.z * gx3d_View_matrix._20; 
-//                         + gx3d_View_matrix._30; // don't need this since it will always be 0
-        wf->plane[i].n.y = vf->plane[i].n.x * gx3d_View_matrix._01 +
-                           vf->plane[i].n.y * gx3d_View_matrix._11 +
-                           vf->plane[i].n.z * gx3d_View_matrix._21;
-//                         + gx3d_View_matrix._31;
-        wf->plane[i].n.z = vf->plane[i].n.x * gx3d_View_matrix._02 +
-                           vf->plane[i].n.y * gx3d_View_matrix._12 +
-                           vf->plane[i].n.z * gx3d_View_matrix._22; 
-//                         + gx3d_View_matrix._32;
-        wf->plane[i].d   = vf->plane[i].n.x * gx3d_View_matrix._03 +
-                           vf->plane[i].n.y * gx3d_View_matrix._13 +
-                           vf->plane[i].n.z * gx3d_View_matrix._23;
+      default:
+        // Left, right, top and bottom planes go through the view space origin
+        n = vf->plane[i].n;
+        d = vf->plane[i].d;
         break;
     }
+    // Transform plane into world space
+    wf->plane[i].n.x = n.x * view_matrix->_00 +
+                       n.y * view_matrix->_01 +
+                       n.z * view_matrix->_02;
+    wf->plane[i].n.y = n.x * view_matrix->_10 +
+                       n.y * view_matrix->_11 +
+                       n.z * view_matrix->_12;
+    wf->plane[i].n.z = n.x * view_matrix->_20 +
+                       n.y * view_matrix->_21 +
+                       n.z * view_matrix->_22;
+    wf->plane[i].d   = n.x * view_matrix->_30 +
+                       n.y * view_matrix->_31 +
+                       n.z * view_matrix->_32 + d;
   }
 
 /*____________________________________________________________________
@@ -683,6 +893,72 @@ void gx3d_GetWorldFrustum (gx3dViewFrustum *vf, gx3dWorldFrustum *wf)
     DEBUG_ASSERT (fabsf(gx3d_VectorDotProduct (&(wf->plane[i].n), &(wf->plane[i].n)) - 1) < .01);
 }
 
+/*____________________________________________________________________
+|
+| Function: gx3d_InitViewContext
+|
+| Output: Inits a view context from a view matrix and the parameters of
+|   a projection.  Unlike the default view context, it doesn't depend 
+|   on the current view and projection, so it can be used for another 
+|   camera (a shadow or reflection view, for example).
+|___________________________________________________________________*/
+
+void gx3d_InitViewContext (
+  gx3dViewContext *context,
+  gx3dMatrix      *view_matrix,
+  float            hfov,          // horizontal field of view in degrees (0.1 - 179.9)
+  float            vfov,          // vertical field of view in degrees (0.1 - 179.9)
+  float            near_plane,    // in world z units
+  float            far_plane )    // in world z units
+{
+  DEBUG_ASSERT (context);
+  DEBUG_ASSERT (view_matrix);
+
+  context->view_matrix = *view_matrix;
+  gx3d_ComputeProjectionMatrixHV (&(context->projection_matrix), hfov, vfov, near_plane, far_plane);
+  gx3d_MultiplyMatrix (&(context->view_matrix), &(context->projection_matrix), &(context->view_projection_matrix));
+  gx3d_ComputeViewFrustum (&(context->frustum), hfov, vfov, near_plane, far_plane);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_SetViewContextMatrix
+|
+| Output: Changes the view matrix of a view context, keeping its 
+|   projection.
+|___________________________________________________________________*/
+
+void gx3d_SetViewContextMatrix (gx3dViewContext *context, gx3dMatrix *view_matrix)
+{
+  DEBUG_ASSERT (context);
+  DEBUG_ASSERT (view_matrix);
+
+  context->view_matrix = *view_matrix;
+  gx3d_MultiplyMatrix (&(context->view_matrix), &(context->projection_matrix), &(context->view_projection_matrix));
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_GetViewContext
+|
+| Output: Returns a copy of the default view context, which has the 
+|   current view and projection.  Like gx3d_GetViewFrustum(), this 
+|   should be called from the thread that sets the view and projection.
+|   The copy can then be used by queries on any thread.
+|___________________________________________________________________*/
+
+void gx3d_GetViewContext (gx3dViewContext *context)
+{
+  DEBUG_ASSERT (context);
+
+  if (gx3d_View_projection_matrix_dirty)
+    gx3d_UpdateViewProjectionMatrix ();
+  if (gx3d_View_frustum_dirty) 
+    gx3d_UpdateViewFrustum ();
+
+  *context = gx3d_View_context;
+}
+
 /*____________________________________________________________________
 |
 | Function: gx3d_GetIdentityMatrix
@@ -1236,6 +1512,11 @@ inline void gx3d_GetRotateTextureMatrixInverse (gx3dMatrix *m, float degrees)
 | Function: gx3d_MultiplyMatrix
 |
 | Output: Multiplies m1 * m2, putting result in mresult.
+|
+| Description: Uses AVX or SSE if the cpu supports it.  All versions 
+|   add the products in the same order, so they give exactly the same
+|   results.  The matrices don't need to be aligned (see
+|   gx3d_MultiplyMatrixAligned()).
 |___________________________________________________________________*/
 
 void gx3d_MultiplyMatrix (gx3dMatrix *m1, gx3dMatrix *m2, gx3dMatrix *mresult)
@@ -1248,15 +1529,121 @@ void gx3d_MultiplyMatrix (gx3dMatrix *m1, gx3dMatrix *m2, gx3dMatrix *mresult)
   DEBUG_ASSERT (m2);
   DEBUG_ASSERT (mresult);
 
-  // Multiply
-  memset ((void *)&mtemp, 0, 16*sizeof(float));
-  for (i=0; i<4; i++)
-    for (j=0; j<4; j++)
-      for (k=0; k<4; k++)
-        ((float *)&mtemp)[i*4+j] += (((float *)m1)[i*4+k] * ((float *)m2)[k*4+j]);
+  if (CPU_FEATURES & gx3d_CPU_AVX)
+    Multiply_Matrix_AVX (m1, m2, mresult);
+  else if (CPU_FEATURES & gx3d_CPU_SSE2)
+    Multiply_Matrix_SSE (m1, m2, mresult, false);
+  else {
+    // Multiply
+    memset ((void *)&mtemp, 0, 16*sizeof(float));
+    for (i=0; i<4; i++)
+      for (j=0; j<4; j++)
+        for (k=0; k<4; k++)
+          ((float *)&mtemp)[i*4+j] += (((float *)m1)[i*4+k] * ((float *)m2)[k*4+j]);
+    // Put result into mresult
+    *mresult = mtemp;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_MultiplyMatrixAligned
+|
+| Output: Multiplies m1 * m2, putting result in mresult.  Same as
+|   gx3d_MultiplyMatrix() but all 3 matrices must be 16-byte aligned
+|   (declared __declspec(align(16)) or allocated with _aligned_malloc()),
+|   so the SSE version can use aligned loads and stores.
+|___________________________________________________________________*/
 
-  // Put result into mresult
-  *mresult = mtemp;
+void gx3d_MultiplyMatrixAligned (gx3dMatrix *m1, gx3dMatrix *m2, gx3dMatrix *mresult)
+{
+  // Verify input params
+  DEBUG_ASSERT (m1 AND (((size_t)m1 & 15) == 0));
+  DEBUG_ASSERT (m2 AND (((size_t)m2 & 15) == 0));
+  DEBUG_ASSERT (mresult AND (((size_t)mresult & 15) == 0));
+
+  if (CPU_FEATURES & gx3d_CPU_AVX)
+    Multiply_Matrix_AVX (m1, m2, mresult);
+  else if (CPU_FEATURES & gx3d_CPU_SSE2)
+    Multiply_Matrix_SSE (m1, m2, mresult, true);
+  else
+    gx3d_MultiplyMatrix (m1, m2, mresult);
+}
+
+/*____________________________________________________________________
+|
+| Function: Multiply_Matrix_SSE
+|
+| Input: Called from gx3d_MultiplyMatrix(), gx3d_MultiplyMatrixAligned()
+| Output: Multiplies m1 * m2 using SSE, putting result in mresult.
+|   Each row of the result is the rows of m2 scaled by the elements of
+|   the same row of m1.
+|___________________________________________________________________*/
+
+static void Multiply_Matrix_SSE (gx3dMatrix *m1, gx3dMatrix *m2, gx3dMatrix *mresult, bool aligned)
+{
+  int i;
+  __m128 b0, b1, b2, b3, a, r[4];
+
+  b0 = Load_Row (&(m2->_00), aligned);
+  b1 = Load_Row (&(m2->_10), aligned);
+  b2 = Load_Row (&(m2->_20), aligned);
+  b3 = Load_Row (&(m2->_30), aligned);
+
+  // Compute all rows before storing any, in case mresult is m1 or m2
+  for (i=0; i<4; i++) {
+    a    = Load_Row (&(((float *)m1)[i*4]), aligned);
+    r[i] = _mm_mul_ps (_mm_shuffle_ps (a, a, _MM_SHUFFLE(0,0,0,0)), b0);
+    r[i] = _mm_add_ps (r[i], _mm_mul_ps (_mm_shuffle_ps (a, a, _MM_SHUFFLE(1,1,1,1)), b1));
+    r[i] = _mm_add_ps (r[i], _mm_mul_ps (_mm_shuffle_ps (a, a, _MM_SHUFFLE(2,2,2,2)), b2));
+    r[i] = _mm_add_ps (r[i], _mm_mul_ps (_mm_shuffle_ps (a, a, _MM_SHUFFLE(3,3,3,3)), b3));
+  }
+  Store_Row (&(mresult->_00), r[0], aligned);
+  Store_Row (&(mresult->_10), r[1], aligned);
+  Store_Row (&(mresult->_20), r[2], aligned);
+  Store_Row (&(mresult->_30), r[3], aligned);
+}
+
+/*____________________________________________________________________
+|
+| Function: Multiply_Matrix_AVX
+|
+| Input: Called from gx3d_MultiplyMatrix(), gx3d_MultiplyMatrixAligned()
+| Output: Multiplies m1 * m2 using AVX, putting result in mresult.  
+|   Same as Multiply_Matrix_SSE() but computes 2 rows of the result at 
+|   a time.  Pairs of rows are only 16-byte aligned even in aligned
+|   matrices, so they are always loaded and stored unaligned (on a cpu
+|   with AVX that costs nothing when the data is aligned).
+|___________________________________________________________________*/
+
+static void Multiply_Matrix_AVX (gx3dMatrix *m1, gx3dMatrix *m2, gx3dMatrix *mresult)
+{
+  __m256 b0, b1, b2, b3, a01, a23, r01, r23;
+
+  // Each row of m2 in both halves
+  b0 = _mm256_broadcast_ps ((__m128 *)&(m2->_00));
+  b1 = _mm256_broadcast_ps ((__m128 *)&(m2->_10));
+  b2 = _mm256_broadcast_ps ((__m128 *)&(m2->_20));
+  b3 = _mm256_broadcast_ps ((__m128 *)&(m2->_30));
+
+  // Rows 0,1 and 2,3 of m1
+  a01 = _mm256_loadu_ps (&(m1->_00));
+  a23 = _mm256_loadu_ps (&(m1->_20));
+
+  r01 = _mm256_mul_ps (_mm256_shuffle_ps (a01, a01, _MM_SHUFFLE(0,0,0,0)), b0);
+  r01 = _mm256_add_ps (r01, _mm256_mul_ps (_mm256_shuffle_ps (a01, a01, _MM_SHUFFLE(1,1,1,1)), b1));
+  r01 = _mm256_add_ps (r01, _mm256_mul_ps (_mm256_shuffle_ps (a01, a01, _MM_SHUFFLE(2,2,2,2)), b2));
+  r01 = _mm256_add_ps (r01, _mm256_mul_ps (_mm256_shuffle_ps (a01, a01, _MM_SHUFFLE(3,3,3,3)), b3));
+  r23 = _mm256_mul_ps (_mm256_shuffle_ps (a23, a23, _MM_SHUFFLE(0,0,0,0)), b0);
+  r23 = _mm256_add_ps (r23, _mm256_mul_ps (_mm256_shuffle_ps (a23, a23, _MM_SHUFFLE(1,1,1,1)), b1));
+  r23 = _mm256_add_ps (r23, _mm256_mul_ps (_mm256_shuffle_ps (a23, a23, _MM_SHUFFLE(2,2,2,2)), b2));
+  r23 = _mm256_add_ps (r23, _mm256_mul_ps (_mm256_shuffle_ps (a23, a23, _MM_SHUFFLE(3,3,3,3)), b3));
+
+  _mm256_storeu_ps (&(mresult->_00), r01);
+  _mm256_storeu_ps (&(mresult->_20), r23);
+
+  // Avoid AVX to SSE transition penalties in the caller
+  _mm256_zeroupper ();
 }
 
 /*____________________________________________________________________
@@ -1290,6 +1677,7 @@ void gx3d_MultiplyScalarMatrix (float s, gx3dMatrix *m, gx3dMatrix *mresult)
 
 void gx3d_MultiplyVectorMatrix (gx3dVector *v, gx3dMatrix *m, gx3dVector *vresult)
 {
+  __m128 r;
   gx3dVector vorig;
 
   // Verify input params
@@ -1297,6 +1685,17 @@ void gx3d_MultiplyVectorMatrix (gx3dVector *v, gx3dMatrix *m, gx3dVector *vresul
   DEBUG_ASSERT (m);
   DEBUG_ASSERT (vresult);
 
+  // Use SSE if available (adds in the same order as below, so gives the same result)
+  if (CPU_FEATURES & gx3d_CPU_SSE2) {
+    r = _mm_mul_ps (_mm_set1_ps (v->x), _mm_loadu_ps (&(m->_00)));
+    r = _mm_add_ps (r, _mm_mul_ps (_mm_set1_ps (v->y), _mm_loadu_ps (&(m->_10))));
+    r = _mm_add_ps (r, _mm_mul_ps (_mm_set1_ps (v->z), _mm_loadu_ps (&(m->_20))));
+    r = _mm_add_ps (r, _mm_loadu_ps (&(m->_30)));
+    _mm_storel_pi ((__m64 *)vresult, r);
+    _mm_store_ss (&(vresult->z), _mm_movehl_ps (r, r));
+    return;
+  }
+
   // Make a copy of v in case v and vresult are the same  
   vorig.x = v->x;
   vorig.y = v->y;
@@ -1328,6 +1727,7 @@ void gx3d_MultiplyVectorMatrix (gx3dVector *v, gx3dMatrix *m, gx3dVector *vresul
 
 void gx3d_MultiplyNormalVectorMatrix (gx3dVector *v, gx3dMatrix *m, gx3dVector *vresult)
 {
+  __m128 r;
   gx3dVector vorig;
 
   // Verify input params
@@ -1335,6 +1735,16 @@ void gx3d_MultiplyNormalVectorMatrix (gx3dVector *v, gx3dMatrix *m, gx3dVector *
   DEBUG_ASSERT (m);
   DEBUG_ASSERT (vresult);
 
+  // Use SSE if available (adds in the same order as below, so gives the same result)
+  if (CPU_FEATURES & gx3d_CPU_SSE2) {
+    r = _mm_mul_ps (_mm_set1_ps (v->x), _mm_loadu_ps (&(m->_00)));
+    r = _mm_add_ps (r, _mm_mul_ps (_mm_set1_ps (v->y), _mm_loadu_ps (&(m->_10))));
+    r = _mm_add_ps (r, _mm_mul_ps (_mm_set1_ps (v->z), _mm_loadu_ps (&(m->_20))));
+    _mm_storel_pi ((__m64 *)vresult, r);
+    _mm_store_ss (&(vresult->z), _mm_movehl_ps (r, r));
+    return;
+  }
+
   // Make a copy of v in case v and vresult are the same  
   vorig.x = v->x;
   vorig.y = v->y;
@@ -1369,6 +1779,12 @@ void gx3d_MultiplyVector4DMatrix (gx3dVector4D *v, gx3dMatrix *m, gx3dVector4D *
   DEBUG_ASSERT (m);
   DEBUG_ASSERT (vresult);
 
+  // Use SSE if available (adds in the same order as below, so gives the same result)
+  if (CPU_FEATURES & gx3d_CPU_SSE2) {
+    Multiply_Vector4D_Matrix_SSE (v, m, vresult, false);
+    return;
+  }
+
   // Copy v into a temp vector
 //  memcpy (v4, v, sizeof(gx3dVector4D));
 //  v4[3] = 1;
@@ -1384,6 +1800,85 @@ void gx3d_MultiplyVector4DMatrix (gx3dVector4D *v, gx3dMatrix *m, gx3dVector4D *
       ((float *)vresult)[i] += (v4[s] * ((float *)m)[s*4+i]);
 }
 
+/*____________________________________________________________________
+|
+| Function: gx3d_MultiplyVector4DMatrixAligned
+|
+| Output: Multiplies v * m, putting result in vresult.  Same as
+|   gx3d_MultiplyVector4DMatrix() but v, m and vresult must be 16-byte
+|   aligned, so the SSE version can use aligned loads and stores.
+|___________________________________________________________________*/
+
+void gx3d_MultiplyVector4DMatrixAligned (gx3dVector4D *v, gx3dMatrix *m, gx3dVector4D *vresult)
+{
+  // Verify input params
+  DEBUG_ASSERT (v AND (((size_t)v & 15) == 0));
+  DEBUG_ASSERT (m AND (((size_t)m & 15) == 0));
+  DEBUG_ASSERT (vresult AND (((size_t)vresult & 15) == 0));
+
+  if (CPU_FEATURES & gx3d_CPU_SSE2)
+    Multiply_Vector4D_Matrix_SSE (v, m, vresult, true);
+  else
+    gx3d_MultiplyVector4DMatrix (v, m, vresult);
+}
+
+/*____________________________________________________________________
+|
+| Function: Multiply_Vector4D_Matrix_SSE
+|
+| Input: Called from gx3d_MultiplyVector4DMatrix(),
+|                    gx3d_MultiplyVector4DMatrixAligned()
+| Output: Multiplies v * m using SSE, putting result in vresult.  Adds
+|   in the same order as gx3d_MultiplyVector4DMatrix(), so gives the
+|   same result.
+|___________________________________________________________________*/
+
+static void Multiply_Vector4D_Matrix_SSE (gx3dVector4D *v, gx3dMatrix *m, gx3dVector4D *vresult, bool aligned)
+{
+  __m128 a, r;
+
+  a = Load_Row ((float *)v, aligned);
+  r = _mm_mul_ps (_mm_shuffle_ps (a, a, _MM_SHUFFLE(0,0,0,0)), Load_Row (&(m->_00), aligned));
+  r = _mm_add_ps (r, _mm_mul_ps (_mm_shuffle_ps (a, a, _MM_SHUFFLE(1,1,1,1)), Load_Row (&(m->_10), aligned)));
+  r = _mm_add_ps (r, _mm_mul_ps (_mm_shuffle_ps (a, a, _MM_SHUFFLE(2,2,2,2)), Load_Row (&(m->_20), aligned)));
+  r = _mm_add_ps (r, _mm_mul_ps (_mm_shuffle_ps (a, a, _MM_SHUFFLE(3,3,3,3)), Load_Row (&(m->_30), aligned)));
+  Store_Row ((float *)vresult, r, aligned);
+}
+
+/*____________________________________________________________________
+|
+| Function: Load_Row
+|
+| Input: Called from Multiply_Matrix_SSE(), Multiply_Vector4D_Matrix_SSE()
+| Output: Returns 4 floats (a matrix row or 4D vector) loaded with an
+|   aligned load if aligned is true, else an unaligned load.
+|___________________________________________________________________*/
+
+static inline __m128 Load_Row (float *row, bool aligned)
+{
+  if (aligned)
+    return (_mm_load_ps (row));
+  else
+    return (_mm_loadu_ps (row));
+}
+
+/*____________________________________________________________________
+|
+| Function: Store_Row
+|
+| Input: Called from Multiply_Matrix_SSE(), Multiply_Vector4D_Matrix_SSE()
+| Output: Stores 4 floats with an aligned store if aligned is true, else
+|   an unaligned store.
+|___________________________________________________________________*/
+
+static inline void Store_Row (float *row, __m128 r, bool aligned)
+{
+  if (aligned)
+    _mm_store_ps (row, r);
+  else
+    _mm_storeu_ps (row, r);
+}
+
 /*____________________________________________________________________
 |
 | Function: gx3d_MultiplyScalarVector
@@ -1404,6 +1899,277 @@ inline void gx3d_MultiplyScalarVector (float s, gx3dVector *v, gx3dVector *vresu
   vresult->z = v->z * s;
 }
 
+/*____________________________________________________________________
+|
+| Function: gx3d_MatrixToAffineMatrix
+|
+| Output: Copies the first 3 columns of m into an affine matrix.  The
+|   last column of m should be (0,0,0,1).
+|___________________________________________________________________*/
+
+void gx3d_MatrixToAffineMatrix (gx3dMatrix *m, gx3dAffineMatrix *a)
+{
+  // Verify input params
+  DEBUG_ASSERT (m);
+  DEBUG_ASSERT (a);
+
+  a->_00 = m->_00;  a->_01 = m->_01;  a->_02 = m->_02;
+  a->_10 = m->_10;  a->_11 = m->_11;  a->_12 = m->_12;
+  a->_20 = m->_20;  a->_21 = m->_21;  a->_22 = m->_22;
+  a->_30 = m->_30;  a->_31 = m->_31;  a->_32 = m->_32;
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_AffineMatrixToMatrix
+|
+| Output: Copies an affine matrix into a 4x4 matrix, setting the last
+|   column to (0,0,0,1).
+|___________________________________________________________________*/
+
+void gx3d_AffineMatrixToMatrix (gx3dAffineMatrix *a, gx3dMatrix *m)
+{
+  // Verify input params
+  DEBUG_ASSERT (a);
+  DEBUG_ASSERT (m);
+
+  m->_00 = a->_00;  m->_01 = a->_01;  m->_02 = a->_02;  m->_03 = 0;
+  m->_10 = a->_10;  m->_11 = a->_11;  m->_12 = a->_12;  m->_13 = 0;
+  m->_20 = a->_20;  m->_21 = a->_21;  m->_22 = a->_22;  m->_23 = 0;
+  m->_30 = a->_30;  m->_31 = a->_31;  m->_32 = a->_32;  m->_33 = 1;
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_GetIdentityAffineMatrix
+|
+| Output: Sets a to the identity matrix.
+|___________________________________________________________________*/
+
+void gx3d_GetIdentityAffineMatrix (gx3dAffineMatrix *a)
+{
+  // Verify input params
+  DEBUG_ASSERT (a);
+
+  a->_00 = 1;  a->_01 = 0;  a->_02 = 0;
+  a->_10 = 0;  a->_11 = 1;  a->_12 = 0;
+  a->_20 = 0;  a->_21 = 0;  a->_22 = 1;
+  a->_30 = 0;  a->_31 = 0;  a->_32 = 0;
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_MultiplyAffineMatrix
+|
+| Output: Multiplies a1 * a2, putting result in aresult.
+|
+| Description: Same as gx3d_MultiplyMatrix() with the last column of
+|   both matrices taken as (0,0,0,1), so 36 multiplies instead of 64.
+|   Uses SSE if the cpu supports it.  Adds the products in the same
+|   order as gx3d_MultiplyMatrix() so the result is the same as 
+|   multiplying the 4x4 versions of a1 and a2.
+|___________________________________________________________________*/
+
+void gx3d_MultiplyAffineMatrix (gx3dAffineMatrix *a1, gx3dAffineMatrix *a2, gx3dAffineMatrix *aresult)
+{
+  gx3dAffineMatrix atemp;
+  
+  // Verify input params
+  DEBUG_ASSERT (a1);
+  DEBUG_ASSERT (a2);
+  DEBUG_ASSERT (aresult);
+
+  if (CPU_FEATURES & gx3d_CPU_SSE2)
+    Multiply_Affine_Matrix_SSE (a1, a2, aresult);
+  else {
+    atemp._00 = a1->_00 * a2->_00 + a1->_01 * a2->_10 + a1->_02 * a2->_20;
+    atemp._01 = a1->_00 * a2->_01 + a1->_01 * a2->_11 + a1->_02 * a2->_21;
+    atemp._02 = a1->_00 * a2->_02 + a1->_01 * a2->_12 + a1->_02 * a2->_22;
+    atemp._10 = a1->_10 * a2->_00 + a1->_11 * a2->_10 + a1->_12 * a2->_20;
+    atemp._11 = a1->_10 * a2->_01 + a1->_11 * a2->_11 + a1->_12 * a2->_21;
+    atemp._12 = a1->_10 * a2->_02 + a1->_11 * a2->_12 + a1->_12 * a2->_22;
+    atemp._20 = a1->_20 * a2->_00 + a1->_21 * a2->_10 + a1->_22 * a2->_20;
+    atemp._21 = a1->_20 * a2->_01 + a1->_21 * a2->_11 + a1->_22 * a2->_21;
+    atemp._22 = a1->_20 * a2->_02 + a1->_21 * a2->_12 + a1->_22 * a2->_22;
+    atemp._30 = a1->_30 * a2->_00 + a1->_31 * a2->_10 + a1->_32 * a2->_20 + a2->_30;
+    atemp._31 = a1->_30 * a2->_01 + a1->_31 * a2->_11 + a1->_32 * a2->_21 + a2->_31;
+    atemp._32 = a1->_30 * a2->_02 + a1->_31 * a2->_12 + a1->_32 * a2->_22 + a2->_32;
+    // Put result into aresult
+    *aresult = atemp;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Multiply_Affine_Matrix_SSE
+|
+| Input: Called from gx3d_MultiplyAffineMatrix()
+| Output: Multiplies a1 * a2 using SSE, putting result in aresult.
+|   Each column of the result is the columns of a1 (plus the implied
+|   last column) scaled by the elements of the same column of a2.
+|___________________________________________________________________*/
+
+static void Multiply_Affine_Matrix_SSE (gx3dAffineMatrix *a1, gx3dAffineMatrix *a2, gx3dAffineMatrix *aresult)
+{
+  __m128 c0, c1, c2, w, r0, r1, r2;
+
+  c0 = _mm_loadu_ps (&(a1->_00));
+  c1 = _mm_loadu_ps (&(a1->_01));
+  c2 = _mm_loadu_ps (&(a1->_02));
+  w  = _mm_set_ps (1, 0, 0, 0);
+
+  // Compute all columns before storing any, in case aresult is a1 or a2
+  r0 = _mm_mul_ps (c0, _mm_set1_ps (a2->_00));
+  r0 = _mm_add_ps (r0, _mm_mul_ps (c1, _mm_set1_ps (a2->_10)));
+  r0 = _mm_add_ps (r0, _mm_mul_ps (c2, _mm_set1_ps (a2->_20)));
+  r0 = _mm_add_ps (r0, _mm_mul_ps (w,  _mm_set1_ps (a2->_30)));
+  r1 = _mm_mul_ps (c0, _mm_set1_ps (a2->_01));
+  r1 = _mm_add_ps (r1, _mm_mul_ps (c1, _mm_set1_ps (a2->_11)));
+  r1 = _mm_add_ps (r1, _mm_mul_ps (c2, _mm_set1_ps (a2->_21)));
+  r1 = _mm_add_ps (r1, _mm_mul_ps (w,  _mm_set1_ps (a2->_31)));
+  r2 = _mm_mul_ps (c0, _mm_set1_ps (a2->_02));
+  r2 = _mm_add_ps (r2, _mm_mul_ps (c1, _mm_set1_ps (a2->_12)));
+  r2 = _mm_add_ps (r2, _mm_mul_ps (c2, _mm_set1_ps (a2->_22)));
+  r2 = _mm_add_ps (r2, _mm_mul_ps (w,  _mm_set1_ps (a2->_32)));
+
+  _mm_storeu_ps (&(aresult->_00), r0);
+  _mm_storeu_ps (&(aresult->_01), r1);
+  _mm_storeu_ps (&(aresult->_02), r2);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_GetInverseAffineMatrix
+|
+| Output: Computes the inverse of an affine matrix if possible.  Returns
+|   true on success, else false if the matrix is singular.
+|
+| Description: The inverse of the 3x3 part A is computed from its 
+|   cofactors.  The translation of the inverse is -t * A^-1.
+|___________________________________________________________________*/
+
+int gx3d_GetInverseAffineMatrix (gx3dAffineMatrix *a, gx3dAffineMatrix *ainverse)
+{
+  float det, inv_det;
+  gx3dAffineMatrix atemp;
+  int inverse_computed = FALSE;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (a);
+  DEBUG_ASSERT (ainverse);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  // Cofactors of the 3x3 part (transposed)
+  atemp._00 = a->_11 * a->_22 - a->_12 * a->_21;
+  atemp._01 = a->_02 * a->_21 - a->_01 * a->_22;
+  atemp._02 = a->_01 * a->_12 - a->_02 * a->_11;
+  atemp._10 = a->_12 * a->_20 - a->_10 * a->_22;
+  atemp._11 = a->_00 * a->_22 - a->_02 * a->_20;
+  atemp._12 = a->_02 * a->_10 - a->_00 * a->_12;
+  atemp._20 = a->_10 * a->_21 - a->_11 * a->_20;
+  atemp._21 = a->_01 * a->_20 - a->_00 * a->_21;
+  atemp._22 = a->_00 * a->_11 - a->_01 * a->_10;
+
+  det = a->_00 * atemp._00 + a->_01 * atemp._10 + a->_02 * atemp._20;
+  if (det != 0) {
+    inv_det = (float)1 / det;
+    atemp._00 *= inv_det;  atemp._01 *= inv_det;  atemp._02 *= inv_det;
+    atemp._10 *= inv_det;  atemp._11 *= inv_det;  atemp._12 *= inv_det;
+    atemp._20 *= inv_det;  atemp._21 *= inv_det;  atemp._22 *= inv_det;
+    // Translation = -t * A^-1
+    atemp._30 = -(a->_30 * atemp._00 + a->_31 * atemp._10 + a->_32 * atemp._20);
+    atemp._31 = -(a->_30 * atemp._01 + a->_31 * atemp._11 + a->_32 * atemp._21);
+    atemp._32 = -(a->_30 * atemp._02 + a->_31 * atemp._12 + a->_32 * atemp._22);
+    // Put result into ainverse
+    *ainverse = atemp;
+    inverse_computed = TRUE;
+  }
+
+  return (inverse_computed);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_MultiplyVectorAffineMatrix
+|
+| Output: Multiplies v * a, putting result in vresult.  Gives the same
+|   result as gx3d_MultiplyVectorMatrix() with the 4x4 version of a.
+|
+| Description: No SSE version since the columns would need to be summed
+|   across.  To transform many vectors by the same matrix, the 4x4 
+|   gx3d_MultiplyVectorMatrix() or gx3d_MultiplyVectorArrayMatrix() 
+|   are faster.
+|___________________________________________________________________*/
+
+void gx3d_MultiplyVectorAffineMatrix (gx3dVector *v, gx3dAffineMatrix *a, gx3dVector *vresult)
+{
+  gx3dVector vorig;
+
+  // Verify input params
+  DEBUG_ASSERT (v);
+  DEBUG_ASSERT (a);
+  DEBUG_ASSERT (vresult);
+
+  // Make a copy of v in case v and vresult are the same  
+  vorig.x = v->x;
+  vorig.y = v->y;
+  vorig.z = v->z;
+
+  vresult->x = vorig.x * a->_00 +
+               vorig.y * a->_10 +
+               vorig.z * a->_20 +
+                         a->_30;
+  vresult->y = vorig.x * a->_01 +
+               vorig.y * a->_11 +
+               vorig.z * a->_21 +
+                         a->_31;
+  vresult->z = vorig.x * a->_02 +
+               vorig.y * a->_12 +
+               vorig.z * a->_22 +
+                         a->_32;
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_MultiplyNormalVectorAffineMatrix
+|
+| Output: Multiplies v * a without the translation, putting result in 
+|   vresult.  Same restrictions as gx3d_MultiplyNormalVectorMatrix().
+|___________________________________________________________________*/
+
+void gx3d_MultiplyNormalVectorAffineMatrix (gx3dVector *v, gx3dAffineMatrix *a, gx3dVector *vresult)
+{
+  gx3dVector vorig;
+
+  // Verify input params
+  DEBUG_ASSERT (v);
+  DEBUG_ASSERT (a);
+  DEBUG_ASSERT (vresult);
+
+  // Make a copy of v in case v and vresult are the same  
+  vorig.x = v->x;
+  vorig.y = v->y;
+  vorig.z = v->z;
+
+  vresult->x = vorig.x * a->_00 +
+               vorig.y * a->_10 +
+               vorig.z * a->_20;
+  vresult->y = vorig.x * a->_01 +
+               vorig.y * a->_11 +
+               vorig.z * a->_21;
+  vresult->z = vorig.x * a->_02 +
+               vorig.y * a->_12 +
+               vorig.z * a->_22;
+}
+
 /*____________________________________________________________________
 |
 | Function: gx3d_NormalizeVector
@@ -1463,6 +2229,147 @@ inline void gx3d_NormalizeVector (gx3dVector *v, gx3dVector *normal, float *magn
   }
 }
 
+/*____________________________________________________________________
+|
+| Function: gx3d_NormalizeVector
+|
+| Output: Normalizes a vector, returning result in vnormal vector.  
+|   With gx3d_ACCURACY_FAST uses the SSE reciprocal square root (see
+|   gx3d_ReciprocalSqrt()).  The length of the result is then within 
+|   5e-7 of 1, compared to 2e-7 for gx3d_ACCURACY_EXACT.
+|
+| Complexity: (Worst/Average) 1 sqrt, 1 divide, 6 multiply (exact)
+|                             1 rsqrt, 9 multiply (fast)
+|___________________________________________________________________*/
+
+void gx3d_NormalizeVector (gx3dVector *v, gx3dVector *normal, gx3dAccuracy accuracy)
+{
+  float m, y;
+
+  // Verify input params
+  DEBUG_ASSERT (v);
+  DEBUG_ASSERT (normal);
+
+  m = v->x*v->x + v->y*v->y + v->z*v->z;
+
+  if ((accuracy == gx3d_ACCURACY_FAST) AND (CPU_FEATURES & gx3d_CPU_SSE2) AND (m >= FLT_MIN)) {
+    // Same as gx3d_ReciprocalSqrt()
+    y = _mm_cvtss_f32 (_mm_rsqrt_ss (_mm_set_ss (m)));
+    y = (0.5f * y) * (3.0f - (m * y) * y);
+    normal->x = v->x * y;
+    normal->y = v->y * y;
+    normal->z = v->z * y;
+  }
+  else
+    gx3d_NormalizeVector (v, normal);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_NormalizeVectorArray
+|
+| Output: Normalizes each vector v[i], putting results in normal[i].
+|   v and normal can be the same array, but otherwise shouldn't 
+|   overlap.  Gives the same results as calling gx3d_NormalizeVector()
+|   with the same accuracy for each vector.
+|
+| Description: Uses SSE if the cpu supports it, 4 vectors at a time. 
+|   The 12 floats of 4 vectors are loaded as 3 registers, the squared 
+|   lengths are summed after shuffling the squares into x, y and z 
+|   registers, and the 4 scale factors are shuffled back to match the 
+|   layout of the vectors.
+|___________________________________________________________________*/
+
+void gx3d_NormalizeVectorArray (gx3dVector *v, gx3dVector *normal, int num_vectors, gx3dAccuracy accuracy)
+{
+  int i, j;
+  float *src, *dst;
+  __m128 a, b, c, a2, b2, c2, t1, t2, x2, y2, z2, len2, s, y;
+  __m128 zero, tiny, half, three;
+
+  // Verify input params
+  DEBUG_ASSERT (v OR (num_vectors == 0));
+  DEBUG_ASSERT (normal OR (num_vectors == 0));
+  DEBUG_ASSERT (num_vectors >= 0);
+
+  i = 0;
+  if (CPU_FEATURES & gx3d_CPU_SSE2) {
+    zero  = _mm_setzero_ps ();
+    tiny  = _mm_set1_ps (FLT_MIN);
+    half  = _mm_set1_ps (0.5f);
+    three = _mm_set1_ps (3.0f);
+    for (; i+4<=num_vectors; i+=4) {
+      src = (float *)&v[i];
+      dst = (float *)&normal[i];
+      // a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+      a = _mm_loadu_ps (&src[0]);
+      b = _mm_loadu_ps (&src[4]);
+      c = _mm_loadu_ps (&src[8]);
+      a2 = _mm_mul_ps (a, a);
+      b2 = _mm_mul_ps (b, b);
+      c2 = _mm_mul_ps (c, c);
+      t1 = _mm_shuffle_ps (a2, b2, _MM_SHUFFLE(1,0,3,2));   // z0 x1 y1 z1
+      t2 = _mm_shuffle_ps (b2, c2, _MM_SHUFFLE(1,0,3,2));   // x2 y2 z2 x3
+      x2 = _mm_shuffle_ps (a2, t2, _MM_SHUFFLE(3,0,3,0));   // x0 x1 x2 x3
+      y2 = _mm_shuffle_ps (_mm_shuffle_ps (a2, b2, _MM_SHUFFLE(0,0,1,1)), _mm_shuffle_ps (b2, c2, _MM_SHUFFLE(2,2,3,3)), _MM_SHUFFLE(2,0,2,0));
+      z2 = _mm_shuffle_ps (t1, c2, _MM_SHUFFLE(3,0,3,0));   // z0 z1 z2 z3
+      // Same order of adds as gx3d_VectorMagnitude()
+      len2 = _mm_add_ps (_mm_add_ps (x2, y2), z2);
+      // Any zero (or too short for the reciprocal sqrt) vectors?  Use the single vector function on this group
+      if (_mm_movemask_ps ((accuracy == gx3d_ACCURACY_FAST) ? _mm_cmplt_ps (len2, tiny) : _mm_cmpeq_ps (len2, zero))) {
+        for (j=0; j<4; j++)
+          gx3d_NormalizeVector (&v[i+j], &normal[i+j], accuracy);
+        continue;
+      }
+      // Scale factors
+      if (accuracy == gx3d_ACCURACY_FAST) {
+        y = _mm_rsqrt_ps (len2);
+        s = _mm_mul_ps (_mm_mul_ps (half, y), _mm_sub_ps (three, _mm_mul_ps (_mm_mul_ps (len2, y), y)));
+      }
+      else
+        s = _mm_div_ps (_mm_set1_ps (1.0f), _mm_sqrt_ps (len2));
+      // Scale each vector by its scale factor
+      _mm_storeu_ps (&dst[0], _mm_mul_ps (a, _mm_shuffle_ps (s, s, _MM_SHUFFLE(1,0,0,0))));
+      _mm_storeu_ps (&dst[4], _mm_mul_ps (b, _mm_shuffle_ps (s, s, _MM_SHUFFLE(2,2,1,1))));
+      _mm_storeu_ps (&dst[8], _mm_mul_ps (c, _mm_shuffle_ps (s, s, _MM_SHUFFLE(3,3,3,2))));
+    }
+  }
+
+  // Normalize the rest one at a time
+  for (; i<num_vectors; i++)
+    gx3d_NormalizeVector (&v[i], &normal[i], accuracy);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_ReciprocalSqrt
+|
+| Output: Returns 1/sqrt(x).  x should be > 0.
+|
+| Description: gx3d_ACCURACY_EXACT computes 1/sqrtf(x).  
+|   gx3d_ACCURACY_FAST refines the SSE reciprocal sqrt estimate (which 
+|   has a relative error of up to 1.5*2^-12) with one Newton-Raphson 
+|   step.  This squares the error, so the result has a relative error
+|   of at most 4e-7 (about 7 ulps), compared to 1 ulp for exact.  x 
+|   must be at least FLT_MIN for the estimate to be valid.  Falls back
+|   to exact if the cpu doesn't support SSE2.
+|___________________________________________________________________*/
+
+float gx3d_ReciprocalSqrt (float x, gx3dAccuracy accuracy)
+{
+  float y;
+
+  DEBUG_ASSERT (x > 0);
+
+  if ((accuracy == gx3d_ACCURACY_FAST) AND (CPU_FEATURES & gx3d_CPU_SSE2) AND (x >= FLT_MIN)) {
+    y = _mm_cvtss_f32 (_mm_rsqrt_ss (_mm_set_ss (x)));
+    // Newton-Raphson step (same order of operations as gx3d_NormalizeVectorArray())
+    return ((0.5f * y) * (3.0f - (x * y) * y));
+  }
+  else
+    return (1 / sqrtf (x));
+}
+
 /*____________________________________________________________________
 |
 | Function: gx3d_VectorMagnitude
@@ -2123,3 +3030,19 @@ void gx3d_YZVectorToHeading (gx3dVector *v, float *heading)
   else
     *heading = 270 - atanf(v->z/-v->y) * RADIANS_TO_DEGREES;
 }
+
+/*____________________________________________________________________
+|
+| Function: Read_CPU_Features
+|
+| Input: Called from the functions that test CPU_FEATURES
+| Output: Copies the cpu features into CPU_features (marked as read) and
+|   returns them.
+|___________________________________________________________________*/
+
+static unsigned Read_CPU_Features ()
+{
+  CPU_features = gx3d_GetCPUFeatures () | CPU_FEATURES_READ;
+
+  return (CPU_features);
+}
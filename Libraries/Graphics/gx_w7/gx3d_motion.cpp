@@ -88,6 +88,8 @@
 
 static float ONE_OVER_THOUSAND = 1.0f / 1000.0f;
 
+#define SLERP_BATCH 64    // # bone rotations interpolated with one call to gx3d_GetSlerpQuaternions()
+
 /*___________________
 |
 | Function prototypes
@@ -470,6 +472,7 @@ gx3dMotion *gx3d_Motion_Copy (gx3dMotion *motion)
   new_motion->max_nkeys       = motion->max_nkeys;
   new_motion->duration        = motion->duration;
   new_motion->num_bones       = motion->num_bones;
+  new_motion->fast_slerp      = motion->fast_slerp;
   if (motion->bones) {
     // Create new array of bones
     new_motion->bones = (gx3dMotionBone *) malloc (motion->num_bones * sizeof(gx3dMotionBone));
@@ -914,17 +917,26 @@ bool gx3d_Motion_Update (gx3dMotion *motion, float local_time, bool repeat)
 | Output: Animates a bone including linked bones and child bones.
 |   Returns true if updated, else false if no changes.  Assumes bones
 |   in the array are ordered with no child before its parent.
+|
+| Description: The rotations of bones between 2 keys are gathered into
+|   batches and interpolated with gx3d_GetSlerpQuaternions(), exactly
+|   or with its fast approximation if motion->fast_slerp is set.
 |___________________________________________________________________*/
 
 static void Animate_Bones (gx3dMotion *motion, unsigned milliseconds)
 {
-  int i;
+  int i, j, n;
   int key, curkey;
   float t;
   gx3dMotionBone *bone;
   gx3dVector v;
   gx3dQuaternion q1, q2;
   gx3dCompressedQuaternion cq1, cq2;
+  gx3dQuaternionStream from, to;
+  gx3dLocalBonePose *pose;
+  int   batch_bone[SLERP_BATCH];
+  float from_x[SLERP_BATCH], from_y[SLERP_BATCH], from_z[SLERP_BATCH], from_w[SLERP_BATCH];
+  float to_x  [SLERP_BATCH], to_y  [SLERP_BATCH], to_z  [SLERP_BATCH], to_w  [SLERP_BATCH];
 
   DEBUG_ASSERT (motion)
   DEBUG_ASSERT (motion->output_local_pose)
@@ -939,6 +951,16 @@ static void Animate_Bones (gx3dMotion *motion, unsigned milliseconds)
   // Compute time between curkey and next key as a value between 0-1
   t = (float)(milliseconds * motion->keys_per_second % 1000) * ONE_OVER_THOUSAND;
 
+  from.x = from_x;
+  from.y = from_y;
+  from.z = from_z;
+  from.w = from_w;
+  to.x   = to_x;
+  to.y   = to_y;
+  to.z   = to_z;
+  to.w   = to_w;
+  n = 0;
+
 /*____________________________________________________________________
 |
 | Animate all bones
@@ -963,23 +985,43 @@ static void Animate_Bones (gx3dMotion *motion, unsigned milliseconds)
       if (key == bone->nkeys-1) {
         cq1 = bone->rot_key[key];
         DECOMPRESS_QUATERNION (cq1, q1)
+        motion->output_local_pose->bone_pose[i].q = q1;
       }
-      // Interpolate between 2 keys
+      // Interpolate between 2 keys (add to the batch)
       else {
         cq1 = bone->rot_key[key];                              
         DECOMPRESS_QUATERNION (cq1, q1)
         cq2 = bone->rot_key[key+1];
         DECOMPRESS_QUATERNION (cq2, q2)
-        gx3d_GetSlerpQuaternion (&q1, &q2, t, &q1);
-//        gx3d_NormalizeQuaternion (&q1);             // ********** Is this needed????? - nope, apparently not
+        batch_bone[n] = i;
+        from_x[n] = q1.x;
+        from_y[n] = q1.y;
+        from_z[n] = q1.z;
+        from_w[n] = q1.w;
+        to_x[n]   = q2.x;
+        to_y[n]   = q2.y;
+        to_z[n]   = q2.z;
+        to_w[n]   = q2.w;
+        n++;
       }
 		}
     // For inactive bones (bones with no keyframes) just use default bone pose (rotation)
 		else 
-      q1 = bone->qrotation;
-
-    // Output this quaternion
-    motion->output_local_pose->bone_pose[i].q = q1;
+      motion->output_local_pose->bone_pose[i].q = bone->qrotation;
+
+    // Interpolate the batch when full or after the last bone, outputting each quaternion
+    if ((n == SLERP_BATCH) OR (n AND (i == motion->num_bones-1))) {
+      gx3d_GetSlerpQuaternions (&from, &to, t, &from, n, NOT motion->fast_slerp);
+//      gx3d_NormalizeQuaternion (&q1);             // ********** Is this needed????? - nope, apparently not
+      for (j=0; j<n; j++) {
+        pose = &(motion->output_local_pose->bone_pose[batch_bone[j]]);
+        pose->q.x = from_x[j];
+        pose->q.y = from_y[j];
+        pose->q.z = from_z[j];
+        pose->q.w = from_w[j];
+      }
+      n = 0;
+    }
 
 /*____________________________________________________________________
 |
@@ -145,6 +145,7 @@ gx3dMotionSkeleton *gx3d_MotionSkeleton_Read_GX3DSKEL_File (char *filename)
 {
   int i;
   FILE *fp;
+  gx3dMatrix m;
   gx3dMotionSkeleton *skeleton = 0;
  
 /*____________________________________________________________________
@@ -176,10 +177,12 @@ gx3dMotionSkeleton *gx3d_MotionSkeleton_Read_GX3DSKEL_File (char *filename)
       TERMINAL_ERROR ("gx3d_MotionSkeleton_Read_GX3DSKEL_File(): can't allocate memory for bones array")
     // Read out each bone
     for (i=0; i<skeleton->num_bones; i++) {
-      // Read pre matrix
-      fread (&(skeleton->bones[i].pre), sizeof(gx3dMatrix), 1, fp);
+      // Read pre matrix (stored as a 4x4 matrix)
+      fread (&m, sizeof(gx3dMatrix), 1, fp);
+      gx3d_MatrixToAffineMatrix (&m, &(skeleton->bones[i].pre));
       // Read post matrix
-      fread (&(skeleton->bones[i].post), sizeof(gx3dMatrix), 1, fp);
+      fread (&m, sizeof(gx3dMatrix), 1, fp);
+      gx3d_MatrixToAffineMatrix (&m, &(skeleton->bones[i].post));
       // Read name
       fread (skeleton->bones[i].name, sizeof(char), gx_ASCIIZ_STRING_LENGTH_LONG, fp);
       // Read parent
@@ -318,6 +321,7 @@ void gx3d_MotionSkeleton_Write_GX3DSKEL_File (gx3dMotionSkeleton *skeleton, char
 {
   int i;
   FILE *fp;
+  gx3dMatrix m;
 
 /*____________________________________________________________________
 |
@@ -341,10 +345,12 @@ void gx3d_MotionSkeleton_Write_GX3DSKEL_File (gx3dMotionSkeleton *skeleton, char
     fwrite (&(skeleton->num_bones), sizeof(int), 1, fp);
     // Write out each bone
     for (i=0; i<skeleton->num_bones; i++) {
-      // Write pre matrix
-      fwrite (&(skeleton->bones[i].pre), sizeof(gx3dMatrix), 1, fp);
+      // Write pre matrix (stored as a 4x4 matrix)
+      gx3d_AffineMatrixToMatrix (&(skeleton->bones[i].pre), &m);
+      fwrite (&m, sizeof(gx3dMatrix), 1, fp);
       // Write post matrix
-      fwrite (&(skeleton->bones[i].post), sizeof(gx3dMatrix), 1, fp);
+      gx3d_AffineMatrixToMatrix (&(skeleton->bones[i].post), &m);
+      fwrite (&m, sizeof(gx3dMatrix), 1, fp);
       // Write name
       fwrite (skeleton->bones[i].name, sizeof(char), gx_ASCIIZ_STRING_LENGTH_LONG, fp);
       // Write parent
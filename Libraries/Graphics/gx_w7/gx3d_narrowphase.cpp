@@ -0,0 +1,455 @@
+/*____________________________________________________________________
+|
+| File: gx3d_narrowphase.cpp
+|
+| Description: Functions to manipulate gx3dNarrowphase.
+|
+| Functions: gx3d_Narrowphase_Init
+|            gx3d_Narrowphase_Free
+|            gx3d_Narrowphase_Collide
+|             Collide_Chunk
+|              Collide_Shapes
+|               Overlap
+|
+| Description: A narrowphase runs the exact collision tests for a list
+|   of pairs of shapes (usually the overlapping pairs found by a
+|   broadphase).  The correct gx3d_Relation_*() and gx3d_Collide_*()
+|   function is called for each pair based on the shape types.
+|
+|   The pair list is split into chunks of a fixed size that are handed
+|   out to a pool of worker threads (plus the calling thread) in any
+|   order (see gx3d_jobpool.cpp).  Each chunk writes its contacts to its own part of the
+|   contact array, which has room for one contact per pair, so no
+|   memory is allocated while the tests run.  The chunks are then packed
+|   together in order, so the contacts are always returned in pair order
+|   no matter how many threads are used or which thread ran each chunk.
+|
+|   Typical use each frame: update the shapes (position at the start of
+|   the frame and movement during it), update a broadphase with their
+|   swept bound boxes, then call gx3d_Narrowphase_Collide() with the
+|   shapes and broadphase->pair.
+|
+| (C) Copyright 2017 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|
+| DEBUG_ASSERTED!
+|___________________________________________________________________*/
+
+//#define DEBUG
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+
+#include <math.h>
+
+#include "dp.h"
+
+#include "gx3d_jobpool.h"
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define CHUNK_PAIRS             256   // # pairs tested as one unit of work
+#define PARALLEL_MIN_PAIRS      1024  // test fewer pairs than this on the calling thread
+
+/*___________________
+|
+| Macros
+|__________________*/
+
+#define OVERLAP(_relation_) (((_relation_) == gxRELATION_INTERSECT) OR ((_relation_) == gxRELATION_INSIDE))
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+// Pairs to test (see gx3d_Narrowphase_Collide())
+typedef struct {
+  gx3dNarrowphase    *narrowphase;
+  gx3dCollisionShape *shapes;
+  gx3dBroadphasePair *pairs;
+  int                 num_pairs;
+} Job;
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static void Collide_Chunk (void *job, int chunk);
+static bool Collide_Shapes (gx3dCollisionShape *shape1, gx3dCollisionShape *shape2, float *time);
+static bool Overlap (gx3dCollisionShape *shape1, gx3dCollisionShape *shape2);
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Narrowphase_Init
+|
+| Output: Creates a narrowphase that uses num_threads threads (including
+|   the calling thread) to test pairs.  If num_threads is 0, uses one
+|   thread per processor.
+|___________________________________________________________________*/
+
+gx3dNarrowphase *gx3d_Narrowphase_Init (int num_threads)
+{
+  gx3dJobPool *pool;
+  bool error;
+  gx3dNarrowphase *narrowphase = 0;
+
+  error = false;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (num_threads >= 0);
+
+/*____________________________________________________________________
+|
+| Allocate memory
+|___________________________________________________________________*/
+
+  narrowphase = (gx3dNarrowphase *) calloc (1, sizeof(gx3dNarrowphase));
+  if (narrowphase == 0)
+    error = true;
+
+/*____________________________________________________________________
+|
+| Start worker threads
+|___________________________________________________________________*/
+
+  if (NOT error) {
+    pool = gx3d_JobPool_Init (num_threads);
+    if (pool == 0)
+      error = true;
+    else {
+      narrowphase->thread_data = pool;
+      narrowphase->num_threads = pool->num_workers + 1;
+    }
+  }
+
+/*____________________________________________________________________
+|
+| On any error, free memory
+|___________________________________________________________________*/
+
+  if (error) {
+    gx3d_Narrowphase_Free (narrowphase);
+    narrowphase = 0;
+  }
+
+  return (narrowphase);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Narrowphase_Free
+|
+| Output: Stops the worker threads and frees all memory for a
+|   narrowphase.
+|___________________________________________________________________*/
+
+void gx3d_Narrowphase_Free (gx3dNarrowphase *narrowphase)
+{
+  if (narrowphase) {
+    gx3d_JobPool_Free ((gx3dJobPool *)narrowphase->thread_data);
+    if (narrowphase->contact)
+      free (narrowphase->contact);
+    if (narrowphase->chunk_contacts)
+      free (narrowphase->chunk_contacts);
+    free (narrowphase);
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Narrowphase_Collide
+|
+| Output: Tests each pair of shapes for a collision during the time
+|   period the shapes move.  Returns # of contacts found (in
+|   narrowphase->contact, in the same order as the pairs) or -1 on any
+|   error.
+|
+|   The contacts are the same no matter how many threads are used.
+|___________________________________________________________________*/
+
+int gx3d_Narrowphase_Collide (
+  gx3dNarrowphase    *narrowphase,
+  gx3dCollisionShape *shapes,
+  gx3dBroadphasePair *pairs,
+  int                 num_pairs )
+{
+  int i, num_chunks, max_contacts;
+  gx3dContact *contact;
+  int *chunk_contacts;
+  Job job;
+  int num_contacts = -1;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (narrowphase);
+  DEBUG_ASSERT (shapes OR (num_pairs == 0));
+  DEBUG_ASSERT (pairs OR (num_pairs == 0));
+  DEBUG_ASSERT (num_pairs >= 0);
+
+/*____________________________________________________________________
+|
+| Make room for 1 contact per pair
+|___________________________________________________________________*/
+
+  num_chunks = (num_pairs + CHUNK_PAIRS - 1) / CHUNK_PAIRS;
+  if (num_chunks * CHUNK_PAIRS > narrowphase->max_contacts) {
+    max_contacts = num_chunks * CHUNK_PAIRS;
+    contact = (gx3dContact *) realloc (narrowphase->contact, max_contacts * sizeof(gx3dContact));
+    if (contact)
+      narrowphase->contact = contact;
+    chunk_contacts = (int *) realloc (narrowphase->chunk_contacts, num_chunks * sizeof(int));
+    if (chunk_contacts)
+      narrowphase->chunk_contacts = chunk_contacts;
+    if (contact AND chunk_contacts)
+      narrowphase->max_contacts = max_contacts;
+    else
+      gxError ("gx3d_Narrowphase_Collide(): Can't allocate memory");
+  }
+
+/*____________________________________________________________________
+|
+| Test all chunks of pairs
+|___________________________________________________________________*/
+
+  if (num_chunks * CHUNK_PAIRS <= narrowphase->max_contacts) {
+    job.narrowphase = narrowphase;
+    job.shapes      = shapes;
+    job.pairs       = pairs;
+    job.num_pairs   = num_pairs;
+    // Not worth waking the worker threads for a few pairs?
+    if (num_pairs < PARALLEL_MIN_PAIRS)
+      for (i=0; i<num_chunks; i++)
+        Collide_Chunk (&job, i);
+    else
+      gx3d_JobPool_Run ((gx3dJobPool *)narrowphase->thread_data, Collide_Chunk, &job, num_chunks);
+
+/*____________________________________________________________________
+|
+| Pack the contacts of all chunks together in order
+|___________________________________________________________________*/
+
+    num_contacts = 0;
+    for (i=0; i<num_chunks; i++) {
+      if (narrowphase->chunk_contacts[i] AND (num_contacts != i * CHUNK_PAIRS))
+        memmove (&(narrowphase->contact[num_contacts]), &(narrowphase->contact[i * CHUNK_PAIRS]), narrowphase->chunk_contacts[i] * sizeof(gx3dContact));
+      num_contacts += narrowphase->chunk_contacts[i];
+    }
+    narrowphase->num_contacts = num_contacts;
+  }
+
+  return (num_contacts);
+}
+
+/*____________________________________________________________________
+|
+| Function: Collide_Chunk
+|
+| Input: Called from gx3d_Narrowphase_Collide() (or by gx3d_JobPool_Run())
+| Output: Tests one chunk of pairs, putting its contacts in its own part
+|   of the contact array.
+|___________________________________________________________________*/
+
+static void Collide_Chunk (void *job, int chunk)
+{
+  int i, first, last;
+  float time;
+  gx3dBroadphasePair *pair;
+  gx3dContact *contact;
+  Job *data = (Job *)job;
+
+  first = chunk * CHUNK_PAIRS;
+  last  = first + CHUNK_PAIRS;
+  if (last > data->num_pairs)
+    last = data->num_pairs;
+  contact = &(data->narrowphase->contact[first]);
+
+  for (i=first; i<last; i++) {
+    pair = &(data->pairs[i]);
+    if (Collide_Shapes (&(data->shapes[pair->proxy1]), &(data->shapes[pair->proxy2]), &time)) {
+      contact->pair   = i;
+      contact->shape1 = pair->proxy1;
+      contact->shape2 = pair->proxy2;
+      contact->time   = time;
+      contact++;
+    }
+  }
+
+  data->narrowphase->chunk_contacts[chunk] = (int)(contact - &(data->narrowphase->contact[first]));
+}
+
+/*____________________________________________________________________
+|
+| Function: Collide_Shapes
+|
+| Input: Called from Collide_Chunk()
+| Output: Returns true if two shapes collide during the time period and
+|   the parametric collision time (0 if already intersecting).
+|
+| Description: The shapes are tested with the gx3d_Relation_*()
+|   function for their types at the start of the period.  If not
+|   intersecting, the first shape is moved relative to the second,
+|   which is treated as static, using the gx3d_Collide_*() function for
+|   their types.  Pairs with no gx3d_Collide_*() function (box/triangle,
+|   plane/triangle, triangle/triangle) are only tested at the start of
+|   the period.  Pairs of planes never collide.  Planes are two-sided.
+|___________________________________________________________________*/
+
+static bool Collide_Shapes (gx3dCollisionShape *shape1, gx3dCollisionShape *shape2, float *time)
+{
+  gx3dVector v;
+  gx3dTrajectory trajectory;
+  gx3dPlane plane;
+  gx3dCollisionShape *temp;
+  gxRelation result = gxRELATION_OUTSIDE;
+
+  // Put the shapes in order of type
+  if (shape1->type > shape2->type) {
+    temp   = shape1;
+    shape1 = shape2;
+    shape2 = temp;
+  }
+
+  // Already intersecting?
+  if (Overlap (shape1, shape2)) {
+    *time = 0;
+    return (true);
+  }
+
+  // Compute the trajectory of shape1 relative to shape2
+  gx3d_SubtractVector (&(shape1->movement), &(shape2->movement), &v);
+  gx3d_NormalizeVector (&v, &trajectory.direction, &trajectory.velocity);
+  if (trajectory.velocity == 0)
+    return (false);
+
+  switch (shape1->type) {
+    case gx3d_COLLISION_SHAPE_SPHERE:
+      switch (shape2->type) {
+        case gx3d_COLLISION_SHAPE_SPHERE:
+          result = gx3d_Collide_Sphere_StaticSphere (&(shape1->sphere), &trajectory, 1, &(shape2->sphere), time);
+          break;
+        case gx3d_COLLISION_SHAPE_BOX:
+          result = gx3d_Collide_Sphere_StaticBox (&(shape1->sphere), &trajectory, 1, &(shape2->box), time);
+          break;
+        case gx3d_COLLISION_SHAPE_PLANE:
+          // Make the plane face the sphere (gx3d_Collide_Sphere_StaticPlane() treats the back side as solid)
+          plane = shape2->plane;
+          if (gx3d_Distance_Point_Plane (&(shape1->sphere.center), &plane) < 0) {
+            gx3d_NegateVector (&(plane.n), &(plane.n));
+            plane.d = -plane.d;
+          }
+          result = gx3d_Collide_Sphere_StaticPlane (&(shape1->sphere), &trajectory, 1, &plane, time);
+          break;
+        case gx3d_COLLISION_SHAPE_TRIANGLE:
+          result = gx3d_Collide_Sphere_StaticTriangle (&(shape1->sphere), &trajectory, 1, shape2->triangle, time);
+          break;
+        default:
+          DEBUG_ERROR ("Collide_Shapes(): invalid shape type")
+          break;
+      }
+      break;
+    case gx3d_COLLISION_SHAPE_BOX:
+      switch (shape2->type) {
+        case gx3d_COLLISION_SHAPE_BOX:
+          result = gx3d_Collide_Box_StaticBox (&(shape1->box), &trajectory, 1, &(shape2->box), time);
+          break;
+        case gx3d_COLLISION_SHAPE_PLANE:
+          result = gx3d_Collide_Box_StaticPlane (&(shape1->box), &trajectory, 1, &(shape2->plane), time);
+          break;
+        case gx3d_COLLISION_SHAPE_TRIANGLE:
+          // No gx3d_Collide_*() function, only tested at start of period
+          break;
+        default:
+          DEBUG_ERROR ("Collide_Shapes(): invalid shape type")
+          break;
+      }
+      break;
+    case gx3d_COLLISION_SHAPE_PLANE:
+    case gx3d_COLLISION_SHAPE_TRIANGLE:
+      // No gx3d_Collide_*() function, only tested at start of period
+      break;
+    default:
+      DEBUG_ERROR ("Collide_Shapes(): invalid shape type")
+      break;
+  }
+
+  return (result == gxRELATION_INTERSECT);
+}
+
+/*____________________________________________________________________
+|
+| Function: Overlap
+|
+| Input: Called from Collide_Shapes()
+| Output: Returns true if two shapes (in order of type) are intersecting.
+|___________________________________________________________________*/
+
+static bool Overlap (gx3dCollisionShape *shape1, gx3dCollisionShape *shape2)
+{
+  gxRelation result = gxRELATION_OUTSIDE;
+
+  switch (shape1->type) {
+    case gx3d_COLLISION_SHAPE_SPHERE:
+      switch (shape2->type) {
+        case gx3d_COLLISION_SHAPE_SPHERE:
+          result = gx3d_Relation_Sphere_Sphere (&(shape1->sphere), &(shape2->sphere), true);
+          break;
+        case gx3d_COLLISION_SHAPE_BOX:
+          result = gx3d_Relation_Box_Sphere (&(shape2->box), &(shape1->sphere));
+          break;
+        case gx3d_COLLISION_SHAPE_PLANE:
+          result = gx3d_Relation_Sphere_Plane (&(shape1->sphere), &(shape2->plane));
+          break;
+        case gx3d_COLLISION_SHAPE_TRIANGLE:
+          result = gx3d_Relation_Triangle_Sphere (shape2->triangle, &(shape1->sphere));
+          break;
+        default:
+          DEBUG_ERROR ("Overlap(): invalid shape type")
+          break;
+      }
+      break;
+    case gx3d_COLLISION_SHAPE_BOX:
+      switch (shape2->type) {
+        case gx3d_COLLISION_SHAPE_BOX:
+          result = gx3d_Relation_Box_Box (&(shape1->box), &(shape2->box));
+          break;
+        case gx3d_COLLISION_SHAPE_PLANE:
+          result = gx3d_Relation_Box_Plane (&(shape1->box), &(shape2->plane));
+          break;
+        case gx3d_COLLISION_SHAPE_TRIANGLE:
+          result = gx3d_Relation_Triangle_Box (shape2->triangle, &(shape1->box));
+          break;
+        default:
+          DEBUG_ERROR ("Overlap(): invalid shape type")
+          break;
+      }
+      break;
+    case gx3d_COLLISION_SHAPE_PLANE:
+      if (shape2->type == gx3d_COLLISION_SHAPE_TRIANGLE)
+        result = gx3d_Relation_Triangle_Plane (shape2->triangle, &(shape1->plane));
+      break;
+    case gx3d_COLLISION_SHAPE_TRIANGLE:
+      result = gx3d_Relation_Triangle_Triangle (shape1->triangle, shape2->triangle);
+      break;
+    default:
+      DEBUG_ERROR ("Overlap(): invalid shape type")
+      break;
+  }
+
+  return (OVERLAP(result));
+}
@@ -322,16 +322,17 @@ void gx3d_Nearest_Point_Box (gx3dVector *point, gx3dBox *box, gx3dVector *neares
 |
 | Output: Returns the nearest point on a triangle from a given point.
 |
-| Reference: 3D Math for Graphics and Game Development (pg. 286)
+| Description: Determines which feature region (vertex, edge or face) 
+|   of the triangle the point projects into and returns the nearest 
+|   point on that feature.
+|
+| Reference: Real-Time Collision Detection, pg. 141
 |___________________________________________________________________*/
 
 void gx3d_Nearest_Point_Triangle (gx3dVector *point, gx3dVector *vertices, gx3dVector *nearest_point)
 {
-  int i, s, e, nearest, edge_intersect[3], num_edge_intersect;
-  float d, distance, nearest_distance_squared;
-  gx3dVector v, edge;
-  gx3dPlane plane;
-  gx3dLine line;
+  float d1, d2, d3, d4, d5, d6, va, vb, vc, v, w, denom;
+  gx3dVector ab, ac, ap, bp, cp;
 
 /*____________________________________________________________________
 |
@@ -344,95 +345,74 @@ void gx3d_Nearest_Point_Triangle (gx3dVector *point, gx3dVector *vertices, gx3dV
 
 /*____________________________________________________________________
 |
-| Init variables
+| Main procedure
 |___________________________________________________________________*/
 
-  // Determine triangle vertex that is nearest to point
-  nearest = 0;
-  nearest_distance_squared = gx3d_DistanceSquared_Point_Point (point, &vertices[nearest]);
-  for (i=1; i<3; i++) {
-    d = gx3d_DistanceSquared_Point_Point (point, &vertices[i]);
-    if (d < nearest_distance_squared) {
-      nearest = i;
-      nearest_distance_squared = d;
-    }
-  }
+  gx3d_SubtractVector (&vertices[1], &vertices[0], &ab);
+  gx3d_SubtractVector (&vertices[2], &vertices[0], &ac);
 
-  // Compute a vector from nearest vertex to point
-  gx3d_SubtractVector (point, &vertices[nearest], &v);
-
-  // Determine which edges intersect sphere surrounding point - check first two edges connected to nearest vertex
-  for (i=0, num_edge_intersect=0; i<2; i++) {
-    gx3d_SubtractVector (&vertices[nearest+i%3], &vertices[nearest], &edge);
-    if (gx3d_VectorDotProduct (&v, &edge) > 0) {
-      edge_intersect[i] = 1;
-      num_edge_intersect++;
-    }
-    else
-      edge_intersect[i] = 0;
+  // Check if point in vertex region outside vertex 0
+  gx3d_SubtractVector (point, &vertices[0], &ap);
+  d1 = gx3d_VectorDotProduct (&ab, &ap);
+  d2 = gx3d_VectorDotProduct (&ac, &ap);
+  if ((d1 <= 0) AND (d2 <= 0)) {
+    *nearest_point = vertices[0];
+    return;
   }
-  // Check third edge only if first two don't both intersect the sphere
-  if (num_edge_intersect < 2) {
-    line.start = vertices[nearest+1%3];
-    line.end   = vertices[nearest+2%3];
-    gx3d_Nearest_Point_Line (point, &line, &v);
-    if (gx3d_DistanceSquared_Point_Point (point, &v) <= nearest_distance_squared) {
-      edge_intersect[2] = 1;
-      num_edge_intersect++;
-    }
-    else
-      edge_intersect[2] = 0;
-  }
-  else
-    edge_intersect[2] = 0;
 
-/*____________________________________________________________________
-|
-| Find nearest point on the plane of the triangle
-|___________________________________________________________________*/
-
-  if (num_edge_intersect >= 2) {
-    // Compute the plane formed by the triangle
-    gx3d_GetPlane (&vertices[0], &vertices[1], &vertices[2], &plane);
-    distance = gx3d_Distance_Point_Plane (point, &plane);
-    // Multiply the -distance by the plane normal to get offset from point to plane
-    gx3d_MultiplyScalarVector (-distance, &plane.n, &v);
-    // Add this amount to point to get the nearest point on the plane
-    gx3d_AddVector (point, &v, nearest_point);
+  // Check if point in vertex region outside vertex 1
+  gx3d_SubtractVector (point, &vertices[1], &bp);
+  d3 = gx3d_VectorDotProduct (&ab, &bp);
+  d4 = gx3d_VectorDotProduct (&ac, &bp);
+  if ((d3 >= 0) AND (d4 <= d3)) {
+    *nearest_point = vertices[1];
+    return;
   }
 
-/*____________________________________________________________________
-|
-| Find nearest point on the line formed by two points of the triangle
-|___________________________________________________________________*/
+  // Check if point in edge region of edge 0-1
+  vc = d1*d4 - d3*d2;
+  if ((vc <= 0) AND (d1 >= 0) AND (d3 <= 0)) {
+    v = d1 / (d1 - d3);
+    nearest_point->x = vertices[0].x + v * ab.x;
+    nearest_point->y = vertices[0].y + v * ab.y;
+    nearest_point->z = vertices[0].z + v * ab.z;
+    return;
+  }
 
-  else if (num_edge_intersect == 1) {
-    for (i=0; i<3; i++) 
-      if (edge_intersect[i]) {
-        switch (i) {
-          case 0:
-          case 1: s = nearest;
-                  e = nearest+i%3;
-                  break;
-          case 2: s = nearest+1%3;
-                  e = nearest+2%3;
-                  break;
-        }
-        line.start = vertices[s];
-        line.end   = vertices[e];
-        gx3d_Nearest_Point_Line (point, &line, nearest_point);
-//        distance = gx3d_Distance_Point_Point (point, nearest_point);
-        break;
-      }
+  // Check if point in vertex region outside vertex 2
+  gx3d_SubtractVector (point, &vertices[2], &cp);
+  d5 = gx3d_VectorDotProduct (&ab, &cp);
+  d6 = gx3d_VectorDotProduct (&ac, &cp);
+  if ((d6 >= 0) AND (d5 <= d6)) {
+    *nearest_point = vertices[2];
+    return;
   }
 
-/*____________________________________________________________________
-|
-| Nearest point is nearest point on the triangle
-|___________________________________________________________________*/
+  // Check if point in edge region of edge 0-2
+  vb = d5*d2 - d1*d6;
+  if ((vb <= 0) AND (d2 >= 0) AND (d6 <= 0)) {
+    w = d2 / (d2 - d6);
+    nearest_point->x = vertices[0].x + w * ac.x;
+    nearest_point->y = vertices[0].y + w * ac.y;
+    nearest_point->z = vertices[0].z + w * ac.z;
+    return;
+  }
 
-  else {
-    *nearest_point = vertices[nearest];
-//    nearest_distance_squared = sqrtf (nearest_distance_squared);
+  // Check if point in edge region of edge 1-2
+  va = d3*d6 - d5*d4;
+  if ((va <= 0) AND ((d4 - d3) >= 0) AND ((d5 - d6) >= 0)) {
+    w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    nearest_point->x = vertices[1].x + w * (vertices[2].x - vertices[1].x);
+    nearest_point->y = vertices[1].y + w * (vertices[2].y - vertices[1].y);
+    nearest_point->z = vertices[1].z + w * (vertices[2].z - vertices[1].z);
+    return;
   }
+
+  // Point is inside face region (compute using barycentric coordinates)
+  denom = 1 / (va + vb + vc);
+  v = vb * denom;
+  w = vc * denom;
+  nearest_point->x = vertices[0].x + ab.x * v + ac.x * w;
+  nearest_point->y = vertices[0].y + ab.y * v + ac.y * w;
+  nearest_point->z = vertices[0].z + ab.z * v + ac.z * w;
 }
@@ -48,6 +48,7 @@
 |
 |            gx3d_WriteGX3DBINFile
 |            gx3d_ReadGX3DBINFile
+|            gx3d_ReadGX3DBINBoxtree
 |
 |            gx3d_ObjectBoundBoxVisible
 |            gx3d_ObjectBoundSphereVisible
@@ -95,6 +96,11 @@
 | Constants
 |__________________*/
 
+// Accuracy used to renormalize X_vertex_normal.  The X arrays are rebuilt
+//   from the original normals on every update, so errors don't build up
+//   and the fast version is accurate enough.
+#define X_NORMAL_ACCURACY gx3d_ACCURACY_FAST
+
 #define ADD_TO_OBJECTLIST(_obj_)    \
   {                                 \
     if (objectlist == 0)            \
@@ -130,7 +136,7 @@ static void GetObjectInfo_Layer (gx3dObjectLayer *layer, int *num_layers, int *n
 static void Draw_Layer (gx3dObjectLayer *layer, unsigned flags, bool draw_one_layer_only);
 static void Update_Layer_Vertices (gx3dObjectLayer *layer);
 static void Update_Layer_Morphs (gx3dObjectLayer *layer);
-static void Update_Layer_Transforms (gx3dObjectLayer *layer, gx3dMatrix *parent_matrix, int parent_transform_dirty);
+static void Update_Layer_Transforms (gx3dObjectLayer *layer, gx3dAffineMatrix *parent_matrix, int parent_transform_dirty);
 static gx3dObjectLayer *Get_Layer_With_Name (gx3dObjectLayer *layer, char *);
 static void TwistX_Layer   (gx3dObjectLayer *layer, float twist_rate);
 static void TwistY_Layer   (gx3dObjectLayer *layer, float twist_rate);
@@ -164,8 +170,8 @@ gx3dObject *gx3d_CreateObject ()
   object = (gx3dObject *) calloc (1, sizeof(gx3dObject));
   if (object) {
     // Init transforms
-    gx3d_GetIdentityMatrix (&(object->transform.local_matrix));
-    gx3d_GetIdentityMatrix (&(object->transform.composite_matrix));
+    gx3d_GetIdentityAffineMatrix (&(object->transform.local_matrix));
+    gx3d_GetIdentityAffineMatrix (&(object->transform.composite_matrix));
  		// Add to objectlist
 		ADD_TO_OBJECTLIST (object);
  }
@@ -209,8 +215,8 @@ gx3dObjectLayer *gx3d_CreateObjectLayer (gx3dObject *object)
   layer = (gx3dObjectLayer *) calloc (1, sizeof(gx3dObjectLayer));
   if (layer) {
     // Init transforms
-    gx3d_GetIdentityMatrix (&(layer->transform.local_matrix));
-    gx3d_GetIdentityMatrix (&(layer->transform.composite_matrix));
+    gx3d_GetIdentityAffineMatrix (&(layer->transform.local_matrix));
+    gx3d_GetIdentityAffineMatrix (&(layer->transform.composite_matrix));
     // Find a unique id for this layer
     if (object->layer == 0)
       layer->id = 1;
@@ -405,6 +411,9 @@ static void Free_Layer (gx3dObjectLayer *layer)
     }
     if (layer->composite_morph)
       free (layer->composite_morph);
+    // Free convex hull, if any
+    if (layer->convex_hull)
+      gx3d_ConvexHull_Free (layer->convex_hull);
     // Free textures
     for (i=0; i<gx3d_NUM_TEXTURE_STAGES; i++) 
       if (layer->texture[i])
@@ -1037,6 +1046,7 @@ void gx3d_DrawObjectLayer (gx3dObjectLayer *layer, unsigned flags)
 static void Draw_Layer (gx3dObjectLayer *layer, unsigned flags, bool draw_one_layer_only)
 {
   int i;
+  gx3dMatrix m;
 
 /*____________________________________________________________________
 |
@@ -1063,8 +1073,10 @@ static void Draw_Layer (gx3dObjectLayer *layer, unsigned flags, bool draw_one_la
         gx3d_SetTexture (i, layer->texture[i]);
 
     // Set local matrix for this layer?
-    if (NOT (flags & gx3d_DONT_SET_LOCAL_MATRIX)) 
-      gx3d_SetWorldMatrix (&(layer->transform.composite_matrix));
+    if (NOT (flags & gx3d_DONT_SET_LOCAL_MATRIX)) {
+      gx3d_AffineMatrixToMatrix (&(layer->transform.composite_matrix), &m);
+      gx3d_SetWorldMatrix (&m);
+    }
 
     // Register layer?
     if (layer->driver_data == 0) {
@@ -1232,8 +1244,9 @@ static void Update_Layer_Vertices (gx3dObjectLayer *layer)
             layer->X_vertex_normal[i].y += (v.y * weight->value[j]);
             layer->X_vertex_normal[i].z += (v.z * weight->value[j]);
           }
-          gx3d_NormalizeVector (&(layer->X_vertex_normal[i]), &(layer->X_vertex_normal[i]));
         }
+        // Normalize the blended normals
+        gx3d_NormalizeVectorArray (layer->X_vertex_normal, layer->X_vertex_normal, layer->num_vertices, X_NORMAL_ACCURACY);
       }
     }
   }
@@ -1284,7 +1297,7 @@ static void Update_Layer_Morphs (gx3dObjectLayer *layer)
 | Output: Updates layer transforms including linked layers and child layers.
 |___________________________________________________________________*/
 
-static void Update_Layer_Transforms (gx3dObjectLayer *layer, gx3dMatrix *parent_matrix, int parent_transform_dirty)
+static void Update_Layer_Transforms (gx3dObjectLayer *layer, gx3dAffineMatrix *parent_matrix, int parent_transform_dirty)
 {
 
 /*____________________________________________________________________
@@ -1304,7 +1317,7 @@ static void Update_Layer_Transforms (gx3dObjectLayer *layer, gx3dMatrix *parent_
     // Update layer transform?
     if (layer->transform.dirty OR parent_transform_dirty) { 
       // Composite matrix = local matrix * parent matrix
-      gx3d_MultiplyMatrix (&(layer->transform.local_matrix), parent_matrix, &(layer->transform.composite_matrix));
+      gx3d_MultiplyAffineMatrix (&(layer->transform.local_matrix), parent_matrix, &(layer->transform.composite_matrix));
       layer->transform.dirty = TRUE;
     }
     // Update child layer/s
@@ -1405,6 +1418,7 @@ static gx3dObjectLayer *Get_Layer_With_Name (gx3dObjectLayer *layer, char *name)
 
 void gx3d_SetObjectMatrix (gx3dObject *object, gx3dMatrix *m)
 {
+  gx3dAffineMatrix a;
 
 /*____________________________________________________________________
 |
@@ -1420,9 +1434,10 @@ void gx3d_SetObjectMatrix (gx3dObject *object, gx3dMatrix *m)
 |___________________________________________________________________*/
 
   // Is the new matrix different from the current local matrix?
-  if (memcmp ((void *)&(object->transform.local_matrix), (void *)m, sizeof(gx3dMatrix)) != 0) {
+  gx3d_MatrixToAffineMatrix (m, &a);
+  if (memcmp ((void *)&(object->transform.local_matrix), (void *)&a, sizeof(gx3dAffineMatrix)) != 0) {
     // Set new local matrix
-    memcpy ((void *)&(object->transform.local_matrix), (void *)m, sizeof(gx3dMatrix));
+    memcpy ((void *)&(object->transform.local_matrix), (void *)&a, sizeof(gx3dAffineMatrix));
     object->transform.dirty = TRUE;
 //    // Set object's dynamic boxtree, if any, to dirty
 //    if (object->boxtree)
@@ -1441,6 +1456,7 @@ void gx3d_SetObjectMatrix (gx3dObject *object, gx3dMatrix *m)
 void gx3d_SetObjectLayerMatrix (gx3dObject *object, gx3dObjectLayer *layer, gx3dMatrix *m)
 {
   gx3dMatrix m1, m2;
+  gx3dAffineMatrix a;
 
 /*____________________________________________________________________
 |
@@ -1457,12 +1473,14 @@ void gx3d_SetObjectLayerMatrix (gx3dObject *object, gx3dObjectLayer *layer, gx3d
 |___________________________________________________________________*/
 
   // Is the new matrix different from the current local matrix?
-  if (memcmp ((void *)&(layer->transform.local_matrix), (void *)m, sizeof(gx3dMatrix)) != 0) {
+  gx3d_MatrixToAffineMatrix (m, &a);
+  if (memcmp ((void *)&(layer->transform.local_matrix), (void *)&a, sizeof(gx3dAffineMatrix)) != 0) {
     // Set new local matrix
     gx3d_GetTranslateMatrix (&m1, -layer->pivot.x, -layer->pivot.y, -layer->pivot.z);
     gx3d_GetTranslateMatrix (&m2,  layer->pivot.x,  layer->pivot.y,  layer->pivot.z);
     gx3d_MultiplyMatrix (&m1, m, &m1);
-    gx3d_MultiplyMatrix (&m1, &m2, &(layer->transform.local_matrix));
+    gx3d_MultiplyMatrix (&m1, &m2, &m1);
+    gx3d_MatrixToAffineMatrix (&m1, &(layer->transform.local_matrix));
     layer->transform.dirty = TRUE;
 //    // Set object's dynamic boxtree, if any, to dirty
 //    if (object->boxtree)
@@ -1553,8 +1571,9 @@ static void TwistX_Layer (gx3dObjectLayer *layer, float twist_rate)
         layer->X_vertex_normal[i].x = layer->vertex_normal[i].x;
         layer->X_vertex_normal[i].y = (layer->vertex_normal[i].y * c) - (layer->vertex_normal[i].z * s);
         layer->X_vertex_normal[i].z = (layer->vertex_normal[i].y * s) + (layer->vertex_normal[i].z * c);
-        gx3d_NormalizeVector (&(layer->X_vertex_normal[i]), &(layer->X_vertex_normal[i]));
       }
+      // Renormalize the normals
+      gx3d_NormalizeVectorArray (layer->X_vertex_normal, layer->X_vertex_normal, layer->num_vertices, X_NORMAL_ACCURACY);
     }
     // On any error, delete X arrays
     else {
@@ -1652,8 +1671,9 @@ static void TwistY_Layer (gx3dObjectLayer *layer, float twist_rate)
         layer->X_vertex_normal[i].x = (layer->vertex_normal[i].z * s) + (layer->vertex_normal[i].x * c);
         layer->X_vertex_normal[i].y = layer->vertex_normal[i].y;
         layer->X_vertex_normal[i].z = (layer->vertex_normal[i].z * c) - (layer->vertex_normal[i].x * s);
-        gx3d_NormalizeVector (&(layer->X_vertex_normal[i]), &(layer->X_vertex_normal[i]));
       }
+      // Renormalize the normals
+      gx3d_NormalizeVectorArray (layer->X_vertex_normal, layer->X_vertex_normal, layer->num_vertices, X_NORMAL_ACCURACY);
     }
     // On any error, delete X arrays
     else {
@@ -1751,8 +1771,9 @@ static void TwistZ_Layer (gx3dObjectLayer *layer, float twist_rate)
         layer->X_vertex_normal[i].x = (layer->vertex_normal[i].x * c) - (layer->vertex_normal[i].y * s);
         layer->X_vertex_normal[i].y = (layer->vertex_normal[i].x * s) + (layer->vertex_normal[i].y * c);
         layer->X_vertex_normal[i].z = layer->vertex_normal[i].z;
-        gx3d_NormalizeVector (&(layer->X_vertex_normal[i]), &(layer->X_vertex_normal[i]));
       }
+      // Renormalize the normals
+      gx3d_NormalizeVectorArray (layer->X_vertex_normal, layer->X_vertex_normal, layer->num_vertices, X_NORMAL_ACCURACY);
     }
     // On any error, delete X arrays
     else {
@@ -1806,7 +1827,7 @@ void gx3d_TransformObject (gx3dObject *object, gx3dMatrix *m)
 
 void gx3d_TransformObjectLayer (gx3dObjectLayer *layer, gx3dMatrix *m)
 {
-  int i, j;
+  int i;
   gx3dMatrix m1, m2;
 
 /*____________________________________________________________________
@@ -1833,17 +1854,20 @@ void gx3d_TransformObjectLayer (gx3dObjectLayer *layer, gx3dMatrix *m)
   gx3d_MultiplyMatrix (&m1, &m2, &m2);
 
   // Transform the vertices
-  if (layer->vertex AND layer->vertex_normal) 
-    // Transform each vertex
-    for (i=0; i<layer->num_vertices; i++) {
-      gx3d_MultiplyVectorMatrix       (&(layer->vertex[i]),        &m2, &(layer->vertex[i]));
-      gx3d_MultiplyNormalVectorMatrix (&(layer->vertex_normal[i]), &m2, &(layer->vertex_normal[i]));
+  if (layer->vertex AND layer->vertex_normal) {
+    gx3d_MultiplyVectorArrayMatrix (layer->vertex,        &m2, layer->vertex,        layer->num_vertices);
+    gx3d_MultiplyNormalArrayMatrix (layer->vertex_normal, &m2, layer->vertex_normal, layer->num_vertices);
+    for (i=0; i<layer->num_vertices; i++)
       gx3d_NormalizeVector (&(layer->vertex_normal[i]), &(layer->vertex_normal[i]));
-    }
+  }
+  // Free convex hull, if any (rebuilt when next needed)
+  if (layer->convex_hull) {
+    gx3d_ConvexHull_Free (layer->convex_hull);
+    layer->convex_hull = 0;
+  }
   // Transform any morph maps
   for (i=0; i<layer->num_morphs; i++)
-    for (j=0; j<layer->morph[i].num_entries; j++) 
-      gx3d_MultiplyVectorMatrix (&(layer->morph[i].offset[j]), m, &(layer->morph[i].offset[j]));
+    gx3d_MultiplyVectorArrayMatrix (layer->morph[i].offset, m, layer->morph[i].offset, layer->morph[i].num_entries);
 }
 
 /*____________________________________________________________________
@@ -2089,6 +2113,12 @@ static bool Combine_Object_Layers (gx3dObjectLayer *dst_layer, gx3dObjectLayer *
 | Combine the layers into dst_layer
 |___________________________________________________________________*/
 
+            // Free convex hull, if any (rebuilt when next needed)
+            if (dst_layer->convex_hull) {
+              gx3d_ConvexHull_Free (dst_layer->convex_hull);
+              dst_layer->convex_hull = 0;
+            }
+
             // Expand memory for vertex array
             dst_layer->vertex = (gx3dVector *) realloc (dst_layer->vertex, (dst_layer->num_vertices + src_layer->num_vertices) * sizeof(gx3dVector));
             if (dst_layer->vertex == NULL)
@@ -2312,21 +2342,25 @@ void gx3d_WriteLWO2File (char *filename, gx3dObject *object)
 |
 | Function: gx3d_WriteGX3DBINFile
 |                                                                                        
-| Output: Writes a GX3DBIN file from a gx3d object.
+| Output: Writes a GX3DBIN file from a gx3d object.  If boxtree is not
+|   0, the bsp tree of that boxtree (which must have been created for 
+|   this object) is also written so it can be loaded without rebuilding
+|   it (see gx3d_ReadGX3DBINBoxtree()).
 |___________________________________________________________________*/
                          
 void gx3d_WriteGX3DBINFile (
-  char       *filename, 
-  gx3dObject *object, 
-  bool        output_texcoords,
-  bool        output_vertex_normals, 
-  bool        output_diffuse_color,
-  bool        output_specular_color,
-  bool        output_weights,
-  bool        output_morphs,
-  bool        output_skeleton,
-  bool        opengl_formatting, 
-  bool        write_textfile_version )
+  char        *filename, 
+  gx3dObject  *object, 
+  bool         output_texcoords,
+  bool         output_vertex_normals, 
+  bool         output_diffuse_color,
+  bool         output_specular_color,
+  bool         output_weights,
+  bool         output_morphs,
+  bool         output_skeleton,
+  bool         opengl_formatting, 
+  bool         write_textfile_version,
+  gx3dBoxtree *boxtree )
 {
 
 /*____________________________________________________________________
@@ -2352,7 +2386,8 @@ void gx3d_WriteGX3DBINFile (
                                output_morphs,
                                output_skeleton,
                                opengl_formatting, 
-                               write_textfile_version );
+                               write_textfile_version,
+                               boxtree );
 }
 
 /*____________________________________________________________________
@@ -2434,6 +2469,39 @@ void gx3d_ReadGX3DBINFile (
   DEBUG_ASSERT (*object);
 }
 
+/*____________________________________________________________________
+|
+| Function: gx3d_ReadGX3DBINBoxtree
+|                                                                                        
+| Output: Reads the boxtree stored in a GX3DBIN file (written by 
+|   gx3d_WriteGX3DBINFile()) and attaches it to an object without 
+|   rebuilding the bsp tree.  The object must have the same geometry as
+|   the object the boxtree was written with (usually the object read from
+|   the same file).  Returns the boxtree or 0 if the file has no boxtree 
+|   or the boxtree doesn't match the object, in which case the caller 
+|   can create one with gx3d_Boxtree_Init().
+|___________________________________________________________________*/
+
+gx3dBoxtree *gx3d_ReadGX3DBINBoxtree (char *filename, gx3dObject *object, int num_threads)
+{
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (filename);
+  DEBUG_ASSERT (object);
+  DEBUG_ASSERT (num_threads >= 0);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  return (GX3DBIN_File_To_Boxtree (filename, object, num_threads));
+}
+
 /*____________________________________________________________________
 |
 | Function: gx3d_ObjectBoundBoxVisible
@@ -2450,6 +2518,7 @@ void gx3d_ReadGX3DBINFile (
  
 gxRelation gx3d_ObjectBoundBoxVisible (gx3dObject *object)
 {
+  gx3dMatrix m;
 
 /*____________________________________________________________________
 |
@@ -2463,7 +2532,9 @@ gxRelation gx3d_ObjectBoundBoxVisible (gx3dObject *object)
 | Main procedure
 |___________________________________________________________________*/
 
-  return (gx3d_Relation_Box_Frustum (&object->bound_box, &(object->transform.local_matrix)));
+  gx3d_AffineMatrixToMatrix (&(object->transform.local_matrix), &m);
+
+  return (gx3d_Relation_Box_Frustum (&object->bound_box, &m));
 }
 
 /*____________________________________________________________________
@@ -2500,7 +2571,7 @@ gxRelation gx3d_ObjectBoundSphereVisible (gx3dObject *object)
 |___________________________________________________________________*/
 
   // Transform center of object bounding sphere into world space
-  gx3d_MultiplyVectorMatrix (&(object->bound_sphere.center), &(object->transform.local_matrix), &sphere.center);
+  gx3d_MultiplyVectorAffineMatrix (&(object->bound_sphere.center), &(object->transform.local_matrix), &sphere.center);
   // Set sphere radius (in world units)
   x = object->bound_sphere.radius * object->transform.local_matrix._00;
   y = object->bound_sphere.radius * object->transform.local_matrix._01;
@@ -429,7 +429,8 @@ void gx3d_UpdateParticleSystem (gx3dParticleSystem particle_system, unsigned ela
       particle->direction.x = random_GetFloat () * (float)2 - (float)1;
       particle->direction.y = random_GetFloat () * (float)2 - (float)1;
       particle->direction.z = random_GetFloat () * (float)2 - (float)1;
-      gx3d_NormalizeVector (&(particle->direction), &(particle->direction));
+      // Random direction doesn't need to be exactly unit length
+      gx3d_NormalizeVector (&(particle->direction), &(particle->direction), gx3d_ACCURACY_FAST);
     }
     else 
       particle->direction = psys->data.direction;
@@ -511,7 +512,7 @@ static void Emit_Particle (gx3dEmitter *emitter, gx3dVector *position)
       v.x = random_GetFloat();
       v.y = random_GetFloat();
       v.z = random_GetFloat();
-      gx3d_NormalizeVector (&v, &v);
+      gx3d_NormalizeVector (&v, &v, gx3d_ACCURACY_FAST);
       radius = random_GetFloat() * emitter->radius;
       position->x = v.x * radius;
       position->y = v.y * radius;
@@ -609,8 +610,7 @@ void gx3d_DrawParticleSystem (gx3dParticleSystem particle_system, gx3dVector *vi
       // Compute the matrix to align particles to face the camera
       gx3d_GetBillboardRotateXYMatrix (&m_rotateparticle, &(psys->base_vertex_normal), view_normal);
       // Rotate the 'base' particle to face camera
-      for (i=0; i<4; i++)
-        gx3d_MultiplyVectorMatrix     (&(psys->base_vertex[i]),     &m_rotateparticle, &(psys->X_base_vertex[i]));
+      gx3d_MultiplyVectorArrayMatrix  (psys->base_vertex,           &m_rotateparticle, psys->X_base_vertex, 4);
       gx3d_MultiplyNormalVectorMatrix (&(psys->base_vertex_normal), &m_rotateparticle, &(psys->X_base_vertex_normal));
 //      psys->local_matrix_dirty = false;
     }
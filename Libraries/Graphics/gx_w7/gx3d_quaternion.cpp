@@ -21,6 +21,10 @@
 |             gx3d_MultiplyVectorQuaternion
 |             gx3d_ScaleQuaternion
 |             gx3d_SubtractQuaternion
+|             gx3d_GetNlerpQuaternions
+|             gx3d_GetSlerpQuaternions
+|              Get_Slerp_Coefficients
+|             gx3d_GetQuaternionMatrices
 |
 | (C) Copyright 2017 Abonvita Software LLC.
 | Licensed under the GX Toolkit License, Version 1.0.
@@ -36,9 +40,18 @@
 #include <first_header.h>
 
 #include <math.h>
+#include <xmmintrin.h>
 
 #include "dp.h"
 
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define SLERP_TERMS           9                   // # terms of the series used by gx3d_GetSlerpQuaternions()
+#define SLERP_LAST_TERM_SCALE 1.85298109240830    // minimizes the error of ending the series after SLERP_TERMS terms
+
 /*___________________
 |
 | Macros
@@ -46,6 +59,20 @@
 
 #define QUATERNION_MAGNITUDE(_q_) (_q_->w * _q_->w + _q_->x * _q_->x + _q_->y * _q_->y + _q_->z * _q_->z)
 
+// Dot products of 4 pairs of quaternions (in SSE registers, one component per register)
+#define QUATERNION_DOT_PRODUCTS(_x0_,_y0_,_z0_,_w0_,_x1_,_y1_,_z1_,_w1_)  \
+  _mm_add_ps (_mm_add_ps (_mm_add_ps (_mm_mul_ps (_x0_, _x1_),           \
+                                      _mm_mul_ps (_y0_, _y1_)),          \
+                                      _mm_mul_ps (_z0_, _z1_)),          \
+                                      _mm_mul_ps (_w0_, _w1_))
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static void Get_Slerp_Coefficients (float t, float *b);
+
 /*____________________________________________________________________
 |
 | Function: gx3d_GetQuaternionAxisAngle
@@ -369,7 +396,7 @@ inline float gx3d_QuaternionDotProduct (gx3dQuaternion *q1, gx3dQuaternion *q2)
   return (q1->w * q2->w + 
           q1->x * q2->x +
           q1->y * q2->y + 
-          q2->z * q2->z);
+          q1->z * q2->z);
 }
 
 /*____________________________________________________________________
@@ -727,3 +754,362 @@ void gx3d_SubtractQuaternion (gx3dQuaternion *q1, gx3dQuaternion *q2, gx3dQuater
   // tq = q1 * q2(inverse)
   gx3d_MultiplyQuaternion (q1, &qi2, qresult);
 }
+
+/*____________________________________________________________________
+|
+| Function: gx3d_GetNlerpQuaternions
+|
+| Output: Linearly interpolates between each pair of quaternions
+|   from[i] and to[i] along the shorter arc and normalizes the results.
+|   Amount should be a value between 0 and 1.  qresult can be the same
+|   as from or to.
+|
+| Description: Cheaper than slerp, but the rotation speed isn't 
+|   constant (it is fastest halfway between the two quaternions).  Uses
+|   SSE to interpolate 4 quaternions at a time.
+|___________________________________________________________________*/
+
+void gx3d_GetNlerpQuaternions (
+  gx3dQuaternionStream *from,
+  gx3dQuaternionStream *to,
+  float                 amount,
+  gx3dQuaternionStream *qresult,
+  int                   num_quaternions )
+{
+  int i;
+  float k0, k1, len;
+  gx3dQuaternion q;
+  __m128 x0, y0, z0, w0, x1, y1, z1, w1, sign, a0, a1, one, inv_len;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (from);
+  DEBUG_ASSERT (to);
+  DEBUG_ASSERT (qresult);
+  DEBUG_ASSERT ((amount >= 0) AND (amount <= 1));
+  DEBUG_ASSERT (num_quaternions >= 0);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  k0 = 1 - amount;
+  k1 = amount;
+
+  i = 0;
+  if (gx3d_GetCPUFeatures () & gx3d_CPU_SSE2) {
+    a0  = _mm_set1_ps (k0);
+    a1  = _mm_set1_ps (k1);
+    one = _mm_set1_ps (1);
+    for (; i+4<=num_quaternions; i+=4) {
+      x0 = _mm_loadu_ps (&(from->x[i]));
+      y0 = _mm_loadu_ps (&(from->y[i]));
+      z0 = _mm_loadu_ps (&(from->z[i]));
+      w0 = _mm_loadu_ps (&(from->w[i]));
+      x1 = _mm_loadu_ps (&(to->x[i]));
+      y1 = _mm_loadu_ps (&(to->y[i]));
+      z1 = _mm_loadu_ps (&(to->z[i]));
+      w1 = _mm_loadu_ps (&(to->w[i]));
+      // Negate from where the dot product is negative to take the shorter arc
+      sign = _mm_and_ps (QUATERNION_DOT_PRODUCTS (x0, y0, z0, w0, x1, y1, z1, w1), _mm_set1_ps (-0.0f));
+      x0 = _mm_add_ps (_mm_mul_ps (_mm_xor_ps (x0, sign), a0), _mm_mul_ps (x1, a1));
+      y0 = _mm_add_ps (_mm_mul_ps (_mm_xor_ps (y0, sign), a0), _mm_mul_ps (y1, a1));
+      z0 = _mm_add_ps (_mm_mul_ps (_mm_xor_ps (z0, sign), a0), _mm_mul_ps (z1, a1));
+      w0 = _mm_add_ps (_mm_mul_ps (_mm_xor_ps (w0, sign), a0), _mm_mul_ps (w1, a1));
+      // Normalize
+      inv_len = _mm_div_ps (one, _mm_sqrt_ps (QUATERNION_DOT_PRODUCTS (x0, y0, z0, w0, x0, y0, z0, w0)));
+      _mm_storeu_ps (&(qresult->x[i]), _mm_mul_ps (x0, inv_len));
+      _mm_storeu_ps (&(qresult->y[i]), _mm_mul_ps (y0, inv_len));
+      _mm_storeu_ps (&(qresult->z[i]), _mm_mul_ps (z0, inv_len));
+      _mm_storeu_ps (&(qresult->w[i]), _mm_mul_ps (w0, inv_len));
+    }
+  }
+
+  // Interpolate any remaining quaternions one at a time
+  for (; i<num_quaternions; i++) {
+    if (from->x[i] * to->x[i] + from->y[i] * to->y[i] + from->z[i] * to->z[i] + from->w[i] * to->w[i] < 0)
+      k0 = amount - 1;
+    else
+      k0 = 1 - amount;
+    q.x = from->x[i] * k0 + to->x[i] * k1;
+    q.y = from->y[i] * k0 + to->y[i] * k1;
+    q.z = from->z[i] * k0 + to->z[i] * k1;
+    q.w = from->w[i] * k0 + to->w[i] * k1;
+    len = 1 / sqrtf (q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+    qresult->x[i] = q.x * len;
+    qresult->y[i] = q.y * len;
+    qresult->z[i] = q.z * len;
+    qresult->w[i] = q.w * len;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_GetSlerpQuaternions
+|
+| Output: Spherically interpolates between each pair of quaternions
+|   from[i] and to[i].  Amount should be a value between 0 and 1.  
+|   qresult can be the same as from or to.
+|
+|   If exact is true, calls gx3d_GetSlerpQuaternion() for each pair.
+|   Else uses a polynomial approximation with no trig functions and no
+|   branches, 4 quaternions at a time using SSE.  The weights it gives
+|   each quaternion differ from the exact ones by at most 2e-5 (when the
+|   quaternions are 180 degrees of rotation apart), 1e-6 within 120 
+|   degrees and 2e-8 within 90 degrees.
+|
+| Reference: Eberly, "A Fast and Accurate Algorithm for Computing SLERP",
+|   Journal of Graphics, GPU, and Game Tools, 2011.
+|
+| Description: slerp(q0,q1,t) = s(1-t,x) * q0 + s(t,x) * q1, where x is
+|   the cos of the angle between q0 and q1 and s(t,x) is 
+|   sin(t*angle)/sin(angle).  s(t,x) is a power series in (x-1) whose
+|   coefficients only depend on t.  All quaternions use the same t, so
+|   the coefficients are computed once (in Get_Slerp_Coefficients()) 
+|   and each weight is a polynomial of degree 8 in (x-1).
+|___________________________________________________________________*/
+
+void gx3d_GetSlerpQuaternions (
+  gx3dQuaternionStream *from,
+  gx3dQuaternionStream *to,
+  float                 amount,
+  gx3dQuaternionStream *qresult,
+  int                   num_quaternions,
+  bool                  exact )
+{
+  int i, j;
+  float b0[SLERP_TERMS], b1[SLERP_TERMS], x, d, k0, k1;
+  gx3dQuaternion q0, q1;
+  __m128 x0, y0, z0, w0, x1, y1, z1, w1, dot, sign, vd, a0, a1;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (from);
+  DEBUG_ASSERT (to);
+  DEBUG_ASSERT (qresult);
+  DEBUG_ASSERT ((amount >= 0) AND (amount <= 1));
+  DEBUG_ASSERT (num_quaternions >= 0);
+
+/*____________________________________________________________________
+|
+| Exact version
+|___________________________________________________________________*/
+
+  if (exact) {
+    for (i=0; i<num_quaternions; i++) {
+      q0.x = from->x[i];
+      q0.y = from->y[i];
+      q0.z = from->z[i];
+      q0.w = from->w[i];
+      q1.x = to->x[i];
+      q1.y = to->y[i];
+      q1.z = to->z[i];
+      q1.w = to->w[i];
+      gx3d_GetSlerpQuaternion (&q0, &q1, amount, &q0);
+      qresult->x[i] = q0.x;
+      qresult->y[i] = q0.y;
+      qresult->z[i] = q0.z;
+      qresult->w[i] = q0.w;
+    }
+    return;
+  }
+
+/*____________________________________________________________________
+|
+| Fast version
+|___________________________________________________________________*/
+
+  // Get coefficients of the series for the weights of from and to
+  Get_Slerp_Coefficients (1 - amount, b0);
+  Get_Slerp_Coefficients (amount, b1);
+
+  i = 0;
+  if (gx3d_GetCPUFeatures () & gx3d_CPU_SSE2) {
+    for (; i+4<=num_quaternions; i+=4) {
+      x0 = _mm_loadu_ps (&(from->x[i]));
+      y0 = _mm_loadu_ps (&(from->y[i]));
+      z0 = _mm_loadu_ps (&(from->z[i]));
+      w0 = _mm_loadu_ps (&(from->w[i]));
+      x1 = _mm_loadu_ps (&(to->x[i]));
+      y1 = _mm_loadu_ps (&(to->y[i]));
+      z1 = _mm_loadu_ps (&(to->z[i]));
+      w1 = _mm_loadu_ps (&(to->w[i]));
+      // Negate from where the dot product is negative to take the shorter arc
+      dot  = QUATERNION_DOT_PRODUCTS (x0, y0, z0, w0, x1, y1, z1, w1);
+      sign = _mm_and_ps (dot, _mm_set1_ps (-0.0f));
+      vd   = _mm_sub_ps (_mm_xor_ps (dot, sign), _mm_set1_ps (1));
+      // Compute weights
+      a0 = _mm_set1_ps (b0[SLERP_TERMS-1]);
+      a1 = _mm_set1_ps (b1[SLERP_TERMS-1]);
+      for (j=SLERP_TERMS-2; j>=0; j--) {
+        a0 = _mm_add_ps (_mm_mul_ps (a0, vd), _mm_set1_ps (b0[j]));
+        a1 = _mm_add_ps (_mm_mul_ps (a1, vd), _mm_set1_ps (b1[j]));
+      }
+      a0 = _mm_xor_ps (a0, sign);
+      // Interpolate
+      _mm_storeu_ps (&(qresult->x[i]), _mm_add_ps (_mm_mul_ps (x0, a0), _mm_mul_ps (x1, a1)));
+      _mm_storeu_ps (&(qresult->y[i]), _mm_add_ps (_mm_mul_ps (y0, a0), _mm_mul_ps (y1, a1)));
+      _mm_storeu_ps (&(qresult->z[i]), _mm_add_ps (_mm_mul_ps (z0, a0), _mm_mul_ps (z1, a1)));
+      _mm_storeu_ps (&(qresult->w[i]), _mm_add_ps (_mm_mul_ps (w0, a0), _mm_mul_ps (w1, a1)));
+    }
+  }
+
+  // Interpolate any remaining quaternions one at a time (same operations as above)
+  for (; i<num_quaternions; i++) {
+    x = from->x[i] * to->x[i] + from->y[i] * to->y[i] + from->z[i] * to->z[i] + from->w[i] * to->w[i];
+    d = fabsf (x) - 1;
+    k0 = b0[SLERP_TERMS-1];
+    k1 = b1[SLERP_TERMS-1];
+    for (j=SLERP_TERMS-2; j>=0; j--) {
+      k0 = k0 * d + b0[j];
+      k1 = k1 * d + b1[j];
+    }
+    if (x < 0)
+      k0 = -k0;
+    q0.x = from->x[i] * k0 + to->x[i] * k1;
+    q0.y = from->y[i] * k0 + to->y[i] * k1;
+    q0.z = from->z[i] * k0 + to->z[i] * k1;
+    q0.w = from->w[i] * k0 + to->w[i] * k1;
+    qresult->x[i] = q0.x;
+    qresult->y[i] = q0.y;
+    qresult->z[i] = q0.z;
+    qresult->w[i] = q0.w;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Slerp_Coefficients
+|
+| Input: Called from gx3d_GetSlerpQuaternions()
+| Output: Gets the coefficients b[i] of the series 
+|   sin(t*angle)/sin(angle) = sum of b[i] * (x-1)^i, x = cos(angle).
+|
+| Description: b[0] = t, b[i] = b[i-1] * (t^2 - i^2) / (i * (2i+1)).
+|   The last coefficient is scaled by a constant chosen (by Eberly) to
+|   minimize the error from ending the series there.
+|___________________________________________________________________*/
+
+static void Get_Slerp_Coefficients (float t, float *b)
+{
+  int i;
+  double u, v, c;
+
+  c = (double)t;
+  b[0] = t;
+  for (i=1; i<SLERP_TERMS; i++) {
+    u = 1.0 / (i * (2*i + 1));
+    v = (double)i / (2*i + 1);
+    if (i == SLERP_TERMS-1) {
+      u *= SLERP_LAST_TERM_SCALE;
+      v *= SLERP_LAST_TERM_SCALE;
+    }
+    c *= (u * t * t - v);
+    b[i] = (float)c;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_GetQuaternionMatrices
+|
+| Output: Builds a rotation matrix m[i] from each quaternion q[i].  Gives
+|   exactly the same matrices as gx3d_GetQuaternionMatrix().
+|___________________________________________________________________*/
+
+void gx3d_GetQuaternionMatrices (gx3dQuaternionStream *q, gx3dMatrix *m, int num_quaternions)
+{
+  int i;
+  gx3dQuaternion qt;
+  __m128 x, y, z, w, x2, y2, z2, wx, wy, wz, xx, xy, xz, yy, yz, zz, one, zero, r0, r1, r2, r3;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (q);
+  DEBUG_ASSERT (m);
+  DEBUG_ASSERT (num_quaternions >= 0);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  i = 0;
+  if (gx3d_GetCPUFeatures () & gx3d_CPU_SSE2) {
+    one  = _mm_set1_ps (1);
+    zero = _mm_setzero_ps ();
+    for (; i+4<=num_quaternions; i+=4) {
+      x  = _mm_loadu_ps (&(q->x[i]));
+      y  = _mm_loadu_ps (&(q->y[i]));
+      z  = _mm_loadu_ps (&(q->z[i]));
+      w  = _mm_loadu_ps (&(q->w[i]));
+      x2 = _mm_add_ps (x, x);
+      y2 = _mm_add_ps (y, y);
+      z2 = _mm_add_ps (z, z);
+      wx = _mm_mul_ps (w, x2);
+      wy = _mm_mul_ps (w, y2);
+      wz = _mm_mul_ps (w, z2);
+      xx = _mm_mul_ps (x, x2);
+      xy = _mm_mul_ps (x, y2);
+      xz = _mm_mul_ps (x, z2);
+      yy = _mm_mul_ps (y, y2);
+      yz = _mm_mul_ps (y, z2);
+      zz = _mm_mul_ps (z, z2);
+      // Row 0 of each matrix
+      r0 = _mm_sub_ps (one, _mm_add_ps (yy, zz));
+      r1 = _mm_sub_ps (xy, wz);
+      r2 = _mm_add_ps (xz, wy);
+      r3 = zero;
+      _MM_TRANSPOSE4_PS (r0, r1, r2, r3);
+      _mm_storeu_ps (&(m[i  ]._00), r0);
+      _mm_storeu_ps (&(m[i+1]._00), r1);
+      _mm_storeu_ps (&(m[i+2]._00), r2);
+      _mm_storeu_ps (&(m[i+3]._00), r3);
+      // Row 1
+      r0 = _mm_add_ps (xy, wz);
+      r1 = _mm_sub_ps (one, _mm_add_ps (xx, zz));
+      r2 = _mm_sub_ps (yz, wx);
+      r3 = zero;
+      _MM_TRANSPOSE4_PS (r0, r1, r2, r3);
+      _mm_storeu_ps (&(m[i  ]._10), r0);
+      _mm_storeu_ps (&(m[i+1]._10), r1);
+      _mm_storeu_ps (&(m[i+2]._10), r2);
+      _mm_storeu_ps (&(m[i+3]._10), r3);
+      // Row 2
+      r0 = _mm_sub_ps (xz, wy);
+      r1 = _mm_add_ps (yz, wx);
+      r2 = _mm_sub_ps (one, _mm_add_ps (xx, yy));
+      r3 = zero;
+      _MM_TRANSPOSE4_PS (r0, r1, r2, r3);
+      _mm_storeu_ps (&(m[i  ]._20), r0);
+      _mm_storeu_ps (&(m[i+1]._20), r1);
+      _mm_storeu_ps (&(m[i+2]._20), r2);
+      _mm_storeu_ps (&(m[i+3]._20), r3);
+      // Row 3
+      r3 = _mm_set_ps (1, 0, 0, 0);
+      _mm_storeu_ps (&(m[i  ]._30), r3);
+      _mm_storeu_ps (&(m[i+1]._30), r3);
+      _mm_storeu_ps (&(m[i+2]._30), r3);
+      _mm_storeu_ps (&(m[i+3]._30), r3);
+    }
+  }
+
+  // Build any remaining matrices one at a time
+  for (; i<num_quaternions; i++) {
+    qt.x = q->x[i];
+    qt.y = q->y[i];
+    qt.z = q->z[i];
+    qt.w = q->w[i];
+    gx3d_GetQuaternionMatrix (&qt, &m[i]);
+  }
+}
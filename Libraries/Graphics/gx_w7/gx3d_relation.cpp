@@ -38,10 +38,19 @@
 |
 |             gx3d_Relation_Point_Frustum
 |             gx3d_Relation_Point_Frustum
+|             gx3d_Relation_Point_Frustum
+|              Relation_Point_Frustum
+|             gx3d_Relation_Sphere_Frustum
 |             gx3d_Relation_Sphere_Frustum
 |             gx3d_Relation_Sphere_Frustum
+|              Relation_Sphere_Frustum
 |             gx3d_Relation_Sphere_Frustum
 |             gx3d_Relation_Sphere_Frustum
+|             gx3d_Relation_Sphere_Frustum
+|              Relation_Sphere_Frustum
+|             gx3d_Relation_Box_Frustum
+|             gx3d_Relation_Box_Frustum
+|              Relation_Box_Frustum
 |             gx3d_Relation_Box_Frustum
 |             gx3d_Relation_Box_Frustum
 |
@@ -71,6 +80,20 @@
 #define GREATER_THAN_ZERO(_val_) ((_val_) > EPSILON)
 #define LESS_THAN_ZERO(_val_) ((_val_) < -EPSILON)
 
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static gxRelation Relation_Point_Frustum (gx3dVector *point, gx3dMatrix *view_matrix, gx3dViewFrustum *vf);
+static gxRelation Relation_Sphere_Frustum (gx3dSphere *sphere, gx3dMatrix *view_matrix, gx3dViewFrustum *vf);
+static gxRelation Relation_Sphere_Frustum (
+  gx3dSphere             *sphere, 
+  gx3dMatrix             *view_matrix, 
+  gx3dViewFrustum        *vf, 
+  gx3dFrustumOrientation *orientation );
+static gxRelation Relation_Box_Frustum (gx3dBox *box, gx3dMatrix *box_transform, gx3dMatrix *view_projection_matrix);
+
 /*____________________________________________________________________
 |
 | Function: gx3d_Relation_Point_Plane
@@ -1266,7 +1289,7 @@ gxRelation gx3d_Relation_Triangle_Triangle (gx3dVector *vertices1, gx3dVector *v
 {               
   int i, index, sign[3];
   float d, distance[3];
-  gx3dVector v, v1, v2;
+  gx3dVector v, v1, v2, n;
   gx3dPlane plane2;
   gxPointF tri1[3], tri2[3], p1, p2;
   gxRelation result;
@@ -1287,9 +1310,13 @@ gxRelation gx3d_Relation_Triangle_Triangle (gx3dVector *vertices1, gx3dVector *v
   // Compute plane triangle 2 is in
   gx3d_GetPlane (&vertices2[0], &vertices2[1], &vertices2[2], &plane2);
   // Compute signed distances of vertices in triangle 1 to plane 2
-  distance[0] = gx3d_Distance_Point_Plane (&vertices2[0], &plane2);
-  distance[1] = gx3d_Distance_Point_Plane (&vertices2[1], &plane2);
-  distance[2] = gx3d_Distance_Point_Plane (&vertices2[2], &plane2);
+  distance[0] = gx3d_Distance_Point_Plane (&vertices1[0], &plane2);
+  distance[1] = gx3d_Distance_Point_Plane (&vertices1[1], &plane2);
+  distance[2] = gx3d_Distance_Point_Plane (&vertices1[2], &plane2);
+  // Absolute values of normal components select the plane to project onto
+  n.x = fabsf (plane2.n.x);
+  n.y = fabsf (plane2.n.y);
+  n.z = fabsf (plane2.n.z);
   
   // Are all vertices in triangle 1 in front of the plane?
   if (GREATER_THAN_ZERO(distance[0]) AND GREATER_THAN_ZERO(distance[1]) AND GREATER_THAN_ZERO(distance[2]))
@@ -1301,7 +1328,7 @@ gxRelation gx3d_Relation_Triangle_Triangle (gx3dVector *vertices1, gx3dVector *v
     // Are triangles coplanar?
     if (EQUAL_ZERO(distance[0]) AND EQUAL_ZERO(distance[1]) AND EQUAL_ZERO(distance[2])) {
       // Project triangles onto the axis-aligned plane where the area of triangle 2 is maximized
-      if ((plane2.n.x >= plane2.n.y) AND (plane2.n.x >= plane2.n.z)) 
+      if ((n.x >= n.y) AND (n.x >= n.z)) 
         // Drop x and project onto yz plane
         for (i=0; i<3; i++) {
           tri1[i].x = vertices1[i].y;
@@ -1309,7 +1336,7 @@ gxRelation gx3d_Relation_Triangle_Triangle (gx3dVector *vertices1, gx3dVector *v
           tri2[i].x = vertices2[i].y;
           tri2[i].y = vertices2[i].z;
         }
-      else if ((plane2.n.y >= plane2.n.x) AND (plane2.n.y >= plane2.n.z))
+      else if ((n.y >= n.x) AND (n.y >= n.z))
         // Drop y and project onto xz plane
         for (i=0; i<3; i++) {
           tri1[i].x = vertices1[i].x;
@@ -1344,17 +1371,17 @@ gxRelation gx3d_Relation_Triangle_Triangle (gx3dVector *vertices1, gx3dVector *v
       else
         index = 2;
       // Compute intersection points of the two edges in triangle 1 that pass through the plane
-      gx3d_SubtractVector (&vertices1[index+1%3], &vertices1[index], &v);
-      d = distance[index] / (distance[index] - distance[index+1%3]);
+      gx3d_SubtractVector (&vertices1[(index+1)%3], &vertices1[index], &v);
+      d = distance[index] / (distance[index] - distance[(index+1)%3]);
       gx3d_MultiplyScalarVector (d, &v, &v);
       gx3d_AddVector (&vertices1[index], &v, &v1);
 
-      gx3d_SubtractVector (&vertices1[index+2%3], &vertices1[index], &v);
-      d = distance[index] / (distance[index] - distance[index+2%3]);
+      gx3d_SubtractVector (&vertices1[(index+2)%3], &vertices1[index], &v);
+      d = distance[index] / (distance[index] - distance[(index+2)%3]);
       gx3d_MultiplyScalarVector (d, &v, &v);
       gx3d_AddVector (&vertices1[index], &v, &v2);
       // Project triangle2,v1,v2 onto the axis-aligned plane where the area of triangle 2 is maximized
-      if ((plane2.n.x >= plane2.n.y) AND (plane2.n.x >= plane2.n.z)) {
+      if ((n.x >= n.y) AND (n.x >= n.z)) {
         // Drop x and project onto yz plane
         for (i=0; i<3; i++) {
           tri2[i].x = vertices2[i].y;
@@ -1365,7 +1392,7 @@ gxRelation gx3d_Relation_Triangle_Triangle (gx3dVector *vertices1, gx3dVector *v
         p2.x = v2.y;
         p2.y = v2.z;
       }
-      else if ((plane2.n.y >= plane2.n.x) AND (plane2.n.y >= plane2.n.z)) {
+      else if ((n.y >= n.x) AND (n.y >= n.z)) {
         // Drop y and project onto xz plane
         for (i=0; i<3; i++) {
           tri2[i].x = vertices2[i].x;
@@ -1398,125 +1425,55 @@ gxRelation gx3d_Relation_Triangle_Triangle (gx3dVector *vertices1, gx3dVector *v
 /*____________________________________________________________________
 |
 | Function: gx3d_Relation_Point_Frustum
-|                                                                                        
-| Output: Returns position of point (in world space) relative to the 
-|   defautl view Frustum.
 |
-|   Returns gxRELATION_OUTSIDE = point outside of VF
-|           gxRELATION_INSIDE  = point is entirely within VF
-|
-| Notes: Assumes point is in world coordinates.
+| Output: Returns position of point (in world space) relative to the
+|   default view frustum.
 |___________________________________________________________________*/
 
 gxRelation gx3d_Relation_Point_Frustum (gx3dVector *point)
 {
-  float distance;
-  gx3dVector point_view_pos;
-  gxRelation result;
-
-/*____________________________________________________________________
-|
-| Verify input params
-|___________________________________________________________________*/
-
-  DEBUG_ASSERT (point);
-
-/*____________________________________________________________________
-|
-| Init variables
-|___________________________________________________________________*/
-
   if (gx3d_View_frustum_dirty)
     gx3d_UpdateViewFrustum ();
-  
-/*____________________________________________________________________
-|
-| Test point z coordinate against front/back Frustum planes
-|___________________________________________________________________*/
 
-  // Transform z into view space
-  point_view_pos.z = gx3d_View_matrix._02 * point->x +
-                     gx3d_View_matrix._12 * point->y +
-                     gx3d_View_matrix._22 * point->z +
-                     gx3d_View_matrix._32;
-  // Compute distance to near plane (distance will be positive behind near plane)
-  distance = gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_NEAR].d - point_view_pos.z;
-  // Behind near plane?
-  if (distance > 0)
-    result = gxRELATION_OUTSIDE;
-  else {
-    // Compute distance to far plane (distance will be positive beyond near plane)
-    distance = point_view_pos.z - gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_FAR].d;
-    // Beyond far plane?
-    if (distance > 0)
-      result = gxRELATION_OUTSIDE;
-    else {
+  return (Relation_Point_Frustum (point, &(gx3d_View_context.view_matrix), &(gx3d_View_context.frustum)));
+}
 
 /*____________________________________________________________________
 |
-| Test point x coordinate against left/right Frustum planes
+| Function: gx3d_Relation_Point_Frustum
+|
+| Output: Returns position of point (in world space) relative to a view
+|   frustum, seen through the default view matrix.
 |___________________________________________________________________*/
 
-      // Transform x into view space
-      point_view_pos.x = gx3d_View_matrix._00 * point->x +
-                         gx3d_View_matrix._10 * point->y +
-                         gx3d_View_matrix._20 * point->z +
-                         gx3d_View_matrix._30;
-      // Compute distance to left plane (distance will be negative on left side of left plane)
-      distance = (point_view_pos.x * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_LEFT].n.x) +
-                 (point_view_pos.z * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_LEFT].n.z);
-      // Left of left plane?
-      if (distance < 0) 
-        result = gxRELATION_OUTSIDE;
-      else {
-        // Compute distance to right plane (distance will be negative on right side of right plane)
-        distance = (point_view_pos.x * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_RIGHT].n.x) +
-                   (point_view_pos.z * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_RIGHT].n.z);
-        // Right of right plane?
-        if (distance < 0) 
-          result = gxRELATION_OUTSIDE;
-        else {
+gxRelation gx3d_Relation_Point_Frustum (gx3dVector *point, gx3dViewFrustum *vf)
+{
+  return (Relation_Point_Frustum (point, &(gx3d_View_context.view_matrix), vf));
+}
 
 /*____________________________________________________________________
 |
-| Test sphere center y coordinate against top/bottom, Frustum planes
+| Function: gx3d_Relation_Point_Frustum
+|
+| Output: Returns position of point (in world space) relative to the view
+|   frustum of a view context.  Only reads the context, so it can be
+|   called from any thread.
 |___________________________________________________________________*/
 
-          // Transform y into view space
-          point_view_pos.y = gx3d_View_matrix._01 * point->x +
-                             gx3d_View_matrix._11 * point->y +
-                             gx3d_View_matrix._21 * point->z +
-                             gx3d_View_matrix._31;
-          // Compute distance to top plane (distance will be negative above top plane)
-          distance = (point_view_pos.y * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_TOP].n.y) +
-                     (point_view_pos.z * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_TOP].n.z);
-          // Above top plane?
-          if (distance < 0) 
-            result = gxRELATION_OUTSIDE;
-          else {
-            // Compute distance to bottom plane (distance will be negative below bottom plane)
-            distance = (point_view_pos.y * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_BOTTOM].n.y) +
-                       (point_view_pos.z * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_BOTTOM].n.z);
-            // Below bottom plane?
-            if (distance < 0) 
-              result = gxRELATION_OUTSIDE;
-            else
-              result = gxRELATION_INSIDE;
-          }
-        }
-      }
-    }
-  }
- 
-  return (result);
+gxRelation gx3d_Relation_Point_Frustum (gx3dViewContext *context, gx3dVector *point)
+{
+  DEBUG_ASSERT (context);
+
+  return (Relation_Point_Frustum (point, &(context->view_matrix), &(context->frustum)));
 }
 
 /*____________________________________________________________________
 |
-| Function: gx3d_Relation_Point_Frustum
-|                                                                                        
+| Function: Relation_Point_Frustum
+|
+| Input: Called from gx3d_Relation_Point_Frustum()
 | Output: Returns position of point (in world space) relative to a view
-|   Frustum.
+|   Frustum seen through a view matrix.
 |
 |   Returns gxRELATION_OUTSIDE = point outside of VF
 |           gxRELATION_INSIDE  = point is entirely within VF
@@ -1524,7 +1481,7 @@ gxRelation gx3d_Relation_Point_Frustum (gx3dVector *point)
 | Notes: Assumes point is in world coordinates.
 |___________________________________________________________________*/
 
-gxRelation gx3d_Relation_Point_Frustum (gx3dVector *point, gx3dViewFrustum *vf)
+static gxRelation Relation_Point_Frustum (gx3dVector *point, gx3dMatrix *view_matrix, gx3dViewFrustum *vf)
 {
   float distance;
   gx3dVector point_view_pos;
@@ -1536,6 +1493,7 @@ gxRelation gx3d_Relation_Point_Frustum (gx3dVector *point, gx3dViewFrustum *vf)
 |___________________________________________________________________*/
 
   DEBUG_ASSERT (point);
+  DEBUG_ASSERT (view_matrix);
   DEBUG_ASSERT (vf);
 
 /*____________________________________________________________________
@@ -1544,10 +1502,10 @@ gxRelation gx3d_Relation_Point_Frustum (gx3dVector *point, gx3dViewFrustum *vf)
 |___________________________________________________________________*/
 
   // Transform z into view space
-  point_view_pos.z = gx3d_View_matrix._02 * point->x +
-                     gx3d_View_matrix._12 * point->y +
-                     gx3d_View_matrix._22 * point->z +
-                     gx3d_View_matrix._32;
+  point_view_pos.z = view_matrix->_02 * point->x +
+                     view_matrix->_12 * point->y +
+                     view_matrix->_22 * point->z +
+                     view_matrix->_32;
   // Compute distance to near plane (distance will be positive behind near plane)
   distance = vf->plane[gx3d_FRUSTUM_PLANE_NEAR].d - point_view_pos.z;
   // Behind near plane?
@@ -1567,10 +1525,10 @@ gxRelation gx3d_Relation_Point_Frustum (gx3dVector *point, gx3dViewFrustum *vf)
 |___________________________________________________________________*/
 
       // Transform x into view space
-      point_view_pos.x = gx3d_View_matrix._00 * point->x +
-                         gx3d_View_matrix._10 * point->y +
-                         gx3d_View_matrix._20 * point->z +
-                         gx3d_View_matrix._30;
+      point_view_pos.x = view_matrix->_00 * point->x +
+                         view_matrix->_10 * point->y +
+                         view_matrix->_20 * point->z +
+                         view_matrix->_30;
       // Compute distance to left plane (distance will be negative on left side of left plane)
       distance = (point_view_pos.x * vf->plane[gx3d_FRUSTUM_PLANE_LEFT].n.x) +
                  (point_view_pos.z * vf->plane[gx3d_FRUSTUM_PLANE_LEFT].n.z);
@@ -1592,10 +1550,10 @@ gxRelation gx3d_Relation_Point_Frustum (gx3dVector *point, gx3dViewFrustum *vf)
 |___________________________________________________________________*/
 
           // Transform y into view space
-          point_view_pos.y = gx3d_View_matrix._01 * point->x +
-                             gx3d_View_matrix._11 * point->y +
-                             gx3d_View_matrix._21 * point->z +
-                             gx3d_View_matrix._31;
+          point_view_pos.y = view_matrix->_01 * point->x +
+                             view_matrix->_11 * point->y +
+                             view_matrix->_21 * point->z +
+                             view_matrix->_31;
           // Compute distance to top plane (distance will be negative above top plane)
           distance = (point_view_pos.y * vf->plane[gx3d_FRUSTUM_PLANE_TOP].n.y) +
                      (point_view_pos.z * vf->plane[gx3d_FRUSTUM_PLANE_TOP].n.z);
@@ -1623,146 +1581,53 @@ gxRelation gx3d_Relation_Point_Frustum (gx3dVector *point, gx3dViewFrustum *vf)
 /*____________________________________________________________________
 |
 | Function: gx3d_Relation_Sphere_Frustum
-|                                                                                        
-| Output: Returns position of sphere (in world space) relative to the
-|   default view Frustum.
 |
-|   Returns gxRELATION_OUTSIDE   = sphere outside of VF
-|           gxRELATION_INSIDE    = sphere is entirely within VF
-|           gxRELATION_INTERSECT = sphere intersects VF
-|
-| Notes: Assumes sphere is in world coordinates.
-|
-| Reference: Tim Round, "Object Occlusion Culling", Game Programming
-|   Gems, DeLoura, pp. 421-431, 2000.
+| Output: Returns position of sphere (in world space) relative to the
+|   default view frustum.
 |___________________________________________________________________*/
 
 gxRelation gx3d_Relation_Sphere_Frustum (gx3dSphere *sphere)
 {
-  float distance;
-  gx3dVector sphere_view_pos;
-  gxRelation result;
-  bool intersecting = false;
-
-/*____________________________________________________________________
-|
-| Verify input params
-|___________________________________________________________________*/
-
-  DEBUG_ASSERT (sphere);
-  DEBUG_ASSERT (sphere->radius > 0);
-
-/*____________________________________________________________________
-|
-| Init variables
-|___________________________________________________________________*/
-
   if (gx3d_View_frustum_dirty)
     gx3d_UpdateViewFrustum ();
-  
-/*____________________________________________________________________
-|
-| Test sphere center z coordinate against front/back Frustum planes
-|___________________________________________________________________*/
 
-  // Transform z into view space
-  sphere_view_pos.z = gx3d_View_matrix._02 * sphere->center.x +
-                      gx3d_View_matrix._12 * sphere->center.y +
-                      gx3d_View_matrix._22 * sphere->center.z +
-                      gx3d_View_matrix._32;
-  // Compute distance to near plane (distance will be positive behind near plane)
-  distance = gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_NEAR].d - sphere_view_pos.z;
-  // Behind near plane?
-  if (distance > sphere->radius)
-    result = gxRELATION_OUTSIDE;
-	else {
-    // Intersects near plane?
-		if (-distance <= sphere->radius) 
-			intersecting = true;
-		// Compute distance to far plane (distance will be positive beyond near plane)
-		distance = sphere_view_pos.z - gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_FAR].d;
-		// Beyond far plane?
-		if (distance > sphere->radius)
-			result = gxRELATION_OUTSIDE;
-		else {
-  		// Intersects far plane?
-			if (-distance <= sphere->radius) 
-				intersecting = true;
+  return (Relation_Sphere_Frustum (sphere, &(gx3d_View_context.view_matrix), &(gx3d_View_context.frustum)));
+}
 
 /*____________________________________________________________________
 |
-| Test sphere center x coordinate against left/right Frustum planes
+| Function: gx3d_Relation_Sphere_Frustum
+|
+| Output: Returns position of sphere (in world space) relative to a view
+|   frustum, seen through the default view matrix.
 |___________________________________________________________________*/
 
-      // Transform x into view space
-      sphere_view_pos.x = gx3d_View_matrix._00 * sphere->center.x +
-                          gx3d_View_matrix._10 * sphere->center.y +
-                          gx3d_View_matrix._20 * sphere->center.z +
-                          gx3d_View_matrix._30;
-      // Compute distance to left plane (distance will be negative on left side of left plane)
-      distance = (sphere_view_pos.x * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_LEFT].n.x) +
-                 (sphere_view_pos.z * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_LEFT].n.z);
-      // Left of left plane?
-      if (distance < -sphere->radius) 
-        result = gxRELATION_OUTSIDE;
-			else {
-        // Intersects left plane?
-        if (distance <= sphere->radius) 
-          intersecting = true;
-        // Compute distance to right plane (distance will be positive on right side of right plane)
-        distance = (sphere_view_pos.x * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_RIGHT].n.x) +
-                   (sphere_view_pos.z * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_RIGHT].n.z);
-        // Right of right plane?
-        if (distance < -sphere->radius) 
-          result = gxRELATION_OUTSIDE;
-				else {
-          // Intersects right plane?
-          if (distance <= sphere->radius) 
-            intersecting = true;
+gxRelation gx3d_Relation_Sphere_Frustum (gx3dSphere *sphere, gx3dViewFrustum *vf)
+{
+  return (Relation_Sphere_Frustum (sphere, &(gx3d_View_context.view_matrix), vf));
+}
 
 /*____________________________________________________________________
 |
-| Test sphere center y coordinate against top/bottom, Frustum planes
+| Function: gx3d_Relation_Sphere_Frustum
+|
+| Output: Returns position of sphere (in world space) relative to the view
+|   frustum of a view context.  Only reads the context, so it can be
+|   called from any thread.
 |___________________________________________________________________*/
 
-          // Transform y into view space
-          sphere_view_pos.y = gx3d_View_matrix._01 * sphere->center.x +
-                              gx3d_View_matrix._11 * sphere->center.y +
-                              gx3d_View_matrix._21 * sphere->center.z +
-                              gx3d_View_matrix._31;
-          // Compute distance to top plane (distance will be negative above top plane)
-          distance = (sphere_view_pos.y * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_TOP].n.y) +
-                     (sphere_view_pos.z * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_TOP].n.z);
-          // Above top plane?
-          if (distance < -sphere->radius) 
-            result = gxRELATION_OUTSIDE;
-					else {
-            // Intersects top plane?
-            if (distance <= sphere->radius) 
-              intersecting = true;
-            // Compute distance to bottom plane (distance will be negative below bottom plane)
-            distance = (sphere_view_pos.y * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_BOTTOM].n.y) +
-                       (sphere_view_pos.z * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_BOTTOM].n.z);
-            // Below bottom plane?
-            if (distance < -sphere->radius) 
-              result = gxRELATION_OUTSIDE;
-            else if (intersecting OR (distance <= sphere->radius))
-              result = gxRELATION_INTERSECT;
-            else
-              result = gxRELATION_INSIDE;
-          }
-        }
-      }
-    }
-  }
- 
-  return (result);
+gxRelation gx3d_Relation_Sphere_Frustum (gx3dViewContext *context, gx3dSphere *sphere)
+{
+  DEBUG_ASSERT (context);
+
+  return (Relation_Sphere_Frustum (sphere, &(context->view_matrix), &(context->frustum)));
 }
 
 /*____________________________________________________________________
 |
-| Function: gx3d_Relation_Sphere_Frustum
-|                                                                                        
+| Function: Relation_Sphere_Frustum
+|
+| Input: Called from gx3d_Relation_Sphere_Frustum()
 | Output: Returns position of sphere (in world space) relative to a 
 |   view Frustum.
 |
@@ -1776,7 +1641,7 @@ gxRelation gx3d_Relation_Sphere_Frustum (gx3dSphere *sphere)
 |   Gems, DeLoura, pp. 421-431, 2000.
 |___________________________________________________________________*/
 
-gxRelation gx3d_Relation_Sphere_Frustum (gx3dSphere *sphere, gx3dViewFrustum *vf)
+static gxRelation Relation_Sphere_Frustum (gx3dSphere *sphere, gx3dMatrix *view_matrix, gx3dViewFrustum *vf)
 {
   float distance;
   gx3dVector sphere_view_pos;
@@ -1790,6 +1655,7 @@ gxRelation gx3d_Relation_Sphere_Frustum (gx3dSphere *sphere, gx3dViewFrustum *vf
 
   DEBUG_ASSERT (sphere);
   DEBUG_ASSERT (sphere->radius > 0);
+  DEBUG_ASSERT (view_matrix);
   DEBUG_ASSERT (vf);
 
 /*____________________________________________________________________
@@ -1798,10 +1664,10 @@ gxRelation gx3d_Relation_Sphere_Frustum (gx3dSphere *sphere, gx3dViewFrustum *vf
 |___________________________________________________________________*/
 
   // Transform z into view space
-  sphere_view_pos.z = gx3d_View_matrix._02 * sphere->center.x +
-                      gx3d_View_matrix._12 * sphere->center.y +
-                      gx3d_View_matrix._22 * sphere->center.z +
-                      gx3d_View_matrix._32;
+  sphere_view_pos.z = view_matrix->_02 * sphere->center.x +
+                      view_matrix->_12 * sphere->center.y +
+                      view_matrix->_22 * sphere->center.z +
+                      view_matrix->_32;
   // Compute distance to near plane (distance will be positive behind near plane)
   distance = vf->plane[gx3d_FRUSTUM_PLANE_NEAR].d - sphere_view_pos.z;
   // Behind near plane?
@@ -1827,10 +1693,10 @@ gxRelation gx3d_Relation_Sphere_Frustum (gx3dSphere *sphere, gx3dViewFrustum *vf
 |___________________________________________________________________*/
 
       // Transform x into view space
-      sphere_view_pos.x = gx3d_View_matrix._00 * sphere->center.x +
-                          gx3d_View_matrix._10 * sphere->center.y +
-                          gx3d_View_matrix._20 * sphere->center.z +
-                          gx3d_View_matrix._30;
+      sphere_view_pos.x = view_matrix->_00 * sphere->center.x +
+                          view_matrix->_10 * sphere->center.y +
+                          view_matrix->_20 * sphere->center.z +
+                          view_matrix->_30;
       // Compute distance to left plane (distance will be negative on left side of left plane)
       distance = (sphere_view_pos.x * vf->plane[gx3d_FRUSTUM_PLANE_LEFT].n.x) +
                  (sphere_view_pos.z * vf->plane[gx3d_FRUSTUM_PLANE_LEFT].n.z);
@@ -1858,10 +1724,10 @@ gxRelation gx3d_Relation_Sphere_Frustum (gx3dSphere *sphere, gx3dViewFrustum *vf
 |___________________________________________________________________*/
 
           // Transform y into view space
-          sphere_view_pos.y = gx3d_View_matrix._01 * sphere->center.x +
-                              gx3d_View_matrix._11 * sphere->center.y +
-                              gx3d_View_matrix._21 * sphere->center.z +
-                              gx3d_View_matrix._31;
+          sphere_view_pos.y = view_matrix->_01 * sphere->center.x +
+                              view_matrix->_11 * sphere->center.y +
+                              view_matrix->_21 * sphere->center.z +
+                              view_matrix->_31;
           // Compute distance to top plane (distance will be negative above top plane)
           distance = (sphere_view_pos.y * vf->plane[gx3d_FRUSTUM_PLANE_TOP].n.y) +
                      (sphere_view_pos.z * vf->plane[gx3d_FRUSTUM_PLANE_TOP].n.z);
@@ -1894,185 +1760,62 @@ gxRelation gx3d_Relation_Sphere_Frustum (gx3dSphere *sphere, gx3dViewFrustum *vf
 /*____________________________________________________________________
 |
 | Function: gx3d_Relation_Sphere_Frustum
-|                                                                                        
-| Output: Returns position of sphere (in world space) relative to the
-|   default view Frustum.
-|
-|   Returns gxRELATION_OUTSIDE   = sphere outside of VF
-|           gxRELATION_INSIDE    = sphere is entirely within VF
-|           gxRELATION_INTERSECT = sphere intersects VF
 |
-| Notes: Assumes sphere is in world coordinates.
-|
-|   Doesn't check planes already determined to be inside.  Updates orientation
-|   with any new planes found to be inside.
-|
-| Reference: Tim Round, "Object Occlusion Culling", Game Programming
-|   Gems, DeLoura, pp. 421-431, 2000.
+| Output: Returns position of sphere (in world space) relative to the
+|   default view frustum, skipping planes in orientation the sphere is
+|   already known to be inside of.
 |___________________________________________________________________*/
 
 gxRelation gx3d_Relation_Sphere_Frustum (gx3dSphere *sphere, gx3dFrustumOrientation *orientation)
 {
-  float distance;
-  gx3dVector sphere_view_pos;
-  bool intersecting = false;
-
-/*____________________________________________________________________
-|
-| Verify input params
-|___________________________________________________________________*/
-
-  DEBUG_ASSERT (sphere);
-  DEBUG_ASSERT (sphere->radius > 0);
-  DEBUG_ASSERT (orientation);
-
-/*____________________________________________________________________
-|
-| Init variables
-|___________________________________________________________________*/
-
   if (gx3d_View_frustum_dirty)
     gx3d_UpdateViewFrustum ();
-  
-/*____________________________________________________________________
-|
-| Test sphere center z coordinate against front/back Frustum planes
-|___________________________________________________________________*/
 
-  // Transform z into view space
-  sphere_view_pos.z = gx3d_View_matrix._02 * sphere->center.x +
-                      gx3d_View_matrix._12 * sphere->center.y +
-                      gx3d_View_matrix._22 * sphere->center.z +
-                      gx3d_View_matrix._32;
-
-  // Check only if not already known to be inside near plane
-  if (orientation->inside_near == 0) {
-    // Compute distance to near plane (distance will be positive behind near plane)
-    distance = gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_NEAR].d - sphere_view_pos.z;
-    // Behind near plane?
-    if (distance > sphere->radius)
-      return (gxRELATION_OUTSIDE);
-    // Intersects near plane?
-    else if (-distance <= sphere->radius)
-      intersecting = true;
-    else 
-      // Update orientation
-      orientation->inside_near = 1;
-  }
-
-  // Check only if not already known to be inside far plane
-  if (orientation->inside_far == 0) {
-    // Compute distance to far plane (distance will be positive beyond near plane)
-    distance = sphere_view_pos.z - gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_FAR].d;
-    // Beyond far plane?
-    if (distance > sphere->radius)
-      return (gxRELATION_OUTSIDE);
-    // Intersects far plane?
-    else if (-distance <= sphere->radius)
-      intersecting = true;
-    else 
-      // Udpate orientation
-      orientation->inside_far = 1;
-  }
+  return (Relation_Sphere_Frustum (sphere, &(gx3d_View_context.view_matrix), &(gx3d_View_context.frustum), orientation));
+}
 
 /*____________________________________________________________________
 |
-| Test sphere center x coordinate against left/right Frustum planes
+| Function: gx3d_Relation_Sphere_Frustum
+|
+| Output: Returns position of sphere (in world space) relative to a view
+|   frustum seen through the default view matrix, skipping planes in 
+|   orientation the sphere is already known to be inside of.
 |___________________________________________________________________*/
 
-  // Check only if not already known to be inside both left and right planes
-  if ((orientation->inside_left == 0) OR (orientation->inside_right == 0)) {
-    // Transform x into view space
-    sphere_view_pos.x = gx3d_View_matrix._00 * sphere->center.x +
-                        gx3d_View_matrix._10 * sphere->center.y +
-                        gx3d_View_matrix._20 * sphere->center.z +
-                        gx3d_View_matrix._30;
-
-    // Check only if not already known to be inside left plane
-    if (orientation->inside_left == 0) {
-      // Compute distance to left plane (distance will be negative on left side of left plane)
-      distance = (sphere_view_pos.x * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_LEFT].n.x) +
-                 (sphere_view_pos.z * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_LEFT].n.z);
-      // Left of left plane?
-      if (distance < -sphere->radius) 
-        return (gxRELATION_OUTSIDE);
-      // Intersects left plane?
-      else if (distance <= sphere->radius)
-        intersecting = true;
-      else 
-        // Update orientation
-        orientation->inside_left = 1;
-    }
-
-    // Check only if not already known to be inside right plane
-    if (orientation->inside_right == 0) {
-      // Compute distance to right plane (distance will be negative on right side of right plane)
-      distance = (sphere_view_pos.x * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_RIGHT].n.x) +
-                 (sphere_view_pos.z * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_RIGHT].n.z);
-      // Right of right plane?
-      if (distance < -sphere->radius) 
-        return (gxRELATION_OUTSIDE);
-      // Intersects right plane?
-      else if (distance <= sphere->radius)
-        intersecting = true;
-      else 
-        // Update orientation
-        orientation->inside_right = 1;
-    }
-  }
+gxRelation gx3d_Relation_Sphere_Frustum (
+  gx3dSphere             *sphere, 
+  gx3dViewFrustum        *vf, 
+  gx3dFrustumOrientation *orientation )
+{
+  return (Relation_Sphere_Frustum (sphere, &(gx3d_View_context.view_matrix), vf, orientation));
+}
 
 /*____________________________________________________________________
 |
-| Test sphere center y coordinate against top/bottom, Frustum planes
+| Function: gx3d_Relation_Sphere_Frustum
+|
+| Output: Returns position of sphere (in world space) relative to the view
+|   frustum of a view context, skipping planes in orientation the 
+|   sphere is already known to be inside of.  Only reads the context,
+|   so it can be called from any thread.
 |___________________________________________________________________*/
 
-  // Check only if not already known to be inside both top and bottom planes
-  if ((orientation->inside_top == 0) OR (orientation->inside_bottom == 0)) {
-    // Transform y into view space
-    sphere_view_pos.y = gx3d_View_matrix._01 * sphere->center.x +
-                        gx3d_View_matrix._11 * sphere->center.y +
-                        gx3d_View_matrix._21 * sphere->center.z +
-                        gx3d_View_matrix._31;
-
-    // Check only if not already known to be inside top plane
-    if (orientation->inside_top == 0) {
-      // Compute distance to top plane (distance will be negative above top plane)
-      distance = (sphere_view_pos.y * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_TOP].n.y) +
-                 (sphere_view_pos.z * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_TOP].n.z);
-      // Above top plane?
-      if (distance < -sphere->radius) 
-        return (gxRELATION_OUTSIDE);
-      // Intersects top plane?
-      else if (distance <= sphere->radius)
-        intersecting = true;
-      else 
-        // Update orientation
-        orientation->inside_top = 1;
-    }
-
-    // Check only if not already known to be inside bottom plane
-    if (orientation->inside_bottom == 0) {
-      // Compute distance to bottom plane (distance will be negative below bottom plane)
-      distance = (sphere_view_pos.y * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_BOTTOM].n.y) +
-                 (sphere_view_pos.z * gx3d_View_frustum.plane[gx3d_FRUSTUM_PLANE_BOTTOM].n.z);
-      // Below bottom plane?
-      if (distance < -sphere->radius) 
-        return (gxRELATION_OUTSIDE);
-      else if (intersecting OR (distance <= sphere->radius))
-        return (gxRELATION_INTERSECT);
-      else
-        // Update orientation
-        orientation->inside_bottom = 1;
-    }
-  }
+gxRelation gx3d_Relation_Sphere_Frustum (
+  gx3dViewContext        *context,
+  gx3dSphere             *sphere, 
+  gx3dFrustumOrientation *orientation )
+{
+  DEBUG_ASSERT (context);
 
-  return (gxRELATION_INSIDE);
+  return (Relation_Sphere_Frustum (sphere, &(context->view_matrix), &(context->frustum), orientation));
 }
 
 /*____________________________________________________________________
 |
-| Function: gx3d_Relation_Sphere_Frustum
-|                                                                                        
+| Function: Relation_Sphere_Frustum
+|
+| Input: Called from gx3d_Relation_Sphere_Frustum()
 | Output: Returns position of sphere (in world space) relative to the
 |   a view Frustum.
 |
@@ -2089,8 +1832,9 @@ gxRelation gx3d_Relation_Sphere_Frustum (gx3dSphere *sphere, gx3dFrustumOrientat
 |   Gems, DeLoura, pp. 421-431, 2000.
 |___________________________________________________________________*/
 
-gxRelation gx3d_Relation_Sphere_Frustum (
+static gxRelation Relation_Sphere_Frustum (
   gx3dSphere             *sphere, 
+  gx3dMatrix             *view_matrix, 
   gx3dViewFrustum        *vf, 
   gx3dFrustumOrientation *orientation )
 {
@@ -2105,6 +1849,7 @@ gxRelation gx3d_Relation_Sphere_Frustum (
 
   DEBUG_ASSERT (sphere);
   DEBUG_ASSERT (sphere->radius > 0);
+  DEBUG_ASSERT (view_matrix);
   DEBUG_ASSERT (vf);
   DEBUG_ASSERT (orientation);
 
@@ -2114,10 +1859,10 @@ gxRelation gx3d_Relation_Sphere_Frustum (
 |___________________________________________________________________*/
 
   // Transform z into view space
-  sphere_view_pos.z = gx3d_View_matrix._02 * sphere->center.x +
-                      gx3d_View_matrix._12 * sphere->center.y +
-                      gx3d_View_matrix._22 * sphere->center.z +
-                      gx3d_View_matrix._32;
+  sphere_view_pos.z = view_matrix->_02 * sphere->center.x +
+                      view_matrix->_12 * sphere->center.y +
+                      view_matrix->_22 * sphere->center.z +
+                      view_matrix->_32;
 
   // Check only if not already known to be inside near plane
   if (orientation->inside_near == 0) {
@@ -2157,10 +1902,10 @@ gxRelation gx3d_Relation_Sphere_Frustum (
   // Check only if not already known to be inside both left and right planes
   if ((orientation->inside_left == 0) OR (orientation->inside_right == 0)) {
     // Transform x into view space
-    sphere_view_pos.x = gx3d_View_matrix._00 * sphere->center.x +
-                        gx3d_View_matrix._10 * sphere->center.y +
-                        gx3d_View_matrix._20 * sphere->center.z +
-                        gx3d_View_matrix._30;
+    sphere_view_pos.x = view_matrix->_00 * sphere->center.x +
+                        view_matrix->_10 * sphere->center.y +
+                        view_matrix->_20 * sphere->center.z +
+                        view_matrix->_30;
 
     // Check only if not already known to be inside left plane
     if (orientation->inside_left == 0) {
@@ -2203,10 +1948,10 @@ gxRelation gx3d_Relation_Sphere_Frustum (
   // Check only if not already known to be inside both top and bottom planes
   if ((orientation->inside_top == 0) OR (orientation->inside_bottom == 0)) {
     // Transform y into view space
-    sphere_view_pos.y = gx3d_View_matrix._01 * sphere->center.x +
-                        gx3d_View_matrix._11 * sphere->center.y +
-                        gx3d_View_matrix._21 * sphere->center.z +
-                        gx3d_View_matrix._31;
+    sphere_view_pos.y = view_matrix->_01 * sphere->center.x +
+                        view_matrix->_11 * sphere->center.y +
+                        view_matrix->_21 * sphere->center.z +
+                        view_matrix->_31;
 
     // Check only if not already known to be inside top plane
     if (orientation->inside_top == 0) {
@@ -2246,8 +1991,49 @@ gxRelation gx3d_Relation_Sphere_Frustum (
 /*____________________________________________________________________
 |
 | Function: gx3d_Relation_Box_Frustum
-|                                                                                        
-| Output: Returns position of sphere relative to the default view frustum.
+|
+| Output: Returns position of box relative to the default view frustum.  Box
+|   is axis-aligned but is transformed by box_transform matrix 
+|   (typically a object to world transform), which can makes it an 
+|   oriented box.
+|___________________________________________________________________*/
+
+gxRelation gx3d_Relation_Box_Frustum (
+  gx3dBox    *box, 
+  gx3dMatrix *box_transform ) // to transform AAB into world space
+{
+  if (gx3d_View_projection_matrix_dirty)
+    gx3d_UpdateViewProjectionMatrix ();
+
+  return (Relation_Box_Frustum (box, box_transform, &(gx3d_View_context.view_projection_matrix)));
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Relation_Box_Frustum
+|
+| Output: Returns position of box relative to the view frustum of a view 
+|   context.  Box is transformed by box_transform matrix.  Only reads
+|   the context, so it can be called from any thread.
+|___________________________________________________________________*/
+
+gxRelation gx3d_Relation_Box_Frustum (
+  gx3dViewContext *context,
+  gx3dBox         *box, 
+  gx3dMatrix      *box_transform ) // to transform AAB into world space
+{
+  DEBUG_ASSERT (context);
+
+  return (Relation_Box_Frustum (box, box_transform, &(context->view_projection_matrix)));
+}
+
+/*____________________________________________________________________
+|
+| Function: Relation_Box_Frustum
+|
+| Input: Called from gx3d_Relation_Box_Frustum()
+| Output: Returns position of a box relative to the view frustum of a
+|   view * projection matrix.
 |   Box is axis-aligned but is transformed by box_transform matrix
 |   (typically a object to world transform), which can makes it an 
 |   oriented box.
@@ -2267,9 +2053,10 @@ gxRelation gx3d_Relation_Sphere_Frustum (
 #define OUT_NEAR    0x10
 #define OUT_FAR     0x20
 
-gxRelation gx3d_Relation_Box_Frustum (
+static gxRelation Relation_Box_Frustum (
   gx3dBox    *box, 
-  gx3dMatrix *box_transform ) // to transform AAB into world space
+  gx3dMatrix *box_transform,           // to transform AAB into world space
+  gx3dMatrix *view_projection_matrix )
 {
   int i;
   byte outcode[8], code;
@@ -2284,14 +2071,7 @@ gxRelation gx3d_Relation_Box_Frustum (
 
   DEBUG_ASSERT (box);
   DEBUG_ASSERT (box_transform);
-
-/*____________________________________________________________________
-|
-| Init variables
-|___________________________________________________________________*/
-
-  if (gx3d_View_projection_matrix_dirty)
-    gx3d_UpdateViewProjectionMatrix ();
+  DEBUG_ASSERT (view_projection_matrix);
 
 /*____________________________________________________________________
 |
@@ -2299,7 +2079,7 @@ gxRelation gx3d_Relation_Box_Frustum (
 |___________________________________________________________________*/
 
   // Get matrix to transform object bounding box into projection space
-  gx3d_MultiplyMatrix (box_transform, &gx3d_View_projection_matrix, &m);
+  gx3d_MultiplyMatrix (box_transform, view_projection_matrix, &m);
 
   // Init points of the bounding box
   point[0].x = box->min.x; // front left bottom corner
@@ -2326,12 +2106,15 @@ gxRelation gx3d_Relation_Box_Frustum (
   point[7].x = box->max.x; // back right top corner
   point[7].y = box->max.y;
   point[7].z = box->max.z;
+  for (i=0; i<8; i++)
+    point[i].w = 1;
+
+  // Transform the points into projection space
+  gx3d_MultiplyVector4DArrayMatrix (point, &m, point, 8);
 
   // Compute outcodes
   for (i=0; i<8; i++) {
     outcode[i] = 0;
-    point[i].w = 1;
-    gx3d_MultiplyVector4DMatrix (&point[i], &m, &point[i]);
     // Is point left of left clip plane?
     if (point[i].x < -point[i].w)
       outcode[i] |= OUT_LEFT;
@@ -2403,7 +2186,6 @@ gxRelation gx3d_Relation_Box_Frustum (
 gxRelation gx3d_Relation_Box_Frustum (gx3dBox *box, gx3dWorldFrustum *wf)
 {
   int i;
-  float min_distance, max_distance;
   gx3dVector vmin, vmax;
   bool intersecting = false;
 
@@ -2417,43 +2199,17 @@ gxRelation gx3d_Relation_Box_Frustum (gx3dBox *box, gx3dWorldFrustum *wf)
 
 /*____________________________________________________________________
 |
-| Test box against near/far Frustum planes
+| Test box against all Frustum planes
 |___________________________________________________________________*/
 
-  GET_BOX_DIAGONAL (gx3d_FRUSTUM_PLANE_NEAR)
-
-  // Compute min distance to origin
-  min_distance = gx3d_Distance_Point_Plane (&vmin, &(wf->plane[gx3d_FRUSTUM_PLANE_NEAR]));
-  
-  // Behind near plane?
-  if (min_distance < wf->plane[gx3d_FRUSTUM_PLANE_NEAR].d)
-    return (gxRELATION_OUTSIDE);
-  // Compute max distance to origin
-  max_distance = gx3d_Distance_Point_Plane (&vmax, &(wf->plane[gx3d_FRUSTUM_PLANE_NEAR]));
-  // Intersects near plane?
-  if (max_distance <= wf->plane[gx3d_FRUSTUM_PLANE_NEAR].d)
-    intersecting = true;
-  
-  // Beyond far plane?
-  if (max_distance > wf->plane[gx3d_FRUSTUM_PLANE_FAR].d)
-    return (gxRELATION_OUTSIDE);
-  // Intersects far plane?
-  else if (min_distance >= wf->plane[gx3d_FRUSTUM_PLANE_FAR].d)
-    intersecting = true;
-
-/*____________________________________________________________________
-|
-| Test box against left,right,top,bottom Frustum planes
-|___________________________________________________________________*/
-
-  for (i=gx3d_FRUSTUM_PLANE_LEFT; i<gx3d_NUM_FRUSTUM_PLANES; i++) {     
+  for (i=0; i<gx3d_NUM_FRUSTUM_PLANES; i++) {     
     GET_BOX_DIAGONAL (i)
-   // Outside plane?
-   if (gx3d_Distance_Point_Plane (&vmin, &(wf->plane[i])) < 0)
-     return (gxRELATION_OUTSIDE);
-   // Intersects plane?
-   else if (gx3d_Distance_Point_Plane (&vmax, &(wf->plane[i])) <= 0)
-     intersecting = true;
+    // Outside plane? (corner farthest along the plane normal is outside)
+    if (gx3d_Distance_Point_Plane (&vmax, &(wf->plane[i])) < 0)
+      return (gxRELATION_OUTSIDE);
+    // Intersects plane? (corner farthest behind the plane normal is outside)
+    else if (gx3d_Distance_Point_Plane (&vmin, &(wf->plane[i])) < 0)
+      intersecting = true;
   }
 
 /*____________________________________________________________________
@@ -2497,7 +2253,6 @@ gxRelation gx3d_Relation_Box_Frustum (gx3dBox *box, gx3dWorldFrustum *wf)
 
 gxRelation gx3d_Relation_Box_Frustum (gx3dBox *box, gx3dWorldFrustum *wf, gx3dFrustumOrientation *orientation)
 {
-  float min_distance, max_distance;
   gx3dVector vmin, vmax;
   bool intersecting = false;
 
@@ -2512,35 +2267,39 @@ gxRelation gx3d_Relation_Box_Frustum (gx3dBox *box, gx3dWorldFrustum *wf, gx3dFr
 
 /*____________________________________________________________________
 |
-| Test box against near/far frustum planes
+| Test box against near frustum plane
 |___________________________________________________________________*/
 
-  GET_BOX_DIAGONAL (gx3d_FRUSTUM_PLANE_NEAR)
-
-  // Check only if not already known to be inside near or far planes
-  if ((orientation->inside_near == 0) OR (orientation->inside_far == 0)) {
-    // Compute min distance to origin
-    min_distance = gx3d_Distance_Point_Plane (&vmin, &(wf->plane[gx3d_FRUSTUM_PLANE_NEAR]));
-    // Behind near plane?
-    if (min_distance < wf->plane[gx3d_FRUSTUM_PLANE_NEAR].d)
+  // Check only if not already known to be inside plane
+  if (orientation->inside_near == 0) {
+    GET_BOX_DIAGONAL (gx3d_FRUSTUM_PLANE_NEAR)
+    // Outside plane?
+    if (gx3d_Distance_Point_Plane (&vmax, &(wf->plane[gx3d_FRUSTUM_PLANE_NEAR])) < 0)
       return (gxRELATION_OUTSIDE);
-    // Compute max distance to origin
-    max_distance = gx3d_Distance_Point_Plane (&vmax, &(wf->plane[gx3d_FRUSTUM_PLANE_NEAR]));
-    // Intersects near plane?
-    if (max_distance <= wf->plane[gx3d_FRUSTUM_PLANE_NEAR].d)
+    // Intersects plane?
+    else if (gx3d_Distance_Point_Plane (&vmin, &(wf->plane[gx3d_FRUSTUM_PLANE_NEAR])) < 0)
       intersecting = true;
-    else 
-      // Update orientation
+    // Update orientation
+    else
       orientation->inside_near = 1;
-    
-    // Beyond far plane?
-    if (max_distance > wf->plane[gx3d_FRUSTUM_PLANE_FAR].d)
+  }
+
+/*____________________________________________________________________
+|
+| Test box against far frustum plane
+|___________________________________________________________________*/
+
+  // Check only if not already known to be inside plane
+  if (orientation->inside_far == 0) {
+    GET_BOX_DIAGONAL (gx3d_FRUSTUM_PLANE_FAR)
+    // Outside plane?
+    if (gx3d_Distance_Point_Plane (&vmax, &(wf->plane[gx3d_FRUSTUM_PLANE_FAR])) < 0)
       return (gxRELATION_OUTSIDE);
-    // Intersects far plane?
-    else if (min_distance >= wf->plane[gx3d_FRUSTUM_PLANE_FAR].d)
+    // Intersects plane?
+    else if (gx3d_Distance_Point_Plane (&vmin, &(wf->plane[gx3d_FRUSTUM_PLANE_FAR])) < 0)
       intersecting = true;
-    else 
-      // Update orientation
+    // Update orientation
+    else
       orientation->inside_far = 1;
   }
 
@@ -2553,10 +2312,10 @@ gxRelation gx3d_Relation_Box_Frustum (gx3dBox *box, gx3dWorldFrustum *wf, gx3dFr
   if (orientation->inside_left == 0) {
     GET_BOX_DIAGONAL (gx3d_FRUSTUM_PLANE_LEFT)
     // Outside plane?
-    if (gx3d_Distance_Point_Plane (&vmin, &(wf->plane[gx3d_FRUSTUM_PLANE_LEFT])) < 0)
+    if (gx3d_Distance_Point_Plane (&vmax, &(wf->plane[gx3d_FRUSTUM_PLANE_LEFT])) < 0)
       return (gxRELATION_OUTSIDE);
     // Intersects plane?
-    else if (gx3d_Distance_Point_Plane (&vmax, &(wf->plane[gx3d_FRUSTUM_PLANE_LEFT])) <= 0)
+    else if (gx3d_Distance_Point_Plane (&vmin, &(wf->plane[gx3d_FRUSTUM_PLANE_LEFT])) < 0)
       intersecting = true;
     // Update orientation
     else
@@ -2572,10 +2331,10 @@ gxRelation gx3d_Relation_Box_Frustum (gx3dBox *box, gx3dWorldFrustum *wf, gx3dFr
   if (orientation->inside_right == 0) {
     GET_BOX_DIAGONAL (gx3d_FRUSTUM_PLANE_RIGHT)
     // Outside plane?
-    if (gx3d_Distance_Point_Plane (&vmin, &(wf->plane[gx3d_FRUSTUM_PLANE_RIGHT])) < 0)
+    if (gx3d_Distance_Point_Plane (&vmax, &(wf->plane[gx3d_FRUSTUM_PLANE_RIGHT])) < 0)
       return (gxRELATION_OUTSIDE);
     // Intersects plane?
-    else if (gx3d_Distance_Point_Plane (&vmax, &(wf->plane[gx3d_FRUSTUM_PLANE_RIGHT])) <= 0)
+    else if (gx3d_Distance_Point_Plane (&vmin, &(wf->plane[gx3d_FRUSTUM_PLANE_RIGHT])) < 0)
       intersecting = true;
     // Update orientation
     else
@@ -2591,10 +2350,10 @@ gxRelation gx3d_Relation_Box_Frustum (gx3dBox *box, gx3dWorldFrustum *wf, gx3dFr
   if (orientation->inside_top == 0) {
     GET_BOX_DIAGONAL (gx3d_FRUSTUM_PLANE_TOP)
     // Outside plane?
-    if (gx3d_Distance_Point_Plane (&vmin, &(wf->plane[gx3d_FRUSTUM_PLANE_TOP])) < 0)
+    if (gx3d_Distance_Point_Plane (&vmax, &(wf->plane[gx3d_FRUSTUM_PLANE_TOP])) < 0)
       return (gxRELATION_OUTSIDE);
     // Intersects plane?
-    else if (gx3d_Distance_Point_Plane (&vmax, &(wf->plane[gx3d_FRUSTUM_PLANE_TOP])) <= 0)
+    else if (gx3d_Distance_Point_Plane (&vmin, &(wf->plane[gx3d_FRUSTUM_PLANE_TOP])) < 0)
       intersecting = true;
     // Update orientation
     else
@@ -2610,10 +2369,10 @@ gxRelation gx3d_Relation_Box_Frustum (gx3dBox *box, gx3dWorldFrustum *wf, gx3dFr
   if (orientation->inside_bottom == 0) {
     GET_BOX_DIAGONAL (gx3d_FRUSTUM_PLANE_BOTTOM)
     // Outside plane?
-    if (gx3d_Distance_Point_Plane (&vmin, &(wf->plane[gx3d_FRUSTUM_PLANE_BOTTOM])) < 0)
+    if (gx3d_Distance_Point_Plane (&vmax, &(wf->plane[gx3d_FRUSTUM_PLANE_BOTTOM])) < 0)
       return (gxRELATION_OUTSIDE);
     // Intersects plane?
-    else if (gx3d_Distance_Point_Plane (&vmax, &(wf->plane[gx3d_FRUSTUM_PLANE_BOTTOM])) <= 0)
+    else if (gx3d_Distance_Point_Plane (&vmin, &(wf->plane[gx3d_FRUSTUM_PLANE_BOTTOM])) < 0)
       intersecting = true;
     // Update orientation
     else
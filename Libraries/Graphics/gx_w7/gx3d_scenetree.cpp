@@ -0,0 +1,888 @@
+/*____________________________________________________________________
+|
+| File: gx3d_scenetree.cpp
+|
+| Description: Functions to manipulate gx3dScenetree.
+|
+| Functions: gx3d_Scenetree_Init
+|            gx3d_Scenetree_Free
+|            gx3d_Scenetree_AddInstance
+|             Set_Instance_Transform
+|            gx3d_Scenetree_RemoveInstance
+|            gx3d_Scenetree_SetInstanceTransform
+|            gx3d_Scenetree_Update
+|             Make_Tree
+|              Make_Subtree
+|               Partition_Instances
+|                Get_Center
+|             Refit_Tree
+|            gx3d_Scenetree_Intersect_Ray
+|             Intersect_Ray_Instance
+|            gx3d_Scenetree_Intersect_Sphere
+|             Intersect_Sphere_Instance
+|            gx3d_Scenetree_Intersect_Frustum
+|
+| Description: A scenetree is a two-level bounding volume hierarchy.
+|   The top level is a bvh over the world space bound boxes of object
+|   instances.  Each instance has an object to world transform and
+|   points to the boxtree of its object, which is the bottom level.
+|   Many instances can share the same boxtree.
+|
+|   Queries are transformed into the object space of each instance
+|   reached in the top level and then use the boxtree of the instance,
+|   so finding the nearest instance and poly takes logarithmic time in
+|   the # of instances.
+|
+|   When instances move (gx3d_Scenetree_SetInstanceTransform()) the bvh
+|   is refit bottom-up.  When instances are added or removed the bvh is
+|   rebuilt.  Either happens at the next query or call to
+|   gx3d_Scenetree_Update().
+|
+|   Instance transforms must be made of rotation, uniform scale and
+|   translation.
+|
+| (C) Copyright 2017 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|
+| DEBUG_ASSERTED!
+|___________________________________________________________________*/
+
+//#define DEBUG
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+
+#include <math.h>
+
+#include "dp.h"
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define MAX_LEAF_INSTANCES  2     // don't split a node with this many instances or less
+#define MAX_STACK_NODES     64    // max depth of bvh (balanced so this is never reached)
+#define MAX_CONTACTS        32    // # sphere contacts checked without allocating memory
+#define INV_DIRECTION_MAX   1e30f // used as reciprocal of a 0 ray direction component
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+// Node of bvh to visit in a frustum query
+typedef struct {
+  int                    node;
+  gx3dFrustumOrientation orientation;    // planes the node is known to be inside of
+} Frustum_Stack_Entry;
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static bool  Set_Instance_Transform (gx3dScenetreeInstance *instance, gx3dMatrix *transform);
+static bool  Make_Tree (gx3dScenetree *scenetree);
+static int   Make_Subtree (gx3dScenetree *scenetree, int first, int num_instances, int *num_nodes);
+static void  Partition_Instances (gx3dScenetree *scenetree, int first, int num_instances, int axis);
+static inline float Get_Center (gx3dScenetree *scenetree, int index, int axis);
+static void  Refit_Tree (gx3dScenetree *scenetree);
+static bool  Intersect_Ray_Instance (
+  gx3dScenetree    *scenetree,
+  int               instance,
+  gx3dRay          *ray,
+  float             ray_length,
+  gx3dScenetreeHit *hit );
+static bool  Intersect_Sphere_Instance (
+  gx3dScenetree    *scenetree,
+  int               instance,
+  gx3dSphere       *sphere,
+  gx3dScenetreeHit *hit );
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Scenetree_Init
+|
+| Output: Creates an empty scenetree with room for max_instances
+|   instances.  More room is allocated as needed.
+|___________________________________________________________________*/
+
+gx3dScenetree *gx3d_Scenetree_Init (int max_instances)
+{
+  bool error;
+  gx3dScenetree *scenetree = 0;
+
+  error = false;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (max_instances > 0);
+
+/*____________________________________________________________________
+|
+| Allocate memory
+|___________________________________________________________________*/
+
+  scenetree = (gx3dScenetree *) calloc (1, sizeof(gx3dScenetree));
+  if (scenetree == 0)
+    error = true;
+  else {
+    scenetree->instance = (gx3dScenetreeInstance *) calloc (max_instances, sizeof(gx3dScenetreeInstance));
+    if (scenetree->instance == 0)
+      error = true;
+    scenetree->instance_index = (int *) calloc (max_instances, sizeof(int));
+    if (scenetree->instance_index == 0)
+      error = true;
+    scenetree->node = (gx3dScenetreeNode *) calloc (2*max_instances-1, sizeof(gx3dScenetreeNode));
+    if (scenetree->node == 0)
+      error = true;
+    scenetree->max_instances = max_instances;
+  }
+
+/*____________________________________________________________________
+|
+| On any error, free memory
+|___________________________________________________________________*/
+
+  if (error) {
+    gx3d_Scenetree_Free (scenetree);
+    scenetree = 0;
+  }
+
+  return (scenetree);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Scenetree_Free
+|
+| Output: Frees all memory for a scenetree.  Doesn't free the boxtrees
+|   of the instances.
+|___________________________________________________________________*/
+
+void gx3d_Scenetree_Free (gx3dScenetree *scenetree)
+{
+  if (scenetree) {
+    if (scenetree->instance)
+      free (scenetree->instance);
+    if (scenetree->instance_index)
+      free (scenetree->instance_index);
+    if (scenetree->node)
+      free (scenetree->node);
+    free (scenetree);
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Scenetree_AddInstance
+|
+| Output: Adds an instance of an object (its boxtree) to a scenetree.
+|   Returns id of the new instance or -1 on any error.
+|___________________________________________________________________*/
+
+int gx3d_Scenetree_AddInstance (gx3dScenetree *scenetree, gx3dBoxtree *boxtree, gx3dMatrix *transform, void *data)
+{
+  int i, n;
+  gx3dScenetreeInstance *instance;
+  int *instance_index;
+  gx3dScenetreeNode *node;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (scenetree);
+  DEBUG_ASSERT (boxtree);
+  DEBUG_ASSERT (transform);
+
+/*____________________________________________________________________
+|
+| Find an unused entry
+|___________________________________________________________________*/
+
+  for (i=0; i<scenetree->max_instances; i++)
+    if (NOT scenetree->instance[i].active)
+      break;
+
+  // Out of room?
+  if (i == scenetree->max_instances) {
+    n = 2 * scenetree->max_instances;
+    instance       = (gx3dScenetreeInstance *) realloc (scenetree->instance,       n * sizeof(gx3dScenetreeInstance));
+    if (instance)
+      scenetree->instance = instance;
+    instance_index = (int *)                   realloc (scenetree->instance_index, n * sizeof(int));
+    if (instance_index)
+      scenetree->instance_index = instance_index;
+    node           = (gx3dScenetreeNode *)     realloc (scenetree->node,           (2*n-1) * sizeof(gx3dScenetreeNode));
+    if (node)
+      scenetree->node = node;
+    if ((instance == 0) OR (instance_index == 0) OR (node == 0)) {
+      gxError ("gx3d_Scenetree_AddInstance(): Can't allocate memory");
+      return (-1);
+    }
+    memset (&(scenetree->instance[scenetree->max_instances]), 0, (n - scenetree->max_instances) * sizeof(gx3dScenetreeInstance));
+    scenetree->max_instances = n;
+  }
+
+/*____________________________________________________________________
+|
+| Init the instance
+|___________________________________________________________________*/
+
+  instance = &(scenetree->instance[i]);
+  instance->boxtree = boxtree;
+  instance->data    = data;
+  if (NOT Set_Instance_Transform (instance, transform)) {
+    gxError ("gx3d_Scenetree_AddInstance(): Transform can't be inverted");
+    return (-1);
+  }
+  instance->active = true;
+  scenetree->num_instances++;
+  scenetree->rebuild = true;
+
+  return (i);
+}
+
+/*____________________________________________________________________
+|
+| Function: Set_Instance_Transform
+|
+| Input: Called from gx3d_Scenetree_AddInstance(),
+|   gx3d_Scenetree_SetInstanceTransform()
+| Output: Sets the transforms and world space bound box of an instance.
+|   Returns false if the transform can't be inverted.
+|___________________________________________________________________*/
+
+static bool Set_Instance_Transform (gx3dScenetreeInstance *instance, gx3dMatrix *transform)
+{
+  gx3dAffineMatrix a, ainverse;
+  bool ok;
+
+  gx3d_MatrixToAffineMatrix (transform, &a);
+  ok = (gx3d_GetInverseAffineMatrix (&a, &ainverse) != FALSE);
+  if (ok) {
+    gx3d_AffineMatrixToMatrix (&ainverse, &(instance->inverse_transform));
+    instance->transform = *transform;
+    instance->scale = sqrtf (transform->_00 * transform->_00 + transform->_01 * transform->_01 + transform->_02 * transform->_02);
+    gx3d_TransformBoundBox (&(instance->boxtree->box), transform, &(instance->box));
+  }
+
+  return (ok);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Scenetree_RemoveInstance
+|
+| Output: Removes an instance from a scenetree.
+|___________________________________________________________________*/
+
+void gx3d_Scenetree_RemoveInstance (gx3dScenetree *scenetree, int instance)
+{
+  DEBUG_ASSERT (scenetree);
+  DEBUG_ASSERT ((instance >= 0) AND (instance < scenetree->max_instances));
+  DEBUG_ASSERT (scenetree->instance[instance].active);
+
+  if (scenetree->instance[instance].active) {
+    scenetree->instance[instance].active = false;
+    scenetree->num_instances--;
+    scenetree->rebuild = true;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Scenetree_SetInstanceTransform
+|
+| Output: Sets the object to world transform of an instance.  Should
+|   also be called (with the same transform) after the boxtree of the
+|   instance is updated, since its bound box may have changed.
+|___________________________________________________________________*/
+
+void gx3d_Scenetree_SetInstanceTransform (gx3dScenetree *scenetree, int instance, gx3dMatrix *transform)
+{
+  DEBUG_ASSERT (scenetree);
+  DEBUG_ASSERT ((instance >= 0) AND (instance < scenetree->max_instances));
+  DEBUG_ASSERT (scenetree->instance[instance].active);
+  DEBUG_ASSERT (transform);
+
+  if (NOT Set_Instance_Transform (&(scenetree->instance[instance]), transform))
+    gxError ("gx3d_Scenetree_SetInstanceTransform(): Transform can't be inverted");
+  scenetree->dirty = true;
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Scenetree_Update
+|
+| Output: Rebuilds the bvh of a scenetree if instances were added or
+|   removed, else refits it if any instances moved.  Called by all
+|   query functions so calling it directly is optional.
+|___________________________________________________________________*/
+
+void gx3d_Scenetree_Update (gx3dScenetree *scenetree)
+{
+  DEBUG_ASSERT (scenetree);
+
+  if (scenetree->rebuild)
+    Make_Tree (scenetree);
+  else if (scenetree->dirty)
+    Refit_Tree (scenetree);
+  scenetree->rebuild = false;
+  scenetree->dirty   = false;
+}
+
+/*____________________________________________________________________
+|
+| Function: Make_Tree
+|
+| Input: Called from gx3d_Scenetree_Update()
+| Output: Builds the bvh of a scenetree from the active instances.
+|   Returns true on success or false on any error.
+|___________________________________________________________________*/
+
+static bool Make_Tree (gx3dScenetree *scenetree)
+{
+  int i, n;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (scenetree);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  // Make list of active instances
+  for (i=0, n=0; i<scenetree->max_instances; i++)
+    if (scenetree->instance[i].active)
+      scenetree->instance_index[n++] = i;
+  DEBUG_ASSERT (n == scenetree->num_instances);
+
+  scenetree->num_nodes = 0;
+  if (n)
+    Make_Subtree (scenetree, 0, n, &(scenetree->num_nodes));
+
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: Make_Subtree
+|
+| Input: Called from Make_Tree(), Make_Subtree()
+| Output: Creates a subtree for a range of instances (in instance_index)
+|   and returns index of its root node.  Nodes are added in depth-first
+|   order.  Each node is split at the median instance center along the
+|   longest axis of its box, so the bvh is balanced.
+|___________________________________________________________________*/
+
+static int Make_Subtree (gx3dScenetree *scenetree, int first, int num_instances, int *num_nodes)
+{
+  int i, n, axis;
+  float dx, dy, dz;
+  gx3dScenetreeNode *node;
+
+  n = (*num_nodes)++;
+  node = &(scenetree->node[n]);
+
+  // Compute box of this node
+  node->box = scenetree->instance[scenetree->instance_index[first]].box;
+  for (i=first+1; i<first+num_instances; i++)
+    gx3d_EncloseBoundBox (&(node->box), &(scenetree->instance[scenetree->instance_index[i]].box));
+
+  // Make a terminal node?
+  if (num_instances <= MAX_LEAF_INSTANCES) {
+    node->offset        = first;
+    node->num_instances = num_instances;
+  }
+  else {
+    // Split on longest axis
+    dx = node->box.max.x - node->box.min.x;
+    dy = node->box.max.y - node->box.min.y;
+    dz = node->box.max.z - node->box.min.z;
+    if ((dx >= dy) AND (dx >= dz))
+      axis = 0;
+    else if (dy >= dz)
+      axis = 1;
+    else
+      axis = 2;
+    Partition_Instances (scenetree, first, num_instances, axis);
+    // Create children (left child is the next node)
+    node->num_instances = 0;
+    Make_Subtree (scenetree, first, num_instances/2, num_nodes);
+    scenetree->node[n].offset = Make_Subtree (scenetree, first + num_instances/2, num_instances - num_instances/2, num_nodes);
+  }
+
+  return (n);
+}
+
+/*____________________________________________________________________
+|
+| Function: Partition_Instances
+|
+| Input: Called from Make_Subtree()
+| Output: Reorders a range of instances (in instance_index) so the
+|   first half have centers on axis no greater than the second half
+|   (quickselect of the median).
+|___________________________________________________________________*/
+
+static void Partition_Instances (gx3dScenetree *scenetree, int first, int num_instances, int axis)
+{
+  int i, j, left, right, middle, temp;
+  float pivot;
+
+  left   = first;
+  right  = first + num_instances - 1;
+  middle = first + num_instances/2;
+  while (left < right) {
+    pivot = Get_Center (scenetree, (left + right) / 2, axis);
+    i = left;
+    j = right;
+    while (i <= j) {
+      while (Get_Center (scenetree, i, axis) < pivot)
+        i++;
+      while (Get_Center (scenetree, j, axis) > pivot)
+        j--;
+      if (i <= j) {
+        temp = scenetree->instance_index[i];
+        scenetree->instance_index[i] = scenetree->instance_index[j];
+        scenetree->instance_index[j] = temp;
+        i++;
+        j--;
+      }
+    }
+    if (middle <= j)
+      right = j;
+    else if (middle >= i)
+      left = i;
+    else
+      break;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Center
+|
+| Input: Called from Partition_Instances()
+| Output: Returns center (times 2) of bound box of an instance on an
+|   axis.
+|___________________________________________________________________*/
+
+static inline float Get_Center (gx3dScenetree *scenetree, int index, int axis)
+{
+  gx3dBox *box = &(scenetree->instance[scenetree->instance_index[index]].box);
+
+  return (((float *)&(box->min))[axis] + ((float *)&(box->max))[axis]);
+}
+
+/*____________________________________________________________________
+|
+| Function: Refit_Tree
+|
+| Input: Called from gx3d_Scenetree_Update()
+| Output: Refits boxes of the bvh to the current instance boxes,
+|   bottom-up.  Since the nodes are in depth-first order, children
+|   always follow their parent so going through the node array in
+|   reverse refits children first.
+|___________________________________________________________________*/
+
+static void Refit_Tree (gx3dScenetree *scenetree)
+{
+  int i, j;
+  gx3dScenetreeNode *node;
+
+  for (i=scenetree->num_nodes-1; i>=0; i--) {
+    node = &(scenetree->node[i]);
+    // Is this a terminal node?
+    if (node->num_instances) {
+      node->box = scenetree->instance[scenetree->instance_index[node->offset]].box;
+      for (j=node->offset+1; j<(int)(node->offset+node->num_instances); j++)
+        gx3d_EncloseBoundBox (&(node->box), &(scenetree->instance[scenetree->instance_index[j]].box));
+    }
+    else {
+      node->box = scenetree->node[i+1].box;
+      gx3d_EncloseBoundBox (&(node->box), &(scenetree->node[node->offset].box));
+    }
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Scenetree_Intersect_Ray
+|
+| Output: Finds the nearest poly of any instance in a scenetree hit by a
+|   ray.
+|
+|   Returns gxRELATION_OUTSIDE   = ray doesn't intersect any instance
+|           gxRELATION_INTERSECT = ray intersects a poly (nearest poly
+|                                  returned in hit)
+|___________________________________________________________________*/
+
+gxRelation gx3d_Scenetree_Intersect_Ray (
+  gx3dScenetree    *scenetree,
+  gx3dRay          *ray,
+  float             ray_length,
+  gx3dScenetreeHit *hit )
+{
+  int i, n, near_child, far_child, num_stack;
+  int stack[MAX_STACK_NODES];
+  float distance, near_distance, far_distance;
+  bool near_hit, far_hit;
+  gx3dVector inv_direction;
+  gx3dScenetreeNode *node;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (scenetree);
+  DEBUG_ASSERT (ray);
+  DEBUG_ASSERT (ray_length > 0);
+  DEBUG_ASSERT (hit);
+
+/*____________________________________________________________________
+|
+| Init variables
+|___________________________________________________________________*/
+
+  if (scenetree->rebuild OR scenetree->dirty)
+    gx3d_Scenetree_Update (scenetree);
+
+  hit->instance = -1;
+  hit->distance = ray_length;
+
+  inv_direction.x = (ray->direction.x == 0) ? INV_DIRECTION_MAX : 1 / ray->direction.x;
+  inv_direction.y = (ray->direction.y == 0) ? INV_DIRECTION_MAX : 1 / ray->direction.y;
+  inv_direction.z = (ray->direction.z == 0) ? INV_DIRECTION_MAX : 1 / ray->direction.z;
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  num_stack = 0;
+  if (scenetree->num_nodes)
+    if (gx3d_Intersect_Ray_Box (&(ray->origin), &inv_direction, hit->distance, &(scenetree->node[0].box), &distance) == gxRELATION_INTERSECT)
+      stack[num_stack++] = 0;
+
+  while (num_stack) {
+    n = stack[--num_stack];
+    node = &(scenetree->node[n]);
+    // Is this a terminal node?
+    if (node->num_instances) {
+      for (i=node->offset; i<(int)(node->offset+node->num_instances); i++)
+        if (gx3d_Intersect_Ray_Box (&(ray->origin), &inv_direction, hit->distance, &(scenetree->instance[scenetree->instance_index[i]].box), &distance) == gxRELATION_INTERSECT)
+          Intersect_Ray_Instance (scenetree, scenetree->instance_index[i], ray, hit->distance, hit);
+    }
+    else {
+      // Visit the nearest child first (so the farther one is more likely to be culled)
+      near_child = n+1;
+      far_child  = node->offset;
+      near_hit = (gx3d_Intersect_Ray_Box (&(ray->origin), &inv_direction, hit->distance, &(scenetree->node[near_child].box), &near_distance) == gxRELATION_INTERSECT);
+      far_hit  = (gx3d_Intersect_Ray_Box (&(ray->origin), &inv_direction, hit->distance, &(scenetree->node[far_child].box), &far_distance) == gxRELATION_INTERSECT);
+      if (near_hit AND far_hit AND (far_distance < near_distance)) {
+        near_child = node->offset;
+        far_child  = n+1;
+      }
+      if (far_hit AND near_hit) {
+        DEBUG_ASSERT (num_stack+2 <= MAX_STACK_NODES);
+        stack[num_stack++] = far_child;
+        stack[num_stack++] = near_child;
+      }
+      else if (near_hit)
+        stack[num_stack++] = n+1;
+      else if (far_hit)
+        stack[num_stack++] = node->offset;
+    }
+  }
+
+  if (hit->instance != -1)
+    return (gxRELATION_INTERSECT);
+  else
+    return (gxRELATION_OUTSIDE);
+}
+
+/*____________________________________________________________________
+|
+| Function: Intersect_Ray_Instance
+|
+| Input: Called from gx3d_Scenetree_Intersect_Ray()
+| Output: Intersects a world space ray with the boxtree of an instance.
+|   If the ray hits a poly nearer than ray_length, updates hit and
+|   returns true.
+|___________________________________________________________________*/
+
+static bool Intersect_Ray_Instance (
+  gx3dScenetree    *scenetree,
+  int               instance,
+  gx3dRay          *ray,
+  float             ray_length,
+  gx3dScenetreeHit *hit )
+{
+  float scale, object_ray_length;
+  gx3dRay object_ray;
+  gx3dBoxtreeRayHit boxtree_hit;
+  gx3dScenetreeInstance *inst = &(scenetree->instance[instance]);
+
+  // Transform ray into object space
+  gx3d_MultiplyVectorMatrix       (&(ray->origin),    &(inst->inverse_transform), &(object_ray.origin));
+  gx3d_MultiplyNormalVectorMatrix (&(ray->direction), &(inst->inverse_transform), &(object_ray.direction));
+  gx3d_NormalizeVector (&(object_ray.direction), &(object_ray.direction), &scale);
+  if (scale == 0)
+    return (false);
+  // Distances in object space are scale times distances in world space
+  object_ray_length = ray_length * scale;
+
+  if (gx3d_Boxtree_Intersect_Rays (inst->boxtree, &object_ray, &object_ray_length, 1, &boxtree_hit) == 0)
+    return (false);
+  if (boxtree_hit.distance / scale >= ray_length)
+    return (false);
+
+  hit->instance = instance;
+  hit->poly     = boxtree_hit.poly;
+  hit->layer    = boxtree_hit.layer;
+  hit->distance = boxtree_hit.distance / scale;
+  gx3d_MultiplyVectorMatrix (&(boxtree_hit.intersection), &(inst->transform), &(hit->point));
+
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Scenetree_Intersect_Sphere
+|
+| Output: Finds the instances in a scenetree with geometry intersecting
+|   a sphere.  Returns # of instances.  If hit is not NULL, returns the
+|   poly (of any instance) nearest the sphere center.
+|___________________________________________________________________*/
+
+int gx3d_Scenetree_Intersect_Sphere (
+  gx3dScenetree    *scenetree,
+  gx3dSphere       *sphere,
+  gx3dScenetreeHit *hit )
+{
+  int i, n, num_stack, count;
+  int stack[MAX_STACK_NODES];
+  float radius_squared;
+  gx3dScenetreeHit nearest;
+  gx3dScenetreeNode *node;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (scenetree);
+  DEBUG_ASSERT (sphere);
+
+/*____________________________________________________________________
+|
+| Init variables
+|___________________________________________________________________*/
+
+  if (scenetree->rebuild OR scenetree->dirty)
+    gx3d_Scenetree_Update (scenetree);
+
+  count = 0;
+  nearest.instance = -1;
+  nearest.distance = sphere->radius;
+  radius_squared = sphere->radius * sphere->radius;
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  num_stack = 0;
+  if (scenetree->num_nodes)
+    stack[num_stack++] = 0;
+
+  while (num_stack) {
+    n = stack[--num_stack];
+    node = &(scenetree->node[n]);
+    if (gx3d_DistanceSquared_Point_Box (&(sphere->center), &(node->box)) > radius_squared)
+      continue;
+    // Is this a terminal node?
+    if (node->num_instances) {
+      for (i=node->offset; i<(int)(node->offset+node->num_instances); i++)
+        if (gx3d_DistanceSquared_Point_Box (&(sphere->center), &(scenetree->instance[scenetree->instance_index[i]].box)) <= radius_squared)
+          if (Intersect_Sphere_Instance (scenetree, scenetree->instance_index[i], sphere, &nearest))
+            count++;
+    }
+    else {
+      DEBUG_ASSERT (num_stack+2 <= MAX_STACK_NODES);
+      stack[num_stack++] = node->offset;
+      stack[num_stack++] = n+1;
+    }
+  }
+
+  if (hit)
+    *hit = nearest;
+
+  return (count);
+}
+
+/*____________________________________________________________________
+|
+| Function: Intersect_Sphere_Instance
+|
+| Input: Called from gx3d_Scenetree_Intersect_Sphere()
+| Output: Intersects a world space sphere with the boxtree of an
+|   instance.  Returns true if any poly intersects the sphere.  Updates
+|   hit if a poly is nearer the sphere center than hit->distance.
+|___________________________________________________________________*/
+
+static bool Intersect_Sphere_Instance (
+  gx3dScenetree    *scenetree,
+  int               instance,
+  gx3dSphere       *sphere,
+  gx3dScenetreeHit *hit )
+{
+  int i, n;
+  float distance;
+  gx3dSphere object_sphere;
+  gx3dVector point, v;
+  gx3dBoxtreeContact contact[MAX_CONTACTS], *contacts;
+  gx3dScenetreeInstance *inst = &(scenetree->instance[instance]);
+
+  // Transform sphere into object space
+  gx3d_MultiplyVectorMatrix (&(sphere->center), &(inst->inverse_transform), &(object_sphere.center));
+  object_sphere.radius = sphere->radius / inst->scale;
+
+  n = gx3d_Boxtree_Intersect_Sphere (inst->boxtree, &object_sphere, contact, MAX_CONTACTS);
+  if (n == 0)
+    return (false);
+
+  // Need all contacts to find the nearest
+  contacts = contact;
+  if (n > MAX_CONTACTS) {
+    contacts = (gx3dBoxtreeContact *) malloc (n * sizeof(gx3dBoxtreeContact));
+    if (contacts)
+      gx3d_Boxtree_Intersect_Sphere (inst->boxtree, &object_sphere, contacts, n);
+    else {
+      contacts = contact;
+      n = MAX_CONTACTS;
+    }
+  }
+
+  for (i=0; i<n; i++) {
+    gx3d_MultiplyVectorMatrix (&(contacts[i].point), &(inst->transform), &point);
+    gx3d_SubtractVector (&point, &(sphere->center), &v);
+    distance = sqrtf (gx3d_VectorDotProduct (&v, &v));
+    if ((distance < hit->distance) OR (hit->instance == -1)) {
+      hit->instance = instance;
+      hit->poly     = contacts[i].poly;
+      hit->layer    = contacts[i].layer;
+      hit->distance = distance;
+      hit->point    = point;
+    }
+  }
+
+  if (contacts != contact)
+    free (contacts);
+
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_Scenetree_Intersect_Frustum
+|
+| Output: Finds the instances in a scenetree whose bound box is in (or
+|   intersects) a view frustum.  Returns # of instances.  Instance ids
+|   are returned for the first max_instances found.
+|
+|   Planes a node is found to be inside of are not tested again for its
+|   children, and nodes entirely inside the frustum are not tested at
+|   all.
+|___________________________________________________________________*/
+
+int gx3d_Scenetree_Intersect_Frustum (
+  gx3dScenetree    *scenetree,
+  gx3dWorldFrustum *wf,
+  int              *instances,
+  int               max_instances )
+{
+  int i, n, num_stack, count;
+  Frustum_Stack_Entry stack[MAX_STACK_NODES];
+  gx3dFrustumOrientation orientation, instance_orientation;
+  gx3dScenetreeNode *node;
+
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (scenetree);
+  DEBUG_ASSERT (wf);
+  DEBUG_ASSERT (instances OR (max_instances == 0));
+
+/*____________________________________________________________________
+|
+| Init variables
+|___________________________________________________________________*/
+
+  if (scenetree->rebuild OR scenetree->dirty)
+    gx3d_Scenetree_Update (scenetree);
+
+  count = 0;
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  num_stack = 0;
+  if (scenetree->num_nodes) {
+    memset (&(stack[0].orientation), 0, sizeof(gx3dFrustumOrientation));
+    stack[0].node = 0;
+    num_stack = 1;
+  }
+
+  while (num_stack) {
+    num_stack--;
+    n           = stack[num_stack].node;
+    orientation = stack[num_stack].orientation;
+    node = &(scenetree->node[n]);
+    if (gx3d_Relation_Box_Frustum (&(node->box), wf, &orientation) == gxRELATION_OUTSIDE)
+      continue;
+    // Is this a terminal node?
+    if (node->num_instances) {
+      for (i=node->offset; i<(int)(node->offset+node->num_instances); i++) {
+        instance_orientation = orientation;
+        if (gx3d_Relation_Box_Frustum (&(scenetree->instance[scenetree->instance_index[i]].box), wf, &instance_orientation) != gxRELATION_OUTSIDE) {
+          if (count < max_instances)
+            instances[count] = scenetree->instance_index[i];
+          count++;
+        }
+      }
+    }
+    else {
+      DEBUG_ASSERT (num_stack+2 <= MAX_STACK_NODES);
+      stack[num_stack].node          = node->offset;
+      stack[num_stack].orientation   = orientation;
+      stack[num_stack+1].node        = n+1;
+      stack[num_stack+1].orientation = orientation;
+      num_stack += 2;
+    }
+  }
+
+  return (count);
+}
@@ -61,7 +61,7 @@ static gx3dSkeletonBone *Get_Bone_With_Name (gx3dSkeletonBone *bone, char *name)
 static void Update_Bone_Transforms (
   gx3dSkeleton		 *skel, 
   gx3dSkeletonBone *bone, 
-  gx3dMatrix			 *parent_matrix, 
+  gx3dAffineMatrix *parent_matrix, 
   bool							parent_transform_dirty );
 
 /*___________________
@@ -121,8 +121,8 @@ gx3dSkeleton *gx3d_Skeleton_Init (
       // Copy array of vertices?
       memcpy ((void *)(skel->vertex), (void *)vertices, num_vertices * sizeof(gx3dVector));
       // Init root transform to identity
-      gx3d_GetIdentityMatrix (&(skel->root_transform.local_matrix));
-      gx3d_GetIdentityMatrix (&(skel->root_transform.composite_matrix));
+      gx3d_GetIdentityAffineMatrix (&(skel->root_transform.local_matrix));
+      gx3d_GetIdentityAffineMatrix (&(skel->root_transform.composite_matrix));
     }
   }
 
@@ -202,8 +202,8 @@ void gx3d_Skeleton_AddBone (
       bone->start_point = start_point;
       bone->end_point   = end_point;
       // Init transform
-      gx3d_GetIdentityMatrix (&(bone->transform.local_matrix));
-      gx3d_GetIdentityMatrix (&(bone->transform.composite_matrix));
+      gx3d_GetIdentityAffineMatrix (&(bone->transform.local_matrix));
+      gx3d_GetIdentityAffineMatrix (&(bone->transform.composite_matrix));
 			// Count number of object layers that use this bone (have a weightmap with same name as bone)
 			n = 0;
 			Count_Layers_Using_Bone (object->layer, bone->name, &n);
@@ -679,6 +679,7 @@ static gx3dSkeletonBone *Get_Bone_With_Name (gx3dSkeletonBone *bone, char *name)
 
 void gx3d_Skeleton_SetMatrix (gx3dObject *object, gx3dMatrix *m)
 {
+  gx3dAffineMatrix a;
 
 /*____________________________________________________________________
 |
@@ -695,9 +696,10 @@ void gx3d_Skeleton_SetMatrix (gx3dObject *object, gx3dMatrix *m)
 |___________________________________________________________________*/
 
   // Is the new matrix different from the current local matrix?
-  if (memcmp ((void *)&(SKELETON_TRANSFORM.local_matrix), (void *)m, sizeof(gx3dMatrix)) != 0) {
+  gx3d_MatrixToAffineMatrix (m, &a);
+  if (memcmp ((void *)&(SKELETON_TRANSFORM.local_matrix), (void *)&a, sizeof(gx3dAffineMatrix)) != 0) {
     // Set new local matrix
-    memcpy ((void *)&(SKELETON_TRANSFORM.local_matrix), (void *)m, sizeof(gx3dMatrix));
+    memcpy ((void *)&(SKELETON_TRANSFORM.local_matrix), (void *)&a, sizeof(gx3dAffineMatrix));
     SKELETON_TRANSFORM.dirty = true;
   }
 }
@@ -712,6 +714,7 @@ void gx3d_Skeleton_SetMatrix (gx3dObject *object, gx3dMatrix *m)
 void gx3d_Skeleton_SetBoneMatrix (gx3dSkeletonBone *bone, gx3dMatrix *m)
 {
   gx3dMatrix m1, m2;
+  gx3dAffineMatrix a;
 
 /*____________________________________________________________________
 |
@@ -726,16 +729,19 @@ void gx3d_Skeleton_SetBoneMatrix (gx3dSkeletonBone *bone, gx3dMatrix *m)
 | Main procedure
 |___________________________________________________________________*/
 
-  if (bone)
+  if (bone) {
     // Is the new matrix different from the current local matrix?
-    if (memcmp ((void *)&(BONE_TRANSFORM.local_matrix), (void *)m, sizeof(gx3dMatrix)) != 0) {
+    gx3d_MatrixToAffineMatrix (m, &a);
+    if (memcmp ((void *)&(BONE_TRANSFORM.local_matrix), (void *)&a, sizeof(gx3dAffineMatrix)) != 0) {
       // Set new local matrix
       gx3d_GetTranslateMatrix (&m1, -bone->pivot.x, -bone->pivot.y, -bone->pivot.z);
       gx3d_GetTranslateMatrix (&m2,  bone->pivot.x,  bone->pivot.y,  bone->pivot.z);
       gx3d_MultiplyMatrix (&m1, m, &m1);
-      gx3d_MultiplyMatrix (&m1, &m2, &(BONE_TRANSFORM.local_matrix));
+      gx3d_MultiplyMatrix (&m1, &m2, &m1);
+      gx3d_MatrixToAffineMatrix (&m1, &(BONE_TRANSFORM.local_matrix));
       BONE_TRANSFORM.dirty = true;
     }
+  }
 }
 
 /*____________________________________________________________________
@@ -769,7 +775,7 @@ void gx3d_Skeleton_UpdateTransforms (gx3dObject *object)
 static void Update_Bone_Transforms (
   gx3dSkeleton		 *skel, 
   gx3dSkeletonBone *bone, 
-  gx3dMatrix			 *parent_matrix, 
+  gx3dAffineMatrix *parent_matrix, 
   bool							parent_transform_dirty )
 {
 	int i;
@@ -792,13 +798,13 @@ static void Update_Bone_Transforms (
     // Update bone transform?
     if (bone->transform.dirty OR parent_transform_dirty) {
       // Composite matrix = local matrix * parent matrix
-      gx3d_MultiplyMatrix (&(bone->transform.local_matrix), parent_matrix, &(bone->transform.composite_matrix));
+      gx3d_MultiplyAffineMatrix (&(bone->transform.local_matrix), parent_matrix, &(bone->transform.composite_matrix));
       bone->transform.dirty = true;
 			// Is the skeleton attached to the object?
 			if (skel->attached) 
 				// Copy bone matrix to each of the layer's matrix palette, if any
 				for (i=0; i<bone->num_nonlocal_matrices; i++)
-					*(bone->nonlocal_matrices[i]) = bone->transform.composite_matrix;
+					gx3d_AffineMatrixToMatrix (&(bone->transform.composite_matrix), bone->nonlocal_matrices[i]);
     }
     // Update child bones transforms
     if (bone->child)
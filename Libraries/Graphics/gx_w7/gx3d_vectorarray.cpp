@@ -0,0 +1,393 @@
+/*____________________________________________________________________
+|
+| File: gx3d_vectorarray.cpp
+|
+| Description: Functions to transform arrays of vectors by a matrix.
+|
+| Functions: gx3d_VectorArray_InitThreads
+|            gx3d_VectorArray_FreeThreads
+|            gx3d_MultiplyVectorArrayMatrix
+|             Transform_Array
+|            gx3d_MultiplyNormalArrayMatrix
+|             Transform_Array
+|            gx3d_MultiplyVector4DArrayMatrix
+|             Transform_Array
+|              Transform_Chunk
+|               Transform_Range
+|
+| Description: These functions give the same results as calling
+|   gx3d_MultiplyVectorMatrix(), gx3d_MultiplyNormalVectorMatrix() or
+|   gx3d_MultiplyVector4DMatrix() for each vector, without the cost of
+|   a call and reloading the matrix for each one.  The vectors can be
+|   packed or spread out by a stride (for example the positions in an
+|   array of vertex structures).
+|
+|   If gx3d_VectorArray_InitThreads() has been called, large arrays are
+|   split into chunks that are handed out to a pool of worker threads
+|   (plus the calling thread, see gx3d_jobpool.cpp).  Only one array is split at a time.  If
+|   another thread is already using the pool, the array is transformed
+|   on the calling thread.
+|
+| (C) Copyright 2017 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|
+| DEBUG_ASSERTED!
+|___________________________________________________________________*/
+
+//#define DEBUG
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+
+#include <math.h>
+#include <xmmintrin.h>
+
+#include "dp.h"
+
+#include "gx3d_jobpool.h"
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define CHUNK_VECTORS           4096    // # vectors transformed as one unit of work
+#define PARALLEL_MIN_VECTORS    32768   // transform fewer vectors than this on the calling thread
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+enum Transform_Type {
+  TRANSFORM_VECTOR,
+  TRANSFORM_NORMAL,
+  TRANSFORM_VECTOR4D
+};
+
+// An array to transform
+typedef struct {
+  Transform_Type  type;
+  char           *v;
+  int             v_stride;
+  gx3dMatrix     *m;
+  char           *vresult;
+  int             vresult_stride;
+  int             num_vectors;
+  bool            use_sse;
+} Job;
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static void Transform_Array (
+  Transform_Type  type,
+  void           *v,
+  int             v_stride,
+  gx3dMatrix     *m,
+  void           *vresult,
+  int             vresult_stride,
+  int             num_vectors );
+static void Transform_Chunk (void *job, int chunk);
+static void Transform_Range (Job *job, int first, int last);
+
+/*___________________
+|
+| Global variables
+|__________________*/
+
+static gx3dJobPool *Threads = 0;   // worker thread pool, if any
+
+/*____________________________________________________________________
+|
+| Function: gx3d_VectorArray_InitThreads
+|
+| Output: Starts a pool of worker threads used to transform large
+|   arrays, so num_threads threads (including the calling thread) work
+|   on each one.  If num_threads is 0, uses one thread per processor.
+|   Returns true on success.
+|
+|   Call once at startup, not while any array is being transformed.
+|___________________________________________________________________*/
+
+bool gx3d_VectorArray_InitThreads (int num_threads)
+{
+/*____________________________________________________________________
+|
+| Verify input params
+|___________________________________________________________________*/
+
+  DEBUG_ASSERT (num_threads >= 0);
+  DEBUG_ASSERT (Threads == 0);
+
+/*____________________________________________________________________
+|
+| Main procedure
+|___________________________________________________________________*/
+
+  Threads = gx3d_JobPool_Init (num_threads);
+
+  return (Threads != 0);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_VectorArray_FreeThreads
+|
+| Output: Stops the worker threads started by
+|   gx3d_VectorArray_InitThreads(), if any.  Call once at shutdown, not
+|   while any array is being transformed.
+|___________________________________________________________________*/
+
+void gx3d_VectorArray_FreeThreads ()
+{
+  gx3d_JobPool_Free (Threads);
+  Threads = 0;
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_MultiplyVectorArrayMatrix
+|
+| Output: Multiplies each vector v[i] * m, putting results in
+|   vresult[i].  The strides are the # bytes from one vector to the
+|   next (0 if the vectors are packed).  v and vresult can be the same
+|   array, but otherwise shouldn't overlap.
+|___________________________________________________________________*/
+
+void gx3d_MultiplyVectorArrayMatrix (
+  gx3dVector *v,
+  gx3dMatrix *m,
+  gx3dVector *vresult,
+  int         num_vectors,
+  int         v_stride,
+  int         vresult_stride )
+{
+  DEBUG_ASSERT (v OR (num_vectors == 0));
+  DEBUG_ASSERT (m);
+  DEBUG_ASSERT (vresult OR (num_vectors == 0));
+  DEBUG_ASSERT (num_vectors >= 0);
+  DEBUG_ASSERT (v_stride >= 0);
+  DEBUG_ASSERT (vresult_stride >= 0);
+
+  if (v_stride == 0)
+    v_stride = sizeof(gx3dVector);
+  if (vresult_stride == 0)
+    vresult_stride = sizeof(gx3dVector);
+  Transform_Array (TRANSFORM_VECTOR, (void *)v, v_stride, m, (void *)vresult, vresult_stride, num_vectors);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_MultiplyNormalArrayMatrix
+|
+| Output: Multiplies each normal vector v[i] * m (without translation),
+|   putting results in vresult[i].  The normals are not renormalized.
+|   See gx3d_MultiplyVectorArrayMatrix() for the strides.
+|___________________________________________________________________*/
+
+void gx3d_MultiplyNormalArrayMatrix (
+  gx3dVector *v,
+  gx3dMatrix *m,
+  gx3dVector *vresult,
+  int         num_vectors,
+  int         v_stride,
+  int         vresult_stride )
+{
+  DEBUG_ASSERT (v OR (num_vectors == 0));
+  DEBUG_ASSERT (m);
+  DEBUG_ASSERT (vresult OR (num_vectors == 0));
+  DEBUG_ASSERT (num_vectors >= 0);
+  DEBUG_ASSERT (v_stride >= 0);
+  DEBUG_ASSERT (vresult_stride >= 0);
+
+  if (v_stride == 0)
+    v_stride = sizeof(gx3dVector);
+  if (vresult_stride == 0)
+    vresult_stride = sizeof(gx3dVector);
+  Transform_Array (TRANSFORM_NORMAL, (void *)v, v_stride, m, (void *)vresult, vresult_stride, num_vectors);
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_MultiplyVector4DArrayMatrix
+|
+| Output: Multiplies each 4D vector v[i] * m, putting results in
+|   vresult[i].  See gx3d_MultiplyVectorArrayMatrix() for the strides.
+|___________________________________________________________________*/
+
+void gx3d_MultiplyVector4DArrayMatrix (
+  gx3dVector4D *v,
+  gx3dMatrix   *m,
+  gx3dVector4D *vresult,
+  int           num_vectors,
+  int           v_stride,
+  int           vresult_stride )
+{
+  DEBUG_ASSERT (v OR (num_vectors == 0));
+  DEBUG_ASSERT (m);
+  DEBUG_ASSERT (vresult OR (num_vectors == 0));
+  DEBUG_ASSERT (num_vectors >= 0);
+  DEBUG_ASSERT (v_stride >= 0);
+  DEBUG_ASSERT (vresult_stride >= 0);
+
+  if (v_stride == 0)
+    v_stride = sizeof(gx3dVector4D);
+  if (vresult_stride == 0)
+    vresult_stride = sizeof(gx3dVector4D);
+  Transform_Array (TRANSFORM_VECTOR4D, (void *)v, v_stride, m, (void *)vresult, vresult_stride, num_vectors);
+}
+
+/*____________________________________________________________________
+|
+| Function: Transform_Array
+|
+| Input: Called from gx3d_MultiplyVectorArrayMatrix(),
+|   gx3d_MultiplyNormalArrayMatrix(), gx3d_MultiplyVector4DArrayMatrix()
+| Output: Transforms an array of vectors, using the worker threads if
+|   the array is large enough and the threads are free.
+|___________________________________________________________________*/
+
+static void Transform_Array (
+  Transform_Type  type,
+  void           *v,
+  int             v_stride,
+  gx3dMatrix     *m,
+  void           *vresult,
+  int             vresult_stride,
+  int             num_vectors )
+{
+  Job job;
+
+  job.type           = type;
+  job.v              = (char *)v;
+  job.v_stride       = v_stride;
+  job.m              = m;
+  job.vresult        = (char *)vresult;
+  job.vresult_stride = vresult_stride;
+  job.num_vectors    = num_vectors;
+  job.use_sse        = ((gx3d_GetCPUFeatures () & gx3d_CPU_SSE2) != 0);
+
+  // Split the array among the worker threads?
+  if (Threads AND Threads->num_workers AND (num_vectors >= PARALLEL_MIN_VECTORS))
+    gx3d_JobPool_Run (Threads, Transform_Chunk, &job, (num_vectors + CHUNK_VECTORS - 1) / CHUNK_VECTORS);
+  else
+    Transform_Range (&job, 0, num_vectors);
+}
+
+/*____________________________________________________________________
+|
+| Function: Transform_Chunk
+|
+| Input: Called from Transform_Array() (by gx3d_JobPool_Run())
+| Output: Transforms one chunk of vectors of a job.
+|___________________________________________________________________*/
+
+static void Transform_Chunk (void *job, int chunk)
+{
+  int first, last;
+  Job *data = (Job *)job;
+
+  first = chunk * CHUNK_VECTORS;
+  last  = first + CHUNK_VECTORS;
+  if (last > data->num_vectors)
+    last = data->num_vectors;
+  Transform_Range (data, first, last);
+}
+
+/*____________________________________________________________________
+|
+| Function: Transform_Range
+|
+| Input: Called from Transform_Array(), Transform_Chunk()
+| Output: Transforms vectors first to last-1 of a job.
+|
+| Description: The SSE code adds the products in the same order as the
+|   single vector functions, so gives exactly the same results.  Each
+|   vector is read before its result is written, so v and vresult can
+|   be the same array.
+|___________________________________________________________________*/
+
+static void Transform_Range (Job *job, int first, int last)
+{
+  int i;
+  char *src, *dst;
+  float *p;
+  __m128 row0, row1, row2, row3, a, r;
+
+  src = job->v       + first * job->v_stride;
+  dst = job->vresult + first * job->vresult_stride;
+
+/*____________________________________________________________________
+|
+| Use SSE
+|___________________________________________________________________*/
+
+  if (job->use_sse) {
+    row0 = _mm_loadu_ps (&(job->m->_00));
+    row1 = _mm_loadu_ps (&(job->m->_10));
+    row2 = _mm_loadu_ps (&(job->m->_20));
+    row3 = _mm_loadu_ps (&(job->m->_30));
+    switch (job->type) {
+      case TRANSFORM_VECTOR:
+        for (i=first; i<last; i++, src+=job->v_stride, dst+=job->vresult_stride) {
+          p = (float *)src;
+          r = _mm_mul_ps (_mm_load1_ps (&p[0]), row0);
+          r = _mm_add_ps (r, _mm_mul_ps (_mm_load1_ps (&p[1]), row1));
+          r = _mm_add_ps (r, _mm_mul_ps (_mm_load1_ps (&p[2]), row2));
+          r = _mm_add_ps (r, row3);
+          _mm_storel_pi ((__m64 *)dst, r);
+          _mm_store_ss (&(((float *)dst)[2]), _mm_movehl_ps (r, r));
+        }
+        break;
+      case TRANSFORM_NORMAL:
+        for (i=first; i<last; i++, src+=job->v_stride, dst+=job->vresult_stride) {
+          p = (float *)src;
+          r = _mm_mul_ps (_mm_load1_ps (&p[0]), row0);
+          r = _mm_add_ps (r, _mm_mul_ps (_mm_load1_ps (&p[1]), row1));
+          r = _mm_add_ps (r, _mm_mul_ps (_mm_load1_ps (&p[2]), row2));
+          _mm_storel_pi ((__m64 *)dst, r);
+          _mm_store_ss (&(((float *)dst)[2]), _mm_movehl_ps (r, r));
+        }
+        break;
+      case TRANSFORM_VECTOR4D:
+        for (i=first; i<last; i++, src+=job->v_stride, dst+=job->vresult_stride) {
+          a = _mm_loadu_ps ((float *)src);
+          r = _mm_mul_ps (_mm_shuffle_ps (a, a, _MM_SHUFFLE(0,0,0,0)), row0);
+          r = _mm_add_ps (r, _mm_mul_ps (_mm_shuffle_ps (a, a, _MM_SHUFFLE(1,1,1,1)), row1));
+          r = _mm_add_ps (r, _mm_mul_ps (_mm_shuffle_ps (a, a, _MM_SHUFFLE(2,2,2,2)), row2));
+          r = _mm_add_ps (r, _mm_mul_ps (_mm_shuffle_ps (a, a, _MM_SHUFFLE(3,3,3,3)), row3));
+          _mm_storeu_ps ((float *)dst, r);
+        }
+        break;
+    }
+  }
+
+/*____________________________________________________________________
+|
+| Else use the single vector functions
+|___________________________________________________________________*/
+
+  else {
+    switch (job->type) {
+      case TRANSFORM_VECTOR:
+        for (i=first; i<last; i++, src+=job->v_stride, dst+=job->vresult_stride)
+          gx3d_MultiplyVectorMatrix ((gx3dVector *)src, job->m, (gx3dVector *)dst);
+        break;
+      case TRANSFORM_NORMAL:
+        for (i=first; i<last; i++, src+=job->v_stride, dst+=job->vresult_stride)
+          gx3d_MultiplyNormalVectorMatrix ((gx3dVector *)src, job->m, (gx3dVector *)dst);
+        break;
+      case TRANSFORM_VECTOR4D:
+        for (i=first; i<last; i++, src+=job->v_stride, dst+=job->vresult_stride)
+          gx3d_MultiplyVector4DMatrix ((gx3dVector4D *)src, job->m, (gx3dVector4D *)dst);
+        break;
+    }
+  }
+}
@@ -8,6 +8,13 @@
 | Licensed under the GX Toolkit License, Version 1.0.
 |___________________________________________________________________*/
 
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define GX3DBIN_BOXTREE_ID  "BXTR"
+
 /*___________________
 |
 | Type definitions
@@ -46,3 +53,22 @@ struct gx3dBinFileMorphHeader {
 // followed by:
 //int        *index;  // array of indeces into vertex array
 //gx3dVector *offset; // array of vertex offsets
+
+struct gx3dBinFileBoxtreeHeader {
+  int         type;               // gx3dBoxtreeType
+  int         build;              // gx3dBoxtreeBuild
+  int         num_vertices;       // # vertices in all layers (must match the object)
+  int         num_polygons;       // # polygons in all layers (must match the object)
+  int         num_nodes;
+  float       build_time;         // time (ms) it took to build the bsp tree (dynamic boxtrees)
+};
+// followed by:
+//gx3dBoxtreeNode *node;  // array of nodes (depth-first order)
+//gx3dPolygon     *poly;  // array of polygons in bsp tree order (vertex indeces into all layers, child layers first)
+//gx3dBinFileBoxtreeTrailer trailer;
+
+// Last 8 bytes of a file with a boxtree chunk (the boxtree chunk is optional so older files are still readable)
+struct gx3dBinFileBoxtreeTrailer {
+  int         offset;             // file offset of boxtree header
+  char        id[4];              // GX3DBIN_BOXTREE_ID
+};
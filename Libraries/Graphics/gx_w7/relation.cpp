@@ -184,10 +184,10 @@ gxRelation gxRelation_Point_Polygon (float x, float y, gxPointF *poly, int num_p
   int i, e0, e1, inside;
   bool y0, y1;
 
-  e0 = (num_poly_points-1) * 2;
+  e0 = num_poly_points-1;
   e1 = 0;
   y0 = (poly[e0].y >= y);
-  for (i=2, inside=0; i<=(num_poly_points*2); i+=2) {
+  for (i=1, inside=0; i<=num_poly_points; i++) {
     y1 = (poly[e1].y >= y);
     if (y0 != y1)
       if (((poly[e1].y - y) * (poly[e0].x - poly[e1].x) >= (poly[e1].x - x) * (poly[e0].y - poly[e1].y)) == y1)
@@ -219,16 +219,16 @@ gxRelation gxRelation_Line_Triangle (gxPointF *p1, gxPointF *p2, gxPointF *trian
 
   // Test line for intersection with the edges of triangle
   for (i=0; i<3; i++)
-    if (gxRelation_Line_Line (p1, p2, &triangle[i], &triangle[i+1%3], NULL) == gxRELATION_INTERSECT) {
+    if (gxRelation_Line_Line (p1, p2, &triangle[i], &triangle[(i+1)%3], NULL) == gxRELATION_INTERSECT) {
       result = gxRELATION_INTERSECT;
       break;
     }
 
   // Test for line totally contained in triangle
   if (result == gxRELATION_OUTSIDE) {
-    if (gxRelation_Point_Polygon (p1->x, p1->y, triangle, 3) == gxRELATION_INTERSECT)
+    if (gxRelation_Point_Polygon (p1->x, p1->y, triangle, 3) == gxRELATION_INSIDE)
       result = gxRELATION_INTERSECT;
-    else if (gxRelation_Point_Polygon (p2->x, p2->y, triangle, 3) == gxRELATION_INTERSECT)
+    else if (gxRelation_Point_Polygon (p2->x, p2->y, triangle, 3) == gxRELATION_INSIDE)
       result = gxRELATION_INTERSECT;
   }
 
@@ -256,10 +256,10 @@ gxRelation gxRelation_Triangle_Triangle (gxPointF *triangle1, gxPointF *triangle
   gxRelation result = gxRELATION_OUTSIDE; // assume outside
 
   // Test all edges of t1 for intersection with the edges of t2
-  for (i=0; i<3; i++)
+  for (i=0; (i<3) AND (result == gxRELATION_OUTSIDE); i++)
     for (j=0; j<3; j++) 
-      if (gxRelation_Line_Line (&triangle1[i], &triangle1[i+1%3], 
-                                &triangle2[j], &triangle2[j+1%3], NULL) == gxRELATION_INTERSECT) {
+      if (gxRelation_Line_Line (&triangle1[i], &triangle1[(i+1)%3], 
+                                &triangle2[j], &triangle2[(j+1)%3], NULL) == gxRELATION_INTERSECT) {
         result = gxRELATION_INTERSECT;
         break;
       }
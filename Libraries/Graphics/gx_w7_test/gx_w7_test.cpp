@@ -0,0 +1,805 @@
+/*____________________________________________________________________
+|
+| File: gx_w7_test.cpp
+|
+| Description: Test program for gx_w7 library.  Checks the results of
+|   the optimized (packet, SIMD) functions against the plain versions
+|   and times them.
+|
+| Functions: win_Abort_Program
+|            main
+|             Test_Matrix_Multiply
+|              Create_Matrices
+|              Multiply_Matrix_Scalar
+|              Multiply_Vector_Matrix_Scalar
+|              Multiply_Vector4D_Matrix_Scalar
+|              Floats_Equal
+|             Benchmark_Matrix_Multiply
+|              Create_Matrices
+|              Print_Time
+|             Test_Ray_Triangles
+|              Random_Float
+|             Benchmark_Rays
+|              Create_Grid
+|              Create_Rays
+|              Elapsed_Time
+|             Benchmark_Hierarchy
+|              Create_Hierarchy
+|              Elapsed_Time
+|
+| (C) Copyright 2017 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+
+#include <windows.h>
+#include <winbase.h>
+#include <math.h>
+#include <string.h>
+#include <malloc.h>
+
+#include <iostream>
+using namespace std;
+
+#include <defines.h>
+#include <clib.h>
+#include <gx_w7.h>
+
+// Libraries to link in
+#pragma comment (lib, "version.lib")
+#pragma comment (lib, "winmm.lib")
+#pragma comment (lib, "dxguid.lib")
+#pragma comment (lib, "d3d9.lib")
+#pragma comment (lib, "d3dx9.lib")
+#pragma comment (lib, "dsound.lib")
+#pragma comment (lib, "dinput8.lib")
+
+#pragma comment (lib, "clib.lib")
+#pragma comment (lib, "queue.lib")
+#pragma comment (lib, "dx9.lib")
+#pragma comment (lib, "gx_w7.lib")
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define GRID_SIZE   100     // # cells on each side of the test grid
+#define NUM_RAYS    20000
+#define RAY_LENGTH  30
+
+#define NUM_MATRICES          100000
+#define MATRIX_BENCHMARK_LOOPS 20
+
+#define NUM_TRIANGLE_PACKETS 100000
+
+#define HIERARCHY_LAYERS      1365  // 6 levels of a tree with 4 children per layer
+#define HIERARCHY_LOOPS       1000
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static void        Test_Matrix_Multiply ();
+static void        Benchmark_Matrix_Multiply ();
+static bool        Create_Matrices (gx3dMatrix **m1, gx3dMatrix **m2, gx3dMatrix **mresult, gx3dVector4D **v, gx3dVector4D **vresult);
+static void        Multiply_Matrix_Scalar (gx3dMatrix *m1, gx3dMatrix *m2, gx3dMatrix *mresult);
+static void        Multiply_Vector_Matrix_Scalar (gx3dVector *v, gx3dMatrix *m, gx3dVector *vresult, bool normal);
+static void        Multiply_Vector4D_Matrix_Scalar (gx3dVector4D *v, gx3dMatrix *m, gx3dVector4D *vresult);
+static bool        Floats_Equal (void *f1, void *f2, int n);
+static void        Print_Time (char *name, float t, int n);
+static void        Test_Ray_Triangles ();
+static float       Random_Float (float min, float max);
+static void        Benchmark_Rays ();
+static gx3dObject *Create_Grid (int size);
+static void        Create_Rays (gx3dRay *rays, float *ray_lengths, int num_rays, bool coherent);
+static float       Elapsed_Time (LARGE_INTEGER *start_time);
+static void        Benchmark_Hierarchy ();
+static gx3dObject *Create_Hierarchy (int num_layers);
+
+/*____________________________________________________________________
+|
+| Function: win_Abort_Program
+|
+| Outputs: Aborts program abnormally, optionally prints a string to a
+|   message box
+|___________________________________________________________________*/
+
+void win_Abort_Program (char *str)
+{
+  exit (1);
+}
+
+/*____________________________________________________________________
+|
+| Function: main
+|
+| Outputs:
+|___________________________________________________________________*/
+
+void main ()
+{
+  Test_Matrix_Multiply ();
+  Benchmark_Matrix_Multiply ();
+  Test_Ray_Triangles ();
+  Benchmark_Rays ();
+  Benchmark_Hierarchy ();
+}
+
+/*____________________________________________________________________
+|
+| Function: Test_Matrix_Multiply
+|
+| Input: Called from main()
+| Output: Checks that the matrix and vector multiply functions (which
+|   use SSE or AVX if the cpu has them) give exactly the same results as
+|   plain C versions, including the aligned versions and a result that
+|   is the same matrix as an input.
+|___________________________________________________________________*/
+
+static void Test_Matrix_Multiply ()
+{
+  int i, matrix_bad, aligned_bad, alias_bad, vector_bad, normal_bad, vector4d_bad, vector4d_aligned_bad;
+  gx3dMatrix *m1, *m2, *mresult, mtest;
+  gx3dVector4D *v, *vresult, v4test;
+  gx3dVector v3, v3result, v3test;
+
+  cout << "Matrix multiply test (" << NUM_MATRICES << " matrices)" << endl;
+
+  if (NOT Create_Matrices (&m1, &m2, &mresult, &v, &vresult)) {
+    cout << "  Error allocating matrices" << endl;
+    return;
+  }
+
+  matrix_bad = aligned_bad = alias_bad = vector_bad = normal_bad = vector4d_bad = vector4d_aligned_bad = 0;
+  for (i=0; i<NUM_MATRICES; i++) {
+    Multiply_Matrix_Scalar (&m1[i], &m2[i], &mtest);
+    gx3d_MultiplyMatrix (&m1[i], &m2[i], &mresult[i]);
+    if (NOT Floats_Equal (&mtest, &mresult[i], 16))
+      matrix_bad++;
+    gx3d_MultiplyMatrixAligned (&m1[i], &m2[i], &mresult[i]);
+    if (NOT Floats_Equal (&mtest, &mresult[i], 16))
+      aligned_bad++;
+    // Result in place of the first matrix
+    mresult[i] = m1[i];
+    gx3d_MultiplyMatrix (&mresult[i], &m2[i], &mresult[i]);
+    if (NOT Floats_Equal (&mtest, &mresult[i], 16))
+      alias_bad++;
+
+    v3.x = v[i].x;
+    v3.y = v[i].y;
+    v3.z = v[i].z;
+    Multiply_Vector_Matrix_Scalar (&v3, &m1[i], &v3test, false);
+    gx3d_MultiplyVectorMatrix (&v3, &m1[i], &v3result);
+    if (NOT Floats_Equal (&v3test, &v3result, 3))
+      vector_bad++;
+    Multiply_Vector_Matrix_Scalar (&v3, &m1[i], &v3test, true);
+    gx3d_MultiplyNormalVectorMatrix (&v3, &m1[i], &v3result);
+    if (NOT Floats_Equal (&v3test, &v3result, 3))
+      normal_bad++;
+
+    Multiply_Vector4D_Matrix_Scalar (&v[i], &m1[i], &v4test);
+    gx3d_MultiplyVector4DMatrix (&v[i], &m1[i], &vresult[i]);
+    if (NOT Floats_Equal (&v4test, &vresult[i], 4))
+      vector4d_bad++;
+    gx3d_MultiplyVector4DMatrixAligned (&v[i], &m1[i], &vresult[i]);
+    if (NOT Floats_Equal (&v4test, &vresult[i], 4))
+      vector4d_aligned_bad++;
+  }
+
+  cout << "  gx3d_MultiplyMatrix:                " << matrix_bad << " mismatches (" << alias_bad << " with mresult = m1)" << endl;
+  cout << "  gx3d_MultiplyMatrixAligned:         " << aligned_bad << " mismatches" << endl;
+  cout << "  gx3d_MultiplyVectorMatrix:          " << vector_bad << " mismatches" << endl;
+  cout << "  gx3d_MultiplyNormalVectorMatrix:    " << normal_bad << " mismatches" << endl;
+  cout << "  gx3d_MultiplyVector4DMatrix:        " << vector4d_bad << " mismatches" << endl;
+  cout << "  gx3d_MultiplyVector4DMatrixAligned: " << vector4d_aligned_bad << " mismatches" << endl;
+
+  _aligned_free (m1);
+  _aligned_free (m2);
+  _aligned_free (mresult);
+  _aligned_free (v);
+  _aligned_free (vresult);
+}
+
+/*____________________________________________________________________
+|
+| Function: Benchmark_Matrix_Multiply
+|
+| Input: Called from main()
+| Output: Prints the time per call of the matrix and vector multiply
+|   functions and of the plain C versions.
+|___________________________________________________________________*/
+
+static void Benchmark_Matrix_Multiply ()
+{
+  int i, loop, n;
+  float t;
+  gx3dMatrix *m1, *m2, *mresult;
+  gx3dVector4D *v, *vresult;
+  LARGE_INTEGER start_time;
+
+  cout << "Matrix multiply benchmark (ns per call)" << endl;
+
+  if (NOT Create_Matrices (&m1, &m2, &mresult, &v, &vresult)) {
+    cout << "  Error allocating matrices" << endl;
+    return;
+  }
+  n = NUM_MATRICES * MATRIX_BENCHMARK_LOOPS;
+
+  QueryPerformanceCounter (&start_time);
+  for (loop=0; loop<MATRIX_BENCHMARK_LOOPS; loop++)
+    for (i=0; i<NUM_MATRICES; i++)
+      Multiply_Matrix_Scalar (&m1[i], &m2[i], &mresult[i]);
+  t = Elapsed_Time (&start_time);
+  Print_Time ("matrix (plain C)", t, n);
+
+  QueryPerformanceCounter (&start_time);
+  for (loop=0; loop<MATRIX_BENCHMARK_LOOPS; loop++)
+    for (i=0; i<NUM_MATRICES; i++)
+      gx3d_MultiplyMatrix (&m1[i], &m2[i], &mresult[i]);
+  t = Elapsed_Time (&start_time);
+  Print_Time ("gx3d_MultiplyMatrix", t, n);
+
+  QueryPerformanceCounter (&start_time);
+  for (loop=0; loop<MATRIX_BENCHMARK_LOOPS; loop++)
+    for (i=0; i<NUM_MATRICES; i++)
+      gx3d_MultiplyMatrixAligned (&m1[i], &m2[i], &mresult[i]);
+  t = Elapsed_Time (&start_time);
+  Print_Time ("gx3d_MultiplyMatrixAligned", t, n);
+
+  QueryPerformanceCounter (&start_time);
+  for (loop=0; loop<MATRIX_BENCHMARK_LOOPS; loop++)
+    for (i=0; i<NUM_MATRICES; i++)
+      Multiply_Vector_Matrix_Scalar ((gx3dVector *)&v[i], &m1[i], (gx3dVector *)&vresult[i], false);
+  t = Elapsed_Time (&start_time);
+  Print_Time ("vector (plain C)", t, n);
+
+  QueryPerformanceCounter (&start_time);
+  for (loop=0; loop<MATRIX_BENCHMARK_LOOPS; loop++)
+    for (i=0; i<NUM_MATRICES; i++)
+      gx3d_MultiplyVectorMatrix ((gx3dVector *)&v[i], &m1[i], (gx3dVector *)&vresult[i]);
+  t = Elapsed_Time (&start_time);
+  Print_Time ("gx3d_MultiplyVectorMatrix", t, n);
+
+  QueryPerformanceCounter (&start_time);
+  for (loop=0; loop<MATRIX_BENCHMARK_LOOPS; loop++)
+    for (i=0; i<NUM_MATRICES; i++)
+      Multiply_Vector4D_Matrix_Scalar (&v[i], &m1[i], &vresult[i]);
+  t = Elapsed_Time (&start_time);
+  Print_Time ("vector4D (plain C)", t, n);
+
+  QueryPerformanceCounter (&start_time);
+  for (loop=0; loop<MATRIX_BENCHMARK_LOOPS; loop++)
+    for (i=0; i<NUM_MATRICES; i++)
+      gx3d_MultiplyVector4DMatrix (&v[i], &m1[i], &vresult[i]);
+  t = Elapsed_Time (&start_time);
+  Print_Time ("gx3d_MultiplyVector4DMatrix", t, n);
+
+  QueryPerformanceCounter (&start_time);
+  for (loop=0; loop<MATRIX_BENCHMARK_LOOPS; loop++)
+    for (i=0; i<NUM_MATRICES; i++)
+      gx3d_MultiplyVector4DMatrixAligned (&v[i], &m1[i], &vresult[i]);
+  t = Elapsed_Time (&start_time);
+  Print_Time ("gx3d_MultiplyVector4DMatrixAligned", t, n);
+
+  _aligned_free (m1);
+  _aligned_free (m2);
+  _aligned_free (mresult);
+  _aligned_free (v);
+  _aligned_free (vresult);
+}
+
+/*____________________________________________________________________
+|
+| Function: Create_Matrices
+|
+| Input: Called from Test_Matrix_Multiply(), Benchmark_Matrix_Multiply()
+| Output: Allocates 16-byte aligned arrays of NUM_MATRICES matrices and
+|   4D vectors, filling in the inputs (m1, m2, v) with random values.
+|   Returns false on any error.
+|___________________________________________________________________*/
+
+static bool Create_Matrices (gx3dMatrix **m1, gx3dMatrix **m2, gx3dMatrix **mresult, gx3dVector4D **v, gx3dVector4D **vresult)
+{
+  int i, j;
+
+  *m1      = (gx3dMatrix *)   _aligned_malloc (NUM_MATRICES * sizeof(gx3dMatrix), 16);
+  *m2      = (gx3dMatrix *)   _aligned_malloc (NUM_MATRICES * sizeof(gx3dMatrix), 16);
+  *mresult = (gx3dMatrix *)   _aligned_malloc (NUM_MATRICES * sizeof(gx3dMatrix), 16);
+  *v       = (gx3dVector4D *) _aligned_malloc (NUM_MATRICES * sizeof(gx3dVector4D), 16);
+  *vresult = (gx3dVector4D *) _aligned_malloc (NUM_MATRICES * sizeof(gx3dVector4D), 16);
+  if ((*m1 == 0) OR (*m2 == 0) OR (*mresult == 0) OR (*v == 0) OR (*vresult == 0)) {
+    _aligned_free (*m1);
+    _aligned_free (*m2);
+    _aligned_free (*mresult);
+    _aligned_free (*v);
+    _aligned_free (*vresult);
+    return (false);
+  }
+
+  srand (1);
+  for (i=0; i<NUM_MATRICES; i++) {
+    for (j=0; j<16; j++) {
+      ((float *)&((*m1)[i]))[j] = Random_Float (-10, 10);
+      ((float *)&((*m2)[i]))[j] = Random_Float (-10, 10);
+    }
+    for (j=0; j<4; j++)
+      ((float *)&((*v)[i]))[j] = Random_Float (-10, 10);
+  }
+
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: Multiply_Matrix_Scalar
+|
+| Input: Called from Test_Matrix_Multiply(), Benchmark_Matrix_Multiply()
+| Output: Multiplies m1 * m2 in plain C, adding the products in the same
+|   order as gx3d_MultiplyMatrix().
+|___________________________________________________________________*/
+
+static void Multiply_Matrix_Scalar (gx3dMatrix *m1, gx3dMatrix *m2, gx3dMatrix *mresult)
+{
+  int i, j, k;
+  gx3dMatrix mtemp;
+
+  memset (&mtemp, 0, sizeof(gx3dMatrix));
+  for (i=0; i<4; i++)
+    for (j=0; j<4; j++)
+      for (k=0; k<4; k++)
+        ((float *)&mtemp)[i*4+j] += ((float *)m1)[i*4+k] * ((float *)m2)[k*4+j];
+  *mresult = mtemp;
+}
+
+/*____________________________________________________________________
+|
+| Function: Multiply_Vector_Matrix_Scalar
+|
+| Input: Called from Test_Matrix_Multiply(), Benchmark_Matrix_Multiply()
+| Output: Multiplies v * m in plain C, like gx3d_MultiplyVectorMatrix()
+|   or (if normal is true) gx3d_MultiplyNormalVectorMatrix().
+|___________________________________________________________________*/
+
+static void Multiply_Vector_Matrix_Scalar (gx3dVector *v, gx3dMatrix *m, gx3dVector *vresult, bool normal)
+{
+  gx3dVector vorig;
+
+  vorig = *v;
+  vresult->x = vorig.x * m->_00 + vorig.y * m->_10 + vorig.z * m->_20;
+  vresult->y = vorig.x * m->_01 + vorig.y * m->_11 + vorig.z * m->_21;
+  vresult->z = vorig.x * m->_02 + vorig.y * m->_12 + vorig.z * m->_22;
+  if (NOT normal) {
+    vresult->x += m->_30;
+    vresult->y += m->_31;
+    vresult->z += m->_32;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Multiply_Vector4D_Matrix_Scalar
+|
+| Input: Called from Test_Matrix_Multiply(), Benchmark_Matrix_Multiply()
+| Output: Multiplies v * m in plain C, like gx3d_MultiplyVector4DMatrix().
+|___________________________________________________________________*/
+
+static void Multiply_Vector4D_Matrix_Scalar (gx3dVector4D *v, gx3dMatrix *m, gx3dVector4D *vresult)
+{
+  gx3dVector4D vorig;
+
+  vorig = *v;
+  vresult->x = vorig.x * m->_00 + vorig.y * m->_10 + vorig.z * m->_20 + vorig.w * m->_30;
+  vresult->y = vorig.x * m->_01 + vorig.y * m->_11 + vorig.z * m->_21 + vorig.w * m->_31;
+  vresult->z = vorig.x * m->_02 + vorig.y * m->_12 + vorig.z * m->_22 + vorig.w * m->_32;
+  vresult->w = vorig.x * m->_03 + vorig.y * m->_13 + vorig.z * m->_23 + vorig.w * m->_33;
+}
+
+/*____________________________________________________________________
+|
+| Function: Floats_Equal
+|
+| Input: Called from Test_Matrix_Multiply()
+| Output: Returns true if 2 arrays of n floats are equal.
+|___________________________________________________________________*/
+
+static bool Floats_Equal (void *f1, void *f2, int n)
+{
+  int i;
+
+  for (i=0; i<n; i++)
+    if (((float *)f1)[i] != ((float *)f2)[i])
+      return (false);
+
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: Print_Time
+|
+| Input: Called from Benchmark_Matrix_Multiply()
+| Output: Prints the time per call of a function called n times in t
+|   milliseconds.
+|___________________________________________________________________*/
+
+static void Print_Time (char *name, float t, int n)
+{
+  cout << "  " << name << ": " << t * 1000000 / n << endl;
+}
+
+/*____________________________________________________________________
+|
+| Function: Test_Ray_Triangles
+|
+| Input: Called from main()
+| Output: Checks that gx3d_Intersect_Ray_Triangles() and
+|   gx3d_Intersect_Ray_TrianglesFront() return bit for bit the same
+|   hits, distances and barycentric coords as gx3d_Intersect_Ray_Triangle()
+|   and gx3d_Intersect_Ray_TriangleFront() for each triangle of a packet.
+|   Some rays are aimed at a triangle edge, where rounding decides if the
+|   ray hits.
+|___________________________________________________________________*/
+
+static void Test_Ray_Triangles ()
+{
+  int i, j, k, n, front, mask, hits, mismatches;
+  float a, distance[8], u[8], v[8], t1, u1, v1;
+  bool hit;
+  gx3dVector triangle[8][3], target;
+  gx3dRay ray;
+  gx3dTrianglePacket packet;
+  gxRelation result;
+
+  cout << "Ray/triangle packet test (" << NUM_TRIANGLE_PACKETS << " packets)" << endl;
+
+  srand (1);
+  for (front=0; front<2; front++) {
+    hits = 0;
+    mismatches = 0;
+    for (i=0; i<NUM_TRIANGLE_PACKETS; i++) {
+      // Create a packet of 1-8 random triangles
+      packet.num_triangles = 0;
+      k = 1 + rand() % 8;
+      for (j=0; j<k; j++) {
+        for (n=0; n<3; n++) {
+          triangle[j][n].x = Random_Float (-1, 1);
+          triangle[j][n].y = Random_Float (-1, 1);
+          triangle[j][n].z = Random_Float (-1, 1);
+        }
+        gx3d_SetTrianglePacket (&packet, j, &triangle[j][0], &triangle[j][1], &triangle[j][2]);
+      }
+      // Aim a ray at a point on an edge or inside the first triangle
+      a = Random_Float (0, 1);
+      if (rand() % 4 == 0) {
+        target.x = triangle[0][1].x + a * (triangle[0][2].x - triangle[0][1].x);
+        target.y = triangle[0][1].y + a * (triangle[0][2].y - triangle[0][1].y);
+        target.z = triangle[0][1].z + a * (triangle[0][2].z - triangle[0][1].z);
+      }
+      else {
+        target.x = (triangle[0][0].x + triangle[0][1].x + triangle[0][2].x) / 3 + Random_Float (-0.5f, 0.5f);
+        target.y = (triangle[0][0].y + triangle[0][1].y + triangle[0][2].y) / 3 + Random_Float (-0.5f, 0.5f);
+        target.z = (triangle[0][0].z + triangle[0][1].z + triangle[0][2].z) / 3 + Random_Float (-0.5f, 0.5f);
+      }
+      ray.origin.x = Random_Float (-4, 4);
+      ray.origin.y = Random_Float (-4, 4);
+      ray.origin.z = Random_Float (-4, 4);
+      gx3d_SubtractVector (&target, &(ray.origin), &(ray.direction));
+      gx3d_NormalizeVector (&(ray.direction), &(ray.direction));
+      // Compare each triangle with the one at a time version
+      if (front)
+        mask = gx3d_Intersect_Ray_TrianglesFront (&ray, &packet, distance, u, v);
+      else
+        mask = gx3d_Intersect_Ray_Triangles (&ray, &packet, distance, u, v);
+      for (j=0; j<k; j++) {
+        if (front)
+          result = gx3d_Intersect_Ray_TriangleFront (&ray, triangle[j], &t1, 0, &u1, &v1);
+        else
+          result = gx3d_Intersect_Ray_Triangle (&ray, triangle[j], &t1, 0, &u1, &v1);
+        hit = (result == gxRELATION_INTERSECT);
+        if (hit != ((mask & (1 << j)) != 0))
+          mismatches++;
+        else if (hit) {
+          hits++;
+          if (memcmp (&t1, &distance[j], sizeof(float)) OR memcmp (&u1, &u[j], sizeof(float)) OR memcmp (&v1, &v[j], sizeof(float)))
+            mismatches++;
+        }
+      }
+    }
+    cout << (front ? "  front only:     " : "  front and back: ");
+    cout << hits << " hits, " << mismatches << " mismatches" << endl;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Random_Float
+|
+| Input: Called from Create_Matrices(), Test_Ray_Triangles()
+| Output: Returns a random number from min to max.
+|___________________________________________________________________*/
+
+static float Random_Float (float min, float max)
+{
+  return (min + (max - min) * (rand() / (float)RAND_MAX));
+}
+
+/*____________________________________________________________________
+|
+| Function: Benchmark_Rays
+|
+| Input: Called from main()
+| Output: Measures the speed of intersecting an array of rays with a
+|   boxtree using gx3d_Boxtree_Intersect_Rays() and using a loop calling
+|   gx3d_Boxtree_Intersect_Ray() for each ray, and checks they find the
+|   same hits (bit for bit).  Uses a set of coherent rays (like a camera would cast)
+|   and a set of random rays.
+|___________________________________________________________________*/
+
+static void Benchmark_Rays ()
+{
+  int i, n, set, mismatches;
+  float t, distance, single_rays_per_sec, packet_rays_per_sec;
+  bool hit;
+  gx3dVector intersection;
+  gx3dObject *object;
+  gx3dBoxtree *boxtree;
+  gx3dRay *rays;
+  float *ray_lengths;
+  gx3dBoxtreeRayHit *hits;
+  LARGE_INTEGER start_time;
+
+  cout << "Boxtree ray benchmark (" << NUM_RAYS << " rays, " << 2*GRID_SIZE*GRID_SIZE << " polys)" << endl;
+
+  object      = Create_Grid (GRID_SIZE);
+  boxtree     = gx3d_Boxtree_Init (object, gx3d_BOXTREE_TYPE_STATIC);
+  rays        = (gx3dRay *) malloc (NUM_RAYS * sizeof(gx3dRay));
+  ray_lengths = (float *) malloc (NUM_RAYS * sizeof(float));
+  hits        = (gx3dBoxtreeRayHit *) malloc (NUM_RAYS * sizeof(gx3dBoxtreeRayHit));
+
+  if (boxtree AND rays AND ray_lengths AND hits) {
+    for (set=0; set<2; set++) {
+      Create_Rays (rays, ray_lengths, NUM_RAYS, set == 0);
+      // Time one ray at a time
+      QueryPerformanceCounter (&start_time);
+      for (i=0; i<NUM_RAYS; i++)
+        gx3d_Boxtree_Intersect_Ray (boxtree, &rays[i], ray_lengths[i], 0, &intersection, 0);
+      t = Elapsed_Time (&start_time);
+      single_rays_per_sec = 0;
+      if (t > 0)
+        single_rays_per_sec = NUM_RAYS * 1000 / t;
+      // Time packets
+      QueryPerformanceCounter (&start_time);
+      n = gx3d_Boxtree_Intersect_Rays (boxtree, rays, ray_lengths, NUM_RAYS, hits);
+      t = Elapsed_Time (&start_time);
+      packet_rays_per_sec = 0;
+      if (t > 0)
+        packet_rays_per_sec = NUM_RAYS * 1000 / t;
+      // Check both find the same hits
+      mismatches = 0;
+      for (i=0; i<NUM_RAYS; i++) {
+        hit = (gx3d_Boxtree_Intersect_Ray (boxtree, &rays[i], ray_lengths[i], &distance, &intersection, 0) == gxRELATION_INTERSECT);
+        if (hit != (hits[i].poly != -1))
+          mismatches++;
+        else if (hit AND ((distance != hits[i].distance) OR memcmp (&intersection, &(hits[i].intersection), sizeof(gx3dVector))))
+          mismatches++;
+      }
+      cout << (set == 0 ? "  coherent rays: " : "  random rays:   ");
+      cout << "single = " << (int)single_rays_per_sec << " rays/sec, packet = " << (int)packet_rays_per_sec << " rays/sec";
+      cout << " (" << n << " hits, " << mismatches << " mismatches)" << endl;
+    }
+  }
+  else
+    cout << "  Error creating boxtree" << endl;
+
+  if (hits)
+    free (hits);
+  if (ray_lengths)
+    free (ray_lengths);
+  if (rays)
+    free (rays);
+  if (boxtree)
+    gx3d_Boxtree_Free (boxtree);
+  gx3d_FreeObject (object);
+}
+
+/*____________________________________________________________________
+|
+| Function: Create_Grid
+|
+| Input: Called from Benchmark_Rays()
+| Output: Returns an object with one layer that is a bumpy grid of
+|   size x size cells (2 triangles each) in the xz plane.
+|___________________________________________________________________*/
+
+static gx3dObject *Create_Grid (int size)
+{
+  int x, z, v, p;
+  gx3dObject *object;
+  gx3dObjectLayer *layer;
+
+  object = gx3d_CreateObject ();
+  layer  = gx3d_CreateObjectLayer (object);
+
+  layer->num_vertices = (size+1) * (size+1);
+  layer->num_polygons = 2 * size * size;
+  layer->vertex       = (gx3dVector *) malloc (layer->num_vertices * sizeof(gx3dVector));
+  layer->polygon      = (gx3dPolygon *) malloc (layer->num_polygons * sizeof(gx3dPolygon));
+
+  for (z=0; z<=size; z++)
+    for (x=0; x<=size; x++) {
+      v = z*(size+1) + x;
+      layer->vertex[v].x = (float)x;
+      layer->vertex[v].y = 3 * sinf (x * 0.3f) * cosf (z * 0.2f);
+      layer->vertex[v].z = (float)z;
+    }
+  for (z=0, p=0; z<size; z++)
+    for (x=0; x<size; x++) {
+      v = z*(size+1) + x;
+      layer->polygon[p].index[0] = v;
+      layer->polygon[p].index[1] = v+size+1;
+      layer->polygon[p].index[2] = v+1;
+      p++;
+      layer->polygon[p].index[0] = v+1;
+      layer->polygon[p].index[1] = v+size+1;
+      layer->polygon[p].index[2] = v+size+2;
+      p++;
+    }
+
+  return (object);
+}
+
+/*____________________________________________________________________
+|
+| Function: Create_Rays
+|
+| Input: Called from Benchmark_Rays()
+| Output: Fills in an array of rays pointing down at the grid.  Coherent
+|   rays fan out from one point in scanline order, like a camera's.
+|   Otherwise each ray starts at a random point above the grid and
+|   points in a random downward direction.
+|___________________________________________________________________*/
+
+static void Create_Rays (gx3dRay *rays, float *ray_lengths, int num_rays, bool coherent)
+{
+  int i, width;
+
+  width = (int)sqrtf ((float)num_rays);
+
+  srand (1);
+  for (i=0; i<num_rays; i++) {
+    if (coherent) {
+      rays[i].origin.x    = GRID_SIZE / 2;
+      rays[i].origin.y    = 15;
+      rays[i].origin.z    = -10;
+      rays[i].direction.x = (i % width - width / 2) / (float)width;
+      rays[i].direction.y = -0.5f - (i / width) / (float)width;
+      rays[i].direction.z = 1;
+    }
+    else {
+      rays[i].origin.x    = GRID_SIZE * (rand() / (float)RAND_MAX);
+      rays[i].origin.y    = 6 + 4 * (rand() / (float)RAND_MAX);
+      rays[i].origin.z    = GRID_SIZE * (rand() / (float)RAND_MAX);
+      rays[i].direction.x = rand() / (float)RAND_MAX - 0.5f;
+      rays[i].direction.y = -1 - rand() / (float)RAND_MAX;
+      rays[i].direction.z = rand() / (float)RAND_MAX - 0.5f;
+    }
+    gx3d_NormalizeVector (&(rays[i].direction), &(rays[i].direction));
+    ray_lengths[i] = RAY_LENGTH;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Elapsed_Time
+|
+| Input: Called from Benchmark_Matrix_Multiply(), Benchmark_Rays(),
+|   Benchmark_Hierarchy()
+| Output: Returns the time in milliseconds since start_time.
+|___________________________________________________________________*/
+
+static float Elapsed_Time (LARGE_INTEGER *start_time)
+{
+  LARGE_INTEGER end_time, frequency;
+
+  QueryPerformanceCounter (&end_time);
+  QueryPerformanceFrequency (&frequency);
+
+  return ((float)((double)(end_time.QuadPart - start_time->QuadPart) * 1000 / (double)frequency.QuadPart));
+}
+
+/*____________________________________________________________________
+|
+| Function: Benchmark_Hierarchy
+|
+| Input: Called from main()
+| Output: Prints the time gx3d_Object_UpdateTransforms() takes to update
+|   the composite matrices of a hierarchy of layers when the object 
+|   matrix changes (so every layer is updated).
+|___________________________________________________________________*/
+
+static void Benchmark_Hierarchy ()
+{
+  int loop;
+  float t;
+  gx3dMatrix m;
+  gx3dObject *object;
+  LARGE_INTEGER start_time;
+
+  cout << "Layer hierarchy update benchmark (" << HIERARCHY_LAYERS << " layers)" << endl;
+
+  object = Create_Hierarchy (HIERARCHY_LAYERS);
+  if (object == 0) {
+    cout << "  Error creating object" << endl;
+    return;
+  }
+
+  QueryPerformanceCounter (&start_time);
+  for (loop=0; loop<HIERARCHY_LOOPS; loop++) {
+    gx3d_GetRotateYMatrix (&m, (float)(loop % 360));
+    gx3d_SetObjectMatrix (object, &m);
+    gx3d_Object_UpdateTransforms (object);
+  }
+  t = Elapsed_Time (&start_time);
+  cout << "  gx3d_Object_UpdateTransforms: " << t * 1000 / HIERARCHY_LOOPS << " us per update, ";
+  cout << t * 1000000 / ((float)HIERARCHY_LOOPS * HIERARCHY_LAYERS) << " ns per layer" << endl;
+
+  gx3d_FreeObject (object);
+}
+
+/*____________________________________________________________________
+|
+| Function: Create_Hierarchy
+|
+| Input: Called from Benchmark_Hierarchy()
+| Output: Returns an object with num_layers (empty) layers linked as a
+|   tree with 4 children per layer, each with a rotation and translation
+|   as its local matrix.  Returns 0 on any error.
+|___________________________________________________________________*/
+
+static gx3dObject *Create_Hierarchy (int num_layers)
+{
+  int i;
+  gx3dMatrix m1, m2;
+  gx3dObject *object;
+  gx3dObjectLayer **layer, *parent;
+
+  object = gx3d_CreateObject ();
+  layer  = (gx3dObjectLayer **) malloc (num_layers * sizeof(gx3dObjectLayer *));
+  if ((object == 0) OR (layer == 0)) {
+    if (object)
+      gx3d_FreeObject (object);
+    if (layer)
+      free (layer);
+    return (0);
+  }
+
+  // Create the layers (as a list)
+  for (i=0; i<num_layers; i++) {
+    layer[i] = gx3d_CreateObjectLayer (object);
+    gx3d_GetRotateZMatrix (&m1, (float)(i % 90));
+    gx3d_GetTranslateMatrix (&m2, 1, (float)(i % 4), 0);
+    gx3d_MultiplyMatrix (&m1, &m2, &m1);
+    gx3d_SetObjectLayerMatrix (object, layer[i], &m1);
+  }
+  // Relink them as a tree
+  for (i=0; i<num_layers; i++)
+    layer[i]->next = 0;
+  for (i=1; i<num_layers; i++) {
+    parent = layer[(i-1) / 4];
+    layer[i]->next = parent->child;
+    parent->child  = layer[i];
+  }
+  object->layer = layer[0];
+
+  free (layer);
+
+  return (object);
+}
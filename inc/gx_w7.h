@@ -651,6 +651,14 @@ struct gx3dProjectedTrajectory {
   gx3dVector direction; // direction normal * distance to project
 };
 
+// Up to 8 triangles in SoA layout, tested against a ray at once by gx3d_Intersect_Ray_Triangles()
+struct gx3dTrianglePacket {
+  float vertex0[3][8];  // x, y, z of first vertex of each triangle
+  float edge1[3][8];    // x, y, z of vertex 1 - vertex 0
+  float edge2[3][8];    // x, y, z of vertex 2 - vertex 0
+  int   num_triangles;  // 0-8
+};
+
 struct gx3dMatrix {
   float _00, _01, _02, _03;
   float _10, _11, _12, _13;
@@ -658,10 +666,28 @@ struct gx3dMatrix {
   float _30, _31, _32, _33;
 };
 
+// Accuracy of square root based functions (see gx3d_ReciprocalSqrt() for the max error of each)
+enum gx3dAccuracy {
+  gx3d_ACCURACY_EXACT,  // sqrt and divide
+  gx3d_ACCURACY_FAST    // SSE reciprocal sqrt estimate plus one Newton-Raphson step
+};
+
+// A 4x4 matrix with (0,0,0,1) as the last column, which isn't stored.  Stored by column.
+struct gx3dAffineMatrix {
+  float _00, _10, _20, _30;
+  float _01, _11, _21, _31;
+  float _02, _12, _22, _32;
+};
+
 struct gx3dQuaternion {
   float x, y, z, w;
 };
 
+// Quaternions stored as a separate array for each component (used by the batch quaternion functions)
+struct gx3dQuaternionStream {
+  float *x, *y, *z, *w;
+};
+
 struct gx3dCompressedQuaternion { // Compressed/decompressed using functions in QUANTIZE.CPP
   unsigned short x, y, z, w;   
 };
@@ -744,6 +770,12 @@ struct gx3dSphere {
   float       radius; // radius of bounding sphere
 };
 
+// Capsule - all points within radius of a line segment
+struct gx3dCapsule {
+  gx3dLine    segment;
+  float       radius;
+};
+
 struct gx3dFrustumOrientation {
   unsigned inside_near   : 1; // 1 = inside view Frustum, 0 = not inside (outside or possibly intersecting)
   unsigned inside_far    : 1;
@@ -767,10 +799,11 @@ struct gx3dVertexWeight {
   byte  num_weights;                            // 0 - (MAX_VERTEX_WEIGHTS-1)
 };
 
+// Hierarchy transform (affine, use gx3d_AffineMatrixToMatrix() where a gx3dMatrix is needed)
 struct gx3dTransform {
-  bool       dirty;
-  gx3dMatrix local_matrix;
-  gx3dMatrix composite_matrix;
+  bool             dirty;
+  gx3dAffineMatrix local_matrix;
+  gx3dAffineMatrix composite_matrix;
 };
 
 /*
@@ -793,6 +826,9 @@ enum gx3dFrustumPlanes {
   gx3d_FRUSTUM_PLANE_BOTTOM = 5
 };
 
+// Plane mask with a bit set for each frustum plane (bit i = plane i)
+const unsigned gx3d_FRUSTUM_PLANES_ALL = 0x3F;
+
 struct gx3dViewFrustum {
   gx3dPlane     plane[gx3d_NUM_FRUSTUM_PLANES];
   gx3dRectangle view_plane; // in view space
@@ -807,6 +843,15 @@ struct gx3dWorldFrustum {
   } box_diagonal [gx3d_NUM_FRUSTUM_PLANES];
 };
 
+// A view (camera) for frustum queries (see gx3d_InitViewContext()).  Queries given a view context
+//  only read it, so several views can be culled at the same time on different threads.
+struct gx3dViewContext {
+  gx3dMatrix      view_matrix;
+  gx3dMatrix      projection_matrix;
+  gx3dMatrix      view_projection_matrix;  // view * projection
+  gx3dViewFrustum frustum;                 // in view space
+};
+
 // Matrix palette
 struct gx3dPaletteMatrix {
   gx3dMatrix m;
@@ -868,7 +913,7 @@ struct gx3dParticleSystemData {
 
 // One entry in a bone array
 struct gx3dMotionSkeletonBone {             
-  gx3dMatrix pre, post;
+  gx3dAffineMatrix pre, post;
   char name[gx_ASCIIZ_STRING_LENGTH_LONG];  
   unsigned char parent;                     // 0xFF = root, else index into bone array
 };
@@ -987,6 +1032,7 @@ struct gx3dMotion {
   unsigned             duration;            // total duration of motion (in milliseconds)
   int                  num_bones;
   gx3dMotionBone      *bones;               // array of bones
+  bool                 fast_slerp;          // interpolate keys with the fast approximation in gx3d_GetSlerpQuaternions() (default false)
   // metadata
   int                  num_metadata;        // 0-? (num of elements in metadata array)
   gx3dMotionMetadata  *metadata;            // additional data, if any (in an array)
@@ -1039,6 +1085,30 @@ struct gx3dVertexMorph {
   float       amount;       // 0-1, 0=disabled
 };
 
+/*___________________
+|
+| gx3d Convex Hull format
+|__________________*/
+
+// Convex polyhedron (see gx3d_convexhull.cpp)
+struct gx3dConvexHull {
+  gx3dVector      *vertex;
+  int              num_vertices;
+  int             *face;              // 3 vertex indices per triangle (clockwise seen from outside)
+  int              num_faces;         // 0 if the points were all in a plane
+  int             *neighbor_start;    // index into neighbor of first neighbor of each vertex (num_vertices+1 entries)
+  int             *neighbor;          // vertices connected to each vertex by an edge
+  gx3dVector       center;            // average of vertices (a point inside the hull)
+};
+
+// Simplex from the last GJK query on a pair of hulls, used to start the next query (set num_points to 0 before the first query,
+//   ignored if a hull was rebuilt and no longer has its vertices)
+struct gx3dGJKSimplex {
+  int              num_points;
+  int              vertex1[4];        // hull1 vertex of each point
+  int              vertex2[4];        // hull2 vertex of each point
+};
+
 /*___________________
 |
 | gx3d Object format
@@ -1089,6 +1159,8 @@ struct gx3dObjectLayer {
   gx3dPaletteMatrix *matrix_palette;      // array of matrices that affect weightmaps
   int                num_matrix_palette;  // # entries in matrix palette (0-?)
 
+  gx3dConvexHull    *convex_hull;   // convex hull of vertex array, if built (see gx3d_GetLayerConvexHull())
+
   gx3dObjectLayer   *child;         // use to create a hierarchy
   gx3dObjectLayer   *next;          // use to create a linked list
   // pointer to driver-specific data
@@ -1165,17 +1237,34 @@ enum gx3dBoxtreeType {
   gx3d_BOXTREE_TYPE_DYNAMIC
 };
 
+// Method used to split nodes when building a boxtree
+enum gx3dBoxtreeBuild {
+  gx3d_BOXTREE_BUILD_MEAN,  // split largest axis at mean of poly centers (fixed max depth)
+  gx3d_BOXTREE_BUILD_SAH    // binned surface area heuristic (leaf size/cost termination)
+};
+
+// Quality statistics for a boxtree (see gx3d_Boxtree_GetStats())
+struct gx3dBoxtreeStats {
+  int   num_nodes;            // total # nodes (including leaves)
+  int   num_leaves;           
+  int   max_depth;            // root is depth 1
+  int   max_leaf_polys;       // # polys in largest leaf
+  float avg_leaf_polys;       // average # polys per leaf
+  float traversal_cost;       // expected cost of a random ray query (surface area heuristic)
+};
+
+// bsp tree node (32 bytes).  Nodes are stored in depth-first order in a single array, so the 
+//  left child of a nonterminal node is always the next node in the array.
 struct gx3dBoxtreeNode {
-  int              num_polys;         // total # polygons contained in this subtree
-  word            *poly_index;        // array of indexes into polygon arrays or 0 if not a leaf node (a splitting plane)
-//  char             axis;              // 'x', 'y', 'z'
-//  float            split;             // split position on given axis
-  gx3dBox          box;               // bound box for this node (used if this is a nonterminal node)
-  gx3dBoxtreeNode *left, *right;
+  gx3dBox          box;               // bound box for this node
+  unsigned         offset;            // terminal node: index of first poly, nonterminal node: index of right child
+  unsigned         num_polys;         // terminal node: # polys (> 0), nonterminal node: 0
 };
 
 struct gx3dBoxtree {
   gx3dBoxtreeType   type;             // static or dynamic
+  gx3dBoxtreeBuild  build;            // method used to build (and rebuild) the bsp tree
+  int               num_threads;      // # threads used to build the bsp tree (0 = one per processor)
 /***** I want to get rid of this dependency! ************/
 //  gx3dObject       *object;           // parent object (may need this for dynamic boxtree)
 /********************************************************/
@@ -1188,17 +1277,198 @@ struct gx3dBoxtree {
   gx3dBox          *poly_box;         // AAAB for each polygon
   gx3dVector       *poly_box_center;  // center of box for each polygon
   gx3dPolygon      *poly;             // array of polygons
+  // (poly arrays are in bsp tree order, each terminal node has a contiguous range of polys)
   union {
     struct {
       gx3dVector  **vertex;           // array of pointers to vertices
     } s;  // static
     struct {
-      gx3dVector   *vertex;           // array of (transformed) vertices
-      bool          dirty;            // true if updated needed
+      gx3dVector       *vertex;       // array of (transformed) vertices
+      bool              dirty;        // true if updated needed
+      gx3dObjectLayer **layer;        // array of pointers to layers supplying the vertices
+      int              *layer_vertex; // index of first vertex of each layer in vertex array
+      int               num_layers;
+      float             build_area;   // sum of node box areas when bsp tree was last built
+      float             build_time;   // time (ms) to build bsp tree
+      float             degradation;  // accumulated cost of refits since bsp tree was last built
     } d;  // dynamic
   };
   // bsp tree
-  gx3dBoxtreeNode *root;
+  gx3dBoxtreeNode  *node;             // array of nodes (node[0] is the root)
+  int               num_nodes;
+};
+
+// Result for one ray of a multiple ray query (see gx3d_Boxtree_Intersect_Rays())
+struct gx3dBoxtreeRayHit {
+  int              poly;              // index of poly hit (into boxtree poly arrays) or -1 if no hit
+  gx3dObjectLayer *layer;             // layer containing poly hit
+  float            distance;          // distance from ray origin to intersection
+  gx3dVector       intersection;
+};
+
+// Contact with one poly for sphere and capsule queries (see gx3d_Boxtree_Intersect_Sphere())
+struct gx3dBoxtreeContact {
+  int              poly;              // index of poly (into boxtree poly arrays)
+  gx3dObjectLayer *layer;             // layer containing poly
+  gx3dVector       point;             // point of contact on poly
+  gx3dVector       normal;            // contact normal (points from poly towards sphere/capsule)
+  float            depth;             // penetration depth (0 for a swept sphere contact)
+};
+
+// Pair of intersecting polys of two boxtrees (see gx3d_Boxtree_Intersect_Boxtree())
+struct gx3dBoxtreePolyPair {
+  int              poly1;             // index of poly in first boxtree (into boxtree poly arrays)
+  int              poly2;             // index of poly in second boxtree
+  gx3dObjectLayer *layer1;            // layer containing poly1
+  gx3dObjectLayer *layer2;            // layer containing poly2
+};
+
+/*___________________
+|
+| gx3d Broadphase format
+|__________________*/
+
+// Moving object in a broadphase
+struct gx3dBroadphaseProxy {
+  gx3dBox          box;               // bound box (world space)
+  void            *data;              // user data
+  int              active;            // 0 = entry not used, 1 = active, -1 = removed since last update
+};
+
+// Endpoint of a proxy bound box on one axis
+struct gx3dBroadphaseEndpoint {
+  float            value;
+  int              proxy;             // index of proxy * 2, plus 1 if this is the max endpoint
+};
+
+// Pair of proxies with overlapping bound boxes
+struct gx3dBroadphasePair {
+  int              proxy1;            // proxy1 < proxy2
+  int              proxy2;
+};
+
+// Sweep and prune broadphase
+struct gx3dBroadphase {
+  gx3dBroadphaseProxy    *proxy;      // array of proxies (index is the id returned by gx3d_Broadphase_AddBox/Sphere())
+  int                     max_proxies;
+  int                     num_proxies; // # active proxies
+  gx3dBroadphaseEndpoint *endpoint[3]; // endpoints of active proxies sorted on each axis
+  int                     num_endpoints;
+  gx3dBroadphasePair     *pair;       // all overlapping pairs
+  int                     num_pairs;
+  int                     max_pairs;  // size of pair arrays and # hash buckets (a power of 2)
+  int                    *pair_state; // change to each pair since last update
+  int                    *pair_next;  // next pair in same hash bucket or -1
+  int                    *pair_hash;  // first pair in each hash bucket or -1
+  gx3dBroadphasePair     *added_pair; // pairs that started overlapping at the last update
+  int                     num_added_pairs;
+  gx3dBroadphasePair     *removed_pair; // pairs that stopped overlapping at the last update
+  int                     num_removed_pairs;
+};
+
+/*___________________
+|
+| gx3d Hashgrid format
+|__________________*/
+
+// Uniform grid of cells hashed into buckets, for finding entities (points) near a point
+struct gx3dHashgrid {
+  float            cell_size;
+  float            inv_cell_size;
+  int              num_buckets;       // a power of 2
+  int             *bucket_start;      // index of first entity of each bucket (num_buckets+1 entries)
+  float           *x, *y, *z;         // positions of entities sorted by bucket
+  int             *entity;            // id of each entity sorted by bucket
+  unsigned        *entity_hash;       // bucket of each entity (in id order)
+  int              num_entities;
+  int              max_entities;
+};
+
+/*___________________
+|
+| gx3d Narrowphase format
+|__________________*/
+
+enum gx3dCollisionShapeType {
+  gx3d_COLLISION_SHAPE_SPHERE,
+  gx3d_COLLISION_SHAPE_BOX,
+  gx3d_COLLISION_SHAPE_PLANE,
+  gx3d_COLLISION_SHAPE_TRIANGLE
+};
+
+// Shape tested by a narrowphase (world space)
+struct gx3dCollisionShape {
+  gx3dCollisionShapeType type;
+  union {
+    gx3dSphere     sphere;
+    gx3dBox        box;
+    gx3dPlane      plane;
+    gx3dVector     triangle[3];
+  };
+  gx3dVector       movement;          // projected trajectory over the time period (0 if static)
+};
+
+// Collision between a pair of shapes found by a narrowphase
+struct gx3dContact {
+  int              pair;              // index of the pair in the pair list
+  int              shape1;            // same as the pair
+  int              shape2;
+  float            time;              // parametric collision time in the range 0-1 (0 if already intersecting)
+};
+
+// Multi-threaded narrowphase
+struct gx3dNarrowphase {
+  gx3dContact     *contact;           // contacts found by the last gx3d_Narrowphase_Collide() (in pair order)
+  int              num_contacts;
+  int              max_contacts;      // size of contact array (room for 1 contact per pair)
+  int             *chunk_contacts;    // # contacts found in each chunk of pairs
+  int              num_threads;       // # threads used (including the calling thread)
+  void            *thread_data;       // worker threads
+};
+
+/*___________________
+|
+| gx3d Scenetree format
+|__________________*/
+
+// One instance of an object in a scenetree
+struct gx3dScenetreeInstance {
+  gx3dBoxtree     *boxtree;           // boxtree of the object (object space)
+  gx3dMatrix       transform;         // object to world transform (rotation, uniform scale, translation)
+  gx3dMatrix       inverse_transform; // world to object transform
+  float            scale;             // scale of transform
+  gx3dBox          box;               // bound box in world space
+  void            *data;              // user data
+  bool             active;            // false if this entry is not used
+};
+
+// bvh node (32 bytes).  Nodes are stored in depth-first order in a single array, so the 
+//  left child of a nonterminal node is always the next node in the array.
+struct gx3dScenetreeNode {
+  gx3dBox          box;               // bound box for this node (world space)
+  unsigned         offset;            // terminal node: index of first instance (into instance_index), nonterminal node: index of right child
+  unsigned         num_instances;     // terminal node: # instances (> 0), nonterminal node: 0
+};
+
+// Two-level bvh - a bvh of object instances, each with its own boxtree
+struct gx3dScenetree {
+  gx3dScenetreeInstance *instance;    // array of instances (index is the id returned by gx3d_Scenetree_AddInstance())
+  int                    max_instances;
+  int                    num_instances; // # active instances
+  int                   *instance_index; // active instances in bvh order
+  gx3dScenetreeNode     *node;        // array of nodes (node[0] is the root)
+  int                    num_nodes;
+  bool                   rebuild;     // true if instances were added or removed
+  bool                   dirty;       // true if any instance moved
+};
+
+// Result of a scenetree query
+struct gx3dScenetreeHit {
+  int              instance;          // index of instance hit or -1 if no hit
+  int              poly;              // index of poly hit (into boxtree poly arrays of the instance)
+  gx3dObjectLayer *layer;             // layer containing poly hit
+  float            distance;          // ray: distance from ray origin, sphere: distance from sphere center (world space)
+  gx3dVector       point;             // point on poly (world space)
 };
 
 /*___________________
@@ -1664,6 +1934,12 @@ void gx3d_ComputeProjectionMatrixHV (
   float       vfov,         // vertical field of view in degrees (0.1 - 179.9)
   float       near_plane,   // in world z units
   float       far_plane );  // in world z units
+void gx3d_ComputeViewFrustum (
+  gx3dViewFrustum *vf,      // the resulting frustum (in view space)
+  float            hfov,    // horizontal field of view in degrees (0.1 - 179.9)
+  float            vfov,    // vertical field of view in degrees (0.1 - 179.9)
+  float            near_plane,
+  float            far_plane );
 
 void      gx3d_SetWorldMatrix      (gx3dMatrix *m);
 void      gx3d_GetWorldMatrix      (gx3dMatrix *m);
@@ -1687,6 +1963,20 @@ void      gx3d_GetProjectionMatrix (gx3dMatrix *m);
 
 void      gx3d_GetViewFrustum (gx3dViewFrustum *vf);
 void      gx3d_GetWorldFrustum (gx3dViewFrustum *vf, gx3dWorldFrustum *wf);
+void      gx3d_GetWorldFrustum (gx3dViewContext *context, gx3dWorldFrustum *wf);
+
+// Inits a view context that doesn't depend on the current view and projection
+void      gx3d_InitViewContext (
+  gx3dViewContext *context,
+  gx3dMatrix      *view_matrix,
+  float            hfov,          // horizontal field of view in degrees (0.1 - 179.9)
+  float            vfov,          // vertical field of view in degrees (0.1 - 179.9)
+  float            near_plane,    // in world z units
+  float            far_plane );   // in world z units
+// Changes the view matrix of a view context (keeping its projection)
+void      gx3d_SetViewContextMatrix (gx3dViewContext *context, gx3dMatrix *view_matrix);
+// Gets a copy of the default view context (the current view and projection)
+void      gx3d_GetViewContext (gx3dViewContext *context);
 
 inline void gx3d_GetIdentityMatrix         (gx3dMatrix *m);
 void      gx3d_GetTransposeMatrix        (gx3dMatrix *m, gx3dMatrix *mresult);
@@ -1716,14 +2006,29 @@ inline void gx3d_GetRotateTextureMatrix           (gx3dMatrix *m, float degrees)
 inline void gx3d_GetRotateTextureMatrixInverse    (gx3dMatrix *m, float degrees);
 
 void         gx3d_MultiplyMatrix (gx3dMatrix *m1, gx3dMatrix *m2, gx3dMatrix *mresult);
+// Same as gx3d_MultiplyMatrix() but all matrices must be 16-byte aligned (faster)
+void         gx3d_MultiplyMatrixAligned (gx3dMatrix *m1, gx3dMatrix *m2, gx3dMatrix *mresult);
 void         gx3d_MultiplyScalarMatrix (float s, gx3dMatrix *m, gx3dMatrix *mresult);
 void         gx3d_MultiplyVectorMatrix (gx3dVector *v, gx3dMatrix *m, gx3dVector *vresult);
 void         gx3d_MultiplyNormalVectorMatrix (gx3dVector *v, gx3dMatrix *m, gx3dVector *vresult);
 void         gx3d_MultiplyVector4DMatrix (gx3dVector4D *v, gx3dMatrix *m, gx3dVector4D *vresult);
+// Same as gx3d_MultiplyVector4DMatrix() but v, m and vresult must be 16-byte aligned (faster)
+void         gx3d_MultiplyVector4DMatrixAligned (gx3dVector4D *v, gx3dMatrix *m, gx3dVector4D *vresult);
 inline void  gx3d_MultiplyScalarVector (float s, gx3dVector *v, gx3dVector *vresult);
 
+void         gx3d_MatrixToAffineMatrix (gx3dMatrix *m, gx3dAffineMatrix *a);
+void         gx3d_AffineMatrixToMatrix (gx3dAffineMatrix *a, gx3dMatrix *m);
+void         gx3d_GetIdentityAffineMatrix (gx3dAffineMatrix *a);
+void         gx3d_MultiplyAffineMatrix (gx3dAffineMatrix *a1, gx3dAffineMatrix *a2, gx3dAffineMatrix *aresult);
+int          gx3d_GetInverseAffineMatrix (gx3dAffineMatrix *a, gx3dAffineMatrix *ainverse);
+void         gx3d_MultiplyVectorAffineMatrix (gx3dVector *v, gx3dAffineMatrix *a, gx3dVector *vresult);
+void         gx3d_MultiplyNormalVectorAffineMatrix (gx3dVector *v, gx3dAffineMatrix *a, gx3dVector *vresult);
+
 inline void  gx3d_NormalizeVector (gx3dVector *v, gx3dVector *normal);
 inline void  gx3d_NormalizeVector (gx3dVector *v, gx3dVector *normal, float *magnitude);
+void         gx3d_NormalizeVector (gx3dVector *v, gx3dVector *normal, gx3dAccuracy accuracy);
+void         gx3d_NormalizeVectorArray (gx3dVector *v, gx3dVector *normal, int num_vectors, gx3dAccuracy accuracy = gx3d_ACCURACY_EXACT);
+float        gx3d_ReciprocalSqrt (float x, gx3dAccuracy accuracy = gx3d_ACCURACY_EXACT);
 inline float gx3d_VectorMagnitude (gx3dVector *v);
 inline float gx3d_VectorDotProduct (gx3dVector *v1, gx3dVector *v2);
 inline float gx3d_AngleBetweenVectors (gx3dVector *v1, gx3dVector *v2);
@@ -1753,6 +2058,32 @@ void         gx3d_HeadingToYZVector (float heading, gx3dVector *v);
 void         gx3d_XZVectorToHeading (gx3dVector *v, float *heading);
 void         gx3d_YZVectorToHeading (gx3dVector *v, float *heading);
 
+// GX3D_VECTORARRAY.CPP
+bool gx3d_VectorArray_InitThreads (int num_threads = 0);  // optional, 0 = one thread per processor
+void gx3d_VectorArray_FreeThreads ();
+// Strides are # bytes from one vector to the next (0 = packed)
+void gx3d_MultiplyVectorArrayMatrix (
+  gx3dVector *v,
+  gx3dMatrix *m,
+  gx3dVector *vresult,                // can be the same as v
+  int         num_vectors,
+  int         v_stride       = 0,
+  int         vresult_stride = 0 );
+void gx3d_MultiplyNormalArrayMatrix (
+  gx3dVector *v,
+  gx3dMatrix *m,
+  gx3dVector *vresult,                // can be the same as v
+  int         num_vectors,
+  int         v_stride       = 0,
+  int         vresult_stride = 0 );
+void gx3d_MultiplyVector4DArrayMatrix (
+  gx3dVector4D *v,
+  gx3dMatrix   *m,
+  gx3dVector4D *vresult,              // can be the same as v
+  int           num_vectors,
+  int           v_stride       = 0,
+  int           vresult_stride = 0 );
+
 // GX3D_CAMERA.CPP
 void         gx3d_CameraSetPosition (gx3dVector *from, gx3dVector *to, gx3dVector *world_up, int orientation);
 void         gx3d_CameraGetCurrentPosition (gx3dVector *from, gx3dVector *to, gx3dVector *world_up);
@@ -1806,12 +2137,15 @@ void        gx3d_WriteGX3DBINFile (
   bool        output_morphs,
   bool        output_skeleton,
   bool        opengl_formatting, 
-  bool        write_textfile_version );
+  bool        write_textfile_version,
+  gx3dBoxtree *boxtree = 0 );         // optional boxtree of the object to store in the file
 void        gx3d_ReadGX3DBINFile  (
   char        *filename, 
   gx3dObject **object, 
   unsigned     vertex_format, // use gx3d_VERTEXFORMAT_... flags
   unsigned     flags );       // available flags: gx3d_DONT_COMBINE_LAYERS, gx3d_DONT_GENERATE_MIPMAPS
+// Returns boxtree stored in a GX3DBIN file attached to object (0 if the file has no boxtree or it doesn't match the object)
+gx3dBoxtree *gx3d_ReadGX3DBINBoxtree (char *filename, gx3dObject *object, int num_threads = 1);
 
 gxRelation gx3d_ObjectBoundBoxVisible (gx3dObject *object);
 gxRelation gx3d_ObjectBoundSphereVisible (gx3dObject *object);
@@ -1954,6 +2288,21 @@ inline void  gx3d_NormalizeQuaternion (gx3dQuaternion *q, gx3dQuaternion *qnorma
 void         gx3d_MultiplyVectorQuaternion (gx3dVector *v, gx3dQuaternion *q, gx3dVector *vresult);
 void         gx3d_ScaleQuaternion (gx3dQuaternion *q, float amount, gx3dQuaternion *qresult); // doesn't scale the w component
 void         gx3d_SubtractQuaternion (gx3dQuaternion *q1, gx3dQuaternion *q2, gx3dQuaternion *qresult);
+// Batch versions (qresult can be the same as from or to)
+void         gx3d_GetNlerpQuaternions (
+  gx3dQuaternionStream *from,
+  gx3dQuaternionStream *to,
+  float                 amount,
+  gx3dQuaternionStream *qresult,
+  int                   num_quaternions );
+void         gx3d_GetSlerpQuaternions (
+  gx3dQuaternionStream *from,
+  gx3dQuaternionStream *to,
+  float                 amount,
+  gx3dQuaternionStream *qresult,
+  int                   num_quaternions,
+  bool                  exact = false );  // false = fast approximation (weights within 2e-5 of exact)
+void         gx3d_GetQuaternionMatrices (gx3dQuaternionStream *q, gx3dMatrix *m, int num_quaternions);
 
 // GX3D_RELATION.CPP
        gxRelation gx3d_Relation_Point_Plane (gx3dVector *point, gx3dPlane *plane, float proximity);
@@ -1983,13 +2332,48 @@ inline gxRelation gx3d_Relation_Ray_TriangleFront (gx3dRay *ray, float ray_lengt
        gxRelation gx3d_Relation_Triangle_Triangle (gx3dVector *vertices1, gx3dVector *vertices2);
        gxRelation gx3d_Relation_Point_Frustum (gx3dVector *point);
        gxRelation gx3d_Relation_Point_Frustum (gx3dVector *point, gx3dViewFrustum *vf);
+       gxRelation gx3d_Relation_Point_Frustum (gx3dViewContext *context, gx3dVector *point);
        gxRelation gx3d_Relation_Sphere_Frustum (gx3dSphere *sphere);
        gxRelation gx3d_Relation_Sphere_Frustum (gx3dSphere *sphere, gx3dViewFrustum *vf);
+       gxRelation gx3d_Relation_Sphere_Frustum (gx3dViewContext *context, gx3dSphere *sphere);
        gxRelation gx3d_Relation_Sphere_Frustum (gx3dSphere *sphere, gx3dFrustumOrientation *orientation);
        gxRelation gx3d_Relation_Sphere_Frustum (gx3dSphere *sphere, gx3dViewFrustum *vf, gx3dFrustumOrientation *orientation);
+       gxRelation gx3d_Relation_Sphere_Frustum (gx3dViewContext *context, gx3dSphere *sphere, gx3dFrustumOrientation *orientation);
        gxRelation gx3d_Relation_Box_Frustum (gx3dBox *box, gx3dMatrix *box_transform);
+       gxRelation gx3d_Relation_Box_Frustum (gx3dViewContext *context, gx3dBox *box, gx3dMatrix *box_transform);
        gxRelation gx3d_Relation_Box_Frustum (gx3dBox *box, gx3dWorldFrustum *wf, gx3dFrustumOrientation *orientation);
 
+// GX3D_CULL.CPP
+// Returns # spheres not outside the default view frustum (same test as gx3d_Relation_Sphere_Frustum())
+int gx3d_Cull_Spheres (
+  float    *x,                        // sphere centers (world space)
+  float    *y,
+  float    *z,
+  float    *radius,
+  int       num_spheres,
+  unsigned *visible_mask,             // NULL if not needed, else (num_spheres+31)/32 words (bit i%32 of word i/32 set if sphere i visible)
+  int      *visible );                // NULL if not needed, else indices of visible spheres
+// Returns # spheres not outside the frustum of a view context (can be called from any thread)
+int gx3d_Cull_Spheres (
+  gx3dViewContext *context,
+  float           *x,
+  float           *y,
+  float           *z,
+  float           *radius,
+  int              num_spheres,
+  unsigned        *visible_mask,      // NULL if not needed
+  int             *visible );         // NULL if not needed
+// Returns # boxes not outside the frustum (same test as gx3d_Relation_Box_Frustum())
+int gx3d_Cull_Boxes (
+  gx3dWorldFrustum *wf,
+  gx3dBox          *boxes,
+  int               num_boxes,
+  unsigned          parent_mask,      // planes all boxes are known to be inside of (bit i = plane i)
+  unsigned char    *last_plane,       // NULL if not needed, else plane that last culled each box (tested first)
+  unsigned char    *inside_mask,      // NULL if not needed, else returns planes each box is entirely inside of
+  unsigned         *visible_mask,     // NULL if not needed, else (num_boxes+31)/32 words (bit i%32 of word i/32 set if box i visible)
+  int              *visible );        // NULL if not needed, else indices of visible boxes
+
 // GX3D_NEAREST.CPP
 void gx3d_Nearest_Point_Line     (gx3dVector *point, gx3dLine *line, gx3dVector *nearest_point);
 void gx3d_Nearest_Point_Ray      (gx3dVector *point, gx3dRay *ray, gx3dVector *nearest_point);
@@ -2008,6 +2392,7 @@ inline float gx3d_DistanceSquared_Point_Point (gx3dVector *p1, gx3dVector *p2);
 inline float gx3d_Distance_Point_Plane        (gx3dVector *point, gx3dPlane *plane);
 inline float gx3d_Distance_Point_Sphere       (gx3dVector *point, gx3dSphere *sphere);
        float gx3d_Distance_Point_Box          (gx3dVector *point, gx3dBox *box);
+       float gx3d_DistanceSquared_Point_Box   (gx3dVector *point, gx3dBox *box);
        float gx3d_Distance_Point_Triangle     (gx3dVector *point, gx3dVector *vertices);
 
 // GX3D_INTERSECT.CPP
@@ -2052,6 +2437,8 @@ gxRelation gx3d_Intersect_Ray_Sphere (
   gx3dVector *intersection );
 gxRelation gx3d_Intersect_Ray_Box (gx3dRay *ray, gx3dBox *box, float *distance, gx3dVector *intersection);
 gxRelation gx3d_Intersect_Ray_Box (gx3dRay *ray, float ray_length, gx3dBox *box, float *distance, gx3dVector *intersection);
+// Ray given as origin and inverse direction (distance is required)
+gxRelation gx3d_Intersect_Ray_Box (gx3dVector *origin, gx3dVector *inv_direction, float ray_length, gx3dBox *box, float *distance);
 gxRelation gx3d_Intersect_Ray_Triangle (
   gx3dRay    *ray, 
   gx3dVector *vertices, 
@@ -2082,6 +2469,20 @@ gxRelation gx3d_Intersect_Ray_TriangleFront (
   gx3dVector *intersection,
   float      *barycentric_u,
   float      *barycentric_v );
+void       gx3d_SetTrianglePacket (gx3dTrianglePacket *packet, int triangle, gx3dVector *v0, gx3dVector *v1, gx3dVector *v2);
+// Returns bit mask of triangles hit (distance, barycentric coords returned for each triangle hit, arrays of 8)
+int        gx3d_Intersect_Ray_Triangles (
+  gx3dRay            *ray,
+  gx3dTrianglePacket *packet,
+  float              *distance,
+  float              *barycentric_u = 0,
+  float              *barycentric_v = 0 );
+int        gx3d_Intersect_Ray_TrianglesFront (
+  gx3dRay            *ray,
+  gx3dTrianglePacket *packet,
+  float              *distance,
+  float              *barycentric_u = 0,
+  float              *barycentric_v = 0 );
 gxRelation gx3d_Intersect_Box_Box (gx3dBox *box1, gx3dBox *box2, gx3dBox *intersection_box);
 
 // GX3D_COLLIDE.CPP
@@ -2120,6 +2521,62 @@ gxRelation gx3d_Collide_Sphere_Sphere (
   gx3dSphere              *sphere2,
   gx3dProjectedTrajectory *ptrajectory2,
   float                   *parametric_collision_time ); // NULL if not needed
+gxRelation gx3d_Collide_Sphere_StaticBox (
+  gx3dSphere     *sphere,
+  gx3dTrajectory *trajectory,
+  float           dtime,                        // period of time sphere moves
+  gx3dBox        *static_box,
+  float          *parametric_collision_time,    // NULL if not needed
+  gx3dVector     *collision_point = 0 );        // NULL if not needed
+gxRelation gx3d_Collide_Sphere_StaticBox (
+  gx3dSphere              *sphere,
+  gx3dProjectedTrajectory *ptrajectory,
+  gx3dBox                 *static_box,
+  float                   *parametric_collision_time, // NULL if not needed
+  gx3dVector              *collision_point = 0 );     // NULL if not needed
+gxRelation gx3d_Collide_Sphere_Box (
+  gx3dSphere     *sphere,
+  gx3dTrajectory *trajectory1,
+  float           dtime,                        // period of time sphere and box move
+  gx3dBox        *box,
+  gx3dTrajectory *trajectory2,
+  float          *parametric_collision_time,    // NULL if not needed
+  gx3dVector     *collision_point = 0 );        // NULL if not needed
+gxRelation gx3d_Collide_Sphere_Box (
+  gx3dSphere              *sphere,
+  gx3dProjectedTrajectory *ptrajectory1,
+  gx3dBox                 *box,
+  gx3dProjectedTrajectory *ptrajectory2,
+  float                   *parametric_collision_time, // NULL if not needed
+  gx3dVector              *collision_point = 0 );     // NULL if not needed
+int gx3d_Collide_Sphere_StaticBoxes (
+  gx3dSphere     *sphere,
+  gx3dTrajectory *trajectory,
+  float           dtime,                        // period of time sphere moves
+  gx3dBox        *static_boxes,
+  int             num_boxes,
+  float          *parametric_collision_time,    // NULL if not needed
+  gx3dVector     *collision_point = 0 );        // NULL if not needed
+int gx3d_Collide_Sphere_StaticBoxes (
+  gx3dSphere              *sphere,
+  gx3dProjectedTrajectory *ptrajectory,
+  gx3dBox                 *static_boxes,
+  int                      num_boxes,
+  float                   *parametric_collision_time, // NULL if not needed
+  gx3dVector              *collision_point = 0 );     // NULL if not needed
+gxRelation gx3d_Collide_Sphere_StaticTriangle (
+  gx3dSphere     *sphere,
+  gx3dTrajectory *trajectory,
+  float           dtime,                        // period of time sphere moves
+  gx3dVector     *vertices,                     // 3 vertices of triangle
+  float          *parametric_collision_time,    // NULL if not needed
+  gx3dVector     *collision_point = 0 );        // NULL if not needed
+gxRelation gx3d_Collide_Sphere_StaticTriangle (
+  gx3dSphere              *sphere,
+  gx3dProjectedTrajectory *ptrajectory,
+  gx3dVector              *vertices,                  // 3 vertices of triangle
+  float                   *parametric_collision_time, // NULL if not needed
+  gx3dVector              *collision_point = 0 );     // NULL if not needed
 gxRelation gx3d_Collide_Box_StaticPlane (
   gx3dBox        *box,
   gx3dTrajectory *trajectory,
@@ -2131,6 +2588,19 @@ gxRelation gx3d_Collide_Box_StaticPlane (
   gx3dProjectedTrajectory *trajectory,
   gx3dPlane               *plane,
   float                   *parametric_collision_time ); // NULL if not needed
+gxRelation gx3d_Collide_Box_StaticSphere (
+  gx3dBox        *box,
+  gx3dTrajectory *trajectory,
+  float           dtime,                        // period of time box moves
+  gx3dSphere     *static_sphere,
+  float          *parametric_collision_time,    // NULL if not needed
+  gx3dVector     *collision_point = 0 );        // NULL if not needed
+gxRelation gx3d_Collide_Box_StaticSphere (
+  gx3dBox                 *box,
+  gx3dProjectedTrajectory *ptrajectory,
+  gx3dSphere              *static_sphere,
+  float                   *parametric_collision_time, // NULL if not needed
+  gx3dVector              *collision_point = 0 );     // NULL if not needed
 gxRelation gx3d_Collide_Box_StaticBox (
   gx3dBox        *box,
   gx3dTrajectory *trajectory,
@@ -2142,6 +2612,19 @@ gxRelation gx3d_Collide_Box_StaticBox (
   gx3dProjectedTrajectory *ptrajectory,
   gx3dBox                 *static_box,
   float                   *parametric_collision_time ); // NULL if not needed
+int gx3d_Collide_Box_StaticBoxes (
+  gx3dBox        *box,
+  gx3dTrajectory *trajectory,
+  float           dtime,                        // period of time box moves
+  gx3dBox        *static_boxes,
+  int             num_boxes,
+  float          *parametric_collision_time );  // NULL if not needed
+int gx3d_Collide_Box_StaticBoxes (
+  gx3dBox                 *box,
+  gx3dProjectedTrajectory *ptrajectory,
+  gx3dBox                 *static_boxes,
+  int                      num_boxes,
+  float                   *parametric_collision_time ); // NULL if not needed
 gxRelation gx3d_Collide_Box_Box (
   gx3dBox        *box1,
   gx3dTrajectory *trajectory1,
@@ -2174,8 +2657,21 @@ void gx3d_EncloseBoundSphere    (gx3dSphere *sphere, gx3dVector *vertices, int n
 void gx3d_EncloseBoundSphere    (gx3dSphere *sphere, gx3dSphere *sphere_to_enclose);
 
 // GX3D_BOXTREE.CPP
-gx3dBoxtree *gx3d_Boxtree_Init (gx3dObject *object, gx3dBoxtreeType type);
+gx3dBoxtree *gx3d_Boxtree_Init (gx3dObject *object, gx3dBoxtreeType type, gx3dBoxtreeBuild build = gx3d_BOXTREE_BUILD_SAH, int num_threads = 1);
+// Creates a boxtree for an object using a bsp tree built earlier (returns 0 if the tree doesn't match the object)
+gx3dBoxtree *gx3d_Boxtree_Init_Prebuilt (
+  gx3dObject      *object, 
+  gx3dBoxtreeType  type, 
+  gx3dBoxtreeBuild build,
+  gx3dBoxtreeNode *node,              // array of nodes (depth-first order)
+  int              num_nodes,
+  gx3dPolygon     *poly,              // array of polys in bsp tree order
+  int              num_polygons,
+  float            build_time = 0,    // time (ms) it took to build the tree (used to decide when to rebuild a dynamic tree)
+  int              num_threads = 1 );
 void         gx3d_Boxtree_Free (gx3dBoxtree *boxtree);
+void         gx3d_Boxtree_FreeThreads ();  // stops the threads started by multi-threaded builds (call at shutdown)
+void         gx3d_Boxtree_GetStats (gx3dBoxtree *boxtree, gx3dBoxtreeStats *stats);
 // Sets dirty bit of a dynamic boxtree to true
 void         gx3d_Boxtree_SetDirty (gx3dBoxtree *boxtree);
 void         gx3d_Boxtree_Update (gx3dBoxtree *boxtree);
@@ -2186,5 +2682,176 @@ gxRelation   gx3d_Boxtree_Intersect_Ray (
   float       *distance,        // optional
   gx3dVector  *intersection,    // optional
   char       **name );          // optional
+// Returns # rays that intersect the boxtree
+int          gx3d_Boxtree_Intersect_Rays (
+  gx3dBoxtree       *boxtree,
+  gx3dRay           *rays,
+  float             *ray_lengths,
+  int                num_rays,
+  gx3dBoxtreeRayHit *hits );      // array of num_rays results
+// Returns true if the ray hits any poly (faster than gx3d_Boxtree_Intersect_Ray() for line of sight checks)
+bool         gx3d_Boxtree_Intersect_Ray_Any (
+  gx3dBoxtree *boxtree,
+  gx3dRay     *ray,
+  float        ray_length );
+// Returns # rays that hit any poly
+int          gx3d_Boxtree_Intersect_Rays_Any (
+  gx3dBoxtree *boxtree,
+  gx3dRay     *rays,
+  float       *ray_lengths,
+  int          num_rays,
+  bool        *blocked );        // array of num_rays results
+// Returns # polys intersecting the sphere (contact info returned for the first max_contacts)
+int          gx3d_Boxtree_Intersect_Sphere (
+  gx3dBoxtree        *boxtree,
+  gx3dSphere         *sphere,
+  gx3dBoxtreeContact *contacts,       // NULL if not needed
+  int                 max_contacts );
+// Returns # polys intersecting the capsule (contact info returned for the first max_contacts)
+int          gx3d_Boxtree_Intersect_Capsule (
+  gx3dBoxtree        *boxtree,
+  gx3dCapsule        *capsule,
+  gx3dBoxtreeContact *contacts,       // NULL if not needed
+  int                 max_contacts );
+gxRelation   gx3d_Boxtree_Collide_Sphere (
+  gx3dBoxtree             *boxtree,
+  gx3dSphere              *sphere,
+  gx3dProjectedTrajectory *ptrajectory,
+  float                   *parametric_collision_time, // NULL if not needed
+  gx3dBoxtreeContact      *contact );                 // NULL if not needed
+// Returns index of the poly nearest the point or -1 if none within max_distance (0 = no limit)
+int          gx3d_Boxtree_Nearest_Point (
+  gx3dBoxtree *boxtree,
+  gx3dVector  *point,
+  gx3dVector  *nearest_point,
+  float       *distance = 0,         // NULL if not needed
+  float        max_distance = 0 );
+// Returns # pairs of intersecting polys of two boxtrees, each placed in the world by its transform (the first max_pairs are returned)
+int          gx3d_Boxtree_Intersect_Boxtree (
+  gx3dBoxtree         *boxtree1,
+  gx3dMatrix          *transform1,    // object to world transform of boxtree1
+  gx3dBoxtree         *boxtree2,
+  gx3dMatrix          *transform2,    // object to world transform of boxtree2
+  gx3dBoxtreePolyPair *pairs,         // NULL if not needed
+  int                  max_pairs );
+// Returns true if any poly of boxtree1 intersects any poly of boxtree2 (stops at the first pair found)
+bool         gx3d_Boxtree_Intersect_Boxtree_Any (
+  gx3dBoxtree *boxtree1,
+  gx3dMatrix  *transform1,
+  gx3dBoxtree *boxtree2,
+  gx3dMatrix  *transform2 );
+
+// GX3D_BROADPHASE.CPP
+gx3dBroadphase *gx3d_Broadphase_Init (int max_proxies);  // initial # proxies (grows as needed)
+void            gx3d_Broadphase_Free (gx3dBroadphase *broadphase);
+// Returns id of new proxy or -1 on any error
+int             gx3d_Broadphase_AddBox (gx3dBroadphase *broadphase, gx3dBox *box, void *data = 0);
+int             gx3d_Broadphase_AddSphere (gx3dBroadphase *broadphase, gx3dSphere *sphere, void *data = 0);
+void            gx3d_Broadphase_RemoveProxy (gx3dBroadphase *broadphase, int proxy);
+// Call when proxies move, then call gx3d_Broadphase_Update()
+void            gx3d_Broadphase_SetBoxes (
+  gx3dBroadphase *broadphase,
+  int            *proxies,            // NULL if boxes[i] is the box for proxy i
+  gx3dBox        *boxes,
+  int             num_proxies );
+void            gx3d_Broadphase_SetSpheres (
+  gx3dBroadphase *broadphase,
+  int            *proxies,            // NULL if spheres[i] is the sphere for proxy i
+  gx3dSphere     *spheres,
+  int             num_proxies );
+// Returns # pairs that started or stopped overlapping (in added_pair, removed_pair)
+int             gx3d_Broadphase_Update (gx3dBroadphase *broadphase);
+
+// GX3D_HASHGRID.CPP
+gx3dHashgrid *gx3d_Hashgrid_Init (float cell_size, int max_entities, int num_buckets = 0);  // initial # entities (grows as needed)
+void          gx3d_Hashgrid_Free (gx3dHashgrid *hashgrid);
+// Replaces all entities (id of each entity is its index in positions)
+bool          gx3d_Hashgrid_Build (gx3dHashgrid *hashgrid, gx3dVector *positions, int num_entities);
+// Returns # entities in the sphere (ids returned for the first max_entities)
+int           gx3d_Hashgrid_Intersect_Sphere (
+  gx3dHashgrid *hashgrid,
+  gx3dSphere   *sphere,
+  int          *entities,
+  int           max_entities );
+// Returns # entities in the box (ids returned for the first max_entities)
+int           gx3d_Hashgrid_Intersect_Box (
+  gx3dHashgrid *hashgrid,
+  gx3dBox      *box,
+  int          *entities,
+  int           max_entities );
+
+// GX3D_NARROWPHASE.CPP
+gx3dNarrowphase *gx3d_Narrowphase_Init (int num_threads = 0);  // 0 = one thread per processor
+void             gx3d_Narrowphase_Free (gx3dNarrowphase *narrowphase);
+// Returns # contacts (in narrowphase->contact, in pair order) or -1 on any error
+int              gx3d_Narrowphase_Collide (
+  gx3dNarrowphase    *narrowphase,
+  gx3dCollisionShape *shapes,
+  gx3dBroadphasePair *pairs,          // indices into shapes
+  int                 num_pairs );
+
+// GX3D_CONVEXHULL.CPP
+// Returns NULL on any error
+gx3dConvexHull *gx3d_ConvexHull_Init (gx3dVector *vertices, int num_vertices);
+void            gx3d_ConvexHull_Free (gx3dConvexHull *hull);
+// Builds hull of layer vertices the first time called, returns NULL on any error
+gx3dConvexHull *gx3d_GetLayerConvexHull (gx3dObjectLayer *layer);
+// Returns index of vertex farthest in direction (start_vertex is a hint, such as the last result)
+int             gx3d_ConvexHull_Support (gx3dConvexHull *hull, gx3dVector *direction, int start_vertex = 0);
+
+// GX3D_GJK.CPP
+// Transforms are layer to world (NULL = identity), simplex (if any) starts the query and is updated for the next one
+gxRelation gx3d_Relation_ConvexHull_ConvexHull (
+  gx3dConvexHull *hull1,
+  gx3dMatrix     *transform1,
+  gx3dConvexHull *hull2,
+  gx3dMatrix     *transform2,
+  gx3dGJKSimplex *simplex = 0 );
+// Returns 0 if hulls overlap
+float      gx3d_Distance_ConvexHull_ConvexHull (
+  gx3dConvexHull *hull1,
+  gx3dMatrix     *transform1,
+  gx3dConvexHull *hull2,
+  gx3dMatrix     *transform2,
+  gx3dVector     *point1 = 0,         // closest point on hull1
+  gx3dVector     *point2 = 0,         // closest point on hull2
+  gx3dGJKSimplex *simplex = 0 );
+// If hulls overlap, moving hull2 by depth along normal separates them
+gxRelation gx3d_Penetration_ConvexHull_ConvexHull (
+  gx3dConvexHull *hull1,
+  gx3dMatrix     *transform1,
+  gx3dConvexHull *hull2,
+  gx3dMatrix     *transform2,
+  float          *depth,
+  gx3dVector     *normal,
+  gx3dVector     *point1 = 0,         // deepest point of hull1 in hull2
+  gx3dVector     *point2 = 0,         // deepest point of hull2 in hull1
+  gx3dGJKSimplex *simplex = 0 );
+
+// GX3D_SCENETREE.CPP
+gx3dScenetree *gx3d_Scenetree_Init (int max_instances);  // initial # instances (grows as needed)
+void           gx3d_Scenetree_Free (gx3dScenetree *scenetree);
+// Returns id of new instance or -1 on any error
+int            gx3d_Scenetree_AddInstance (gx3dScenetree *scenetree, gx3dBoxtree *boxtree, gx3dMatrix *transform, void *data = 0);
+void           gx3d_Scenetree_RemoveInstance (gx3dScenetree *scenetree, int instance);
+// Call when an instance moves (or its boxtree was updated)
+void           gx3d_Scenetree_SetInstanceTransform (gx3dScenetree *scenetree, int instance, gx3dMatrix *transform);
+void           gx3d_Scenetree_Update (gx3dScenetree *scenetree);
+gxRelation     gx3d_Scenetree_Intersect_Ray (
+  gx3dScenetree    *scenetree,
+  gx3dRay          *ray,
+  float             ray_length,
+  gx3dScenetreeHit *hit );            // nearest poly hit
+// Returns # instances with geometry intersecting the sphere
+int            gx3d_Scenetree_Intersect_Sphere (
+  gx3dScenetree    *scenetree,
+  gx3dSphere       *sphere,
+  gx3dScenetreeHit *hit );            // poly nearest the sphere center (NULL if not needed)
+// Returns # instances with bound box in the view frustum (ids returned for the first max_instances)
+int            gx3d_Scenetree_Intersect_Frustum (
+  gx3dScenetree    *scenetree,
+  gx3dWorldFrustum *wf,
+  int              *instances,
+  int               max_instances );
 
 #endif